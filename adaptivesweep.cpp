@@ -0,0 +1,167 @@
+#include "adaptivesweep.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kScaleFloor = 1e-9;
+
+// Вторая разделенная разность по трем соседним точкам, 2 f[x0, x1, x2] ~ f''
+double curvature(double xa, double ya, double xb, double yb, double xc, double yc) {
+    double left = (yb - ya) / (xb - xa);
+    double right = (yc - yb) / (xc - xb);
+    return 2.0 * (right - left) / (xc - xa);
+}
+
+// Размах величины c по уже посчитанным точкам, не меньше 1e-9 ее модуля (и 1e-9 абсолютно):
+// величина, постоянная с точностью до округления, не делит свой шум сама на себя
+double channel_scale(const std::vector<SweepSample>& samples, int c) {
+    double yMin = std::numeric_limits<double>::max(), yMax = std::numeric_limits<double>::lowest();
+    for (const SweepSample& s : samples) {
+        if (std::isfinite(s.y[c])) {
+            yMin = std::min(yMin, s.y[c]);
+            yMax = std::max(yMax, s.y[c]);
+        }
+    }
+    if (yMax < yMin) {
+        return 1.0; // допустимых значений нет
+    }
+    double magnitude = std::max({ std::abs(yMin), std::abs(yMax), 1.0 });
+    return std::max(yMax - yMin, kScaleFloor * magnitude);
+}
+
+// Оценка ошибки линейной интерполяции на интервале [i, i + 1]: наибольшая
+// кривизна по тройкам, содержащим интервал, умноженная на h^2 / 8. По нескольким
+// величинам - наибольшая из ошибок, отнесенных к размаху каждой
+std::vector<double> interval_errors(const std::vector<SweepSample>& samples, int channels) {
+    std::size_t n = samples.size();
+    std::vector<double> errors(n > 0 ? n - 1 : 0, 0.0);
+    std::vector<double> curv(n);
+    for (int c = 0; c < channels; ++c) {
+        std::fill(curv.begin(), curv.end(), std::numeric_limits<double>::quiet_NaN());
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            const SweepSample& a = samples[i - 1];
+            const SweepSample& b = samples[i];
+            const SweepSample& d = samples[i + 1];
+            if (std::isfinite(a.y[c]) && std::isfinite(b.y[c]) && std::isfinite(d.y[c])) {
+                curv[i] = std::abs(curvature(a.x, a.y[c], b.x, b.y[c], d.x, d.y[c]));
+            }
+        }
+
+        double scale = channel_scale(samples, c);
+        for (std::size_t i = 0; i + 1 < n; ++i) {
+            const SweepSample& a = samples[i];
+            const SweepSample& b = samples[i + 1];
+            if (!std::isfinite(a.y[c]) || !std::isfinite(b.y[c])) {
+                continue; // граница допустимой области не уточняется
+            }
+            double k = 0.0;
+            if (std::isfinite(curv[i])) k = std::max(k, curv[i]);
+            if (std::isfinite(curv[i + 1])) k = std::max(k, curv[i + 1]);
+            double h = b.x - a.x;
+            errors[i] = std::max(errors[i], k * h * h / 8.0 / scale);
+        }
+    }
+    return errors;
+}
+
+SweepSample make_sample(double x, const std::vector<double>& ys, std::size_t index, int channels) {
+    SweepSample sample{ x, std::vector<double>(channels, std::numeric_limits<double>::quiet_NaN()) };
+    for (int c = 0; c < channels && (index + 1) * channels <= ys.size(); ++c) {
+        sample.y[c] = ys[index * channels + c];
+    }
+    return sample;
+}
+
+} // namespace
+
+std::vector<SweepSample> adaptive_sweep(double from, double to, const SweepEvaluator& evaluate,
+                                        const AdaptiveSweepOptions& options, AdaptiveSweepReport* report) {
+    AdaptiveSweepReport localReport;
+    AdaptiveSweepReport& r = report ? *report : localReport;
+    r = AdaptiveSweepReport();
+
+    std::vector<SweepSample> samples;
+    if (!(to > from) || options.budget < 2) {
+        return samples;
+    }
+    int channels = std::max(options.channels, 1);
+
+    // Грубая сетка
+    std::size_t initial = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(options.initial_points, 2)), 2, options.budget);
+    std::vector<double> xs(initial);
+    for (std::size_t i = 0; i < initial; ++i) {
+        xs[i] = from + (to - from) * static_cast<double>(i) / static_cast<double>(initial - 1);
+    }
+    std::vector<double> ys = evaluate(xs);
+    for (std::size_t i = 0; i < initial; ++i) {
+        samples.push_back(make_sample(xs[i], ys, i, channels));
+    }
+    r.evaluations = initial;
+    r.passes = 1;
+
+    double minWidth = options.min_width * (to - from);
+    std::vector<std::size_t> candidates;
+    std::vector<SweepSample> merged;
+    while (true) {
+        // Ошибки уже отнесены к размаху, допуск - прямо доля размаха
+        std::vector<double> errors = interval_errors(samples, channels);
+        r.max_error = errors.empty() ? 0.0 : *std::max_element(errors.begin(), errors.end());
+
+        candidates.clear();
+        for (std::size_t i = 0; i < errors.size(); ++i) {
+            if (errors[i] > options.tolerance && samples[i + 1].x - samples[i].x > 2.0 * minWidth) {
+                candidates.push_back(i);
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        std::size_t remaining = options.budget - r.evaluations;
+        if (remaining == 0) {
+            r.budget_exhausted = true;
+            break;
+        }
+        // При нехватке бюджета сначала делятся интервалы с наибольшей ошибкой
+        if (candidates.size() > remaining) {
+            std::nth_element(candidates.begin(), candidates.begin() + remaining, candidates.end(),
+                             [&](std::size_t a, std::size_t b) { return errors[a] > errors[b]; });
+            candidates.resize(remaining);
+            std::sort(candidates.begin(), candidates.end());
+            r.budget_exhausted = true;
+        }
+
+        xs.clear();
+        for (std::size_t i : candidates) {
+            xs.push_back(0.5 * (samples[i].x + samples[i + 1].x));
+        }
+        ys = evaluate(xs);
+        r.evaluations += xs.size();
+        ++r.passes;
+
+        // Вставка середин с сохранением порядка по x
+        merged.clear();
+        merged.reserve(samples.size() + xs.size());
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            merged.push_back(std::move(samples[i]));
+            if (next < candidates.size() && candidates[next] == i) {
+                merged.push_back(make_sample(xs[next], ys, next, channels));
+                ++next;
+            }
+        }
+        samples.swap(merged);
+        if (r.budget_exhausted) {
+            r.max_error = 0.0;
+            for (double e : interval_errors(samples, channels)) r.max_error = std::max(r.max_error, e);
+            break;
+        }
+    }
+
+    r.min_spacing = to - from;
+    for (std::size_t i = 0; i + 1 < samples.size(); ++i) {
+        r.min_spacing = std::min(r.min_spacing, samples[i + 1].x - samples[i].x);
+    }
+    return samples;
+}
@@ -0,0 +1,43 @@
+#ifndef ADAPTIVESWEEP_H
+#define ADAPTIVESWEEP_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Адаптивная одномерная развертка: сначала грубая равномерная сетка, затем
+// интервалы, где оценка ошибки линейной интерполяции |f''| h^2 / 8 больше допуска,
+// делятся пополам. Все середины одного прохода считаются одним пакетом, поэтому
+// evaluate может идти через evaluate_batch, кэш результатов или рабочие процессы.
+// В точке может быть несколько величин (channels): интервал делится, если ошибка
+// велика хотя бы по одной из них, допуск у каждой - доля ее собственного размаха.
+
+struct AdaptiveSweepOptions {
+    int initial_points = 17;      // грубая сетка, включая концы
+    std::size_t budget = 2000;    // наибольшее число расчетов функции
+    double tolerance = 1e-3;      // допустимая ошибка в долях размаха значений
+    double min_width = 1e-6;      // интервалы уже этой доли диапазона не делятся
+    int channels = 1;             // величин в каждой точке
+};
+
+struct AdaptiveSweepReport {
+    std::size_t evaluations = 0;
+    int passes = 0;
+    double min_spacing = 0.0;     // наименьший шаг получившейся сетки
+    double max_error = 0.0;       // наибольшая оставшаяся оценка ошибки в долях размаха, как tolerance
+    bool budget_exhausted = false;
+};
+
+struct SweepSample {
+    double x;
+    std::vector<double> y; // channels величин; NaN - значение недопустимо, в оценке не участвует
+};
+
+// evaluate получает точки прохода и возвращает по channels значений на точку подряд в том же порядке
+using SweepEvaluator = std::function<std::vector<double>(const std::vector<double>&)>;
+
+// Точки по возрастанию x
+std::vector<SweepSample> adaptive_sweep(double from, double to, const SweepEvaluator& evaluate,
+                                        const AdaptiveSweepOptions& options = {}, AdaptiveSweepReport* report = nullptr);
+
+#endif // ADAPTIVESWEEP_H
@@ -0,0 +1,119 @@
+#include "analytic.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Первообразные по вертикальной скорости u для разложения по k.
+// s = sqrt(a^2 + u^2), a - горизонтальная скорость относительно ветра (постоянна в вакууме).
+struct DragIntegrals {
+    double a;
+
+    double s(double u) const { return std::sqrt(a * a + u * u); }
+    double as(double u) const { return a > 0.0 ? std::asinh(u / a) : 0.0; } // при a = 0 множитель a^2 обнуляет член
+
+    double P(double u) const { return 0.5 * u * s(u) + 0.5 * a * a * as(u); }                    // int s du
+    double Q(double u) const { double su = s(u); return su * su * su / 3.0; }                     // int s*u du
+    double PP(double u) const { double su = s(u); return su * su * su / 6.0 + 0.5 * a * a * (u * as(u) - su); } // int P du
+    double QQ(double u) const {                                                                   // int Q du
+        double a2 = a * a;
+        return (u * (2.0 * u * u + 5.0 * a2) * s(u) / 8.0 + 3.0 * a2 * a2 * as(u) / 8.0) / 3.0;
+    }
+};
+
+} // namespace
+
+double drag_ratio(const Parameters& params) {
+    State start = initial_state(params);
+    double dvx = start.vx - params.wind_x;
+    double dvz = start.vz - params.wind_z;
+    double speed2 = dvx * dvx + start.vy * start.vy + dvz * dvz;
+    return drag_factor(params) * speed2 / params.g;
+}
+
+FlightSummary vacuum_flight(const Parameters& params) {
+    State start = initial_state(params);
+    FlightSummary summary;
+    if (start.vy <= 0.0) {
+        summary.impact_speed = params.initial_speed;
+        return summary; // Снаряд сразу на земле, как и в численном расчете
+    }
+
+    double T = 2.0 * start.vy / params.g;
+    summary.max_height = start.vy * start.vy / (2.0 * params.g);
+    summary.flight_time = T;
+    summary.impact_x = start.vx * T;
+    summary.impact_z = start.vz * T;
+    summary.total_distance = std::sqrt(summary.impact_x * summary.impact_x + summary.impact_z * summary.impact_z);
+    summary.impact_speed = params.initial_speed; // vy меняет знак, горизонтальная скорость постоянна
+    return summary;
+}
+
+FlightSummary perturbed_flight(const Parameters& params) {
+    State start = initial_state(params);
+    FlightSummary summary;
+    if (start.vy <= 0.0) {
+        summary.impact_speed = params.initial_speed;
+        return summary;
+    }
+
+    // r = r0 + k * r1, где r1'' = -|w0| * w0, w0 - скорость в вакууме относительно ветра
+    double k = drag_factor(params);
+    double g = params.g;
+    double u0 = start.vy;
+    double ax = start.vx - params.wind_x;
+    double az = start.vz - params.wind_z;
+    DragIntegrals I{ std::sqrt(ax * ax + az * az) };
+
+    double P0 = I.P(u0), Q0 = I.Q(u0), PP0 = I.PP(u0), QQ0 = I.QQ(u0);
+    auto y1 = [&](double t) { return (-(I.QQ(u0 - g * t) - QQ0) / g - Q0 * t) / g; };
+    auto h1 = [&](double t) { return (-(I.PP(u0 - g * t) - PP0) / g - P0 * t) / g; }; // x1 = ax * h1, z1 = az * h1
+    auto vy1 = [&](double t) { return (I.Q(u0 - g * t) - Q0) / g; };                      // y1'
+    auto vh1 = [&](double t) { return (I.P(u0 - g * t) - P0) / g; };                      // h1'
+
+    // Время падения: y0(T0 + dT) + k * y1(T0) = 0, y0'(T0) = -u0
+    double T0 = 2.0 * u0 / g;
+    double T = T0 + k * y1(T0) / u0;
+
+    // Вершина: y0'(ta0) = 0, поэтому поправка высоты равна k * y1(ta0)
+    double ta0 = u0 / g;
+    summary.max_height = u0 * u0 / (2.0 * g) + k * y1(ta0);
+
+    double h = h1(T0);
+    summary.flight_time = T;
+    summary.impact_x = start.vx * T + k * ax * h;
+    summary.impact_z = start.vz * T + k * az * h;
+    summary.total_distance = std::sqrt(summary.impact_x * summary.impact_x + summary.impact_z * summary.impact_z);
+
+    // Скорость падения: v0(T) + k * v1(T0), поправка времени входит через vy0' = -g
+    double vh = vh1(T0);
+    double vx = start.vx + k * ax * vh;
+    double vy = u0 - g * T + k * vy1(T0);
+    double vz = start.vz + k * az * vh;
+    summary.impact_speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+    return summary;
+}
+
+FlightSummary evaluate_flight(const Parameters& params, double dt, std::size_t max_points, FlightSolver* solver) {
+    FlightSolver used = FlightSolver::Numerical;
+    FlightSummary summary;
+
+    // Замкнутые решения выведены для плоской земли y = 0 и постоянного ветра
+    double eps = active_terrain() || active_wind_field() ? std::numeric_limits<double>::infinity() : drag_ratio(params);
+    if (eps <= kVacuumDragRatio) {
+        used = FlightSolver::Vacuum;
+        summary = vacuum_flight(params);
+    } else if (eps <= kPerturbationDragRatio) {
+        used = FlightSolver::Perturbation;
+        summary = perturbed_flight(params);
+    } else {
+        summary = integrate_flight_summary(params, dt, max_points);
+    }
+
+    if (solver) {
+        *solver = used;
+    }
+    return summary;
+}
@@ -0,0 +1,33 @@
+#ifndef ANALYTIC_H
+#define ANALYTIC_H
+
+#include "simulation.h"
+#include <cstddef>
+
+// Способ, которым был получен результат полета
+enum class FlightSolver {
+    Vacuum,       // точное решение без сопротивления воздуха
+    Perturbation, // первая поправка по сопротивлению к решению в вакууме
+    Numerical     // интегрирование методом Рунге-Кутты
+};
+
+// Границы применимости быстрых путей по безразмерному параметру сопротивления
+// eps = k * |v0 - wind|^2 / g (отношение силы сопротивления к силе тяжести при выстреле).
+// Относительная ошибка дальности, высоты и времени полета: в вакууме < eps,
+// с первой поправкой < eps^2 (проверено по РК4 с шагом 1e-4). Обе границы дают
+// ошибку меньше, чем дискретизация времени падения при dt = 0.01 (~3e-3).
+constexpr double kVacuumDragRatio = 1e-6;
+constexpr double kPerturbationDragRatio = 1e-2;
+
+double drag_ratio(const Parameters& params);
+
+// Точное решение без сопротивления воздуха
+FlightSummary vacuum_flight(const Parameters& params);
+// Решение в вакууме с поправкой первого порядка по k (квадратичное сопротивление с ветром)
+FlightSummary perturbed_flight(const Parameters& params);
+
+// Выбирает самый дешевый способ расчета, укладывающийся в заявленную точность,
+// иначе интегрирует траекторию численно с шагом dt
+FlightSummary evaluate_flight(const Parameters& params, double dt, std::size_t max_points, FlightSolver* solver = nullptr);
+
+#endif // ANALYTIC_H
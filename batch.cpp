@@ -0,0 +1,206 @@
+#include "batch.h"
+#include "analytic.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Состояния kFloatLanes снарядов в виде структуры массивов, чтобы шаг РК4
+// компилятор мог векторизовать по снарядам
+struct LaneStates {
+    float x[kFloatLanes], y[kFloatLanes], z[kFloatLanes];
+    float vx[kFloatLanes], vy[kFloatLanes], vz[kFloatLanes];
+};
+
+struct LaneParams {
+    float k[kFloatLanes], g[kFloatLanes], wind_x[kFloatLanes], wind_z[kFloatLanes];
+};
+
+void lane_derivatives(const LaneStates& s, const LaneParams& p, LaneStates& d) {
+    for (int l = 0; l < kFloatLanes; ++l) {
+        float dvx = s.vx[l] - p.wind_x[l];
+        float dvy = s.vy[l];
+        float dvz = s.vz[l] - p.wind_z[l];
+        float speed = std::sqrt(dvx * dvx + dvy * dvy + dvz * dvz);
+        d.vx[l] = -p.k[l] * dvx * speed;
+        d.vy[l] = -p.g[l] - p.k[l] * dvy * speed;
+        d.vz[l] = -p.k[l] * dvz * speed;
+        d.x[l] = s.vx[l];
+        d.y[l] = s.vy[l];
+        d.z[l] = s.vz[l];
+    }
+}
+
+void lane_axpy(const LaneStates& s, float h, const LaneStates& d, LaneStates& out) {
+    for (int l = 0; l < kFloatLanes; ++l) {
+        out.x[l] = s.x[l] + h * d.x[l];
+        out.y[l] = s.y[l] + h * d.y[l];
+        out.z[l] = s.z[l] + h * d.z[l];
+        out.vx[l] = s.vx[l] + h * d.vx[l];
+        out.vy[l] = s.vy[l] + h * d.vy[l];
+        out.vz[l] = s.vz[l] + h * d.vz[l];
+    }
+}
+
+void lane_runge_kutta_step(LaneStates& s, const LaneParams& p, float dt) {
+    LaneStates k1, k2, k3, k4, tmp;
+    lane_derivatives(s, p, k1);
+    lane_axpy(s, 0.5f * dt, k1, tmp);
+    lane_derivatives(tmp, p, k2);
+    lane_axpy(s, 0.5f * dt, k2, tmp);
+    lane_derivatives(tmp, p, k3);
+    lane_axpy(s, dt, k3, tmp);
+    lane_derivatives(tmp, p, k4);
+
+    float h = dt / 6.0f;
+    for (int l = 0; l < kFloatLanes; ++l) {
+        s.x[l] += h * (k1.x[l] + 2.0f * k2.x[l] + 2.0f * k3.x[l] + k4.x[l]);
+        s.y[l] += h * (k1.y[l] + 2.0f * k2.y[l] + 2.0f * k3.y[l] + k4.y[l]);
+        s.z[l] += h * (k1.z[l] + 2.0f * k2.z[l] + 2.0f * k3.z[l] + k4.z[l]);
+        s.vx[l] += h * (k1.vx[l] + 2.0f * k2.vx[l] + 2.0f * k3.vx[l] + k4.vx[l]);
+        s.vy[l] += h * (k1.vy[l] + 2.0f * k2.vy[l] + 2.0f * k3.vy[l] + k4.vy[l]);
+        s.vz[l] += h * (k1.vz[l] + 2.0f * k2.vz[l] + 2.0f * k3.vz[l] + k4.vz[l]);
+    }
+}
+
+// Относительное расхождение итогов (с нижней границей 1 м / 1 с для малых значений)
+double summary_divergence(const FlightSummary& a, const FlightSummary& reference) {
+    auto rel = [](double value, double ref) { return std::abs(value - ref) / std::max(std::abs(ref), 1.0); };
+    return std::max({ rel(a.total_distance, reference.total_distance),
+                      rel(a.max_height, reference.max_height),
+                      rel(a.flight_time, reference.flight_time) });
+}
+
+} // namespace
+
+void integrate_flight_summaries_f32(const Parameters* params, int count, double dt, std::size_t max_points, FlightSummary* out) {
+    LaneStates s;
+    LaneParams p;
+    float last_x[kFloatLanes], last_z[kFloatLanes], max_height[kFloatLanes];
+    float last_vx[kFloatLanes], last_vy[kFloatLanes], last_vz[kFloatLanes];
+    std::size_t steps[kFloatLanes];
+    bool alive[kFloatLanes];
+
+    for (int l = 0; l < kFloatLanes; ++l) {
+        // Пустые дорожки повторяют первый снаряд, но в результат не попадают
+        const Parameters& lane = params[l < count ? l : 0];
+        State start = initial_state(lane);
+        s.x[l] = static_cast<float>(start.x);
+        s.y[l] = static_cast<float>(start.y);
+        s.z[l] = static_cast<float>(start.z);
+        s.vx[l] = static_cast<float>(start.vx);
+        s.vy[l] = static_cast<float>(start.vy);
+        s.vz[l] = static_cast<float>(start.vz);
+        p.k[l] = static_cast<float>(drag_factor(lane));
+        p.g[l] = static_cast<float>(lane.g);
+        p.wind_x[l] = static_cast<float>(lane.wind_x);
+        p.wind_z[l] = static_cast<float>(lane.wind_z);
+        last_x[l] = last_z[l] = max_height[l] = 0.0f;
+        last_vx[l] = last_vy[l] = last_vz[l] = 0.0f;
+        steps[l] = 0;
+        alive[l] = l < count;
+    }
+
+    const float fdt = static_cast<float>(dt);
+    bool any_alive = count > 0;
+    while (any_alive) {
+        for (int l = 0; l < kFloatLanes; ++l) {
+            if (alive[l]) {
+                last_x[l] = s.x[l];
+                last_z[l] = s.z[l];
+                last_vx[l] = s.vx[l];
+                last_vy[l] = s.vy[l];
+                last_vz[l] = s.vz[l];
+                max_height[l] = std::max(max_height[l], s.y[l]);
+                ++steps[l];
+            }
+        }
+
+        lane_runge_kutta_step(s, p, fdt);
+
+        any_alive = false;
+        for (int l = 0; l < kFloatLanes; ++l) {
+            alive[l] = alive[l] && s.y[l] + fdt * s.vy[l] >= 0.0f && steps[l] < max_points;
+            any_alive = any_alive || alive[l];
+        }
+    }
+
+    for (int l = 0; l < count; ++l) {
+        FlightSummary& summary = out[l];
+        summary.max_height = max_height[l];
+        summary.impact_x = last_x[l];
+        summary.impact_z = last_z[l];
+        summary.total_distance = std::sqrt(summary.impact_x * summary.impact_x + summary.impact_z * summary.impact_z);
+        summary.impact_speed = std::sqrt(last_vx[l] * last_vx[l] + last_vy[l] * last_vy[l] + last_vz[l] * last_vz[l]);
+        summary.flight_time = (steps[l] - 1) * dt;
+    }
+}
+
+std::vector<FlightSummary> evaluate_batch(const std::vector<Parameters>& params, const BatchOptions& options, BatchReport* report) {
+    std::vector<FlightSummary> results(params.size());
+    BatchReport local;
+    local.flights = params.size();
+
+    // Пачки float32 считают падение на плоскую землю при постоянном ветре,
+    // с рельефом или полем ветра пакет считается в double
+    if (!options.single_precision || active_terrain() || active_wind_field()) {
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            results[i] = evaluate_flight(params[i], options.dt, options.max_points);
+        }
+        if (report) {
+            *report = local;
+        }
+        return results;
+    }
+
+    // Аналитические пути дешевле любого численного, остальные полеты собираются в пачки
+    std::vector<std::size_t> numeric;
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (drag_ratio(params[i]) <= kPerturbationDragRatio) {
+            results[i] = evaluate_flight(params[i], options.dt, options.max_points);
+        } else {
+            numeric.push_back(i);
+        }
+    }
+
+    Parameters lane_params[kFloatLanes];
+    FlightSummary lane_results[kFloatLanes];
+    for (std::size_t begin = 0; begin < numeric.size(); begin += kFloatLanes) {
+        int count = static_cast<int>(std::min<std::size_t>(kFloatLanes, numeric.size() - begin));
+        for (int l = 0; l < count; ++l) {
+            lane_params[l] = params[numeric[begin + l]];
+        }
+        integrate_flight_summaries_f32(lane_params, count, options.dt, options.max_points, lane_results);
+        for (int l = 0; l < count; ++l) {
+            results[numeric[begin + l]] = lane_results[l];
+        }
+    }
+    local.single_precision_flights = numeric.size();
+
+    // Перепроверка выборки в double; перепроверенные полеты получают точный результат
+    std::size_t verify_every = std::max<std::size_t>(options.verify_every, 1);
+    for (std::size_t n = 0; n < numeric.size(); n += verify_every) {
+        std::size_t i = numeric[n];
+        FlightSummary reference = integrate_flight_summary(params[i], options.dt, options.max_points);
+        local.max_divergence = std::max(local.max_divergence, summary_divergence(results[i], reference));
+        results[i] = reference;
+        ++local.verified;
+    }
+
+    if (local.max_divergence > options.tolerance) {
+        local.tolerance_exceeded = true;
+        if (options.auto_escalate) {
+            for (std::size_t i : numeric) {
+                results[i] = integrate_flight_summary(params[i], options.dt, options.max_points);
+            }
+            local.escalated = true;
+        }
+    }
+
+    if (report) {
+        *report = local;
+    }
+    return results;
+}
@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <vector>
+
+// Настройки пакетного расчета (развертки графиков)
+struct BatchOptions {
+    double dt = 0.01;
+    std::size_t max_points = 10000;
+
+    // Режим float32: численные полеты считаются пачками по несколько снарядов в одинарной точности.
+    // Каждый verify_every-й полет дополнительно считается в double; если относительное
+    // расхождение больше tolerance, весь пакет (при auto_escalate) пересчитывается в double.
+    bool single_precision = false;
+    double tolerance = 1e-3;
+    std::size_t verify_every = 16;
+    bool auto_escalate = true;
+};
+
+// Отчет о проверке точности пакета
+struct BatchReport {
+    std::size_t flights = 0;
+    std::size_t single_precision_flights = 0; // посчитано в float32
+    std::size_t verified = 0;                 // из них перепроверено в double
+    double max_divergence = 0.0;              // наибольшее относительное расхождение float32 и double
+    bool tolerance_exceeded = false;
+    bool escalated = false;                   // пакет пересчитан в double
+};
+
+// Численный расчет полета в float32 для count снарядов сразу (count <= kFloatLanes)
+constexpr int kFloatLanes = 8;
+void integrate_flight_summaries_f32(const Parameters* params, int count, double dt, std::size_t max_points, FlightSummary* out);
+
+// Расчет пакета полетов; быстрые аналитические пути используются в обоих режимах
+std::vector<FlightSummary> evaluate_batch(const std::vector<Parameters>& params, const BatchOptions& options, BatchReport* report = nullptr);
+
+#endif // BATCH_H
@@ -0,0 +1,425 @@
+#include "batchjob.h"
+#include "resultcache.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static_assert(std::is_trivially_copyable<FlightSummary>::value, "FlightSummary is stored in the journal as raw bytes");
+
+namespace {
+
+constexpr char kJournalMagic[4] = { 'B', 'J', 'R', 'N' };
+constexpr std::uint32_t kJournalVersion = 1;
+
+struct JournalHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t fingerprint;
+    std::uint64_t count;
+    std::uint64_t unit_size;
+};
+
+struct RecordHeader {
+    std::uint64_t unit;
+    std::uint64_t checksum;
+};
+
+struct Hasher {
+    std::uint64_t state;
+    explicit Hasher(std::uint64_t seed) : state(seed) {}
+    void add(std::uint64_t value) {
+        state ^= value + 0x9e3779b97f4a7c15ull + (state << 6) + (state >> 2);
+        state = (state ^ (state >> 31)) * 0xbf58476d1ce4e5b9ull;
+    }
+    void add(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+    void add(const Parameters& params) {
+        for (int i = 0; i < kScenarioParameterCount; ++i) {
+            add(scenario_parameter(params, i));
+        }
+    }
+};
+
+// FNV-1a по байтам записи: ловит недописанный хвост журнала после обрыва
+std::uint64_t record_checksum(std::uint64_t unit, const FlightSummary* data, std::size_t count) {
+    std::uint64_t hash = 0xcbf29ce484222325ull ^ unit;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < count * sizeof(FlightSummary); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Отпечаток задания вместе с настройками расчета, версией модели и окружением:
+// журнал другого задания не должен подмешаться к результатам
+std::uint64_t job_fingerprint(const BatchJob& job, const BatchJobOptions& options) {
+    Hasher hasher(0x42617463684a6f62ull);
+    hasher.add(job.definition);
+    hasher.add(static_cast<std::uint64_t>(job.count));
+    hasher.add(static_cast<std::uint64_t>(options.unit_size));
+    hasher.add(options.batch.dt);
+    hasher.add(static_cast<std::uint64_t>(options.batch.max_points));
+    hasher.add(static_cast<std::uint64_t>(options.batch.single_precision));
+    hasher.add(options.batch.tolerance);
+    hasher.add(static_cast<std::uint64_t>(options.batch.verify_every));
+    hasher.add(static_cast<std::uint64_t>(options.batch.auto_escalate));
+    hasher.add(static_cast<std::uint64_t>(kResultCacheModelVersion));
+    hasher.add(result_cache_environment());
+    return hasher.state;
+}
+
+bool sync_to_disk(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+std::atomic<bool> g_stopRequested{ false };
+
+void request_stop(int) {
+    g_stopRequested.store(true);
+}
+
+} // namespace
+
+BatchJob make_sweep_job(const SweepDefinition& sweep) {
+    BatchJob job;
+    job.name = QString::fromUtf8(sweep.name.data(), static_cast<int>(sweep.name.size()));
+    job.count = sweep_size(sweep);
+    job.member = [sweep](std::size_t index) { return sweep_point(sweep, index); };
+    Hasher hasher(0x5377656570ull);
+    hasher.add(sweep.base_params);
+    hasher.add(static_cast<std::uint64_t>(sweep.parameter));
+    hasher.add(sweep.from);
+    hasher.add(sweep.to);
+    hasher.add(sweep.step);
+    job.definition = hasher.state;
+    return job;
+}
+
+BatchJob make_ensemble_job(const EnsembleDefinition& ensemble) {
+    BatchJob job;
+    job.name = QString::fromUtf8(ensemble.name.data(), static_cast<int>(ensemble.name.size()));
+    job.count = ensemble.count;
+    job.member = [ensemble](std::size_t index) { return ensemble_member(ensemble, index); };
+    Hasher hasher(0x456e73656d626c65ull);
+    hasher.add(ensemble.base_params);
+    hasher.add(ensemble.sigma);
+    hasher.add(ensemble.seed);
+    job.definition = hasher.state;
+    return job;
+}
+
+bool run_batch_job(const BatchJob& job, const BatchJobOptions& options, const QString& output_path,
+                   BatchJobReport* report, QString* error, const std::function<void(std::size_t, std::size_t)>& progress,
+                   const std::atomic<bool>* cancel) {
+    BatchJobReport local;
+    BatchJobReport& r = report ? *report : local;
+    r = BatchJobReport();
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    if (!job.member || options.unit_size == 0) {
+        return fail("Пустое задание.");
+    }
+
+    const std::size_t unitSize = options.unit_size;
+    const std::size_t units = (job.count + unitSize - 1) / unitSize;
+    const std::uint64_t fingerprint = job_fingerprint(job, options);
+    r.units = units;
+    auto unitLength = [&](std::size_t unit) { return std::min(unitSize, job.count - unit * unitSize); };
+
+    std::vector<FlightSummary> results(job.count);
+    std::vector<char> done(units, 0);
+    std::size_t doneUnits = 0;
+
+    // Журнал прошлого запуска: берутся все целые записи с верной контрольной суммой,
+    // недописанный хвост отрезается
+    const QString journalPath = output_path + ".journal";
+    QFile journal(journalPath);
+    qint64 validBytes = 0;
+    if (journal.open(QIODevice::ReadWrite)) {
+        JournalHeader header;
+        bool matches = journal.read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header)
+                       && std::memcmp(header.magic, kJournalMagic, sizeof(kJournalMagic)) == 0
+                       && header.version == kJournalVersion && header.fingerprint == fingerprint
+                       && header.count == job.count && header.unit_size == unitSize;
+        if (matches) {
+            validBytes = sizeof(header);
+            RecordHeader record;
+            while (journal.read(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record) && record.unit < units) {
+                std::size_t length = unitLength(record.unit);
+                FlightSummary* target = results.data() + record.unit * unitSize;
+                std::vector<FlightSummary> data(length);
+                qint64 bytes = static_cast<qint64>(length * sizeof(FlightSummary));
+                if (journal.read(reinterpret_cast<char*>(data.data()), bytes) != bytes
+                    || record_checksum(record.unit, data.data(), length) != record.checksum) {
+                    break;
+                }
+                std::copy(data.begin(), data.end(), target);
+                if (!done[record.unit]) {
+                    done[record.unit] = 1;
+                    ++doneUnits;
+                }
+                validBytes = journal.pos();
+            }
+            journal.resize(validBytes);
+            journal.seek(validBytes);
+        } else if (journal.size() > 0) {
+            r.discarded_journal = true;
+        }
+    }
+    if (validBytes == 0) {
+        journal.close();
+        if (!journal.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return fail(QString("Не удалось создать журнал %1.").arg(journalPath));
+        }
+        JournalHeader header;
+        std::memcpy(header.magic, kJournalMagic, sizeof(kJournalMagic));
+        header.version = kJournalVersion;
+        header.fingerprint = fingerprint;
+        header.count = job.count;
+        header.unit_size = unitSize;
+        if (journal.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) || !sync_to_disk(journal)) {
+            return fail(QString("Не удалось записать журнал %1.").arg(journalPath));
+        }
+    }
+    r.resumed_units = doneUnits;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<bool> writeFailed{ false }; // рабочие потоки читают флаг без блокировки
+
+    // Контрольная точка - сброс журнала на диск: все записи до нее переживут обрыв питания.
+    // Отдельного файла состояния нет: готовые единицы и их итоги восстанавливаются из журнала,
+    // а параметры полета (и позиция генератора ансамбля) определяются номером полета
+    auto writeCheckpoint = [&]() {
+        if (!sync_to_disk(journal)) {
+            writeFailed = true;
+            return;
+        }
+        ++r.checkpoints;
+    };
+
+    std::vector<std::size_t> pending;
+    for (std::size_t unit = 0; unit < units; ++unit) {
+        if (!done[unit]) {
+            pending.push_back(unit);
+        }
+    }
+
+    std::atomic<std::size_t> nextPending{ 0 };
+    int threadCount = options.threads > 0 ? options.threads : std::max(1, QThread::idealThreadCount());
+    threadCount = static_cast<int>(std::min<std::size_t>(static_cast<std::size_t>(threadCount), std::max<std::size_t>(pending.size(), 1)));
+    int activeThreads = threadCount;
+    auto stopping = [&]() { return (cancel && cancel->load()) || writeFailed; };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&]() {
+            std::vector<Parameters> params;
+            while (!stopping()) {
+                std::size_t index = nextPending.fetch_add(1);
+                if (index >= pending.size()) {
+                    break;
+                }
+                std::size_t unit = pending[index];
+                std::size_t first = unit * unitSize;
+                params.clear();
+                for (std::size_t i = first; i < first + unitLength(unit); ++i) {
+                    params.push_back(job.member(i));
+                }
+                std::vector<FlightSummary> unitResults = evaluate_batch(params, options.batch);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                RecordHeader record{ unit, record_checksum(unit, unitResults.data(), unitResults.size()) };
+                qint64 bytes = static_cast<qint64>(unitResults.size() * sizeof(FlightSummary));
+                if (journal.write(reinterpret_cast<const char*>(&record), sizeof(record)) != sizeof(record)
+                    || journal.write(reinterpret_cast<const char*>(unitResults.data()), bytes) != bytes || !journal.flush()) {
+                    writeFailed = true;
+                    break;
+                }
+                std::copy(unitResults.begin(), unitResults.end(), results.begin() + first);
+                done[unit] = 1;
+                ++doneUnits;
+                ++r.computed_units;
+                finished.notify_one();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            --activeThreads;
+            finished.notify_one();
+        });
+    }
+
+    {
+        QElapsedTimer sinceCheckpoint;
+        sinceCheckpoint.start();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (activeThreads > 0) {
+            finished.wait_for(lock, std::chrono::milliseconds(250));
+            if (sinceCheckpoint.elapsed() >= options.checkpoint_interval_ms && activeThreads > 0) {
+                writeCheckpoint();
+                sinceCheckpoint.restart();
+            }
+            if (progress) {
+                std::size_t flights = std::min(job.count, doneUnits * unitSize);
+                lock.unlock();
+                progress(flights, job.count);
+                lock.lock();
+            }
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (writeFailed) {
+        return fail(QString("Ошибка записи журнала %1.").arg(journalPath));
+    }
+    if (doneUnits < units) {
+        writeCheckpoint();
+        return fail(QString("Расчет остановлен: готово %1 из %2 единиц, повторный запуск продолжит с этого места.").arg(doneUnits).arg(units));
+    }
+
+    // Все единицы готовы: CSV с полной точностью (%.17g восстанавливает double побитово)
+    QSaveFile output(output_path);
+    if (!output.open(QIODevice::WriteOnly)) {
+        return fail(QString("Не удалось создать %1.").arg(output_path));
+    }
+    QByteArray buffer = "index,max_height,total_distance,flight_time,impact_x,impact_z,impact_speed\n";
+    char line[224];
+    for (std::size_t i = 0; i < job.count; ++i) {
+        const FlightSummary& s = results[i];
+        int n = std::snprintf(line, sizeof(line), "%zu,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n", i,
+                              s.max_height, s.total_distance, s.flight_time, s.impact_x, s.impact_z, s.impact_speed);
+        buffer.append(line, n);
+        if (buffer.size() > (1 << 20)) {
+            output.write(buffer);
+            buffer.clear();
+        }
+    }
+    output.write(buffer);
+    if (!output.commit()) {
+        return fail(QString("Не удалось записать %1.").arg(output_path));
+    }
+    journal.close();
+    QFile::remove(journalPath);
+    r.completed = true;
+    return true;
+}
+
+int run_batch_command(const QStringList& arguments) {
+    if (arguments.size() < 3) {
+        std::fprintf(stderr, "Использование: --batch <файл сценариев> <развертка или ансамбль> <результат.csv> "
+                             "[--threads N] [--unit N] [--checkpoint-interval сек] [--float32] [--terrain путь] [--wind-field путь]\n");
+        return 2;
+    }
+    BatchJobOptions options;
+    for (int i = 3; i < arguments.size(); ++i) {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+        if (arg == "--float32") {
+            options.batch.single_precision = true;
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = arguments[++i].toInt();
+        } else if (arg == "--unit" && hasValue) {
+            options.unit_size = std::max(1, arguments[++i].toInt());
+        } else if (arg == "--checkpoint-interval" && hasValue) {
+            options.checkpoint_interval_ms = std::max(1, arguments[++i].toInt()) * 1000;
+        } else if (arg == "--terrain" && hasValue) {
+            std::string terrainError;
+            std::shared_ptr<Heightmap> terrain = Heightmap::load(arguments[++i].toStdString(), &terrainError);
+            if (!terrain) {
+                std::fprintf(stderr, "%s\n", terrainError.c_str());
+                return 3;
+            }
+            terrain->rebase_to_origin();
+            set_active_terrain(terrain);
+        } else if (arg == "--wind-field" && hasValue) {
+            std::string fieldError;
+            std::shared_ptr<WindField> field = WindField::load(arguments[++i].toStdString(), &fieldError);
+            if (!field) {
+                std::fprintf(stderr, "%s\n", fieldError.c_str());
+                return 3;
+            }
+            set_active_wind_field(field);
+        } else {
+            std::fprintf(stderr, "Неизвестный аргумент: %s\n", arg.toUtf8().constData());
+            return 2;
+        }
+    }
+
+    ScenarioFile file;
+    std::string loadError;
+    if (!load_scenario_file(arguments[0].toStdString(), file, &loadError)) {
+        std::fprintf(stderr, "%s\n", loadError.c_str());
+        return 3;
+    }
+    std::string name = arguments[1].toStdString();
+    BatchJob job;
+    for (const SweepDefinition& sweep : file.sweeps) {
+        if (sweep.name == name) job = make_sweep_job(sweep);
+    }
+    for (const EnsembleDefinition& ensemble : file.ensembles) {
+        if (ensemble.name == name) job = make_ensemble_job(ensemble);
+    }
+    if (!job.member) {
+        std::fprintf(stderr, "В файле нет развертки или ансамбля %s\n", name.c_str());
+        return 3;
+    }
+
+    // SIGINT/SIGTERM (в том числе вытеснение задачи планировщиком) - сохранить контрольную точку и выйти
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+
+    BatchJobReport report;
+    QString error;
+    QElapsedTimer sincePrint;
+    sincePrint.start();
+    bool ok = run_batch_job(job, options, arguments[2], &report, &error, [&sincePrint](std::size_t done, std::size_t total) {
+        if (sincePrint.elapsed() >= 1000 || done == total) {
+            std::fprintf(stderr, "\r%zu / %zu", done, total);
+            sincePrint.restart();
+        }
+    }, &g_stopRequested);
+    std::fprintf(stderr, "\n");
+    if (report.discarded_journal) {
+        std::fprintf(stderr, "Журнал другого задания или настроек отброшен.\n");
+    }
+    std::fprintf(stderr, "Единиц: %zu, из журнала: %zu, посчитано: %zu, контрольных точек: %d\n",
+                 report.units, report.resumed_units, report.computed_units, report.checkpoints);
+    if (!ok) {
+        std::fprintf(stderr, "%s\n", error.toUtf8().constData());
+        return 1;
+    }
+    return 0;
+}
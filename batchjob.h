@@ -0,0 +1,59 @@
+#ifndef BATCHJOB_H
+#define BATCHJOB_H
+
+#include "batch.h"
+#include "scenario.h"
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Долгий пакетный расчет (развертка или ансамбль из файла сценариев) с контрольными точками.
+// Задание делится на единицы работы фиксированного размера. Готовая единица дописывается
+// в журнал <результат>.journal (номер, контрольная сумма, итоги полетов); периодически
+// (контрольная точка) журнал сбрасывается на диск. Повторный запуск того же задания
+// продолжает с места остановки: из журнала берутся все целые записи с верной суммой,
+// параметры полета зависят только от его номера (генератор ансамбля счетчиковый),
+// единицы всегда одни и те же, поэтому итог побитово совпадает с расчетом без перерыва.
+
+struct BatchJob {
+    QString name;
+    std::size_t count = 0;
+    std::function<Parameters(std::size_t)> member; // параметры полета по номеру
+    std::uint64_t definition = 0;                  // хэш описания задания
+};
+
+BatchJob make_sweep_job(const SweepDefinition& sweep);
+BatchJob make_ensemble_job(const EnsembleDefinition& ensemble);
+
+struct BatchJobOptions {
+    BatchOptions batch;
+    std::size_t unit_size = 4096;
+    int threads = 0;                   // 0 - по числу ядер
+    int checkpoint_interval_ms = 30000;
+};
+
+struct BatchJobReport {
+    std::size_t units = 0;
+    std::size_t resumed_units = 0;     // взяты из журнала прошлого запуска
+    std::size_t computed_units = 0;
+    int checkpoints = 0;
+    bool discarded_journal = false;    // журнал остался от другого задания или настроек
+    bool completed = false;
+};
+
+// Результаты пишутся в CSV output_path (атомарно, когда готовы все единицы), после чего
+// журнал удаляется. cancel - остановиться после текущих единиц
+// со сбросом журнала на диск; progress(done, total) вызывается из вызывающего потока
+bool run_batch_job(const BatchJob& job, const BatchJobOptions& options, const QString& output_path,
+                   BatchJobReport* report = nullptr, QString* error = nullptr,
+                   const std::function<void(std::size_t, std::size_t)>& progress = {},
+                   const std::atomic<bool>* cancel = nullptr);
+
+// Точка входа --batch: <файл сценариев> <имя развертки или ансамбля> <результат.csv>
+// [--threads N] [--unit N] [--checkpoint-interval сек] [--float32] [--terrain путь] [--wind-field путь]
+int run_batch_command(const QStringList& arguments);
+
+#endif // BATCHJOB_H
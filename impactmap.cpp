@@ -0,0 +1,148 @@
+#include "impactmap.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+ImpactGrid fit_impact_grid(const std::vector<FlightSummary>& sample, int max_cells) {
+    double xMin = std::numeric_limits<double>::max(), xMax = std::numeric_limits<double>::lowest();
+    double zMin = xMin, zMax = xMax;
+    for (const FlightSummary& s : sample) {
+        if (std::isfinite(s.impact_x) && std::isfinite(s.impact_z)) {
+            xMin = std::min(xMin, s.impact_x);
+            xMax = std::max(xMax, s.impact_x);
+            zMin = std::min(zMin, s.impact_z);
+            zMax = std::max(zMax, s.impact_z);
+        }
+    }
+    if (xMin > xMax) {
+        xMin = xMax = zMin = zMax = 0.0;
+    }
+
+    // Поля - доля большего размаха, чтобы вытянутое облако (развертка по углу) не давало
+    // сетку в одну ячейку по узкой стороне
+    double span = std::max({ xMax - xMin, zMax - zMin, 1.0 });
+    double pad = 0.1 * span;
+    ImpactGrid grid;
+    grid.x_min = xMin - pad;
+    grid.z_min = zMin - pad;
+    double width = xMax - xMin + 2.0 * pad;
+    double height = zMax - zMin + 2.0 * pad;
+    double cell = std::max(width, height) / std::max(max_cells, 1);
+    grid.nx = std::max(1, static_cast<int>(std::ceil(width / cell)));
+    grid.nz = std::max(1, static_cast<int>(std::ceil(height / cell)));
+    grid.x_max = grid.x_min + grid.nx * cell;
+    grid.z_max = grid.z_min + grid.nz * cell;
+    return grid;
+}
+
+ImpactHistogram::ImpactHistogram(const ImpactGrid& grid)
+    : cells(grid) {
+    if (grid.valid()) {
+        inv_dx = grid.nx / (grid.x_max - grid.x_min);
+        inv_dz = grid.nz / (grid.z_max - grid.z_min);
+        bins.assign(static_cast<std::size_t>(grid.nx) * grid.nz, 0);
+    } else {
+        cells.nx = cells.nz = 0; // все попадания - вне сетки
+    }
+}
+
+void ImpactHistogram::merge(const ImpactHistogram& other) {
+    if (other.bins.size() == bins.size()) {
+        for (std::size_t i = 0; i < bins.size(); ++i) {
+            bins[i] += other.bins[i];
+        }
+    }
+    inside_count += other.inside_count;
+    outside_count += other.outside_count;
+}
+
+std::uint32_t ImpactHistogram::max_count() const {
+    return bins.empty() ? 0 : *std::max_element(bins.begin(), bins.end());
+}
+
+double ImpactHistogram::density(int i, int j) const {
+    std::uint64_t total = inside_count + outside_count;
+    return total ? count(i, j) / (static_cast<double>(total) * cells.cell_area()) : 0.0;
+}
+
+ImpactHistogram build_impact_map(std::size_t count, const std::function<Parameters(std::size_t)>& member,
+                                 const BatchOptions& options, ImpactGrid grid, int threads, ImpactMapReport* report) {
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t kChunk = 1024; // полетов в пакете evaluate_batch
+
+    // Пробная выборка для сетки
+    std::size_t pilot = 0;
+    std::vector<FlightSummary> pilotResults;
+    if (!grid.valid()) {
+        pilot = std::min<std::size_t>(count, 4096);
+        std::vector<Parameters> params;
+        params.reserve(pilot);
+        for (std::size_t i = 0; i < pilot; ++i) {
+            params.push_back(member(i));
+        }
+        pilotResults = evaluate_batch(params, options);
+        grid = fit_impact_grid(pilotResults);
+    }
+    ImpactHistogram total(grid);
+    for (const FlightSummary& s : pilotResults) {
+        total.add(s.impact_x, s.impact_z);
+    }
+
+    std::size_t rest = count - pilot;
+    int workers = parallel_worker_count(rest, kChunk, threads);
+    std::vector<ImpactHistogram> local(static_cast<std::size_t>(workers), ImpactHistogram(grid));
+    parallel_for(rest, kChunk, threads, [&](std::size_t begin, std::size_t end, int worker) {
+        std::vector<Parameters> params;
+        params.reserve(end - begin);
+        for (std::size_t i = begin; i < end; ++i) {
+            params.push_back(member(pilot + i));
+        }
+        ImpactHistogram& histogram = local[static_cast<std::size_t>(worker)];
+        for (const FlightSummary& s : evaluate_batch(params, options)) {
+            histogram.add(s.impact_x, s.impact_z);
+        }
+    });
+    for (const ImpactHistogram& histogram : local) {
+        total.merge(histogram);
+    }
+
+    if (report) {
+        report->flights = count;
+        report->threads = workers;
+        report->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return total;
+}
+
+std::uint32_t impact_map_color(double t) {
+    // От темно-фиолетового через красный и оранжевый к светло-желтому
+    static const double stops[5][3] = {
+        { 40, 11, 84 }, { 101, 21, 110 }, { 187, 55, 84 }, { 249, 142, 9 }, { 252, 255, 164 }
+    };
+    t = std::clamp(t, 0.0, 1.0) * 4.0;
+    int k = std::min(static_cast<int>(t), 3);
+    double f = t - k;
+    std::uint32_t rgb[3];
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = static_cast<std::uint32_t>(std::lround(stops[k][c] + (stops[k + 1][c] - stops[k][c]) * f));
+    }
+    return 0xE6000000u | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+}
+
+std::vector<std::uint32_t> impact_map_colors(const ImpactHistogram& histogram) {
+    const std::vector<std::uint32_t>& counts = histogram.counts();
+    std::vector<std::uint32_t> colors(counts.size(), 0);
+    std::uint32_t peak = histogram.max_count();
+    if (peak == 0) {
+        return colors;
+    }
+    double scale = 1.0 / std::log1p(static_cast<double>(peak));
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i]) {
+            colors[i] = impact_map_color(std::log1p(static_cast<double>(counts[i])) * scale);
+        }
+    }
+    return colors;
+}
@@ -0,0 +1,83 @@
+#ifndef IMPACTMAP_H
+#define IMPACTMAP_H
+
+#include "batch.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Карта плотности точек падения на плоскости X-Z для рассеивания и разверток.
+// Каждый поток считает свои полеты пакетами и копит попадания в собственную гистограмму
+// на всю сетку; гистограммы складываются в конце. Общих атомарных счетчиков на каждое
+// попадание нет, память - сетка на поток, а не число полетов.
+
+struct ImpactGrid {
+    double x_min = 0.0, x_max = 0.0;
+    double z_min = 0.0, z_max = 0.0;
+    int nx = 0, nz = 0;
+
+    bool valid() const { return nx > 0 && nz > 0 && x_max > x_min && z_max > z_min; }
+    double cell_area() const { return (x_max - x_min) / nx * ((z_max - z_min) / nz); }
+};
+
+// Сетка вокруг точек падения пробной выборки: квадратные ячейки, не больше max_cells по стороне,
+// поля 10% размаха (точки вне сетки учитываются отдельно)
+ImpactGrid fit_impact_grid(const std::vector<FlightSummary>& sample, int max_cells = 256);
+
+// Выравнивание по строке кэша: гистограммы потоков лежат в одном массиве,
+// а счетчики попаданий меняются на каждом полете
+class alignas(64) ImpactHistogram {
+public:
+    ImpactHistogram() = default;
+    explicit ImpactHistogram(const ImpactGrid& grid);
+
+    const ImpactGrid& grid() const { return cells; }
+
+    void add(double x, double z) {
+        double fx = (x - cells.x_min) * inv_dx;
+        double fz = (z - cells.z_min) * inv_dz;
+        if (fx >= 0.0 && fz >= 0.0 && fx < cells.nx && fz < cells.nz) {
+            ++bins[static_cast<std::size_t>(fz) * cells.nx + static_cast<std::size_t>(fx)];
+            ++inside_count;
+        } else {
+            ++outside_count;
+        }
+    }
+    void merge(const ImpactHistogram& other); // сетки должны совпадать
+
+    // i - ячейка по X, j - по Z; ячейки хранятся строками по Z, начиная с z_min
+    std::uint32_t count(int i, int j) const { return bins[static_cast<std::size_t>(j) * cells.nx + i]; }
+    const std::vector<std::uint32_t>& counts() const { return bins; }
+    std::uint32_t max_count() const;
+    std::uint64_t inside() const { return inside_count; }
+    std::uint64_t outside() const { return outside_count; }
+    // Доля всех полетов на квадратный метр
+    double density(int i, int j) const;
+
+private:
+    ImpactGrid cells;
+    double inv_dx = 0.0, inv_dz = 0.0;
+    std::vector<std::uint32_t> bins;
+    std::uint64_t inside_count = 0;
+    std::uint64_t outside_count = 0;
+};
+
+struct ImpactMapReport {
+    std::size_t flights = 0;
+    int threads = 0;
+    double seconds = 0.0;
+};
+
+// Попадания полетов member(0) ... member(count - 1). Невалидная grid - сетка по пробной
+// выборке из первых полетов (они же входят в карту). threads = 0 - по числу ядер
+ImpactHistogram build_impact_map(std::size_t count, const std::function<Parameters(std::size_t)>& member,
+                                 const BatchOptions& options, ImpactGrid grid = {}, int threads = 0,
+                                 ImpactMapReport* report = nullptr);
+
+// Цвета ячеек 0xAARRGGBB (строки по Z от z_min) в логарифмической шкале, пустые ячейки прозрачны.
+// Одна раскраска для изображения в 2D-области и текстуры земли в 3D
+std::vector<std::uint32_t> impact_map_colors(const ImpactHistogram& histogram);
+std::uint32_t impact_map_color(double t); // t в [0, 1]
+
+#endif // IMPACTMAP_H
@@ -1,11 +1,115 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include "batchjob.h"
 #include "mainwindow.h"
+#include "shardrunner.h"
+#include "simclient.h"
+#include "simdaemon.h"
+#include "workprecision.h"
+
+namespace {
+
+// Отмечает первое событие отрисовки окна
+class FirstPaintProbe : public QObject {
+public:
+    explicit FirstPaintProbe(std::function<void()> onPaint) : onPaint(std::move(onPaint)) {}
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override {
+        if (event->type() == QEvent::Paint && onPaint) {
+            std::function<void()> callback = std::move(onPaint);
+            onPaint = nullptr;
+            callback();
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+private:
+    std::function<void()> onPaint;
+};
+
+} // namespace
 
 int main(int argc, char *argv[]) {
+    QElapsedTimer startup;
+    startup.start();
+
+    // Рабочий процесс многопроцессной развертки: без окна, результаты пишутся в общую память
+    if (argc > 1 && std::strcmp(argv[1], "--sweep-worker") == 0) {
+        QCoreApplication app(argc, argv);
+        return run_sweep_worker(app.arguments().mid(2));
+    }
+
+    // Долгая развертка или ансамбль из файла сценариев с контрольными точками; повторный запуск продолжает
+    if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) {
+        QCoreApplication app(argc, argv);
+        return run_batch_command(app.arguments().mid(2));
+    }
+
+    // Демон расчета для внутренних инструментов: запросы через локальный сокет
+    if (argc > 1 && std::strcmp(argv[1], "--serve") == 0) {
+        QCoreApplication app(argc, argv);
+        return run_simulation_daemon(app.arguments().mid(2));
+    }
+
+    // Задержка ответов демона из кэша: --serve-bench [путь сокета] [число запросов]
+    if (argc > 1 && std::strcmp(argv[1], "--serve-bench") == 0) {
+        std::string path = argc > 2 ? argv[2] : kDefaultSimSocket;
+        std::size_t requests = argc > 3 ? static_cast<std::size_t>(std::strtoull(argv[3], nullptr, 10)) : 100000;
+        return run_simulation_client_benchmark(path, requests);
+    }
+
+    // Сравнение интеграторов без окна: таблица CSV в файл или в стандартный вывод
+    if (argc > 1 && std::strcmp(argv[1], "--work-precision") == 0) {
+        std::string csv = work_precision_csv(run_work_precision(reference_scenarios()));
+        std::FILE* out = argc > 2 ? std::fopen(argv[2], "w") : stdout;
+        if (!out) {
+            std::fprintf(stderr, "Не удалось открыть %s\n", argv[2]);
+            return 1;
+        }
+        std::fputs(csv.c_str(), out);
+        return out == stdout ? 0 : std::fclose(out);
+    }
+
+    // --startup-timing: отчет о времени запуска в stderr
+    bool startupTiming = false;
+    for (int i = 1; i < argc; ++i) {
+        startupTiming = startupTiming || std::strcmp(argv[i], "--startup-timing") == 0;
+    }
+
     QApplication app(argc, argv);
+    qint64 appMs = startup.elapsed();
     MainWindow window;
     window.setWindowTitle("Артиллерийская симуляция");
     window.resize(900, 600);
+    qint64 constructedMs = startup.elapsed();
     window.show();
+    qint64 shownMs = startup.elapsed();
+
+    qint64 firstPaintMs = -1, previewMs = -1;
+    auto report = [&]() {
+        if (firstPaintMs >= 0 && previewMs >= 0) {
+            std::fprintf(stderr, "Запуск: QApplication %lld мс, окно построено %lld мс, показано %lld мс, "
+                                 "первый кадр %lld мс, предпросмотр готов %lld мс\n",
+                         appMs, constructedMs, shownMs, firstPaintMs, previewMs);
+        }
+    };
+    FirstPaintProbe probe([&]() {
+        firstPaintMs = startup.elapsed();
+        report();
+    });
+    if (startupTiming) {
+        window.installEventFilter(&probe);
+        QObject::connect(&window, &MainWindow::initialPreviewReady, [&]() {
+            previewMs = startup.elapsed();
+            report();
+        });
+    }
     return app.exec();
-}
\ No newline at end of file
+}
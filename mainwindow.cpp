@@ -1,5 +1,23 @@
 #include "mainwindow.h"
 #include "simulation.h"
+#include "batch.h"
+#include "analytic.h"
+#include "trajectory.h"
+#include "trajectorypool.h"
+#include "terrain.h"
+#include "windfield.h"
+#include "shardrunner.h"
+#include "resultcache.h"
+#include "scenario.h"
+#include "workprecision.h"
+#include "plotitem.h"
+#include "adaptivesweep.h"
+#include "optimalangle.h"
+#include "impactmap.h"
+#include "sweepstore.h"
+#include "sensitivity.h"
+#include "unscented.h"
+#include "view3d.h"
 #include <QFormLayout>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -13,10 +31,21 @@
 #include <QTextStream>
 #include <QComboBox>
 #include <QMessageBox>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QThread>
+#include <QCoreApplication>
+#include <QInputDialog>
+#include <QApplication>
+#include <QImage>
+#include <QPixmap>
+#include <QGraphicsPixmapItem>
+#include <algorithm>
+#include <limits>
 
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), previewStep(0), m_currentFlightTime(1.0) {
+    : QMainWindow(parent), m_currentFlightTime(1.0) {
     setupUI();
     setupPreviewVisualization();
 }
@@ -117,9 +146,49 @@ void MainWindow::setupUI() {
     connect(instructionsButton, &QPushButton::clicked, this, &MainWindow::onShowInstructions);
     buttonLayout->addWidget(instructionsButton);
 
+    // Кнопки рельефа
+    QHBoxLayout *terrainLayout = new QHBoxLayout();
+    loadTerrainButton = new QPushButton("Загрузить рельеф", this);
+    connect(loadTerrainButton, &QPushButton::clicked, this, &MainWindow::onLoadTerrain);
+    terrainLayout->addWidget(loadTerrainButton);
+
+    clearTerrainButton = new QPushButton("Убрать рельеф", this);
+    clearTerrainButton->setEnabled(false);
+    connect(clearTerrainButton, &QPushButton::clicked, this, &MainWindow::onClearTerrain);
+    terrainLayout->addWidget(clearTerrainButton);
+
+    // Кнопки поля ветра
+    QHBoxLayout *windFieldLayout = new QHBoxLayout();
+    loadWindFieldButton = new QPushButton("Загрузить поле ветра", this);
+    connect(loadWindFieldButton, &QPushButton::clicked, this, &MainWindow::onLoadWindField);
+    windFieldLayout->addWidget(loadWindFieldButton);
+
+    clearWindFieldButton = new QPushButton("Убрать поле ветра", this);
+    clearWindFieldButton->setEnabled(false);
+    connect(clearWindFieldButton, &QPushButton::clicked, this, &MainWindow::onClearWindField);
+    windFieldLayout->addWidget(clearWindFieldButton);
+
+    // Поиск угла наибольшей дальности
+    QHBoxLayout *optimalAngleLayout = new QHBoxLayout();
+    optimalAngleButton = new QPushButton("Угол наибольшей дальности", this);
+    connect(optimalAngleButton, &QPushButton::clicked, this, &MainWindow::onFindOptimalAngle);
+    optimalAngleLayout->addWidget(optimalAngleButton);
+    optimalAngleLayout->addWidget(new QLabel("время полета не более, с:", this));
+    maxFlightTimeSpinBox = new QDoubleSpinBox(this);
+    maxFlightTimeSpinBox->setRange(0.0, 1e5);
+    maxFlightTimeSpinBox->setDecimals(2);
+    maxFlightTimeSpinBox->setSpecialValueText("без ограничения");
+    maxFlightTimeSpinBox->setValue(0.0); // Default
+    optimalAngleLayout->addWidget(maxFlightTimeSpinBox);
+    correctAzimuthCheckBox = new QCheckBox("Поправка азимута на снос", this);
+    optimalAngleLayout->addWidget(correctAzimuthCheckBox);
+
     // Добавляем форму и кнопки в левую колонку
     leftColumnLayout->addLayout(formLayout);
     leftColumnLayout->addLayout(buttonLayout);
+    leftColumnLayout->addLayout(terrainLayout);
+    leftColumnLayout->addLayout(windFieldLayout);
+    leftColumnLayout->addLayout(optimalAngleLayout);
     
     // Добавляем секцию для построения графиков зависимостей
     QFrame *graphFrame = new QFrame(this);
@@ -130,42 +199,37 @@ void MainWindow::setupUI() {
     graphLayout->addWidget(graphTitleLabel);
 
     QHBoxLayout *graphTypeLayout = new QHBoxLayout();
-    graphTypeLayout->addWidget(new QLabel("Тип графика:", this));
+    graphTypeLayout->addWidget(new QLabel("Параметр:", this));
     graphTypeComboBox = new QComboBox(this);
-    // Добавляем типы графиков
-    graphTypeComboBox->addItem("Дальность от Начальной скорости", QVariant::fromValue(0));
-    graphTypeComboBox->addItem("Высота от Начальной скорости", QVariant::fromValue(1));
-    graphTypeComboBox->addItem("Время полета от Начальной скорости", QVariant::fromValue(2)); 
-    graphTypeComboBox->addItem("Дальность от Угла", QVariant::fromValue(3));
-    graphTypeComboBox->addItem("Высота от Угла", QVariant::fromValue(4));
-    graphTypeComboBox->addItem("Время полета от Угла", QVariant::fromValue(5));
-    graphTypeComboBox->addItem("Дальность от Массы", QVariant::fromValue(6));
-    graphTypeComboBox->addItem("Высота от Массы", QVariant::fromValue(7));
-    graphTypeComboBox->addItem("Время полета от Массы", QVariant::fromValue(8));
-    graphTypeComboBox->addItem("Дальность от Коэф. сопр.", QVariant::fromValue(9));
-    graphTypeComboBox->addItem("Высота от Коэф. сопр.", QVariant::fromValue(10));
-    graphTypeComboBox->addItem("Время полета от Коэф. сопр.", QVariant::fromValue(11));
-    graphTypeComboBox->addItem("Дальность от Плотности воздуха", QVariant::fromValue(12));
-    graphTypeComboBox->addItem("Высота от Плотности воздуха", QVariant::fromValue(13));
-    graphTypeComboBox->addItem("Время полета от Плотности воздуха", QVariant::fromValue(14));
-    graphTypeComboBox->addItem("Дальность от Радиуса", QVariant::fromValue(15));
-    graphTypeComboBox->addItem("Высота от Радиуса", QVariant::fromValue(16));
-    graphTypeComboBox->addItem("Время полета от Радиуса", QVariant::fromValue(17));
-    graphTypeComboBox->addItem("Дальность от Ветра X", QVariant::fromValue(18));
-    graphTypeComboBox->addItem("Высота от Ветра X", QVariant::fromValue(19));
-    graphTypeComboBox->addItem("Время полета от Ветра X", QVariant::fromValue(20));
-    graphTypeComboBox->addItem("Дальность от Ветра Z", QVariant::fromValue(21));
-    graphTypeComboBox->addItem("Высота от Ветра Z", QVariant::fromValue(22));
-    graphTypeComboBox->addItem("Время полета от Ветра Z", QVariant::fromValue(23));
-    graphTypeComboBox->addItem("Дальность от Азимута", QVariant::fromValue(24));
-    graphTypeComboBox->addItem("Высота от Азимута", QVariant::fromValue(25));
-    graphTypeComboBox->addItem("Время полета от Азимута", QVariant::fromValue(26));
+    // Варьируемые параметры; номер - группа графика в applySweepValue
+    graphTypeComboBox->addItem("Начальная скорость", QVariant::fromValue(0));
+    graphTypeComboBox->addItem("Угол", QVariant::fromValue(1));
+    graphTypeComboBox->addItem("Масса", QVariant::fromValue(2));
+    graphTypeComboBox->addItem("Коэф. сопр.", QVariant::fromValue(3));
+    graphTypeComboBox->addItem("Плотность воздуха", QVariant::fromValue(4));
+    graphTypeComboBox->addItem("Радиус", QVariant::fromValue(5));
+    graphTypeComboBox->addItem("Ветер X", QVariant::fromValue(6));
+    graphTypeComboBox->addItem("Ветер Z", QVariant::fromValue(7));
+    graphTypeComboBox->addItem("Азимут", QVariant::fromValue(8));
 
     connect(graphTypeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::updateGraphParamRanges);
 
     graphTypeLayout->addWidget(graphTypeComboBox);
     graphLayout->addLayout(graphTypeLayout);
 
+    QHBoxLayout *graphMetricLayout = new QHBoxLayout();
+    graphMetricLayout->addWidget(new QLabel("Величина:", this));
+    graphMetricComboBox = new QComboBox(this);
+    // Развертка записывает все величины сразу, смена величины только перерисовывает график
+    graphMetricComboBox->addItem("Дальность", QVariant::fromValue(static_cast<int>(SweepMetric::Range)));
+    graphMetricComboBox->addItem("Макс. высота", QVariant::fromValue(static_cast<int>(SweepMetric::Apex)));
+    graphMetricComboBox->addItem("Время полета", QVariant::fromValue(static_cast<int>(SweepMetric::FlightTime)));
+    graphMetricComboBox->addItem("Скорость падения", QVariant::fromValue(static_cast<int>(SweepMetric::ImpactSpeed)));
+    graphMetricComboBox->addItem("Боковой снос", QVariant::fromValue(static_cast<int>(SweepMetric::LateralDrift)));
+    connect(graphMetricComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onGraphMetricChanged);
+    graphMetricLayout->addWidget(graphMetricComboBox);
+    graphLayout->addLayout(graphMetricLayout);
+
     QHBoxLayout *graphParamMinLayout = new QHBoxLayout();
     graphParamMinLayout->addWidget(new QLabel("Мин. знач. параметра:", this));
     graphParamMinSpinBox = new QDoubleSpinBox(this);
@@ -193,6 +257,48 @@ void MainWindow::setupUI() {
     graphParamStepLayout->addWidget(graphParamStepSpinBox);
     graphLayout->addLayout(graphParamStepLayout);
 
+    QHBoxLayout *graphAdaptiveLayout = new QHBoxLayout();
+    adaptiveSweepCheckBox = new QCheckBox("Адаптивная развертка, допуск %:", this);
+    graphAdaptiveLayout->addWidget(adaptiveSweepCheckBox);
+    adaptiveToleranceSpinBox = new QDoubleSpinBox(this);
+    adaptiveToleranceSpinBox->setRange(0.001, 10.0);
+    adaptiveToleranceSpinBox->setDecimals(3);
+    adaptiveToleranceSpinBox->setValue(0.1); // Default
+    graphAdaptiveLayout->addWidget(adaptiveToleranceSpinBox);
+    graphAdaptiveLayout->addWidget(new QLabel("полетов не более:", this));
+    adaptiveBudgetSpinBox = new QSpinBox(this);
+    adaptiveBudgetSpinBox->setRange(10, 1000000);
+    adaptiveBudgetSpinBox->setValue(2000); // Default
+    graphAdaptiveLayout->addWidget(adaptiveBudgetSpinBox);
+    graphLayout->addLayout(graphAdaptiveLayout);
+
+    QHBoxLayout *graphPrecisionLayout = new QHBoxLayout();
+    singlePrecisionCheckBox = new QCheckBox("Быстрый режим (float32), допуск %:", this);
+    graphPrecisionLayout->addWidget(singlePrecisionCheckBox);
+    precisionToleranceSpinBox = new QDoubleSpinBox(this);
+    precisionToleranceSpinBox->setRange(0.001, 10.0);
+    precisionToleranceSpinBox->setDecimals(3);
+    precisionToleranceSpinBox->setValue(0.1); // Default
+    graphPrecisionLayout->addWidget(precisionToleranceSpinBox);
+    graphLayout->addLayout(graphPrecisionLayout);
+
+    QHBoxLayout *graphWorkersLayout = new QHBoxLayout();
+    QLabel *graphWorkersLabel = new QLabel("Рабочих процессов (0 - в этом окне):", this);
+    graphWorkersLayout->addWidget(graphWorkersLabel);
+    sweepWorkersSpinBox = new QSpinBox(this);
+    sweepWorkersSpinBox->setRange(0, 4 * std::max(1, QThread::idealThreadCount()));
+    sweepWorkersSpinBox->setValue(0); // Default
+    graphWorkersLayout->addWidget(sweepWorkersSpinBox);
+    graphLayout->addLayout(graphWorkersLayout);
+
+    resultCacheCheckBox = new QCheckBox("Кэш результатов на диске", this);
+    resultCacheCheckBox->setChecked(true);
+    graphLayout->addWidget(resultCacheCheckBox);
+
+    invariantSweepCheckBox = new QCheckBox("Сводить полеты с равными k и поворотом по азимуту", this);
+    invariantSweepCheckBox->setChecked(true);
+    graphLayout->addWidget(invariantSweepCheckBox);
+
     plotGraphButton = new QPushButton("Построить график", this);
     connect(plotGraphButton, &QPushButton::clicked, this, &MainWindow::onPlotDependencyGraph);
     // graphLayout->addWidget(plotGraphButton); // Will be added to a QHBoxLayout
@@ -204,9 +310,61 @@ void MainWindow::setupUI() {
     backToPreviewButton = new QPushButton("К предпросмотру траектории", this);
     connect(backToPreviewButton, &QPushButton::clicked, this, &MainWindow::onBackToTrajectoryPreview);
     graphButtonsLayout->addWidget(backToPreviewButton);
+
+    overlayButton = new QPushButton("Развертка в 3D", this);
+    connect(overlayButton, &QPushButton::clicked, this, &MainWindow::onShowSweepOverlay);
+    graphButtonsLayout->addWidget(overlayButton);
     
     graphLayout->addLayout(graphButtonsLayout); // Добавляем кнопки в вертикальную компоновку панели графиков
 
+    impactMapButton = new QPushButton("Карта падений", this);
+    connect(impactMapButton, &QPushButton::clicked, this, &MainWindow::onShowImpactMap);
+    graphLayout->addWidget(impactMapButton);
+
+    QHBoxLayout *sensitivityLayout = new QHBoxLayout();
+    sensitivityButton = new QPushButton("Чувствительность (торнадо)", this);
+    connect(sensitivityButton, &QPushButton::clicked, this, &MainWindow::onSensitivity);
+    sensitivityLayout->addWidget(sensitivityButton);
+    sensitivityLayout->addWidget(new QLabel("сдвиг ±%:", this));
+    sensitivitySpinBox = new QDoubleSpinBox(this);
+    sensitivitySpinBox->setRange(0.1, 100.0);
+    sensitivitySpinBox->setDecimals(1);
+    sensitivitySpinBox->setValue(10.0); // Default
+    sensitivityLayout->addWidget(sensitivitySpinBox);
+    sensitivitySigmaCheckBox = new QCheckBox("±σ ансамбля", this);
+    sensitivityLayout->addWidget(sensitivitySigmaCheckBox);
+    uncertaintyButton = new QPushButton("Неопределенность (UT)", this);
+    connect(uncertaintyButton, &QPushButton::clicked, this, &MainWindow::onUncertainty);
+    sensitivityLayout->addWidget(uncertaintyButton);
+    graphLayout->addLayout(sensitivityLayout);
+
+    workPrecisionButton = new QPushButton("Точность интеграторов", this);
+    connect(workPrecisionButton, &QPushButton::clicked, this, &MainWindow::onWorkPrecision);
+    graphLayout->addWidget(workPrecisionButton);
+
+    QHBoxLayout *surrogateLayout = new QHBoxLayout();
+    surrogateButton = new QPushButton("Построить суррогат", this);
+    connect(surrogateButton, &QPushButton::clicked, this, &MainWindow::onBuildSurrogate);
+    surrogateLayout->addWidget(surrogateButton);
+    surrogateLayout->addWidget(new QLabel("поля ±%:", this));
+    surrogateSpreadSpinBox = new QDoubleSpinBox(this);
+    surrogateSpreadSpinBox->setRange(0.0, 100.0);
+    surrogateSpreadSpinBox->setDecimals(1);
+    surrogateSpreadSpinBox->setValue(10.0); // Default
+    surrogateLayout->addWidget(surrogateSpreadSpinBox);
+    surrogateCheckBox = new QCheckBox("Графики по суррогату", this);
+    surrogateLayout->addWidget(surrogateCheckBox);
+    graphLayout->addLayout(surrogateLayout);
+
+    QHBoxLayout *surrogateFileLayout = new QHBoxLayout();
+    saveSurrogateButton = new QPushButton("Сохранить суррогат", this);
+    connect(saveSurrogateButton, &QPushButton::clicked, this, &MainWindow::onSaveSurrogate);
+    surrogateFileLayout->addWidget(saveSurrogateButton);
+    loadSurrogateButton = new QPushButton("Загрузить суррогат", this);
+    connect(loadSurrogateButton, &QPushButton::clicked, this, &MainWindow::onLoadSurrogate);
+    surrogateFileLayout->addWidget(loadSurrogateButton);
+    graphLayout->addLayout(surrogateFileLayout);
+
     leftColumnLayout->addWidget(graphFrame);
     leftColumnLayout->addStretch(); // Добавляем растяжитель, чтобы панель графиков не растягивалась слишком сильно
     
@@ -256,8 +414,25 @@ void MainWindow::setupPreviewVisualization() {
     previewTimer = new QTimer(this);
     connect(previewTimer, &QTimer::timeout, this, &MainWindow::updatePreviewVisualization);
     
-    // Рассчитываем начальную траекторию
-    calculatePreviewTrajectory();
+    // Начальная траектория считается после показа окна, чтобы не задерживать первый кадр
+    QTimer::singleShot(0, this, [this]() {
+        calculatePreviewTrajectory();
+        emit initialPreviewReady();
+    });
+}
+
+const View3DModule* MainWindow::view3d() {
+    std::string error;
+    double loadMs = 0.0;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const View3DModule* module = view3d_module(&error, &loadMs);
+    QApplication::restoreOverrideCursor();
+    if (!module) {
+        QMessageBox::warning(this, "3D-визуализация", QString("Не удалось загрузить модуль 3D-визуализации: %1").arg(QString::fromStdString(error)));
+    } else if (loadMs > 0.0) {
+        outputArea->append(QString("Модуль 3D-визуализации загружен за %1 мс.").arg(loadMs, 0, 'f', 0));
+    }
+    return module;
 }
 
 void MainWindow::calculatePreviewTrajectory() {
@@ -274,30 +449,15 @@ void MainWindow::calculatePreviewTrajectory() {
     params.initial_speed = inputFields["initial_speed"]->value();
     params.azimuth_deg = inputFields["azimuth_deg"]->value();
     
-    // Переводим углы в радианы
-    double angle_rad = params.angle_deg * 3.14 / 180.0;
-    double azimuth_rad = params.azimuth_deg * 3.14 / 180.0;
-    
-    // Начальное состояние
-    State state = {
-        0.0,
-        0.0,
-        0.0,
-        params.initial_speed * std::cos(angle_rad) * std::cos(azimuth_rad),
-        params.initial_speed * std::sin(angle_rad),
-        params.initial_speed * std::cos(angle_rad) * std::sin(azimuth_rad)
-    };
-    
-    // Рассчитываем траекторию
-    std::vector<State> states;
+    // Рассчитываем траекторию в буфер из пула
     double dt = 0.01; // Увеличенный шаг для предпросмотра (меньше точек)
-    do {
-        states.push_back(state);
-        state = runge_kutta_step(state, params, dt);
-    } while (state.y + dt * state.vy >= 0.0 && states.size() < 10000); // Ограничиваем количество точек
+    std::shared_ptr<const std::vector<State>> samples = simulate_trajectory(params, dt, 10000).share(); // Ограничиваем количество точек
+    const std::vector<State>& states = *samples;
+    previewFlight = std::make_shared<const Trajectory>(samples, params, dt);
     
     // Очищаем предыдущую траекторию
     previewScene->clear();
+    shownSweepParameter = -1;
     previewTrajectory.clear();
     
     // Находим максимальные значения для масштабирования
@@ -315,6 +475,8 @@ void MainWindow::calculatePreviewTrajectory() {
     // Центрирование
     double offsetX = previewView->width() / 2;
     double offsetY = previewView->height() * 0.9; // Земля внизу
+    previewOrigin = QPointF(offsetX, offsetY);
+    previewScale = scale;
     
     // Создаем "землю" (Ось X)
     QGraphicsLineItem *groundLine = new QGraphicsLineItem(
@@ -423,6 +585,22 @@ void MainWindow::calculatePreviewTrajectory() {
         }
     }
     
+    // Профиль рельефа под траекторией
+    if (std::shared_ptr<const Heightmap> terrain = active_terrain()) {
+        QPainterPath terrainPath;
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            QPointF point(offsetX + states[i].x * scale, offsetY - terrain->height_at(states[i].x, states[i].z) * scale);
+            if (i == 0) {
+                terrainPath.moveTo(point);
+            } else {
+                terrainPath.lineTo(point);
+            }
+        }
+        QGraphicsPathItem *terrainItem = new QGraphicsPathItem(terrainPath);
+        terrainItem->setPen(QPen(QColor(139, 90, 43), 2));
+        previewScene->addItem(terrainItem);
+    }
+
     // Добавляем путь на сцену
     QGraphicsPathItem *pathItem = new QGraphicsPathItem(path);
     pathItem->setPen(QPen(Qt::red, 2));
@@ -444,7 +622,7 @@ void MainWindow::calculatePreviewTrajectory() {
         double final_x_val = states.back().x;
         double final_z_val = states.back().z; // Используем Z координату для полной дальности
         double total_distance_val = std::sqrt(final_x_val * final_x_val + final_z_val * final_z_val);
-        double flight_time_val = (states.size() - 1) * dt;
+        double flight_time_val = previewFlight->duration(); // с рельефом - момент падения внутри шага
 
         this->m_currentFlightTime = flight_time_val; // Store flight time
 
@@ -455,42 +633,42 @@ void MainWindow::calculatePreviewTrajectory() {
                               QString("Дальность по Z: %1 м\n").arg(final_z_val, 0, 'f', 2) +
                               QString("Общая дальность: %1 м\n").arg(total_distance_val, 0, 'f', 2) +
                               QString("Время полета: %1 с").arg(flight_time_val, 0, 'f', 2);
+        // Ответ суррогата для сравнения (в его боксе, на плоской земле без поля ветра)
+        if (surrogate.valid() && surrogate.contains(params) && !active_terrain() && !active_wind_field()) {
+            double metrics[kSweepMetricCount];
+            surrogate.evaluate_all(params, metrics);
+            const int range = static_cast<int>(SweepMetric::Range), apex = static_cast<int>(SweepMetric::Apex);
+            const int time = static_cast<int>(SweepMetric::FlightTime);
+            resultsText += QString("\nСуррогат: дальность %1 ± %2 м, высота %3 ± %4 м, время %5 ± %6 с")
+                               .arg(metrics[range], 0, 'f', 2).arg(surrogate.fit(SweepMetric::Range).cv_max, 0, 'g', 2)
+                               .arg(metrics[apex], 0, 'f', 2).arg(surrogate.fit(SweepMetric::Apex).cv_max, 0, 'g', 2)
+                               .arg(metrics[time], 0, 'f', 2).arg(surrogate.fit(SweepMetric::FlightTime).cv_max, 0, 'g', 2);
+        }
         outputArea->setText(resultsText);
     } else {
         outputArea->setText("Нет данных для отображения.");
     }
     
-    // Перезапускаем анимацию
-    previewStep = 0;
+    // Перезапускаем анимацию: положение снаряда берется по времени, а не по номеру точки,
+    // так что частота кадров не зависит от шага интегрирования
+    previewClock.restart();
     if (!previewTimer->isActive()) {
-        int timerInterval = 25; // Default fallback interval
-        if (this->m_currentFlightTime > 0 && !previewTrajectory.isEmpty() && previewTrajectory.size() > 1) {
-            timerInterval = static_cast<int>((this->m_currentFlightTime * 1000) / (previewTrajectory.size() -1) ); // milliseconds per step
-            if (timerInterval <= 0) {
-                timerInterval = 1; // Ensure a positive interval, minimum 1ms
-            }
-        } else if (!previewTrajectory.isEmpty() && previewTrajectory.size() == 1) {
-             timerInterval = 1000; // If only one point, can be a longer static display or handled differently
-        }
-        previewTimer->start(timerInterval);
+        previewTimer->start(16);
     }
 }
 
 void MainWindow::updatePreviewVisualization() {
-    if (previewTrajectory.isEmpty()) {
+    if (!previewFlight || previewFlight->empty()) {
         previewTimer->stop();
         return;
     }
-    
-    // Обновляем позицию снаряда
-    if (previewStep < previewTrajectory.size()) {
-        QPointF pos = previewTrajectory.at(previewStep);
-        projectileItem->setPos(pos.x() - 5, pos.y() - 5); // -5 для центрирования
-        previewStep++;
-    } else {
-        // Запускаем анимацию заново
-        previewStep = 0;
-    }
+
+    // Полет повторяется по кругу в реальном времени
+    double duration = previewFlight->duration();
+    double t = duration > 0.0 ? std::fmod(previewClock.elapsed() / 1000.0, duration) : 0.0;
+    State state = previewFlight->at(t);
+    QPointF pos(previewOrigin.x() + state.x * previewScale, previewOrigin.y() - state.y * previewScale);
+    projectileItem->setPos(pos.x() - 5, pos.y() - 5); // -5 для центрирования
 }
 
 void MainWindow::onRunSimulation() {
@@ -498,7 +676,9 @@ void MainWindow::onRunSimulation() {
     if (!validateCurrentParameters(params)) {
         return;
     }
-    StartSimulation(params);
+    if (const View3DModule* module = view3d()) {
+        module->start_simulation(params);
+    }
 }
 
 void MainWindow::onRunAnimatedSimulation() {
@@ -506,7 +686,9 @@ void MainWindow::onRunAnimatedSimulation() {
     if (!validateCurrentParameters(params)) {
         return;
     }
-    StartAnimatedSimulation(params);
+    if (const View3DModule* module = view3d()) {
+        module->start_animated_simulation(params);
+    }
 }
 
 void MainWindow::onShowInstructions() {
@@ -519,14 +701,31 @@ void MainWindow::onShowInstructions() {
         "Кнопки на левой панели:\n" \
         "- \"Запустить симуляцию\": Открывает окно с 3D-визуализацией конечной траектории.\n" \
         "- \"Запустить анимацию\": Открывает окно с анимированной 3D-визуализацией полета.\n" \
-        "- \"Сохранить параметры\": Сохраняет текущие параметры в файл.\n" \
-        "- \"Загрузить параметры\": Загружает параметры из файла.\n" \
-        "- \"Инструкция\": Показывает это окно.\n\n" \
+        "- \"Сохранить параметры\": Сохраняет текущие параметры в файл сценариев (.scn).\n" \
+        "- \"Загрузить параметры\": Загружает файл сценариев (много именованных наборов параметров, развертки и ансамбли), а также старые файлы key=value и Parameters.txt. Если записей несколько, предлагается выбрать одну; развертка заполняет и секцию графиков.\n" \
+        "- \"Инструкция\": Показывает это окно.\n" \
+        "- \"Загрузить рельеф\": Загружает карту высот (ESRI ASCII .asc или float32 .raw/.bin с заголовком .hdr). Точка выстрела помещается на поверхность, снаряд падает на рельеф, за пределами карты - на плоскость Y = 0.\n" \
+        "- \"Убрать рельеф\": Возвращает плоскую землю.\n" \
+        "- \"Загрузить поле ветра\": Загружает сеточное поле ветра (.wnd, формат описан в windfield.h): по высоте, в 3D и, при нескольких срезах, во времени. Поле добавляется к постоянному ветру из параметров.\n" \
+        "- \"Убрать поле ветра\": Оставляет только постоянный ветер.\n" \
+        "- \"Угол наибольшей дальности\": Находит угол возвышения с наибольшей дальностью при текущих сопротивлении, ветре, рельефе и поле ветра (около десятка полетов) и подставляет его в параметры. Можно ограничить время полета; с поправкой азимута подбирается и азимут, при котором снаряд с учетом сноса падает на заданном направлении.\n\n" \
         "Секция \"Построение графиков зависимостей\":\n" \
-        "- \"Тип графика\": Выбор зависимости для построения.\n" \
+        "- \"Параметр\", \"Величина\": Варьируемый параметр и величина по оси Y (дальность, высота, время полета, скорость падения, боковой снос). Развертка сохраняет все величины сразу: смена величины перерисовывает график без расчета, повторное построение той же развертки тоже не считает полеты.\n" \
         "- \"Мин./Макс. знач. параметра\", \"Шаг параметра\": Настройка диапазона для графика.\n" \
-        "- \"Построить график\": Строит график в области 2D-предпросмотра.\n" \
-        "- \"К предпросмотру траектории\": Возвращает отображение 2D-траектории.\n\n" \
+        "- \"Адаптивная развертка\": Вместо равномерного шага считает грубую сетку и дробит интервалы, где кривая меняется резко (оценка ошибки интерполяции дальности, высоты или времени полета больше допуска в % от размаха величины; скорость падения и снос записываются, но уточнения не требуют), пока не кончится бюджет полетов.\n" \
+        "- \"Рабочих процессов\": При значении больше 0 развертка делится на шарды и считается в отдельных процессах; сбойные шарды перезапускаются.\n" \
+        "- \"Кэш результатов на диске\": Итоги полетов сохраняются между запусками; повторные развертки с теми же параметрами берутся из кэша.\n" \
+        "- \"Сводить полеты с равными k и поворотом по азимуту\": Масса, Cd, плотность и радиус влияют на полет только через k = 0.5·Cd·ρ·A/m, а на плоской земле без поля ветра смена азимута (вместе с ветром) лишь поворачивает траекторию. Точки развертки с одинаковыми k, g, скоростью, углом и ветром в системе выстрела считаются одним полетом, точка падения поворачивается на разницу азимутов; посчитанные полеты запоминаются между развертками. Например, развертка по азимуту при нулевом ветре - один полет.\n" \
+        "- \"Быстрый режим (float32)\": Считает развертку в одинарной точности с выборочной проверкой в double; при расхождении больше допуска развертка пересчитывается в double.\n" \
+        "- \"Построить график\": Строит график в области 2D-предпросмотра; точки появляются по мере расчета. Колесико мыши - масштаб вокруг курсора (с Shift - только по X), перетаскивание - сдвиг, двойной щелчок - весь график. Большие развертки прореживаются по столбцам пикселей без потери пиков.\n" \
+        "- \"К предпросмотру траектории\": Возвращает отображение 2D-траектории.\n" \
+        "- \"Развертка в 3D\": Показывает все траектории развертки в одном 3D-окне с раскраской по выбранной величине. С включенным кэшем результатов траектории сохраняются в него сжатыми и при повторном показе не пересчитываются.\n" \
+        "- \"Карта падений\": Плотность точек падения на плоскости X-Z для ансамбля, выбранного при загрузке файла сценариев (разброс вокруг текущих параметров), или для текущей развертки. Показывается изображением в области предпросмотра и текстурой на земле в 3D-окне вместе с частью траекторий; считается во всех потоках, память - по размеру сетки, а не по числу полетов.\n" \
+        "- \"Чувствительность (торнадо)\": Сдвигает каждый параметр вниз и вверх от текущего значения (на заданный % или, с отметкой \"±σ ансамбля\", на σ ансамбля из файла сценариев), считает все полеты одним параллельным пакетом и строит диаграммы \"торнадо\" для дальности, высоты и бокового сноса: параметры упорядочены по силе влияния. Нулевые ветер и азимут сдвигаются на % от 10 м/с и 90°.\n" \
+        "- \"Неопределенность (UT)\": Переносит разброс параметров ансамбля из файла сценариев (σ каждого поля) на точку падения методом сигма-точек: не больше 21 полета вместо тысяч в Монте-Карло. Выводит среднюю точку падения, ковариацию, дальность и снос с σ и рисует эллипсы рассеивания 1σ и 95% в предпросмотре (вид сверху) и на земле в 3D-окне вместе с траекториями сигма-точек.\n" \
+        "- \"Точность интеграторов\": Считает эталонные выстрелы и текущие параметры разными методами (Эйлер, RK2, RK3, RK4, RK5) и шагами, строит диаграммы \"ошибка - число вычислений\" и \"ошибка - время счета\" в логарифмическом масштабе и выводит самые быстрые настройки для каждого допуска. Рельеф и поле ветра в сравнении не учитываются.\n" \
+        "- \"Построить суррогат\": Считает 1500 полетов по латинскому гиперкубу в боксе вокруг текущих параметров (поля ±%, параметр графика - на весь диапазон графика, g фиксировано) и подбирает многочлены Чебышева для всех величин графика; степень и ошибка определяются 5-кратной перекрестной проверкой. Модель вычисляется за единицы микросекунд; в предпросмотре рядом с расчетом выводится ее ответ с ошибкой, а с отметкой \"Графики по суррогату\" развертки внутри бокса строятся без полетов. Только для плоской земли без поля ветра.\n" \
+        "- \"Сохранить/Загрузить суррогат\": Бинарный файл .sur с боксом, степенями, ошибками и коэффициентами.\n\n" \
         "Окно 3D-симуляции:\n" \
         "- Управление камерой: Вращение (ЛКМ), приближение/отдаление (колесико/ПКМ), панорамирование (СКМ/Shift+ЛКМ).\n" \
         "- Отображаются оси X, Y, Z и сетка.\n" \
@@ -536,25 +735,110 @@ void MainWindow::onShowInstructions() {
     QMessageBox::information(this, "Инструкция", instructionText);
 }
 
+// Загрузка карты высот рельефа
+void MainWindow::onLoadTerrain() {
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Загрузить рельеф"), "",
+                                                    tr("Heightmaps (*.asc *.raw *.bin);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    std::string error;
+    std::shared_ptr<Heightmap> terrain = Heightmap::load(fileName.toStdString(), &error);
+    if (!terrain) {
+        QMessageBox::warning(this, "Ошибка загрузки рельефа", QString::fromStdString(error));
+        return;
+    }
+    terrain->rebase_to_origin();
+    set_active_terrain(terrain);
+    clearTerrainButton->setEnabled(true);
+    calculatePreviewTrajectory();
+}
+
+void MainWindow::onClearTerrain() {
+    set_active_terrain(nullptr);
+    clearTerrainButton->setEnabled(false);
+    calculatePreviewTrajectory();
+}
+
+// Загрузка сеточного поля ветра (файл отображается в память, а не читается)
+void MainWindow::onLoadWindField() {
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Загрузить поле ветра"), "",
+                                                    tr("Wind Fields (*.wnd);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    std::string error;
+    std::shared_ptr<WindField> field = WindField::load(fileName.toStdString(), &error);
+    if (!field) {
+        QMessageBox::warning(this, "Ошибка загрузки поля ветра", QString::fromStdString(error));
+        return;
+    }
+    set_active_wind_field(field);
+    clearWindFieldButton->setEnabled(true);
+    calculatePreviewTrajectory();
+}
+
+void MainWindow::onClearWindField() {
+    set_active_wind_field(nullptr);
+    clearWindFieldButton->setEnabled(false);
+    calculatePreviewTrajectory();
+}
+
+// Угол возвышения (и при поправке на снос - азимут) с наибольшей дальностью
+void MainWindow::onFindOptimalAngle() {
+    Parameters params;
+    if (!validateCurrentParameters(params)) {
+        return;
+    }
+    ElevationSearchOptions options;
+    options.max_flight_time = maxFlightTimeSpinBox->value();
+    options.correct_azimuth = correctAzimuthCheckBox->isChecked();
+    ElevationSearchResult result = find_optimal_elevation(params, options);
+    if (!result.found) {
+        outputArea->setText("Не удалось найти угол наибольшей дальности.");
+        return;
+    }
+
+    QString text = QString("Угол наибольшей дальности: %1° (был %2°), дальность %3 м, время полета %4 с, полетов: %5")
+                       .arg(result.elevation_deg, 0, 'f', 2).arg(params.angle_deg, 0, 'f', 2)
+                       .arg(result.summary.total_distance, 0, 'f', 2).arg(result.summary.flight_time, 0, 'f', 2)
+                       .arg(result.flights);
+    if (result.time_limited) {
+        text += QString("\nУгол ограничен временем полета %1 с.").arg(options.max_flight_time, 0, 'f', 2);
+    }
+    if (options.correct_azimuth) {
+        text += QString("\nАзимут с поправкой на снос: %1° (задан %2°), отклонение точки падения от направления %3°")
+                    .arg(result.azimuth_deg, 0, 'f', 2).arg(params.azimuth_deg, 0, 'f', 2).arg(result.bearing_error_deg, 0, 'f', 3);
+        inputFields["azimuth_deg"]->setValue(result.azimuth_deg);
+    }
+    inputFields["angle_deg"]->setValue(result.elevation_deg);
+    calculatePreviewTrajectory();
+    outputArea->append(text);
+}
+
 // Реализация слота для сохранения параметров
 void MainWindow::onSaveParameters() {
     QString fileName = QFileDialog::getSaveFileName(this, 
                                                     tr("Сохранить параметры"), "",
-                                                    tr("Parameter Files (*.ini);;All Files (*)"));
+                                                    tr("Scenario Files (*.scn);;All Files (*)"));
     if (fileName.isEmpty()) {
         return;
-    } else {
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            // Можно добавить обработку ошибок, например, QMessageBox
-            return;
-        }
+    }
 
-        QTextStream out(&file);
-        for (auto it = inputFields.constBegin(); it != inputFields.constEnd(); ++it) {
-            out << it.key() << "=" << it.value()->value() << "\n";
-        }
-        file.close();
+    // Текущие параметры сохраняются как файл сценариев из одного сценария
+    ScenarioFile file;
+    Parameters params;
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        scenario_parameter(params, i) = inputFields[QString::fromUtf8(scenario_parameter_name(i).data(), static_cast<int>(scenario_parameter_name(i).size()))]->value();
+    }
+    file.scenarios.push_back({ "current", params });
+    std::string error;
+    if (!save_scenario_file(fileName.toStdString(), file, &error)) {
+        QMessageBox::warning(this, "Ошибка сохранения", QString::fromStdString(error));
     }
 }
 
@@ -562,160 +846,164 @@ void MainWindow::onSaveParameters() {
 void MainWindow::onLoadParameters() {
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     tr("Загрузить параметры"), "",
-                                                    tr("Parameter Files (*.ini);;All Files (*)"));
+                                                    tr("Scenario Files (*.scn *.ini *.txt);;All Files (*)"));
     if (fileName.isEmpty()) {
         return;
-    } else {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            // Можно добавить обработку ошибок
+    }
+
+    // Файл сценариев, старый key=value или Parameters.txt
+    ScenarioFile file;
+    std::string error;
+    if (!load_scenario_file(fileName.toStdString(), file, &error)) {
+        QMessageBox::warning(this, "Ошибка загрузки", QString::fromStdString(error));
+        return;
+    }
+    if (file.scenarios.empty() && file.sweeps.empty() && file.ensembles.empty()) {
+        QMessageBox::warning(this, "Ошибка загрузки", "В файле нет сценариев.");
+        return;
+    }
+
+    // Из нескольких записей пользователь выбирает одну; развертка заполняет и секцию графиков,
+    // ансамбль запоминается для карты падений
+    int choice = 0;
+    if (file.scenarios.size() + file.sweeps.size() + file.ensembles.size() > 1) {
+        QStringList items;
+        for (std::size_t i = 0; i < file.scenarios.size(); ++i) {
+            items << QString("Сценарий %1: %2").arg(i + 1).arg(QString::fromUtf8(file.scenarios[i].name.data(), static_cast<int>(file.scenarios[i].name.size())));
+        }
+        for (const SweepDefinition& sweep : file.sweeps) {
+            items << QString("Развертка: %1").arg(QString::fromUtf8(sweep.name.data(), static_cast<int>(sweep.name.size())));
+        }
+        for (const EnsembleDefinition& ensemble : file.ensembles) {
+            items << QString("Ансамбль: %1").arg(QString::fromUtf8(ensemble.name.data(), static_cast<int>(ensemble.name.size())));
+        }
+        bool ok = false;
+        QString item = QInputDialog::getItem(this, "Загрузить параметры", "Запись файла:", items, 0, false, &ok);
+        if (!ok) {
             return;
         }
+        choice = static_cast<int>(items.indexOf(item));
+    }
 
-        QTextStream in(&file);
-        while (!in.atEnd()) {
-            QString line = in.readLine();
-            QStringList parts = line.split('=');
-            if (parts.size() == 2) {
-                QString key = parts[0].trimmed();
-                double value = parts[1].trimmed().toDouble();
-                if (inputFields.contains(key)) {
-                    inputFields[key]->setValue(value);
-                }
-            }
+    const SweepDefinition* sweep = nullptr;
+    Parameters params;
+    int sweepChoice = choice - static_cast<int>(file.scenarios.size());
+    int ensembleChoice = sweepChoice - static_cast<int>(file.sweeps.size());
+    ensembleCount = 0;
+    if (sweepChoice < 0) {
+        params = file.scenarios[choice].params;
+    } else if (ensembleChoice < 0) {
+        sweep = &file.sweeps[sweepChoice];
+        params = sweep->base_params;
+    } else {
+        const EnsembleDefinition& ensemble = file.ensembles[ensembleChoice];
+        params = ensemble.base_params;
+        ensembleSigma = ensemble.sigma;
+        ensembleCount = ensemble.count;
+        ensembleSeed = ensemble.seed;
+    }
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        QString key = QString::fromUtf8(scenario_parameter_name(i).data(), static_cast<int>(scenario_parameter_name(i).size()));
+        if (inputFields.contains(key)) {
+            inputFields[key]->setValue(scenario_parameter(params, i));
         }
-        file.close();
-        calculatePreviewTrajectory(); // Обновляем предпросмотр после загрузки
     }
-}
 
-MainWindow::SimulationResult MainWindow::runSingleSimulationForGraph(Parameters params) {
-    State state = {
-        0.0, 0.0, 0.0,
-        params.initial_speed * std::cos(params.angle_deg * 3.1415926535 / 180.0) * std::cos(params.azimuth_deg * 3.1415926535 / 180.0),
-        params.initial_speed * std::sin(params.angle_deg * 3.1415926535 / 180.0),
-        params.initial_speed * std::cos(params.angle_deg * 3.1415926535 / 180.0) * std::sin(params.azimuth_deg * 3.1415926535 / 180.0)
-    };
-
-    std::vector<State> states;
-    double dt = 0.01; // Более точный dt для расчета графика
-    do {
-        states.push_back(state);
-        state = runge_kutta_step(state, params, dt);
-    } while (state.y + dt * state.vy >= 0.0 && states.size() < 10000); // Ограничиваем количество точек
-
-    SimulationResult result;
-    if (!states.empty()) {
-        for (const auto& s_val : states) {
-            if (s_val.y > result.max_height) result.max_height = s_val.y;
+    if (sweep) {
+        // Номер группы графика для поля Parameters (g в графиках не варьируется)
+        static const int kGraphGroupOfParameter[kScenarioParameterCount] = { 2, 3, 4, 5, -1, 6, 7, 1, 0, 8 };
+        int group = kGraphGroupOfParameter[sweep->parameter];
+        int comboIndex = group >= 0 ? graphTypeComboBox->findData(group) : -1;
+        if (comboIndex >= 0) {
+            graphTypeComboBox->setCurrentIndex(comboIndex);
+            graphParamMinSpinBox->setValue(sweep->from);
+            graphParamMaxSpinBox->setValue(sweep->to);
+            graphParamStepSpinBox->setValue(sweep->step);
+        } else {
+            QMessageBox::information(this, "Загрузить параметры", "Этот параметр нельзя варьировать в графиках; загружены только базовые параметры развертки.");
         }
-        double final_x_val = states.back().x;
-        double final_z_val = states.back().z;
-        result.total_distance = std::sqrt(final_x_val * final_x_val + final_z_val * final_z_val);
-        result.flight_time = (states.size() - 1) * dt;
     }
-    return result;
+    calculatePreviewTrajectory(); // Обновляем предпросмотр после загрузки
 }
 
-void MainWindow::drawDependencyGraph(const QList<QPointF>& dataPoints, const QString& xLabelText, const QString& yLabelText, double xMin, double xMax, double yMin, double yMax) {
+DecimatedPlotItem* MainWindow::startDependencyGraph(const QString& xLabelText, const QString& yLabelText) {
     previewScene->clear(); // Очищаем сцену перед отрисовкой графика
+    shownSweepParameter = -1;
 
+    // График занимает всю область предпросмотра; точки добавляются по мере расчета развертки
+    DecimatedPlotItem *plotItem = new DecimatedPlotItem(QRectF(0, 0, previewView->width(), previewView->height()), xLabelText, yLabelText);
+    previewScene->addItem(plotItem);
+    return plotItem;
+}
 
-    // DIAGNOSTIC TEXT - END
-
-    // Масштабирование и отступы (возвращаем к версии без заголовка, но с фиксом перекрытия текста)
-    double plotWidth = previewView->width() * 0.85;
-    double plotHeight = previewView->height() * 0.80; // Восстановлено
-    double H_MARGIN = previewView->width() * 0.10;
-    double V_MARGIN_TOP = previewView->height() * 0.05; // Восстановлено
-    double V_MARGIN_BOTTOM = previewView->height() * 0.15;
 
-    if (dataPoints.isEmpty()) {
-        QGraphicsTextItem *noDataText = new QGraphicsTextItem("Нет данных для построения графика.");
-        noDataText->setFont(QFont("Arial", 12));
-        noDataText->setPos(previewView->width()/2 - noDataText->boundingRect().width()/2, previewView->height()/2 - noDataText->boundingRect().height()/2);
-        previewScene->addItem(noDataText);
-        return;
+// Подписи осей графика зависимости по группе параметра и величине
+static QString sweepParameterLabel(int graphTypeIndex) {
+    switch (graphTypeIndex) {
+        case 0: return "Начальная скорость (м/с)";
+        case 1: return "Угол (градусы)";
+        case 2: return "Масса (кг)";
+        case 3: return "Коэф. сопр.";
+        case 4: return "Плотность воздуха (кг/м³)";
+        case 5: return "Радиус (м)";
+        case 6: return "Ветер X (м/с)";
+        case 7: return "Ветер Z (м/с)";
+        case 8: return "Азимут (градусы)";
+        default: return "Параметр";
     }
+}
 
-    double effectiveXRange = (xMax - xMin == 0) ? 1 : (xMax - xMin);
-    double effectiveYRange = (yMax - yMin == 0) ? 1 : (yMax - yMin);
-
-    double scaleX = plotWidth / effectiveXRange;
-    double scaleY = plotHeight / effectiveYRange;
+static QString sweepMetricLabel(SweepMetric metric) {
+    switch (metric) {
+        case SweepMetric::Range: return "Дальность (м)";
+        case SweepMetric::Apex: return "Макс. высота (м)";
+        case SweepMetric::FlightTime: return "Время полета (с)";
+        case SweepMetric::ImpactSpeed: return "Скорость падения (м/с)";
+        case SweepMetric::LateralDrift: return "Боковой снос (м)";
+    }
+    return "Результат";
+}
 
-    // Ось X
-    QGraphicsLineItem *xAxis = new QGraphicsLineItem(H_MARGIN, V_MARGIN_TOP + plotHeight, H_MARGIN + plotWidth, V_MARGIN_TOP + plotHeight);
-    xAxis->setPen(QPen(Qt::black, 2));
-    previewScene->addItem(xAxis);
-    
-    // Restore xLabel to its original logic with explicit color
-    QGraphicsTextItem *xLabel = new QGraphicsTextItem(xLabelText); // Original text restored
-    xLabel->setFont(QFont("Arial", 10));
-    xLabel->setDefaultTextColor(Qt::black); // Keep explicit color
-    xLabel->setPos(H_MARGIN + plotWidth / 2 - xLabel->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 25); // Original position restored
-    previewScene->addItem(xLabel);
-
-    // Ось Y
-    QGraphicsLineItem *yAxis = new QGraphicsLineItem(H_MARGIN, V_MARGIN_TOP, H_MARGIN, V_MARGIN_TOP + plotHeight);
-    yAxis->setPen(QPen(Qt::black, 2));
-    previewScene->addItem(yAxis);
-    QGraphicsTextItem *yLabel = new QGraphicsTextItem(yLabelText);
-    yLabel->setFont(QFont("Arial", 10));
-    yLabel->setDefaultTextColor(Qt::black); // Keep explicit color
-    yLabel->setRotation(-90); // Поворачиваем метку для оси Y
-    yLabel->setPos(H_MARGIN - yLabel->boundingRect().height() - 45, V_MARGIN_TOP + plotHeight / 2 + yLabel->boundingRect().width()/2);
-    previewScene->addItem(yLabel);
-    
-    // Добавляем метки на осях
-    int numTicks = 5; // Количество делений на осях
-    QFont tickFont("Arial", 8);
+SweepKey MainWindow::currentSweepKey(const Parameters& baseParams) const {
+    SweepKey key;
+    key.base = baseParams;
+    key.parameter = graphTypeComboBox->currentData().toInt();
+    key.from = graphParamMinSpinBox->value();
+    key.to = graphParamMaxSpinBox->value();
+    key.step = graphParamStepSpinBox->value();
+    key.adaptive = adaptiveSweepCheckBox->isChecked();
+    key.adaptive_tolerance = adaptiveToleranceSpinBox->value() / 100.0;
+    key.adaptive_budget = static_cast<std::size_t>(adaptiveBudgetSpinBox->value());
+    key.single_precision = singlePrecisionCheckBox->isChecked();
+    key.precision_tolerance = precisionToleranceSpinBox->value() / 100.0;
+    key.terrain = active_terrain();
+    key.wind_field = active_wind_field();
+    key.surrogate = surrogateCheckBox->isChecked() && surrogate.valid() && !key.terrain && !key.wind_field;
+    return key;
+}
 
-    // Метки по X
-    for (int i = 0; i <= numTicks; ++i) {
-        double val = xMin + (effectiveXRange / numTicks) * i;
-        double xPos = H_MARGIN + (val - xMin) * scaleX;
-        QGraphicsLineItem *tick = new QGraphicsLineItem(xPos, V_MARGIN_TOP + plotHeight, xPos, V_MARGIN_TOP + plotHeight + 5);
-        previewScene->addItem(tick);
-        QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(val, 'f', 1));
-        label->setFont(tickFont);
-        label->setDefaultTextColor(Qt::black); // Keep explicit color
-        label->setPos(xPos - label->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 10);
-        previewScene->addItem(label);
-    }
-
-    // Метки по Y
-    for (int i = 0; i <= numTicks; ++i) {
-        double val = yMin + (effectiveYRange / numTicks) * i;
-        double yPos = V_MARGIN_TOP + plotHeight - (val - yMin) * scaleY;
-         QGraphicsLineItem *tick = new QGraphicsLineItem(H_MARGIN - 5, yPos, H_MARGIN, yPos);
-        previewScene->addItem(tick);
-        QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(val, 'f', 1));
-        label->setFont(tickFont);
-        label->setDefaultTextColor(Qt::black); // Keep explicit color
-        label->setPos(H_MARGIN - label->boundingRect().width() - 10, yPos - label->boundingRect().height() / 2);
-        previewScene->addItem(label);
-    }
-
-
-    // Рисуем график
-    QPainterPath path;
-    if (!dataPoints.isEmpty()) {
-        QPointF firstScaledPoint(H_MARGIN + (dataPoints.first().x() - xMin) * scaleX,
-                                 V_MARGIN_TOP + plotHeight - (dataPoints.first().y() - yMin) * scaleY);
-        path.moveTo(firstScaledPoint);
-        for (int i = 1; i < dataPoints.size(); ++i) {
-            QPointF scaledPoint(H_MARGIN + (dataPoints.at(i).x() - xMin) * scaleX,
-                                V_MARGIN_TOP + plotHeight - (dataPoints.at(i).y() - yMin) * scaleY);
-            path.lineTo(scaledPoint);
-        }
+void MainWindow::drawSweepRecord(const SweepRecord& record) {
+    SweepMetric metric = static_cast<SweepMetric>(graphMetricComboBox->currentData().toInt());
+    DecimatedPlotItem *plotItem = startDependencyGraph(sweepParameterLabel(record.key.parameter), sweepMetricLabel(metric));
+    std::vector<QPointF> points;
+    points.reserve(record.size());
+    for (std::size_t i = 0; i < record.size(); ++i) {
+        points.push_back(QPointF(record.values[i], record.metric(i, metric)));
     }
-
-    QGraphicsPathItem *pathItem = new QGraphicsPathItem(path);
-    pathItem->setPen(QPen(Qt::blue, 2));
-    previewScene->addItem(pathItem);
+    plotItem->append(points);
+    shownSweepParameter = record.key.parameter;
 }
 
+void MainWindow::onGraphMetricChanged(int index) {
+    Q_UNUSED(index);
+    // Если на экране график развертки, он перерисовывается из сохраненных точек
+    if (shownSweepParameter < 0) {
+        return;
+    }
+    if (const SweepRecord* record = sweepStore.find_parameter(shownSweepParameter)) {
+        drawSweepRecord(*record);
+    }
+}
 
 void MainWindow::onPlotDependencyGraph() {
     // Validate graph specific parameters
@@ -723,7 +1011,7 @@ void MainWindow::onPlotDependencyGraph() {
         QMessageBox::warning(this, "Ошибка параметров графика", "Минимальное значение параметра должно быть меньше максимального.");
         return;
     }
-    if (graphParamStepSpinBox->value() <= 0) {
+    if (!adaptiveSweepCheckBox->isChecked() && graphParamStepSpinBox->value() <= 0) {
         QMessageBox::warning(this, "Ошибка параметров графика", "Шаг параметра должен быть больше нуля.");
         return;
     }
@@ -737,116 +1025,1045 @@ void MainWindow::onPlotDependencyGraph() {
     double paramMin = graphParamMinSpinBox->value();
     double paramMax = graphParamMaxSpinBox->value();
     double paramStep = graphParamStepSpinBox->value();
+    if (graphTypeIndex < 0 || graphTypeIndex > 8) {
+        outputArea->setText("Неизвестный тип графика.");
+        return;
+    }
+
+    if (previewTimer->isActive()) {
+        previewTimer->stop();
+    }
 
-    QList<QPointF> dataPoints;
-    QString yLabel = "Y"; 
-    QString xLabel = "X"; 
-    double currentYMin = std::numeric_limits<double>::max();
-    double currentYMax = std::numeric_limits<double>::lowest();
-    double currentXMin = std::numeric_limits<double>::max();
-    double currentXMax = std::numeric_limits<double>::lowest();
+    // Та же развертка уже посчитана: все величины в ней есть, пересчет не нужен
+    SweepKey sweepKey = currentSweepKey(baseParams);
+    if (const SweepRecord* stored = sweepStore.find(sweepKey)) {
+        drawSweepRecord(*stored);
+        outputArea->setText(QString("Развертка уже посчитана (%1 точек), график построен без расчета.").arg(stored->size()));
+        outputArea->append("График: колесико - масштаб (с Shift - только по X), перетаскивание - сдвиг, двойной щелчок - весь график.");
+        return;
+    }
 
-    // Determine labels based on graph type BEFORE the loop
+    // Развертка внутри бокса суррогата: точки - значения модели, полеты не считаются
+    QString surrogateText;
+    if (sweepKey.surrogate) {
+        SweepRecord record;
+        record.key = sweepKey;
+        bool inside = true;
+        QElapsedTimer surrogateClock;
+        surrogateClock.start();
+        for (double val = paramMin; val <= paramMax; val += paramStep) {
+            Parameters tempParams = baseParams;
+            if (!applySweepValue(tempParams, graphTypeIndex, val)) {
+                continue;
+            }
+            if (!surrogate.contains(tempParams)) {
+                inside = false;
+                break;
+            }
+            double metrics[kSweepMetricCount];
+            surrogate.evaluate_all(tempParams, metrics);
+            record.add(val, metrics);
+        }
+        if (inside && record.size() > 0) {
+            drawSweepRecord(record);
+            SweepMetric metric = static_cast<SweepMetric>(graphMetricComboBox->currentData().toInt());
+            const SurrogateFit& fit = surrogate.fit(metric);
+            outputArea->setText(QString("График по суррогату: %1 точек за %2 мс без полетов.\n"
+                                        "Ошибка величины по перекрестной проверке: СКО %3, наибольшая %4.")
+                                    .arg(record.size()).arg(surrogateClock.nsecsElapsed() * 1e-6, 0, 'f', 2)
+                                    .arg(fit.cv_rms, 0, 'g', 3).arg(fit.cv_max, 0, 'g', 3));
+            outputArea->append("График: колесико - масштаб (с Shift - только по X), перетаскивание - сдвиг, двойной щелчок - весь график.");
+            sweepStore.store(std::move(record));
+            return;
+        }
+        sweepKey.surrogate = false;
+        surrogateText = "Развертка выходит за бокс суррогата - точки посчитаны полетами.";
+    }
+
+    BatchOptions batchOptions;
+    batchOptions.single_precision = singlePrecisionCheckBox->isChecked();
+    batchOptions.tolerance = precisionToleranceSpinBox->value() / 100.0;
+    BatchReport batchReport;
+    QString shardText;
+    auto mergeReport = [&batchReport](const BatchReport& part) {
+        batchReport.flights += part.flights;
+        batchReport.single_precision_flights += part.single_precision_flights;
+        batchReport.verified += part.verified;
+        batchReport.max_divergence = std::max(batchReport.max_divergence, part.max_divergence);
+        batchReport.tolerance_exceeded = batchReport.tolerance_exceeded || part.tolerance_exceeded;
+        batchReport.escalated = batchReport.escalated || part.escalated;
+    };
+    auto evaluate = [&](const std::vector<Parameters>& sweepPart) -> std::vector<FlightSummary> {
+        if (sweepWorkersSpinBox->value() <= 0) {
+            BatchReport partReport;
+            std::vector<FlightSummary> partResults = evaluate_batch(sweepPart, batchOptions, &partReport);
+            mergeReport(partReport);
+            return partResults;
+        }
+        // Развертка по рабочим процессам; окно обновляет прогресс, но повторный запуск заблокирован
+        ShardOptions shardOptions;
+        shardOptions.workers = sweepWorkersSpinBox->value();
+        shardOptions.batch = batchOptions;
+        ShardReport shardReport;
+        plotGraphButton->setEnabled(false);
+        std::vector<FlightSummary> partResults = run_sharded_sweep(sweepPart, shardOptions, &shardReport, [this](std::size_t done, std::size_t total) {
+            outputArea->setText(QString("Развертка: %1 из %2 полетов").arg(done).arg(total));
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        });
+        plotGraphButton->setEnabled(true);
+        mergeReport(shardReport.batch);
+        shardText = QString("Процессов: %1, шардов: %2, сбоев: %3, повторено шардов: %4, досчитано в этом окне: %5")
+                        .arg(shardReport.workers).arg(shardReport.shards).arg(shardReport.failed_attempts)
+                        .arg(shardReport.retried_shards).arg(shardReport.local_shards);
+        return partResults;
+    };
+
+    SweepMetric metric = static_cast<SweepMetric>(graphMetricComboBox->currentData().toInt());
+    DecimatedPlotItem *plotItem = startDependencyGraph(sweepParameterLabel(graphTypeIndex), sweepMetricLabel(metric));
+
+    // Через кэш считаются только полеты, которых в нем еще нет
+    bool useCache = resultCacheCheckBox->isChecked() && ResultCache::instance().is_open();
+    std::size_t cacheHits = 0;
+    std::size_t cacheLookups = 0;
+    std::size_t flightCount = 0;
+    auto evaluateFlights = [&](const std::vector<Parameters>& flights) -> std::vector<FlightSummary> {
+        cacheLookups += flights.size();
+        if (!useCache) {
+            return evaluate(flights);
+        }
+        std::size_t partHits = 0;
+        std::vector<FlightSummary> partResults = evaluate_with_cache(ResultCache::instance(), flights, batchOptions, evaluate, &partHits);
+        cacheHits += partHits;
+        return partResults;
+    };
+    // Планировщик сводит точки к каноническим полетам (равные k, поворот по азимуту)
+    // и помнит их между развертками; до кэша и расчета доходят только новые
+    bool usePlanner = invariantSweepCheckBox->isChecked();
+    std::uint64_t environment = usePlanner ? result_cache_environment() : 0;
+    SweepPlanReport planReport;
+    auto evaluateSweep = [&](const std::vector<Parameters>& sweepPart) -> std::vector<FlightSummary> {
+        flightCount += sweepPart.size();
+        if (!usePlanner) {
+            return evaluateFlights(sweepPart);
+        }
+        return sweepPlanner.evaluate(sweepPart, batchOptions, environment, evaluateFlights, &planReport);
+    };
+
+    // Каждая точка записывается со всеми величинами; на график идет выбранная
+    SweepRecord record;
+    record.key = sweepKey;
+    QString adaptiveText;
+    std::vector<QPointF> chunkPoints;
+    if (adaptiveSweepCheckBox->isChecked()) {
+        // Грубая сетка и уточнение там, где резко меняется хотя бы одна из гладких величин; каждый проход - один пакет
+        AdaptiveSweepOptions adaptiveOptions;
+        adaptiveOptions.tolerance = adaptiveToleranceSpinBox->value() / 100.0;
+        adaptiveOptions.budget = static_cast<std::size_t>(adaptiveBudgetSpinBox->value());
+        // Уточнение по гладким величинам: дальность, высота, время полета. Скорость падения берется
+        // в последней точке РК4 и скачет на каждом шаге приземления, снос без бокового ветра - шум
+        // округления; по ним развертка всегда исчерпала бы бюджет. Записываются все величины
+        constexpr int kRefineChannels = static_cast<int>(SweepMetric::FlightTime) + 1;
+        adaptiveOptions.channels = kRefineChannels;
+        AdaptiveSweepReport adaptiveReport;
+        adaptive_sweep(paramMin, paramMax, [&](const std::vector<double>& values) {
+            std::vector<double> metrics(values.size() * kRefineChannels, std::numeric_limits<double>::quiet_NaN());
+            std::vector<Parameters> passParams;
+            std::vector<std::size_t> passIndex;
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                Parameters tempParams = baseParams;
+                if (applySweepValue(tempParams, graphTypeIndex, values[i])) {
+                    passParams.push_back(tempParams);
+                    passIndex.push_back(i);
+                }
+            }
+            if (passParams.empty()) {
+                return metrics;
+            }
+            std::vector<FlightSummary> results = evaluateSweep(passParams);
+            chunkPoints.clear();
+            for (std::size_t j = 0; j < results.size(); ++j) {
+                std::size_t point = record.size();
+                record.add(values[passIndex[j]], passParams[j], results[j]);
+                std::copy_n(record.metrics.begin() + point * kSweepMetricCount, kRefineChannels,
+                            metrics.begin() + passIndex[j] * kRefineChannels);
+                chunkPoints.push_back(QPointF(record.values[point], record.metric(point, metric)));
+            }
+            plotItem->append(chunkPoints);
+            outputArea->setText(QString("Адаптивная развертка: %1 полетов").arg(flightCount));
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+            return metrics;
+        }, adaptiveOptions, &adaptiveReport);
+        adaptiveText = QString("Адаптивная развертка: %1 полетов за %2 проходов, наименьший шаг %3 (равномерной сетке с таким шагом нужно %4 полетов), оценка ошибки %5% размаха%6")
+                           .arg(adaptiveReport.evaluations).arg(adaptiveReport.passes)
+                           .arg(adaptiveReport.min_spacing, 0, 'g', 4)
+                           .arg(adaptiveReport.min_spacing > 0 ? std::llround((paramMax - paramMin) / adaptiveReport.min_spacing) + 1 : 0)
+                           .arg(adaptiveReport.max_error * 100.0, 0, 'g', 3)
+                           .arg(adaptiveReport.budget_exhausted ? " - бюджет полетов исчерпан" : "");
+    } else {
+        // Собираем все точки развертки; считаются они порциями, чтобы график рос по мере расчета
+        std::vector<Parameters> sweepParams;
+        QList<double> sweepValues;
+        for (double val = paramMin; val <= paramMax; val += paramStep) {
+            Parameters tempParams = baseParams;
+            if (!applySweepValue(tempParams, graphTypeIndex, val)) {
+                continue; // Пропускаем невалидные значения параметра
+            }
+            sweepParams.push_back(tempParams);
+            sweepValues.append(val);
+        }
+        record.values.reserve(sweepParams.size());
+        record.metrics.reserve(sweepParams.size() * kSweepMetricCount);
+
+        // Рабочие процессы получают всю развертку сразу (у них свой прогресс), в окне - порции
+        const std::size_t chunkSize = sweepWorkersSpinBox->value() > 0 ? std::max<std::size_t>(sweepParams.size(), 1) : 8192;
+        for (std::size_t start = 0; start < sweepParams.size(); start += chunkSize) {
+            std::size_t end = std::min(sweepParams.size(), start + chunkSize);
+            std::vector<FlightSummary> results = evaluateSweep(std::vector<Parameters>(sweepParams.begin() + start, sweepParams.begin() + end));
+
+            chunkPoints.clear();
+            for (std::size_t i = start; i < end; ++i) {
+                record.add(sweepValues[static_cast<int>(i)], sweepParams[i], results[i - start]);
+                chunkPoints.push_back(QPointF(record.values[i], record.metric(i, metric)));
+            }
+            plotItem->append(chunkPoints);
+            if (end < sweepParams.size()) {
+                outputArea->setText(QString("Развертка: %1 из %2 полетов").arg(end).arg(sweepParams.size()));
+                QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+            }
+        }
+    }
+
+    if (plotItem->pointCount() == 0) {
+        outputArea->setText("Нет данных для построения графика. Убедитесь, что параметры и шаг корректны и хотя бы одна симуляция в диапазоне дала результат.");
+        return;
+    }
+    sweepStore.store(std::move(record));
+    shownSweepParameter = graphTypeIndex;
+
+    outputArea->clear();
+    if (batchReport.single_precision_flights > 0) {
+        QString precisionText = QString("float32: %1 из %2 полетов, перепроверено в double: %3, макс. расхождение: %4%")
+                                    .arg(batchReport.single_precision_flights).arg(batchReport.flights)
+                                    .arg(batchReport.verified).arg(batchReport.max_divergence * 100.0, 0, 'g', 3);
+        if (batchReport.escalated) {
+            precisionText += "\nРасхождение больше допуска - развертка пересчитана в double.";
+        } else if (batchReport.tolerance_exceeded) {
+            precisionText += "\nВнимание: расхождение больше допуска.";
+        }
+        outputArea->setText(precisionText);
+    }
+    if (!shardText.isEmpty()) {
+        outputArea->append(shardText);
+    }
+    if (!adaptiveText.isEmpty()) {
+        outputArea->append(adaptiveText);
+    }
+    if (usePlanner) {
+        outputArea->append(QString("Инварианты: %1 точек сведено к %2 полетам (из прошлых разверток: %3, совпали внутри развертки: %4)")
+                               .arg(planReport.requested).arg(planReport.flights)
+                               .arg(planReport.reused).arg(planReport.merged));
+    }
+    if (resultCacheCheckBox->isChecked()) {
+        outputArea->append(QString("Из кэша: %1 из %2 полетов").arg(cacheHits).arg(cacheLookups));
+    }
+    if (!surrogateText.isEmpty()) {
+        outputArea->append(surrogateText);
+    }
+    outputArea->append("График: колесико - масштаб (с Shift - только по X), перетаскивание - сдвиг, двойной щелчок - весь график.");
+}
+
+bool MainWindow::applySweepValue(Parameters& params, int graphTypeIndex, double val) const {
     switch (graphTypeIndex) {
-        case 0: case 1: case 2: xLabel = "Начальная скорость (м/с)"; break;
-        case 3: case 4: case 5: xLabel = "Угол (градусы)"; break;
-        case 6: case 7: case 8: xLabel = "Масса (кг)"; break;
-        case 9: case 10: case 11: xLabel = "Коэф. сопр."; break;
-        case 12: case 13: case 14: xLabel = "Плотность воздуха (кг/м³)"; break;
-        case 15: case 16: case 17: xLabel = "Радиус (м)"; break;
-        case 18: case 19: case 20: xLabel = "Ветер X (м/с)"; break;
-        case 21: case 22: case 23: xLabel = "Ветер Z (м/с)"; break;
-        case 24: case 25: case 26: xLabel = "Азимут (градусы)"; break;
-        default: xLabel = "Параметр"; break; 
+        case 0: params.initial_speed = val; return val > 0;
+        case 1: params.angle_deg = val; return val >= 0 && val <= 90;
+        case 2: params.mass = val; return val > 0;
+        case 3: params.Cd = val; return val >= 0;
+        case 4: params.air_density = val; return val >= 0;
+        case 5: params.radius = val; return val > 0;
+        case 6: params.wind_x = val; return true;
+        case 7: params.wind_z = val; return true;
+        case 8: params.azimuth_deg = val; return val >= 0 && val <= 360;
+        default: return false;
+    }
+}
+
+void MainWindow::onShowSweepOverlay() {
+    if (graphParamMinSpinBox->value() >= graphParamMaxSpinBox->value()) {
+        QMessageBox::warning(this, "Ошибка параметров графика", "Минимальное значение параметра должно быть меньше максимального.");
+        return;
     }
 
-    switch (graphTypeIndex) { 
-        case 0: case 3: case 6: case 9: case 12: case 15: case 18: case 21: case 24: yLabel = "Дальность (м)"; break;
-        case 1: case 4: case 7: case 10: case 13: case 16: case 19: case 22: case 25: yLabel = "Макс. высота (м)"; break;
-        case 2: case 5: case 8: case 11: case 14: case 17: case 20: case 23: case 26: yLabel = "Время полета (с)"; break;
-        default: yLabel = "Результат"; break;
+    Parameters baseParams;
+    if (!validateCurrentParameters(baseParams)) {
+        return;
     }
 
+    int graphTypeIndex = graphTypeComboBox->currentData().toInt();
+    double paramMin = graphParamMinSpinBox->value();
+    double paramMax = graphParamMaxSpinBox->value();
+    double paramStep = graphParamStepSpinBox->value();
+
+    SweepMetric sweepMetric = static_cast<SweepMetric>(graphMetricComboBox->currentData().toInt());
+    QString metricName;
+    switch (sweepMetric) {
+        case SweepMetric::Range: metricName = "Range (m)"; break;
+        case SweepMetric::Apex: metricName = "Max height (m)"; break;
+        case SweepMetric::FlightTime: metricName = "Flight time (s)"; break;
+        case SweepMetric::ImpactSpeed: metricName = "Impact speed (m/s)"; break;
+        case SweepMetric::LateralDrift: metricName = "Lateral drift (m)"; break;
+    }
+
+    // Ограничиваем общее число точек, прореживая каждую траекторию
+    const std::size_t maxTotalPoints = 2000000;
+    std::size_t sweepCount = static_cast<std::size_t>((paramMax - paramMin) / paramStep) + 1;
+    std::size_t stride = std::max<std::size_t>(1, sweepCount * 10000 / maxTotalPoints);
+
+    TrajectoryEnsemble ensemble;
+    const double dt = 0.01;
+    const std::size_t maxPoints = 10000;
+
+    // Траектории берутся из кэша результатов (там они хранятся сжатыми с ограниченной ошибкой)
+    // и сохраняются в него; ключ тот же, что у итогов развертки в double с этим шагом
+    bool useCache = resultCacheCheckBox->isChecked() && ResultCache::instance().is_open();
+    BatchOptions cacheOptions;
+    cacheOptions.dt = dt;
+    cacheOptions.max_points = maxPoints;
+    std::uint64_t environment = useCache ? result_cache_environment() : 0;
+    std::size_t cachedTrajectories = 0;
+    std::vector<State> cachedStates;
+
     for (double val = paramMin; val <= paramMax; val += paramStep) {
         Parameters tempParams = baseParams;
-        SimulationResult result;
-        double xValue = val;
-
-        // Apply the varying parameter and run simulation
-        // Also, add specific validation for the varying parameter if needed
-        switch (graphTypeIndex) {
-            // Начальная скорость
-            case 0: tempParams.initial_speed = val; if(val <=0) { /*QMessageBox::information(this, "Пропуск точки", "Начальная скорость <= 0 невалидна для графика.");*/ continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 1: tempParams.initial_speed = val; if(val <=0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 2: tempParams.initial_speed = val; if(val <=0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Угол
-            case 3: tempParams.angle_deg = val; if(val < 0 || val > 90) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 4: tempParams.angle_deg = val; if(val < 0 || val > 90) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 5: tempParams.angle_deg = val; if(val < 0 || val > 90) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Масса
-            case 6: tempParams.mass = val; if(val <=0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 7: tempParams.mass = val; if(val <=0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 8: tempParams.mass = val; if(val <=0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Коэф. сопр.
-            case 9: tempParams.Cd = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 10: tempParams.Cd = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 11: tempParams.Cd = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Плотность воздуха
-            case 12: tempParams.air_density = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 13: tempParams.air_density = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 14: tempParams.air_density = val; if(val < 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Радиус
-            case 15: tempParams.radius = val; if(val <= 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 16: tempParams.radius = val; if(val <= 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 17: tempParams.radius = val; if(val <= 0) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Ветер X
-            case 18: tempParams.wind_x = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 19: tempParams.wind_x = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 20: tempParams.wind_x = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Ветер Z
-            case 21: tempParams.wind_z = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 22: tempParams.wind_z = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 23: tempParams.wind_z = val; result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            // Азимут
-            case 24: tempParams.azimuth_deg = val; if(val < 0 || val > 360) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.total_distance)); break;
-            case 25: tempParams.azimuth_deg = val; if(val < 0 || val > 360) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.max_height)); break;
-            case 26: tempParams.azimuth_deg = val; if(val < 0 || val > 360) { continue; } result = runSingleSimulationForGraph(tempParams); dataPoints.append(QPointF(xValue, result.flight_time)); break;
-            default: outputArea->setText("Неизвестный тип графика."); return;
+        if (!applySweepValue(tempParams, graphTypeIndex, val)) {
+            continue;
         }
-        
-        if (!result.data_is_valid) { // Check if simulation produced valid data for this point
-             // Optionally, inform user or just skip the point silently
-             // QMessageBox::information(this, "Пропуск точки", QString("Симуляция для параметра %1 = %2 не дала валидных результатов.").arg(xLabel).arg(xValue));
-             continue; // Skip this point if data is not valid
-        }
-
-        if (!dataPoints.isEmpty() || result.data_is_valid) { // Ensure we have a valid point to update min/max
-            double yValPoint = 0.0;
-            switch (graphTypeIndex) { // Get the correct Y value based on graph type
-                case 0: case 3: case 6: case 9: case 12: case 15: case 18: case 21: case 24: yValPoint = result.total_distance; break;
-                case 1: case 4: case 7: case 10: case 13: case 16: case 19: case 22: case 25: yValPoint = result.max_height; break;
-                case 2: case 5: case 8: case 11: case 14: case 17: case 20: case 23: case 26: yValPoint = result.flight_time; break;
+        ResultCacheKey key = useCache ? result_cache_key(tempParams, cacheOptions, environment) : ResultCacheKey{};
+        FlightSummary summary;
+        if (useCache && ResultCache::instance().find(key, summary, &cachedStates) && !cachedStates.empty()) {
+            ++cachedTrajectories;
+            append_to_ensemble(ensemble, cachedStates, sweep_metric(summary, tempParams, sweepMetric), stride);
+            continue;
+        }
+
+        // Буфер возвращается в пул в конце итерации и достается следующему полету
+        TrajectoryPool::Buffer trajectoryBuffer = simulate_trajectory(tempParams, dt, maxPoints);
+        const std::vector<State>& states = trajectoryBuffer.states();
+
+        if (useCache) {
+            // В записи кэша - итог того же расчета, что у развертки (с уточнением точки падения)
+            if (!ResultCache::instance().find(key, summary)) {
+                summary = evaluate_flight(tempParams, dt, maxPoints);
             }
-            currentYMin = std::min(currentYMin, yValPoint);
-            currentYMax = std::max(currentYMax, yValPoint);
-            currentXMin = std::min(currentXMin, xValue); 
-            currentXMax = std::max(currentXMax, xValue);
+            ResultCache::instance().store(key, summary, &states);
+        } else {
+            // Итоги по последней точке траектории, величина - та же, что на графике
+            const State& last = states.back();
+            for (const auto& s : states) { summary.max_height = std::max(summary.max_height, s.y); }
+            summary.flight_time = (states.size() - 1) * dt;
+            summary.impact_x = last.x;
+            summary.impact_z = last.z;
+            summary.total_distance = std::sqrt(last.x * last.x + last.z * last.z);
+            summary.impact_speed = std::sqrt(last.vx * last.vx + last.vy * last.vy + last.vz * last.vz);
         }
+        append_to_ensemble(ensemble, states, sweep_metric(summary, tempParams, sweepMetric), stride);
     }
 
-    if (dataPoints.isEmpty()) {
-        outputArea->setText("Нет данных для построения графика. Убедитесь, что параметры и шаг корректны и хотя бы одна симуляция в диапазоне дала результат.");
-        currentXMin = paramMin;
-        currentXMax = paramMax;
-        currentYMin = 0; 
-        currentYMax = 1; 
+    if (ensemble.metric.empty()) {
+        outputArea->setText("Нет данных для 3D-наложения. Проверьте диапазон и шаг параметра.");
+        return;
     }
-    
+    outputArea->setText(QString("3D-наложение: %1 траекторий, %2 точек.").arg(ensemble.metric.size()).arg(ensemble.points.size() / 3));
+    if (useCache) {
+        outputArea->append(QString("Траекторий из кэша: %1 из %2").arg(cachedTrajectories).arg(ensemble.metric.size()));
+    }
+    if (const View3DModule* module = view3d()) {
+        module->start_ensemble_simulation(ensemble, metricName.toStdString(), nullptr);
+    }
+}
+
+// Карта падений: загруженный ансамбль (разброс вокруг текущих параметров) или текущая развертка.
+// Плотность - изображением в области предпросмотра и текстурой на земле в 3D вместе с частью траекторий
+void MainWindow::onShowImpactMap() {
+    Parameters baseParams;
+    if (!validateCurrentParameters(baseParams)) {
+        return;
+    }
+
+    std::size_t count = 0;
+    std::function<Parameters(std::size_t)> member;
+    QString source;
+    if (ensembleCount > 0) {
+        EnsembleDefinition ensemble;
+        ensemble.base_params = baseParams;
+        ensemble.sigma = ensembleSigma;
+        ensemble.count = ensembleCount;
+        ensemble.seed = ensembleSeed;
+        count = ensemble.count;
+        member = [ensemble](std::size_t i) { return ensemble_member(ensemble, i); };
+        source = QString("Ансамбль, %1 полетов").arg(count);
+    } else {
+        if (graphParamMinSpinBox->value() >= graphParamMaxSpinBox->value()) {
+            QMessageBox::warning(this, "Ошибка параметров графика", "Минимальное значение параметра должно быть меньше максимального.");
+            return;
+        }
+        int graphTypeIndex = graphTypeComboBox->currentData().toInt();
+        double paramMin = graphParamMinSpinBox->value();
+        double paramMax = graphParamMaxSpinBox->value();
+        double paramStep = graphParamStepSpinBox->value();
+        std::vector<double> values;
+        for (double val = paramMin; val <= paramMax; val += paramStep) {
+            Parameters tempParams = baseParams;
+            if (applySweepValue(tempParams, graphTypeIndex, val)) {
+                values.push_back(val);
+            }
+        }
+        count = values.size();
+        member = [this, baseParams, graphTypeIndex, values = std::move(values)](std::size_t i) {
+            Parameters tempParams = baseParams;
+            applySweepValue(tempParams, graphTypeIndex, values[i]);
+            return tempParams;
+        };
+        source = QString("Развертка \"%1\", %2 полетов").arg(graphTypeComboBox->currentText()).arg(count);
+    }
+    if (count == 0) {
+        outputArea->setText("Нет полетов для карты падений. Проверьте диапазон и шаг параметра.");
+        return;
+    }
+
+    BatchOptions batchOptions;
+    batchOptions.single_precision = singlePrecisionCheckBox->isChecked();
+    batchOptions.tolerance = precisionToleranceSpinBox->value() / 100.0;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    ImpactMapReport report;
+    ImpactHistogram map = build_impact_map(count, member, batchOptions, ImpactGrid{}, 0, &report);
+    QApplication::restoreOverrideCursor();
+
+    drawImpactMap(map, source);
+    const ImpactGrid& grid = map.grid();
+    outputArea->setText(QString("Карта падений: %1 полетов за %2 с (%3 потоков).\n"
+                                "Сетка %4 x %5 ячеек по %6 м, X от %7 до %8 м, Z от %9 до %10 м.\n"
+                                "Вне сетки: %11 полетов, наибольшая плотность: %12 на ячейку.")
+                            .arg(report.flights).arg(report.seconds, 0, 'f', 2).arg(report.threads)
+                            .arg(grid.nx).arg(grid.nz).arg((grid.x_max - grid.x_min) / std::max(grid.nx, 1), 0, 'g', 3)
+                            .arg(grid.x_min, 0, 'f', 1).arg(grid.x_max, 0, 'f', 1).arg(grid.z_min, 0, 'f', 1).arg(grid.z_max, 0, 'f', 1)
+                            .arg(map.outside()).arg(map.max_count()));
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+
+    // В 3D к карте добавляется до 200 траекторий, равномерно по номерам полетов
+    const std::size_t shown = std::min<std::size_t>(count, 200);
+    const double dt = 0.01;
+    TrajectoryEnsemble ensemble;
+    for (std::size_t k = 0; k < shown; ++k) {
+        TrajectoryPool::Buffer trajectoryBuffer = simulate_trajectory(member(k * count / shown), dt, 10000);
+        const std::vector<State>& states = trajectoryBuffer.states();
+        append_to_ensemble(ensemble, states, std::sqrt(states.back().x * states.back().x + states.back().z * states.back().z), 1);
+    }
+    if (const View3DModule* module = view3d()) {
+        module->start_ensemble_simulation(ensemble, "Range (m)", &map);
+    }
+}
+
+void MainWindow::drawImpactMap(const ImpactHistogram& map, const QString& title) {
+    previewScene->clear();
+    shownSweepParameter = -1;
+    const ImpactGrid& grid = map.grid();
+    if (!grid.valid()) {
+        previewScene->addText("Нет данных для карты падений.");
+        return;
+    }
+
+    // Изображение сетки: столбцы - X, строки - Z (z_max сверху), ячейки без сглаживания
+    std::vector<std::uint32_t> colors = impact_map_colors(map);
+    QImage image(grid.nx, grid.nz, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+    for (int j = 0; j < grid.nz; ++j) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(grid.nz - 1 - j));
+        for (int i = 0; i < grid.nx; ++i) {
+            std::uint32_t c = colors[static_cast<std::size_t>(j) * grid.nx + i];
+            if (c) {
+                line[i] = c;
+            }
+        }
+    }
+
+    double H_MARGIN = previewView->width() * 0.12;
+    double V_MARGIN_TOP = previewView->height() * 0.08;
+    double availableWidth = previewView->width() * 0.68;
+    double availableHeight = previewView->height() * 0.76;
+    // Одинаковый масштаб по осям, чтобы форма эллипса рассеивания не искажалась
+    double scale = std::min(availableWidth / (grid.x_max - grid.x_min), availableHeight / (grid.z_max - grid.z_min));
+    double plotWidth = (grid.x_max - grid.x_min) * scale;
+    double plotHeight = (grid.z_max - grid.z_min) * scale;
+
+    QGraphicsPixmapItem *pixmap = previewScene->addPixmap(QPixmap::fromImage(image.scaled(std::max(1, static_cast<int>(plotWidth)), std::max(1, static_cast<int>(plotHeight)))));
+    pixmap->setPos(H_MARGIN, V_MARGIN_TOP);
+    previewScene->addRect(H_MARGIN, V_MARGIN_TOP, plotWidth, plotHeight, QPen(Qt::black, 1));
+
+    QFont tickFont("Arial", 8);
+    for (int k = 0; k <= 4; ++k) {
+        double x = grid.x_min + (grid.x_max - grid.x_min) * k / 4;
+        double sx = H_MARGIN + plotWidth * k / 4;
+        previewScene->addLine(sx, V_MARGIN_TOP + plotHeight, sx, V_MARGIN_TOP + plotHeight + 5);
+        QGraphicsTextItem *label = previewScene->addText(QString::number(x, 'f', 1), tickFont);
+        label->setDefaultTextColor(Qt::black);
+        label->setPos(sx - label->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 5);
+
+        double z = grid.z_min + (grid.z_max - grid.z_min) * k / 4;
+        double sy = V_MARGIN_TOP + plotHeight - plotHeight * k / 4;
+        previewScene->addLine(H_MARGIN - 5, sy, H_MARGIN, sy);
+        label = previewScene->addText(QString::number(z, 'f', 1), tickFont);
+        label->setDefaultTextColor(Qt::black);
+        label->setPos(H_MARGIN - label->boundingRect().width() - 5, sy - label->boundingRect().height() / 2);
+    }
+    QGraphicsTextItem *xLabel = previewScene->addText("X (м)", QFont("Arial", 10));
+    xLabel->setDefaultTextColor(Qt::black);
+    xLabel->setPos(H_MARGIN + plotWidth / 2 - xLabel->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 22);
+    QGraphicsTextItem *zLabel = previewScene->addText("Z (м)", QFont("Arial", 10));
+    zLabel->setDefaultTextColor(Qt::black);
+    zLabel->setRotation(-90);
+    zLabel->setPos(H_MARGIN - zLabel->boundingRect().height() - 40, V_MARGIN_TOP + plotHeight / 2 + zLabel->boundingRect().width() / 2);
+    QGraphicsTextItem *titleItem = previewScene->addText(title, QFont("Arial", 10));
+    titleItem->setDefaultTextColor(Qt::black);
+    titleItem->setPos(H_MARGIN, V_MARGIN_TOP - titleItem->boundingRect().height() - 2);
+
+    // Шкала: логарифм числа попаданий в ячейку
+    double barX = H_MARGIN + plotWidth + 20;
+    const int barSteps = 64;
+    for (int k = 0; k < barSteps; ++k) {
+        QColor color = QColor::fromRgba(impact_map_color(1.0 - static_cast<double>(k) / (barSteps - 1)));
+        previewScene->addRect(barX, V_MARGIN_TOP + plotHeight * k / barSteps, 12, plotHeight / barSteps + 1, Qt::NoPen, QBrush(color));
+    }
+    QGraphicsTextItem *top = previewScene->addText(QString::number(map.max_count()), tickFont);
+    top->setDefaultTextColor(Qt::black);
+    top->setPos(barX + 14, V_MARGIN_TOP - 6);
+    QGraphicsTextItem *bottom = previewScene->addText("1", tickFont);
+    bottom->setDefaultTextColor(Qt::black);
+    bottom->setPos(barX + 14, V_MARGIN_TOP + plotHeight - 12);
+}
+
+// Чувствительность: все поля Parameters сдвигаются от текущих значений, полеты - одним пакетом
+void MainWindow::onSensitivity() {
+    Parameters baseParams;
+    if (!validateCurrentParameters(baseParams)) {
+        return;
+    }
+
+    SensitivityOptions options;
+    options.relative = sensitivitySpinBox->value() / 100.0;
+    if (sensitivitySigmaCheckBox->isChecked()) {
+        if (ensembleCount == 0) {
+            QMessageBox::information(this, "Чувствительность", "σ задается ансамблем из файла сценариев; загрузите его или снимите отметку \"±σ ансамбля\".");
+            return;
+        }
+        options.use_sigma = true;
+        options.sigma = ensembleSigma;
+    }
+    if (previewTimer->isActive()) {
+        previewTimer->stop();
+    }
+    SensitivityReport report = analyze_sensitivity(baseParams, options);
+    drawTornadoChart(report);
+
+    outputArea->clear();
+    outputArea->append(QString("Чувствительность: %1 полетов за %2 мс, сдвиг %3")
+                           .arg(1 + 2 * report.entries.size())
+                           .arg(report.seconds * 1e3, 0, 'f', 1)
+                           .arg(options.use_sigma ? QString("±σ ансамбля") : QString("±%1%").arg(sensitivitySpinBox->value())));
+    if (!report.entries.empty()) {
+        const SensitivityEntry& top = report.entries[tornado_order(report, SweepMetric::Range).front()];
+        const int range = static_cast<int>(SweepMetric::Range);
+        std::string_view name = scenario_parameter_name(top.parameter);
+        outputArea->append(QString("Сильнее всего на дальность влияет %1: от %2 до %3 м при базовых %4 м")
+                               .arg(QString::fromUtf8(name.data(), static_cast<int>(name.size())))
+                               .arg(std::min(top.low[range], top.high[range]), 0, 'f', 2)
+                               .arg(std::max(top.low[range], top.high[range]), 0, 'f', 2)
+                               .arg(report.base_metrics[range], 0, 'f', 2));
+    }
+}
+
+// Три диаграммы "торнадо" одна под другой: дальность, высота, боковой снос.
+// Полоса параметра - от базового значения величины до значений при сдвиге вниз (синяя) и вверх (красная)
+void MainWindow::drawTornadoChart(const SensitivityReport& report) {
+    previewScene->clear();
+    shownSweepParameter = -1;
+    if (report.entries.empty()) {
+        previewScene->addText("Нет параметров с ненулевым сдвигом.");
+        return;
+    }
+
+    const SweepMetric metrics[] = { SweepMetric::Range, SweepMetric::Apex, SweepMetric::LateralDrift };
+    const QString titles[] = { "Дальность (м)", "Макс. высота (м)", "Боковой снос (м)" };
+    const QColor lowColor(70, 110, 200), highColor(210, 80, 60);
+    QFont labelFont("Arial", 8);
+    QFont titleFont("Arial", 9, QFont::Bold);
+
+    double width = previewView->width();
+    double panelHeight = previewView->height() / 3.0;
+    double labelWidth = width * 0.22;
+    double plotLeft = labelWidth + 10;
+    double plotWidth = width - plotLeft - 20;
+    double centerX = plotLeft + plotWidth / 2;
+    for (int panel = 0; panel < 3; ++panel) {
+        SweepMetric metric = metrics[panel];
+        int m = static_cast<int>(metric);
+        double top = panel * panelHeight;
+        double base = report.base_metrics[m];
+        std::vector<std::size_t> order = tornado_order(report, metric);
+
+        double reach = 0.0;
+        for (const SensitivityEntry& entry : report.entries) {
+            reach = std::max({ reach, std::abs(entry.low[m] - base), std::abs(entry.high[m] - base) });
+        }
+        double scale = reach > 0.0 ? plotWidth / 2 / reach : 0.0;
+
+        QGraphicsTextItem *title = previewScene->addText(QString("%1, базовое %2").arg(titles[panel]).arg(base, 0, 'f', 2), titleFont);
+        title->setDefaultTextColor(Qt::black);
+        title->setPos(plotLeft, top);
+
+        double barsTop = top + 20;
+        double rowHeight = (panelHeight - 26) / order.size();
+        previewScene->addLine(centerX, barsTop, centerX, barsTop + rowHeight * order.size(), QPen(Qt::black, 1));
+        for (std::size_t row = 0; row < order.size(); ++row) {
+            const SensitivityEntry& entry = report.entries[order[row]];
+            double y = barsTop + row * rowHeight;
+            double barHeight = std::max(2.0, rowHeight * 0.7);
+            double lowX = centerX + (entry.low[m] - base) * scale;
+            double highX = centerX + (entry.high[m] - base) * scale;
+            previewScene->addRect(QRectF(QPointF(std::min(centerX, lowX), y), QPointF(std::max(centerX, lowX), y + barHeight)),
+                                  QPen(Qt::NoPen), QBrush(lowColor));
+            previewScene->addRect(QRectF(QPointF(std::min(centerX, highX), y), QPointF(std::max(centerX, highX), y + barHeight)),
+                                  QPen(Qt::NoPen), QBrush(highColor));
+
+            std::string_view name = scenario_parameter_name(entry.parameter);
+            QGraphicsTextItem *label = previewScene->addText(QString("%1 %2..%3")
+                                                                 .arg(QString::fromUtf8(name.data(), static_cast<int>(name.size())))
+                                                                 .arg(entry.low_value, 0, 'g', 4).arg(entry.high_value, 0, 'g', 4),
+                                                             labelFont);
+            label->setDefaultTextColor(Qt::black);
+            label->setPos(labelWidth - label->boundingRect().width(), y + barHeight / 2 - label->boundingRect().height() / 2);
+        }
+    }
+
+    // Легенда цветов
+    QGraphicsTextItem *legend = previewScene->addText("синий - параметр уменьшен, красный - увеличен", labelFont);
+    legend->setDefaultTextColor(Qt::darkGray);
+    legend->setPos(width - legend->boundingRect().width() - 10, 0);
+}
+
+// Неопределенность: σ ансамбля из файла сценариев переносится на точку падения сигма-точками
+// (не больше 21 полета вместо ансамбля Монте-Карло), эллипс - в предпросмотре и на земле в 3D
+void MainWindow::onUncertainty() {
+    Parameters baseParams;
+    if (!validateCurrentParameters(baseParams)) {
+        return;
+    }
+    if (ensembleCount == 0) {
+        QMessageBox::information(this, "Неопределенность", "Разброс параметров задается ансамблем из файла сценариев (sigma.<поле>=...); загрузите файл и выберите ансамбль.");
+        return;
+    }
+    if (previewTimer->isActive()) {
+        previewTimer->stop();
+    }
+
+    UnscentedReport report = unscented_transform(baseParams, diagonal_covariance(ensembleSigma));
+    drawUncertaintyEllipse(report);
+
+    const double scale95 = ellipse_scale(0.95);
+    ImpactEllipse outer = report.ellipse(scale95);
+    const int range = static_cast<int>(SweepMetric::Range);
+    const int drift = static_cast<int>(SweepMetric::LateralDrift);
+    outputArea->clear();
+    outputArea->append(QString("Неопределенность (сигма-точки): %1 полетов за %2 мс, направлений разброса: %3")
+                           .arg(report.flights.size()).arg(report.seconds * 1e3, 0, 'f', 1).arg(report.rank));
+    outputArea->append(QString("Средняя точка падения: X = %1 м, Z = %2 м; ковариация XX = %3, XZ = %4, ZZ = %5 м²")
+                           .arg(report.impact_x, 0, 'f', 2).arg(report.impact_z, 0, 'f', 2)
+                           .arg(report.cov_xx, 0, 'g', 4).arg(report.cov_xz, 0, 'g', 4).arg(report.cov_zz, 0, 'g', 4));
+    outputArea->append(QString("Эллипс 95%: полуоси %1 и %2 м, большая ось под углом %3° к оси X")
+                           .arg(outer.semi_major, 0, 'f', 2).arg(outer.semi_minor, 0, 'f', 2)
+                           .arg(outer.angle * 180.0 / 3.14159265358979, 0, 'f', 1));
+    outputArea->append(QString("Дальность %1 ± %2 м, боковой снос %3 ± %4 м (1σ)")
+                           .arg(report.metric_mean[range], 0, 'f', 2).arg(report.metric_sigma[range], 0, 'f', 2)
+                           .arg(report.metric_mean[drift], 0, 'f', 2).arg(report.metric_sigma[drift], 0, 'f', 2));
+    if (report.clamped > 0) {
+        outputArea->append(QString("Сигма-точек, приведенных к допустимым значениям полей: %1; при большом разбросе оценка грубее.").arg(report.clamped));
+    }
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+
+    // В 3D - траектории всех сигма-точек и оба эллипса
+    const double dt = 0.01;
+    TrajectoryEnsemble ensemble;
+    for (std::size_t i = 0; i < report.sigma_points.size(); ++i) {
+        TrajectoryPool::Buffer trajectoryBuffer = simulate_trajectory(report.sigma_points[i], dt, 10000);
+        append_to_ensemble(ensemble, trajectoryBuffer.states(), report.flights[i].total_distance, 1);
+    }
+    const ImpactEllipse ellipses[] = { report.ellipse(1.0), outer };
+    if (const View3DModule* module = view3d()) {
+        module->start_uncertainty_simulation(ensemble, ellipses, 2);
+    }
+}
+
+void MainWindow::drawUncertaintyEllipse(const UnscentedReport& report) {
+    previewScene->clear();
+    shownSweepParameter = -1;
+
+    const ImpactEllipse ellipses[] = { report.ellipse(1.0), report.ellipse(ellipse_scale(0.95)) };
+    const QColor colors[] = { QColor(40, 80, 220), QColor(210, 50, 40) };
+    const int kSegments = 128;
+
+    // Область: внешний эллипс и точки падения всех сигма-точек с полями 10%
+    double xMin = std::numeric_limits<double>::max(), xMax = std::numeric_limits<double>::lowest();
+    double zMin = xMin, zMax = xMax;
+    auto extend = [&](double x, double z) {
+        xMin = std::min(xMin, x); xMax = std::max(xMax, x);
+        zMin = std::min(zMin, z); zMax = std::max(zMax, z);
+    };
+    for (int k = 0; k < kSegments; ++k) {
+        double x, z;
+        ellipses[1].point(2.0 * 3.14159265358979 * k / kSegments, x, z);
+        extend(x, z);
+    }
+    for (const FlightSummary& flight : report.flights) {
+        extend(flight.impact_x, flight.impact_z);
+    }
+    double pad = std::max({ xMax - xMin, zMax - zMin, 1.0 }) * 0.1;
+    xMin -= pad; xMax += pad; zMin -= pad; zMax += pad;
+
+    double H_MARGIN = previewView->width() * 0.12;
+    double V_MARGIN_TOP = previewView->height() * 0.08;
+    double availableWidth = previewView->width() * 0.76;
+    double availableHeight = previewView->height() * 0.76;
+    // Одинаковый масштаб по осям, иначе эллипс выглядит повернутым и растянутым
+    double scale = std::min(availableWidth / (xMax - xMin), availableHeight / (zMax - zMin));
+    double plotWidth = (xMax - xMin) * scale;
+    double plotHeight = (zMax - zMin) * scale;
+    auto toScene = [&](double x, double z) { return QPointF(H_MARGIN + (x - xMin) * scale, V_MARGIN_TOP + (zMax - z) * scale); };
+
+    previewScene->addRect(H_MARGIN, V_MARGIN_TOP, plotWidth, plotHeight, QPen(Qt::black, 1));
+    for (int e = 0; e < 2; ++e) {
+        QPainterPath path;
+        for (int k = 0; k <= kSegments; ++k) {
+            double x, z;
+            ellipses[e].point(2.0 * 3.14159265358979 * k / kSegments, x, z);
+            if (k == 0) {
+                path.moveTo(toScene(x, z));
+            } else {
+                path.lineTo(toScene(x, z));
+            }
+        }
+        previewScene->addPath(path, QPen(colors[e], 2));
+    }
+
+    // Точки падения сигма-точек и средняя точка крестом
+    for (const FlightSummary& flight : report.flights) {
+        QPointF p = toScene(flight.impact_x, flight.impact_z);
+        previewScene->addEllipse(p.x() - 3, p.y() - 3, 6, 6, QPen(Qt::darkGray), QBrush(Qt::lightGray));
+    }
+    QPointF center = toScene(report.impact_x, report.impact_z);
+    previewScene->addLine(center.x() - 6, center.y(), center.x() + 6, center.y(), QPen(Qt::black, 2));
+    previewScene->addLine(center.x(), center.y() - 6, center.x(), center.y() + 6, QPen(Qt::black, 2));
+
+    QFont tickFont("Arial", 8);
+    for (int k = 0; k <= 4; ++k) {
+        double x = xMin + (xMax - xMin) * k / 4;
+        double sx = H_MARGIN + plotWidth * k / 4;
+        previewScene->addLine(sx, V_MARGIN_TOP + plotHeight, sx, V_MARGIN_TOP + plotHeight + 5);
+        QGraphicsTextItem *label = previewScene->addText(QString::number(x, 'f', 1), tickFont);
+        label->setDefaultTextColor(Qt::black);
+        label->setPos(sx - label->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 5);
+
+        double z = zMin + (zMax - zMin) * k / 4;
+        double sy = V_MARGIN_TOP + plotHeight - plotHeight * k / 4;
+        previewScene->addLine(H_MARGIN - 5, sy, H_MARGIN, sy);
+        label = previewScene->addText(QString::number(z, 'f', 1), tickFont);
+        label->setDefaultTextColor(Qt::black);
+        label->setPos(H_MARGIN - label->boundingRect().width() - 5, sy - label->boundingRect().height() / 2);
+    }
+    QGraphicsTextItem *xLabel = previewScene->addText("X (м)", QFont("Arial", 10));
+    xLabel->setDefaultTextColor(Qt::black);
+    xLabel->setPos(H_MARGIN + plotWidth / 2 - xLabel->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 22);
+    QGraphicsTextItem *zLabel = previewScene->addText("Z (м)", QFont("Arial", 10));
+    zLabel->setDefaultTextColor(Qt::black);
+    zLabel->setRotation(-90);
+    zLabel->setPos(H_MARGIN - zLabel->boundingRect().height() - 40, V_MARGIN_TOP + plotHeight / 2 + zLabel->boundingRect().width() / 2);
+    QGraphicsTextItem *titleItem = previewScene->addText(QString("Точка падения: эллипсы 1σ (синий) и 95% (красный), %1 сигма-точек")
+                                                             .arg(report.flights.size()), QFont("Arial", 10));
+    titleItem->setDefaultTextColor(Qt::black);
+    titleItem->setPos(H_MARGIN, V_MARGIN_TOP - titleItem->boundingRect().height() - 2);
+}
+
+// Сравнение интеграторов: эталонные выстрелы и текущие параметры, диаграмма и рекомендации
+void MainWindow::onWorkPrecision() {
+    std::vector<NamedScenario> scenarios = reference_scenarios();
+    Parameters currentParams;
+    if (validateCurrentParameters(currentParams)) {
+        scenarios.push_back({ "Текущие параметры", currentParams });
+    }
+
     if (previewTimer->isActive()) {
         previewTimer->stop();
     }
+    outputArea->setText("Сравнение интеграторов...");
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    WorkPrecisionReport report = run_work_precision(scenarios);
+    QApplication::restoreOverrideCursor();
+
+    drawWorkPrecisionDiagram(report);
+
     outputArea->clear();
-    drawDependencyGraph(dataPoints, xLabel, yLabel, currentXMin, currentXMax, currentYMin, currentYMax);
+    outputArea->append(QString("Сценариев: %1, ошибка - наибольшая относительная по дальности, апогею и времени полета").arg(scenarios.size()));
+    for (const WorkPrecisionRecommendation& recommendation : report.recommendations) {
+        if (!recommendation.found) {
+            outputArea->append(QString("Допуск %1: ни одна конфигурация не укладывается").arg(recommendation.target, 0, 'g', 2));
+            continue;
+        }
+        const WorkPrecisionPoint& point = recommendation.point;
+        outputArea->append(QString("Допуск %1: %2, шаг %3%4 - ошибка %5, %6 вычислений, %7 мкс на полет")
+                               .arg(recommendation.target, 0, 'g', 2)
+                               .arg(integrator_name(point.integrator))
+                               .arg(point.dt)
+                               .arg(point.production_stop ? " (остановка как в расчете)" : "")
+                               .arg(point.max_error(), 0, 'g', 2)
+                               .arg(point.evaluations, 0, 'f', 0)
+                               .arg(point.seconds * 1e6, 0, 'f', 1));
+    }
+    // Для сравнения - текущие настройки расчета траектории
+    for (const WorkPrecisionPoint& point : report.points) {
+        if (point.production_stop && point.dt == 0.01) {
+            outputArea->append(QString("Текущий расчет (RK4, шаг 0.01, остановка в последней точке над землей): "
+                                       "ошибка дальности %1, апогея %2, времени %3")
+                                   .arg(point.range_error, 0, 'g', 2).arg(point.apex_error, 0, 'g', 2).arg(point.time_error, 0, 'g', 2));
+        }
+    }
+}
+
+void MainWindow::drawWorkPrecisionDiagram(const WorkPrecisionReport& report) {
+    previewScene->clear();
+    shownSweepParameter = -1;
+
+    double panelWidth = previewView->width() * 0.31;
+    double plotHeight = previewView->height() * 0.80;
+    double H_MARGIN = previewView->width() * 0.08;
+    double PANEL_GAP = previewView->width() * 0.09;
+    double V_MARGIN_TOP = previewView->height() * 0.05;
+
+    if (report.points.empty()) {
+        previewScene->addText("Нет данных для диаграммы.");
+        return;
+    }
+
+    // Две панели с общей осью ошибки (снизу ограничена шумом округления): слева - число вычислений
+    // правой части, справа - время счета полета. Обе оси логарифмические
+    auto errorOf = [](const WorkPrecisionPoint& p) { return std::log10(std::max(p.max_error(), 1e-16)); };
+    auto evaluationsOf = [](const WorkPrecisionPoint& p) { return std::log10(std::max(p.evaluations, 1.0)); };
+    auto secondsOf = [](const WorkPrecisionPoint& p) { return std::log10(std::max(p.seconds, 1e-12)); };
+    double yMin = 1e300, yMax = -1e300;
+    for (const WorkPrecisionPoint& p : report.points) {
+        yMin = std::min(yMin, errorOf(p));
+        yMax = std::max(yMax, errorOf(p));
+    }
+    yMin = std::floor(yMin); yMax = std::ceil(yMax);
+    if (yMax <= yMin) yMax = yMin + 1;
+    double scaleY = plotHeight / (yMax - yMin);
+
+    QFont tickFont("Arial", 8);
+    const QColor colors[] = { Qt::red, QColor(255, 140, 0), Qt::darkGreen, Qt::blue, Qt::magenta, Qt::black };
+    auto drawPanel = [&](double left, const std::function<double(const WorkPrecisionPoint&)>& xOf, const QString& xTitle) {
+        double xMin = 1e300, xMax = -1e300;
+        for (const WorkPrecisionPoint& p : report.points) {
+            xMin = std::min(xMin, xOf(p));
+            xMax = std::max(xMax, xOf(p));
+        }
+        xMin = std::floor(xMin); xMax = std::ceil(xMax);
+        if (xMax <= xMin) xMax = xMin + 1;
+        double scaleX = panelWidth / (xMax - xMin);
+        auto toScene = [&](double lx, double ly) {
+            return QPointF(left + (lx - xMin) * scaleX, V_MARGIN_TOP + plotHeight - (ly - yMin) * scaleY);
+        };
+
+        previewScene->addLine(left, V_MARGIN_TOP + plotHeight, left + panelWidth, V_MARGIN_TOP + plotHeight, QPen(Qt::black, 2));
+        previewScene->addLine(left, V_MARGIN_TOP, left, V_MARGIN_TOP + plotHeight, QPen(Qt::black, 2));
+        int xStride = std::max(1, static_cast<int>(xMax - xMin) / 6);
+        for (int e = static_cast<int>(xMin); e <= static_cast<int>(xMax); e += xStride) {
+            QPointF pos = toScene(e, yMin);
+            previewScene->addLine(pos.x(), pos.y(), pos.x(), pos.y() + 5);
+            QGraphicsTextItem *label = previewScene->addText(QString("1e%1").arg(e), tickFont);
+            label->setDefaultTextColor(Qt::black);
+            label->setPos(pos.x() - label->boundingRect().width() / 2, pos.y() + 5);
+        }
+        int yStride = std::max(1, static_cast<int>(yMax - yMin) / 8);
+        for (int e = static_cast<int>(yMin); e <= static_cast<int>(yMax); e += yStride) {
+            QPointF pos = toScene(xMin, e);
+            previewScene->addLine(pos.x() - 5, pos.y(), pos.x(), pos.y());
+            QGraphicsTextItem *label = previewScene->addText(QString("1e%1").arg(e), tickFont);
+            label->setDefaultTextColor(Qt::black);
+            label->setPos(pos.x() - label->boundingRect().width() - 5, pos.y() - label->boundingRect().height() / 2);
+        }
+        QGraphicsTextItem *xLabel = previewScene->addText(xTitle, QFont("Arial", 10));
+        xLabel->setDefaultTextColor(Qt::black);
+        xLabel->setPos(left + panelWidth / 2 - xLabel->boundingRect().width() / 2, V_MARGIN_TOP + plotHeight + 22);
+
+        // Линия на каждый метод, точки по шагам; отдельной пунктирной линией - текущий критерий остановки
+        for (int series = 0; series <= kIntegratorCount; ++series) {
+            bool productionStop = series == kIntegratorCount;
+            Integrator integrator = productionStop ? Integrator::RK4 : static_cast<Integrator>(series);
+            QPainterPath path;
+            bool first = true;
+            for (const WorkPrecisionPoint& p : report.points) {
+                if (p.integrator != integrator || p.production_stop != productionStop) {
+                    continue;
+                }
+                QPointF pos = toScene(xOf(p), errorOf(p));
+                if (first) {
+                    path.moveTo(pos);
+                    first = false;
+                } else {
+                    path.lineTo(pos);
+                }
+                previewScene->addEllipse(pos.x() - 2.5, pos.y() - 2.5, 5, 5, QPen(colors[series]), QBrush(colors[series]));
+            }
+            if (!first) {
+                previewScene->addPath(path, QPen(colors[series], 2, productionStop ? Qt::DashLine : Qt::SolidLine));
+            }
+        }
+    };
+    drawPanel(H_MARGIN, evaluationsOf, "Вычислений правой части на полет");
+    double rightPanel = H_MARGIN + panelWidth + PANEL_GAP;
+    drawPanel(rightPanel, secondsOf, "Время счета полета, с");
+
+    QGraphicsTextItem *yLabel = previewScene->addText("Относительная ошибка", QFont("Arial", 10));
+    yLabel->setDefaultTextColor(Qt::black);
+    yLabel->setRotation(-90);
+    yLabel->setPos(H_MARGIN - yLabel->boundingRect().height() - 40, V_MARGIN_TOP + plotHeight / 2 + yLabel->boundingRect().width() / 2);
+
+    double legendX = rightPanel + panelWidth + 10;
+    double legendY = V_MARGIN_TOP;
+    for (int series = 0; series <= kIntegratorCount; ++series) {
+        bool productionStop = series == kIntegratorCount;
+        Integrator integrator = productionStop ? Integrator::RK4 : static_cast<Integrator>(series);
+        previewScene->addLine(legendX, legendY + 8, legendX + 20, legendY + 8,
+                              QPen(colors[series], 2, productionStop ? Qt::DashLine : Qt::SolidLine));
+        QString name = productionStop ? QString("RK4, текущая остановка") : QString(integrator_name(integrator));
+        QGraphicsTextItem *legend = previewScene->addText(name, tickFont);
+        legend->setDefaultTextColor(Qt::black);
+        legend->setPos(legendX + 24, legendY);
+        legendY += 16;
+    }
+}
+
+// Суррогат: поля сдвигаются на ±% от текущих значений (g фиксировано), параметр графика - на весь
+// диапазон графика. Узким полям достаются младшие степени, параметру графика - старшие
+void MainWindow::onBuildSurrogate() {
+    Parameters baseParams;
+    if (!validateCurrentParameters(baseParams)) {
+        return;
+    }
+    if (active_terrain() || active_wind_field()) {
+        QMessageBox::information(this, "Суррогат", "Суррогат строится для плоской земли без поля ветра; уберите рельеф и поле ветра.");
+        return;
+    }
+
+    SurrogateBox box{ baseParams, baseParams };
+    SurrogateOptions options;
+    options.max_degree = 12;
+    double spread = surrogateSpreadSpinBox->value() / 100.0;
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        if (i == 4) {
+            continue; // g
+        }
+        double value = scenario_parameter(baseParams, i);
+        double delta = spread * std::max(std::abs(value), scenario_parameter_scale(i));
+        scenario_parameter(box.low, i) = clamp_scenario_parameter(i, value - delta);
+        scenario_parameter(box.high, i) = clamp_scenario_parameter(i, value + delta);
+        options.axis_weight[i] = 3;
+        options.max_axis_degree[i] = 4;
+    }
+    Parameters from = baseParams, to = baseParams;
+    int graphTypeIndex = graphTypeComboBox->currentData().toInt();
+    if (graphParamMinSpinBox->value() < graphParamMaxSpinBox->value()
+        && applySweepValue(from, graphTypeIndex, graphParamMinSpinBox->value())
+        && applySweepValue(to, graphTypeIndex, graphParamMaxSpinBox->value())) {
+        for (int i = 0; i < kScenarioParameterCount; ++i) {
+            if (scenario_parameter(from, i) != scenario_parameter(to, i)) {
+                scenario_parameter(box.low, i) = std::min(scenario_parameter(box.low, i), scenario_parameter(from, i));
+                scenario_parameter(box.high, i) = std::max(scenario_parameter(box.high, i), scenario_parameter(to, i));
+                options.axis_weight[i] = 1;
+                options.max_axis_degree[i] = 12;
+            }
+        }
+    }
+
+    if (previewTimer->isActive()) {
+        previewTimer->stop();
+    }
+    outputArea->setText(QString("Суррогат: %1 полетов по латинскому гиперкубу...").arg(options.samples));
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    SurrogateReport report;
+    Surrogate built = build_surrogate(box, options, &report);
+    QApplication::restoreOverrideCursor();
+    if (!built.valid()) {
+        outputArea->setText(QString("Не удалось построить суррогат: из %1 полетов пригодны %2.").arg(report.flights).arg(report.used));
+        return;
+    }
+    surrogate = std::move(built);
+
+    // Время одного вычисления модели
+    QElapsedTimer clock;
+    clock.start();
+    const int evaluations = 10000;
+    double metrics[kSweepMetricCount];
+    for (int k = 0; k < evaluations; ++k) {
+        surrogate.evaluate_all(baseParams, metrics);
+    }
+    double evaluationNs = clock.nsecsElapsed() / static_cast<double>(evaluations);
+
+    outputArea->clear();
+    outputArea->append(QString("Суррогат: %1 полетов за %2 с, подбор степеней за %3 с; варьируется полей: %4. Вычисление всех величин - %5 нс.")
+                           .arg(report.used).arg(report.flight_seconds, 0, 'f', 2).arg(report.fit_seconds, 0, 'f', 2)
+                           .arg(surrogate.dimensions()).arg(evaluationNs, 0, 'f', 0));
+    outputArea->append(QString("Ошибка по %1-кратной перекрестной проверке (СКО / наибольшая):").arg(options.folds));
+    for (int m = 0; m < kSweepMetricCount; ++m) {
+        const SurrogateFit& fit = surrogate.fit(static_cast<SweepMetric>(m));
+        outputArea->append(QString("  %1: %2 / %3, степень %4, членов %5")
+                               .arg(sweepMetricLabel(static_cast<SweepMetric>(m)))
+                               .arg(fit.cv_rms, 0, 'g', 3).arg(fit.cv_max, 0, 'g', 3)
+                               .arg(fit.degree).arg(fit.coefficients.size()));
+    }
+    outputArea->append("С отметкой \"Графики по суррогату\" развертки внутри бокса строятся без полетов.");
+}
+
+void MainWindow::onSaveSurrogate() {
+    if (!surrogate.valid()) {
+        QMessageBox::information(this, "Суррогат", "Сначала постройте или загрузите суррогат.");
+        return;
+    }
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Сохранить суррогат"), "",
+                                                    tr("Surrogate models (*.sur);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    std::string error;
+    if (!surrogate.save(fileName.toStdString(), &error)) {
+        QMessageBox::warning(this, "Ошибка сохранения суррогата", QString::fromStdString(error));
+    }
+}
+
+void MainWindow::onLoadSurrogate() {
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Загрузить суррогат"), "",
+                                                    tr("Surrogate models (*.sur);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    std::string error;
+    Surrogate loaded;
+    if (!Surrogate::load(fileName.toStdString(), loaded, &error)) {
+        QMessageBox::warning(this, "Ошибка загрузки суррогата", QString::fromStdString(error));
+        return;
+    }
+    surrogate = std::move(loaded);
+    outputArea->setText(QString("Суррогат загружен: %1 полей варьируется, построен по %2 полетам.")
+                            .arg(surrogate.dimensions()).arg(surrogate.sample_count()));
 }
 
 void MainWindow::updateGraphParamRanges(int index) {
@@ -857,39 +2074,39 @@ void MainWindow::updateGraphParamRanges(int index) {
     double paramSpinBoxMin = -1e6, paramSpinBoxMax = 1e6; // Default broad range for spinboxes
 
     switch (graphTypeIndex) {
-        case 0: case 1: case 2: // Initial Speed
+        case 0: // Initial Speed
             minVal = 1.0; maxVal = 200.0; stepVal = 10.0;
             paramSpinBoxMin = 0.001; paramSpinBoxMax = 1e6;
             break;
-        case 3: case 4: case 5: // Angle
+        case 1: // Angle
             minVal = 0.0; maxVal = 90.0; stepVal = 5.0;
             paramSpinBoxMin = 0.0; paramSpinBoxMax = 90.0;
             break;
-        case 6: case 7: case 8: // Mass
+        case 2: // Mass
             minVal = 1.0; maxVal = 100.0; stepVal = 5.0;
             paramSpinBoxMin = 0.001; paramSpinBoxMax = 1e6;
             break;
-        case 9: case 10: case 11: // Cd
+        case 3: // Cd
             minVal = 0.0; maxVal = 2.0; stepVal = 0.1;
             paramSpinBoxMin = 0.0; paramSpinBoxMax = 10.0;
             break;
-        case 12: case 13: case 14: // Air Density
+        case 4: // Air Density
             minVal = 0.1; maxVal = 2.0; stepVal = 0.1;
             paramSpinBoxMin = 0.0; paramSpinBoxMax = 5.0;
             break;
-        case 15: case 16: case 17: // Radius
+        case 5: // Radius
             minVal = 0.01; maxVal = 1.0; stepVal = 0.05;
             paramSpinBoxMin = 0.001; paramSpinBoxMax = 10.0;
             break;
-        case 18: case 19: case 20: // Wind X
+        case 6: // Wind X
             minVal = -50.0; maxVal = 50.0; stepVal = 5.0;
             paramSpinBoxMin = -1000.0; paramSpinBoxMax = 1000.0;
             break;
-        case 21: case 22: case 23: // Wind Z
+        case 7: // Wind Z
             minVal = -50.0; maxVal = 50.0; stepVal = 5.0;
             paramSpinBoxMin = -1000.0; paramSpinBoxMax = 1000.0;
             break;
-        case 24: case 25: case 26: // Azimuth
+        case 8: // Azimuth
             minVal = 0.0; maxVal = 360.0; stepVal = 15.0;
             paramSpinBoxMin = 0.0; paramSpinBoxMax = 360.0;
             break;
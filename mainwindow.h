@@ -10,11 +10,25 @@
 #include <QGraphicsScene>
 #include <QGraphicsEllipseItem>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
 #include "parameters.h"
+#include "sweepstore.h"
+#include "surrogate.h"
+#include "sweepplanner.h"
 
 // Forward declaration for QFileDialog
 class QFileDialog;
 class QComboBox; // Forward declaration
+class QCheckBox;
+class QSpinBox;
+struct WorkPrecisionReport;
+struct SensitivityReport;
+struct UnscentedReport;
+class DecimatedPlotItem;
+class ImpactHistogram;
+class Trajectory;
+struct View3DModule;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -22,58 +36,121 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget *parent = nullptr);
 
+signals:
+    void initialPreviewReady(); // The first preview after the window is shown has been computed
+
 private slots:
     void onRunSimulation();
     void onRunAnimatedSimulation();
     void updatePreviewVisualization();
     void onSaveParameters();
     void onLoadParameters();
+    void onLoadTerrain(); // Load a heightmap for the ground
+    void onClearTerrain(); // Back to flat ground
+    void onLoadWindField(); // Map a gridded wind field file
+    void onClearWindField(); // Back to constant wind
+    void onFindOptimalAngle(); // Elevation (and drift-corrected azimuth) for maximum range
     void onPlotDependencyGraph(); // New slot for plotting
+    void onShowSweepOverlay(); // Slot to show all sweep trajectories in one 3D overlay
+    void onShowImpactMap(); // Impact density of the loaded ensemble or the current sweep
+    void onSensitivity(); // Perturb every parameter around the current point and rank the effects
+    void onUncertainty(); // Propagate the ensemble's dispersion with sigma points into an impact ellipse
+    void onWorkPrecision(); // Compare integrators and step sizes on reference shots
+    void onBuildSurrogate(); // Fit a polynomial surrogate of the flight metrics over a box around the current point
+    void onSaveSurrogate();
+    void onLoadSurrogate();
     void onBackToTrajectoryPreview(); // Slot to switch back to trajectory preview
     void onShowInstructions(); // Slot to show instructions
     void updateGraphParamRanges(int index); // Slot to update graph parameter input ranges dynamically
+    void onGraphMetricChanged(int index); // Redraws the graph on screen from the stored sweep
 
 private:
     bool validateCurrentParameters(Parameters& params); // Helper function to validate current parameters
+    bool applySweepValue(Parameters& params, int graphTypeIndex, double val) const; // Sets the swept parameter, false if the value is invalid
+    SweepKey currentSweepKey(const Parameters& baseParams) const; // Everything the sweep points depend on, from the graph controls
+    void drawSweepRecord(const SweepRecord& record); // Plots the selected metric of a stored sweep
     QMap<QString, QDoubleSpinBox*> inputFields;
     QTextEdit *outputArea;
     QPushButton *runButton;
     QPushButton *animateButton;
     QPushButton *saveParamsButton;
     QPushButton *loadParamsButton;
+    QPushButton *loadTerrainButton;
+    QPushButton *clearTerrainButton;
+    QPushButton *loadWindFieldButton;
+    QPushButton *clearWindFieldButton;
+    QPushButton *optimalAngleButton;
+    QDoubleSpinBox *maxFlightTimeSpinBox; // Time-of-flight limit for the optimal angle, 0 = none
+    QCheckBox *correctAzimuthCheckBox; // Also correct azimuth for crosswind drift
 
     // UI Elements for plotting
-    QComboBox *graphTypeComboBox;
+    QComboBox *graphTypeComboBox; // Swept parameter
+    QComboBox *graphMetricComboBox; // Plotted metric; switching it does not recompute the sweep
     QDoubleSpinBox *graphParamMinSpinBox;
     QDoubleSpinBox *graphParamMaxSpinBox;
     QDoubleSpinBox *graphParamStepSpinBox;
+    QCheckBox *singlePrecisionCheckBox; // float32 mode for sweeps
+    QDoubleSpinBox *precisionToleranceSpinBox; // Allowed float32 vs double divergence, %
+    QCheckBox *adaptiveSweepCheckBox; // Refine the sweep where the curve changes fast instead of stepping uniformly
+    QDoubleSpinBox *adaptiveToleranceSpinBox; // Allowed interpolation error, % of the value span
+    QSpinBox *adaptiveBudgetSpinBox; // Flight budget for the adaptive sweep
+    QSpinBox *sweepWorkersSpinBox; // Worker processes for sweeps, 0 = in-process
+    QCheckBox *resultCacheCheckBox; // Reuse flight summaries from the on-disk cache
+    QCheckBox *invariantSweepCheckBox; // Collapse sweep points with equal drag factor or a pure azimuth rotation
     QPushButton *plotGraphButton;
+    QPushButton *overlayButton; // Button to show sweep trajectories in 3D
+    QPushButton *impactMapButton; // Button to build the impact density map
+    QPushButton *sensitivityButton; // Button to build the tornado sensitivity chart
+    QDoubleSpinBox *sensitivitySpinBox; // Perturbation of each parameter, % of its value
+    QCheckBox *sensitivitySigmaCheckBox; // Perturb by the loaded ensemble's sigma instead
+    QPushButton *uncertaintyButton; // Button to propagate the ensemble's sigma with the unscented transform
+    QPushButton *workPrecisionButton; // Button to run the integrator work-precision comparison
+    QPushButton *surrogateButton; // Button to build the surrogate model
+    QDoubleSpinBox *surrogateSpreadSpinBox; // Half-width of the surrogate box for non-swept fields, % of the value
+    QCheckBox *surrogateCheckBox; // Answer graphs from the surrogate when the sweep lies inside its box
+    QPushButton *saveSurrogateButton;
+    QPushButton *loadSurrogateButton;
     QPushButton *backToPreviewButton; // Button to go back to trajectory preview
     QPushButton *instructionsButton; // Button to show instructions
 
+    SweepStore sweepStore; // Last sweep per parameter with all metrics of every point
+    int shownSweepParameter = -1; // Parameter of the stored sweep on screen, -1 = the preview shows something else
+    Surrogate surrogate; // Fitted flight-metric model, invalid until built or loaded
+    SweepPlanner sweepPlanner; // Canonical flights already computed, shared by all sweeps
+
+    // Dispersion of the ensemble last chosen in a scenario file (count 0 = none, the sweep is used)
+    Parameters ensembleSigma{};
+    std::size_t ensembleCount = 0;
+    quint64 ensembleSeed = 0;
+
     QGraphicsView *previewView;
     QGraphicsScene *previewScene;
     QGraphicsEllipseItem *projectileItem;
     QTimer *previewTimer;
-    int previewStep;
+    QElapsedTimer previewClock; // Wall time since the preview animation started
+    std::shared_ptr<const Trajectory> previewFlight; // The animated shell position is looked up by flight time
+    QPointF previewOrigin; // Scene point of the launch site
+    double previewScale = 1.0; // Scene pixels per metre
     QList<QPointF> previewTrajectory;
     double m_currentFlightTime; // Added to store current flight time for animation
 
     void setupUI();
     void runSimulation();
     void setupPreviewVisualization();
+    // The VTK module, loaded on the first 3D request; shows a warning and returns nullptr if it is missing
+    const View3DModule* view3d();
     void calculatePreviewTrajectory();
-    // Helper function to draw the graph
-    void drawDependencyGraph(const QList<QPointF>& dataPoints, const QString& xLabel, const QString& yLabel, double xMin, double xMax, double yMin, double yMax);
-    // Helper struct for simulation results
-    struct SimulationResult {
-        double max_height = 0.0;
-        double total_distance = 0.0;
-        double flight_time = 0.0;
-        bool data_is_valid = true; // Flag to indicate if the simulation produced a usable result
-    };
-    // Helper function to run a single simulation for graph data
-    SimulationResult runSingleSimulationForGraph(Parameters params);
+    // Clears the preview and adds an empty decimated plot that sweep results are streamed into
+    DecimatedPlotItem* startDependencyGraph(const QString& xLabel, const QString& yLabel);
+    // Ranked tornado charts of range, apex and lateral drift, one under another
+    void drawTornadoChart(const SensitivityReport& report);
+    // Top view of the sigma-point impacts with the 1-sigma and 95% dispersion ellipses at equal axis scale
+    void drawUncertaintyEllipse(const UnscentedReport& report);
+    // Log-log work-precision diagram: error against derivative evaluations and against wall time per flight,
+    // two panels sharing the error axis, one line per integrator
+    void drawWorkPrecisionDiagram(const WorkPrecisionReport& report);
+    // Colour-mapped impact histogram over the x-z ground plane with a log-scale colour bar
+    void drawImpactMap(const ImpactHistogram& map, const QString& title);
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "optimalangle.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+// Азимут в модели переводится в радианы множителем 3.14 / 180 (см. initial_state),
+// поэтому направление на точку падения сравнивается в тех же единицах
+constexpr double kDegToModelRad = 3.14 / 180.0;
+
+class Search {
+public:
+    Search(const Parameters& base_params, const ElevationSearchOptions& search_options, const FlightBatchEvaluator& batch_evaluator)
+        : base(base_params), options(search_options), evaluate(batch_evaluator) {}
+
+    std::vector<FlightSummary> run(const std::vector<Parameters>& batch) {
+        flights += batch.size();
+        if (evaluate) {
+            return evaluate(batch);
+        }
+        std::vector<FlightSummary> results;
+        results.reserve(batch.size());
+        for (const Parameters& p : batch) {
+            results.push_back(smooth_flight_summary(p, options.dt, options.max_points));
+        }
+        return results;
+    }
+
+    FlightSummary at(double elevation, double azimuth) {
+        Parameters p = base;
+        p.angle_deg = elevation;
+        p.azimuth_deg = azimuth;
+        return run({ p }).front();
+    }
+
+    // Максимум дальности по углу возвышения на [lo, hi] при фиксированном азимуте
+    double maximize_elevation(double lo, double hi, double azimuth, FlightSummary& best, bool& time_limited);
+
+    // Азимут, при котором точка падения лежит на заданном направлении
+    double correct_azimuth(double elevation, double azimuth, FlightSummary& summary);
+
+    std::size_t flights = 0;
+
+private:
+    const Parameters& base;
+    const ElevationSearchOptions& options;
+    const FlightBatchEvaluator& evaluate;
+};
+
+double bearing_error(const FlightSummary& summary, double target_azimuth) {
+    double bearing = std::atan2(summary.impact_z, summary.impact_x);
+    double diff = bearing - target_azimuth * kDegToModelRad;
+    return std::remainder(diff, 2.0 * 3.14159265358979323846);
+}
+
+double Search::maximize_elevation(double lo, double hi, double azimuth, FlightSummary& best, bool& time_limited) {
+    // Первый пакет: равномерная сетка
+    int n = std::max(options.grid_points, 3);
+    std::vector<double> angles(n);
+    std::vector<Parameters> batch(n, base);
+    for (int i = 0; i < n; ++i) {
+        angles[i] = lo + (hi - lo) * i / (n - 1);
+        batch[i].angle_deg = angles[i];
+        batch[i].azimuth_deg = azimuth;
+    }
+    std::vector<FlightSummary> grid = run(batch);
+
+    // Ограничение по времени: граничный угол - корень time(angle) = T методом Иллинойс
+    time_limited = false;
+    bool limited = false;
+    if (options.max_flight_time > 0.0) {
+        int first_over = -1;
+        for (int i = 0; i < n; ++i) {
+            if (grid[i].flight_time > options.max_flight_time) {
+                first_over = i;
+                break;
+            }
+        }
+        if (first_over == 0) {
+            best = grid[0];
+            time_limited = true;
+            return angles[0]; // даже наименьший угол не укладывается во время
+        }
+        if (first_over > 0) {
+            double a = angles[first_over - 1], b = angles[first_over];
+            double fa = grid[first_over - 1].flight_time - options.max_flight_time;
+            double fb = grid[first_over].flight_time - options.max_flight_time;
+            FlightSummary atA = grid[first_over - 1];
+            int side = 0;
+            while (b - a > options.tolerance_deg) {
+                double c = (a * fb - b * fa) / (fb - fa);
+                if (!(c > a && c < b)) c = 0.5 * (a + b);
+                FlightSummary sc = at(c, azimuth);
+                double fc = sc.flight_time - options.max_flight_time;
+                if (fc > 0.0) {
+                    b = c; fb = fc;
+                    if (side == -1) fa *= 0.5;
+                    side = -1;
+                } else {
+                    a = c; fa = fc; atA = sc;
+                    if (side == 1) fb *= 0.5;
+                    side = 1;
+                }
+            }
+            // Сетка ниже границы; граница - последняя допустимая точка
+            limited = true;
+            hi = a;
+            while (n > 0 && angles[n - 1] >= hi) {
+                angles.pop_back();
+                grid.pop_back();
+                --n;
+            }
+            angles.push_back(hi);
+            grid.push_back(atA);
+            ++n;
+        }
+    }
+
+    int k = 0;
+    for (int i = 1; i < n; ++i) {
+        if (grid[i].total_distance > grid[k].total_distance) k = i;
+    }
+    if (limited && k == n - 1) {
+        // Дальность растет до самой границы по времени - оптимум на границе
+        best = grid[k];
+        time_limited = true;
+        return angles[k];
+    }
+
+    // Брент на отрезке вокруг лучшей точки сетки (минимизация -дальности)
+    double a = angles[std::max(k - 1, 0)];
+    double b = angles[std::min(k + 1, n - 1)];
+    const double golden = 0.3819660112501051;
+    double x = angles[k], w = x, v = x;
+    double fx = -grid[k].total_distance, fw = fx, fv = fx;
+    FlightSummary sx = grid[k];
+    double d = 0.0, e = 0.0;
+    for (int iter = 0; iter < 100; ++iter) {
+        double xm = 0.5 * (a + b);
+        double tol1 = 0.5 * options.tolerance_deg;
+        double tol2 = 2.0 * tol1;
+        if (std::abs(x - xm) <= tol2 - 0.5 * (b - a)) break;
+        if (std::abs(e) > tol1) {
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2.0 * (q - r);
+            if (q > 0.0) p = -p;
+            q = std::abs(q);
+            double etemp = e;
+            e = d;
+            if (std::abs(p) >= std::abs(0.5 * q * etemp) || p <= q * (a - x) || p >= q * (b - x)) {
+                e = (x >= xm ? a - x : b - x);
+                d = golden * e;
+            } else {
+                d = p / q;
+                double u = x + d;
+                if (u - a < tol2 || b - u < tol2) d = std::copysign(tol1, xm - x);
+            }
+        } else {
+            e = (x >= xm ? a - x : b - x);
+            d = golden * e;
+        }
+        double u = std::abs(d) >= tol1 ? x + d : x + std::copysign(tol1, d);
+        FlightSummary su = at(u, azimuth);
+        double fu = -su.total_distance;
+        if (fu <= fx) {
+            if (u >= x) a = x; else b = x;
+            v = w; fv = fw;
+            w = x; fw = fx;
+            x = u; fx = fu; sx = su;
+        } else {
+            if (u < x) a = u; else b = u;
+            if (fu <= fw || w == x) {
+                v = w; fv = fw;
+                w = u; fw = fu;
+            } else if (fu <= fv || v == x || v == w) {
+                v = u; fv = fu;
+            }
+        }
+    }
+    best = sx;
+    return x;
+}
+
+double Search::correct_azimuth(double elevation, double azimuth, FlightSummary& summary) {
+    // Метод секущих по ошибке направления; снос слабо зависит от азимута, обычно хватает 2-3 полетов
+    double tolerance = options.tolerance_deg * kDegToModelRad;
+    double a0 = azimuth;
+    double e0 = bearing_error(summary, base.azimuth_deg);
+    if (std::abs(e0) <= tolerance) {
+        return azimuth;
+    }
+    double a1 = azimuth - e0 / kDegToModelRad;
+    FlightSummary s1 = at(elevation, a1);
+    double e1 = bearing_error(s1, base.azimuth_deg);
+    for (int iter = 0; iter < 8 && std::abs(e1) > tolerance; ++iter) {
+        double a2 = e1 != e0 ? a1 - e1 * (a1 - a0) / (e1 - e0) : a1 - e1 / kDegToModelRad;
+        a0 = a1;
+        e0 = e1;
+        a1 = a2;
+        s1 = at(elevation, a1);
+        e1 = bearing_error(s1, base.azimuth_deg);
+    }
+    summary = s1;
+    return a1;
+}
+
+} // namespace
+
+FlightSummary smooth_flight_summary(const Parameters& params, double dt, std::size_t max_points) {
+    // На рельефе точка падения уже интерполируется внутри шага
+    if (active_terrain()) {
+        return integrate_flight_summary(params, dt, max_points);
+    }
+    std::shared_ptr<const WindField> wind = active_wind_field();
+    State state = initial_state(params);
+    FlightSummary summary;
+    for (std::size_t count = 0; count + 1 < max_points; ++count) {
+        State next = runge_kutta_step(state, params, dt, wind.get(), count * dt);
+        summary.max_height = std::max(summary.max_height, state.y);
+        if (state.vy > 0.0 && next.vy <= 0.0) {
+            double s = bisect_unit([&](double u) { return hermite_slope(state.y, next.y, state.vy, next.vy, dt, u); });
+            summary.max_height = std::max(summary.max_height, hermite(state.y, next.y, state.vy, next.vy, dt, s));
+        }
+        if (next.y < 0.0) {
+            double s = bisect_unit([&](double u) { return hermite(state.y, next.y, state.vy, next.vy, dt, u); });
+            summary.impact_x = hermite(state.x, next.x, state.vx, next.vx, dt, s);
+            summary.impact_z = hermite(state.z, next.z, state.vz, next.vz, dt, s);
+            summary.total_distance = std::sqrt(summary.impact_x * summary.impact_x + summary.impact_z * summary.impact_z);
+            double vx = hermite_slope(state.x, next.x, state.vx, next.vx, dt, s) / dt;
+            double vy = hermite_slope(state.y, next.y, state.vy, next.vy, dt, s) / dt;
+            double vz = hermite_slope(state.z, next.z, state.vz, next.vz, dt, s) / dt;
+            summary.impact_speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+            summary.flight_time = (count + s) * dt;
+            return summary;
+        }
+        state = next;
+        summary.flight_time = (count + 1) * dt;
+    }
+    summary.impact_x = state.x;
+    summary.impact_z = state.z;
+    summary.total_distance = std::sqrt(state.x * state.x + state.z * state.z);
+    summary.impact_speed = std::sqrt(state.vx * state.vx + state.vy * state.vy + state.vz * state.vz);
+    return summary;
+}
+
+ElevationSearchResult find_optimal_elevation(const Parameters& params, const ElevationSearchOptions& options,
+                                             const FlightBatchEvaluator& evaluate) {
+    ElevationSearchResult result;
+    if (!(options.max_elevation > options.min_elevation) || options.tolerance_deg <= 0.0) {
+        return result;
+    }
+    Search search(params, options, evaluate);
+    double azimuth = params.azimuth_deg;
+    FlightSummary best;
+    bool limited = false;
+    double elevation = search.maximize_elevation(options.min_elevation, options.max_elevation, azimuth, best, limited);
+
+    if (options.correct_azimuth) {
+        // Снос зависит от угла возвышения, поэтому поправка азимута и поиск угла чередуются;
+        // повторный поиск угла идет в окрестности найденного
+        for (int pass = 0; pass < 3; ++pass) {
+            double corrected = search.correct_azimuth(elevation, azimuth, best);
+            bool settled = std::abs(corrected - azimuth) <= options.tolerance_deg;
+            azimuth = corrected;
+            if (settled) {
+                break;
+            }
+            double lo = std::max(options.min_elevation, elevation - 5.0);
+            double hi = std::min(options.max_elevation, elevation + 5.0);
+            elevation = search.maximize_elevation(lo, hi, azimuth, best, limited);
+        }
+    }
+
+    result.found = true;
+    result.elevation_deg = elevation;
+    result.azimuth_deg = azimuth - 360.0 * std::floor(azimuth / 360.0);
+    result.summary = best;
+    result.flights = search.flights;
+    result.time_limited = limited;
+    result.bearing_error_deg = bearing_error(best, params.azimuth_deg) / kDegToModelRad;
+    return result;
+}
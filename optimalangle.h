@@ -0,0 +1,49 @@
+#ifndef OPTIMALANGLE_H
+#define OPTIMALANGLE_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Поиск угла возвышения с наибольшей дальностью при сопротивлении и ветре.
+// Грубая сетка углов считается одним пакетом и дает отрезок с максимумом,
+// дальше - метод Брента (парабола через три точки, иначе золотое сечение).
+// Ограничение по времени полета: время растет с углом, поэтому граничный угол
+// находится как корень time(angle) = T, и максимум ищется ниже него.
+
+struct ElevationSearchOptions {
+    double min_elevation = 0.5;    // градусы
+    double max_elevation = 89.5;
+    int grid_points = 5;           // грубая сетка первого пакета
+    double tolerance_deg = 0.01;
+    double max_flight_time = 0.0;  // 0 - без ограничения
+    // Подобрать азимут так, чтобы точка падения лежала на направлении из параметров (снос ветром)
+    bool correct_azimuth = false;
+    double dt = 0.01;
+    std::size_t max_points = 100000;
+};
+
+struct ElevationSearchResult {
+    bool found = false;
+    double elevation_deg = 0.0;
+    double azimuth_deg = 0.0;
+    FlightSummary summary;
+    std::size_t flights = 0;
+    bool time_limited = false;     // максимум упирается в ограничение по времени полета
+    double bearing_error_deg = 0.0; // отклонение направления на точку падения от заданного
+};
+
+// Пакетный расчет полетов; результаты в порядке параметров
+using FlightBatchEvaluator = std::function<std::vector<FlightSummary>(const std::vector<Parameters>&)>;
+
+// Полет с уточнением точки падения на плоскую землю кубической интерполяцией внутри шага,
+// чтобы дальность была гладкой функцией угла (у integrate_flight_summary она ступенчатая
+// с шагом около |vx| * dt). Рельеф и поле ветра учитываются как в обычном расчете.
+FlightSummary smooth_flight_summary(const Parameters& params, double dt, std::size_t max_points);
+
+// evaluate == nullptr - smooth_flight_summary для каждого полета
+ElevationSearchResult find_optimal_elevation(const Parameters& params, const ElevationSearchOptions& options = {},
+                                             const FlightBatchEvaluator& evaluate = nullptr);
+
+#endif // OPTIMALANGLE_H
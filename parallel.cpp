@@ -0,0 +1,41 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+int parallel_worker_count(std::size_t count, std::size_t chunk, int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    std::size_t chunks = (count + std::max<std::size_t>(chunk, 1) - 1) / std::max<std::size_t>(chunk, 1);
+    return static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(static_cast<std::size_t>(threads), chunks)));
+}
+
+int parallel_for(std::size_t count, std::size_t chunk, int threads,
+                 const std::function<void(std::size_t begin, std::size_t end, int worker)>& body) {
+    chunk = std::max<std::size_t>(chunk, 1);
+    int workers = parallel_worker_count(count, chunk, threads);
+    std::atomic<std::size_t> next{ 0 };
+    auto run = [&](int worker) {
+        for (;;) {
+            std::size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+            if (begin >= count) {
+                break;
+            }
+            body(begin, std::min(count, begin + chunk), worker);
+        }
+    };
+
+    // Вызывающий поток работает как последний из потоков
+    std::vector<std::thread> pool;
+    pool.reserve(static_cast<std::size_t>(workers - 1));
+    for (int w = 0; w + 1 < workers; ++w) {
+        pool.emplace_back(run, w);
+    }
+    run(workers - 1);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    return workers;
+}
@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Делит [0, count) на куски по chunk элементов и раздает их потокам (0 - по числу ядер).
+// body(begin, end, worker) вызывается для каждого куска, worker в [0, возвращенное число потоков):
+// поток может копить результат в собственном буфере с этим номером без синхронизации.
+// Общий между потоками только счетчик кусков. Вызов возвращается, когда все куски обработаны.
+int parallel_for(std::size_t count, std::size_t chunk, int threads,
+                 const std::function<void(std::size_t begin, std::size_t end, int worker)>& body);
+
+// Число потоков, которое parallel_for возьмет для count элементов
+int parallel_worker_count(std::size_t count, std::size_t chunk, int threads);
+
+#endif // PARALLEL_H
@@ -0,0 +1,279 @@
+#include "plotitem.h"
+#include <QFont>
+#include <QGraphicsSceneMouseEvent>
+#include <QGraphicsSceneWheelEvent>
+#include <QPainter>
+#include <QPen>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int kTickCount = 5;
+
+bool lessX(const QPointF& a, const QPointF& b) {
+    return a.x() < b.x();
+}
+
+} // namespace
+
+DecimatedPlotItem::DecimatedPlotItem(const QRectF& area, const QString& xLabel, const QString& yLabel)
+    : area(area), xLabel(xLabel), yLabel(yLabel) {
+    setAcceptedMouseButtons(Qt::LeftButton);
+    clear();
+}
+
+void DecimatedPlotItem::append(const QPointF& point) {
+    addPoint(point);
+    refresh();
+}
+
+void DecimatedPlotItem::append(const std::vector<QPointF>& newPoints) {
+    // Одна перерисовка на порцию точек
+    for (const QPointF& point : newPoints) {
+        addPoint(point);
+    }
+    refresh();
+}
+
+void DecimatedPlotItem::addPoint(const QPointF& point) {
+    if (!std::isfinite(point.x()) || !std::isfinite(point.y())) {
+        return;
+    }
+    if (!points.empty() && point.x() < points.back().x()) {
+        sorted = false;
+    }
+    points.push_back(point);
+    dataXMin = std::min(dataXMin, point.x());
+    dataXMax = std::max(dataXMax, point.x());
+    dataYMin = std::min(dataYMin, point.y());
+    dataYMax = std::max(dataYMax, point.y());
+}
+
+void DecimatedPlotItem::refresh() {
+    if (autoView) {
+        view = fittedView();
+    }
+    invalidate();
+}
+
+void DecimatedPlotItem::clear() {
+    points.clear();
+    sorted = true;
+    dataXMin = dataYMin = std::numeric_limits<double>::max();
+    dataXMax = dataYMax = std::numeric_limits<double>::lowest();
+    autoView = true;
+    refresh();
+}
+
+void DecimatedPlotItem::setViewRange(double xMin, double xMax, double yMin, double yMax) {
+    autoView = false;
+    double width = xMax > xMin ? xMax - xMin : 1.0;
+    double height = yMax > yMin ? yMax - yMin : 1.0;
+    view = QRectF(xMin, yMin, width, height);
+    invalidate();
+}
+
+void DecimatedPlotItem::resetView() {
+    autoView = true;
+    refresh();
+}
+
+QRectF DecimatedPlotItem::fittedView() const {
+    if (points.empty()) {
+        return QRectF(0.0, 0.0, 1.0, 1.0);
+    }
+    double xMin = dataXMin, xMax = dataXMax;
+    if (xMax <= xMin) {
+        xMin -= 0.5;
+        xMax += 0.5;
+    }
+    // Небольшой запас по Y, чтобы экстремумы не лежали на рамке
+    double pad = (dataYMax - dataYMin) * 0.05;
+    if (pad <= 0.0) {
+        pad = std::max(std::abs(dataYMax) * 0.05, 0.5);
+    }
+    return QRectF(xMin, dataYMin - pad, xMax - xMin, dataYMax - dataYMin + 2 * pad);
+}
+
+QRectF DecimatedPlotItem::plotRect() const {
+    // Отступы как в прежнем графике: слева под подписи Y, снизу под подписи X
+    return QRectF(area.left() + area.width() * 0.10, area.top() + area.height() * 0.05,
+                  area.width() * 0.85, area.height() * 0.80);
+}
+
+QPointF DecimatedPlotItem::toScene(const QPointF& value) const {
+    QRectF plot = plotRect();
+    return QPointF(plot.left() + (value.x() - view.left()) / view.width() * plot.width(),
+                   plot.bottom() - (value.y() - view.top()) / view.height() * plot.height());
+}
+
+QPointF DecimatedPlotItem::toData(const QPointF& scenePoint) const {
+    QRectF plot = plotRect();
+    return QPointF(view.left() + (scenePoint.x() - plot.left()) / plot.width() * view.width(),
+                   view.top() + (plot.bottom() - scenePoint.y()) / plot.height() * view.height());
+}
+
+void DecimatedPlotItem::invalidate() {
+    decimatedValid = false;
+    update();
+}
+
+void DecimatedPlotItem::decimate() {
+    decimated.clear();
+    visiblePoints = 0;
+    decimatedValid = true;
+    if (points.empty()) {
+        return;
+    }
+    if (!sorted) {
+        std::stable_sort(points.begin(), points.end(), lessX);
+        sorted = true;
+    }
+
+    // Видимые точки и по одной соседней с каждой стороны, чтобы линия доходила до рамки
+    auto first = std::lower_bound(points.begin(), points.end(), QPointF(view.left(), 0.0), lessX);
+    auto last = std::upper_bound(first, points.end(), QPointF(view.right(), 0.0), lessX);
+    if (first != points.begin()) {
+        --first;
+    }
+    if (last != points.end()) {
+        ++last;
+    }
+    visiblePoints = static_cast<std::size_t>(last - first);
+
+    QRectF plot = plotRect();
+    int columns = std::max(1, static_cast<int>(plot.width()));
+    double columnScale = columns / view.width();
+
+    // Столбец пикселей: первая, минимальная, максимальная и последняя точки (в порядке X)
+    auto flush = [&](auto begin, auto minIt, auto maxIt, auto end) {
+        auto lo = std::min(minIt, maxIt);
+        auto hi = std::max(minIt, maxIt);
+        auto previous = points.end();
+        for (auto it : { begin, lo, hi, end }) {
+            if (it != previous) {
+                decimated.append(toScene(*it));
+            }
+            previous = it;
+        }
+    };
+
+    auto columnOf = [&](const QPointF& p) {
+        double c = std::floor((p.x() - view.left()) * columnScale);
+        return static_cast<int>(std::clamp(c, -1.0, static_cast<double>(columns)));
+    };
+
+    auto begin = first, minIt = first, maxIt = first, end = first;
+    int column = columnOf(*first);
+    for (auto it = first + 1; it != last; ++it) {
+        int c = columnOf(*it);
+        if (c != column) {
+            flush(begin, minIt, maxIt, end);
+            begin = minIt = maxIt = end = it;
+            column = c;
+            continue;
+        }
+        if (it->y() < minIt->y()) minIt = it;
+        if (it->y() > maxIt->y()) maxIt = it;
+        end = it;
+    }
+    flush(begin, minIt, maxIt, end);
+}
+
+QRectF DecimatedPlotItem::boundingRect() const {
+    return area;
+}
+
+void DecimatedPlotItem::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*) {
+    if (!decimatedValid) {
+        decimate();
+    }
+    QRectF plot = plotRect();
+    QFont tickFont("Arial", 8);
+    QFont labelFont("Arial", 10);
+
+    painter->setPen(QPen(Qt::black, 2));
+    painter->drawLine(plot.bottomLeft(), plot.bottomRight());
+    painter->drawLine(plot.topLeft(), plot.bottomLeft());
+
+    if (points.empty()) {
+        painter->setFont(QFont("Arial", 12));
+        painter->drawText(area, Qt::AlignCenter, "Нет данных для построения графика.");
+        return;
+    }
+
+    // Метки осей пересчитываются по текущей области просмотра
+    painter->setPen(QPen(Qt::black, 1));
+    painter->setFont(tickFont);
+    for (int i = 0; i <= kTickCount; ++i) {
+        double val = view.left() + view.width() * i / kTickCount;
+        double xPos = plot.left() + plot.width() * i / kTickCount;
+        painter->drawLine(QPointF(xPos, plot.bottom()), QPointF(xPos, plot.bottom() + 5));
+        painter->drawText(QRectF(xPos - 40, plot.bottom() + 7, 80, 14), Qt::AlignHCenter | Qt::AlignTop, QString::number(val, 'g', 5));
+    }
+    for (int i = 0; i <= kTickCount; ++i) {
+        double val = view.top() + view.height() * i / kTickCount;
+        double yPos = plot.bottom() - plot.height() * i / kTickCount;
+        painter->drawLine(QPointF(plot.left() - 5, yPos), QPointF(plot.left(), yPos));
+        painter->drawText(QRectF(area.left(), yPos - 7, plot.left() - area.left() - 8, 14), Qt::AlignRight | Qt::AlignVCenter, QString::number(val, 'g', 5));
+    }
+
+    painter->setFont(labelFont);
+    painter->drawText(QRectF(plot.left(), plot.bottom() + 22, plot.width(), 18), Qt::AlignHCenter | Qt::AlignTop, xLabel);
+    painter->save();
+    painter->translate(area.left() + 2, plot.center().y());
+    painter->rotate(-90);
+    painter->drawText(QRectF(-plot.height() / 2, 0, plot.height(), 18), Qt::AlignHCenter | Qt::AlignTop, yLabel);
+    painter->restore();
+
+    painter->setFont(tickFont);
+    painter->drawText(QRectF(plot.left(), plot.top(), plot.width() - 4, 14), Qt::AlignRight | Qt::AlignTop,
+                      QString("Точек: %1, на экране: %2, отрисовано: %3").arg(points.size()).arg(visiblePoints).arg(decimated.size()));
+
+    painter->save();
+    painter->setClipRect(plot);
+    QPen dataPen(Qt::blue, 2);
+    dataPen.setCosmetic(true);
+    painter->setPen(dataPen);
+    painter->drawPolyline(decimated);
+    painter->restore();
+}
+
+void DecimatedPlotItem::wheelEvent(QGraphicsSceneWheelEvent* event) {
+    // Масштаб вокруг точки под курсором; с Shift - только по X
+    double factor = std::pow(0.999, event->delta());
+    QPointF anchor = toData(event->pos());
+    double left = anchor.x() - (anchor.x() - view.left()) * factor;
+    double top = view.top();
+    double height = view.height();
+    if (!(event->modifiers() & Qt::ShiftModifier)) {
+        top = anchor.y() - (anchor.y() - view.top()) * factor;
+        height *= factor;
+    }
+    autoView = false;
+    view = QRectF(left, top, view.width() * factor, height);
+    invalidate();
+    event->accept();
+}
+
+void DecimatedPlotItem::mousePressEvent(QGraphicsSceneMouseEvent* event) {
+    dragOrigin = event->pos();
+    dragView = view;
+    event->accept();
+}
+
+void DecimatedPlotItem::mouseMoveEvent(QGraphicsSceneMouseEvent* event) {
+    QRectF plot = plotRect();
+    QPointF delta = event->pos() - dragOrigin;
+    autoView = false;
+    view = dragView.translated(-delta.x() / plot.width() * dragView.width(), delta.y() / plot.height() * dragView.height());
+    invalidate();
+    event->accept();
+}
+
+void DecimatedPlotItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event) {
+    resetView();
+    event->accept();
+}
@@ -0,0 +1,70 @@
+#ifndef PLOTITEM_H
+#define PLOTITEM_H
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QRectF>
+#include <QString>
+#include <cstddef>
+#include <vector>
+
+// График зависимости с прореживанием по столбцам пикселей.
+// Все точки хранятся полностью, а рисуется только ломаная из первой, минимальной,
+// максимальной и последней точки каждого столбца (не больше 4 точек на пиксель),
+// поэтому отрисовка не зависит от размера развертки. Точки можно добавлять по мере
+// расчета; масштаб (колесико, Shift - только по X) и сдвиг (перетаскивание) заново
+// прореживают полные данные, двойной щелчок возвращает масштаб по всем данным.
+class DecimatedPlotItem : public QGraphicsItem {
+public:
+    // area - прямоугольник сцены под весь график вместе с осями и подписями
+    DecimatedPlotItem(const QRectF& area, const QString& xLabel, const QString& yLabel);
+
+    void append(const QPointF& point);
+    void append(const std::vector<QPointF>& points);
+    void clear();
+    std::size_t pointCount() const { return points.size(); }
+
+    // Фиксированная область просмотра в координатах данных
+    void setViewRange(double xMin, double xMax, double yMin, double yMax);
+    // Область просмотра по всем данным, дальше следует за добавляемыми точками
+    void resetView();
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+
+protected:
+    void wheelEvent(QGraphicsSceneWheelEvent* event) override;
+    void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+    void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event) override;
+
+private:
+    QRectF plotRect() const;
+    QRectF fittedView() const;
+    void addPoint(const QPointF& point);
+    void refresh(); // подогнать область просмотра (если следует за данными) и перерисовать
+    void invalidate();
+    void decimate();
+    QPointF toScene(const QPointF& value) const;
+    QPointF toData(const QPointF& scenePoint) const;
+
+    QRectF area;
+    QString xLabel;
+    QString yLabel;
+
+    std::vector<QPointF> points; // все точки; сортируются по X перед прореживанием, если пришли не по порядку
+    bool sorted = true;
+    double dataXMin, dataXMax, dataYMin, dataYMax;
+
+    QRectF view; // видимая область в координатах данных (top = min Y)
+    bool autoView = true;
+
+    QPolygonF decimated; // ломаная для отрисовки в координатах сцены
+    std::size_t visiblePoints = 0;
+    bool decimatedValid = false;
+
+    QPointF dragOrigin;
+    QRectF dragView;
+};
+
+#endif // PLOTITEM_H
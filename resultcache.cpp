@@ -0,0 +1,434 @@
+#include "resultcache.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<FlightSummary>::value, "FlightSummary is stored in the mapped index");
+static_assert(std::is_trivially_copyable<State>::value, "Uncompressed trajectory files hold raw states");
+
+struct ResultCache::IndexHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t capacity;
+    std::uint32_t reserved;
+    std::uint64_t clock;            // счетчик обращений для вытеснения давно не использованных записей
+    std::uint64_t trajectory_bytes; // суммарный размер файлов траекторий
+};
+
+struct ResultCache::IndexSlot {
+    std::uint32_t seq;   // seqlock: нечетное значение - запись в процессе изменения
+    std::uint32_t flags;
+    std::uint64_t hash;
+    std::uint64_t check;
+    std::uint64_t last_used;
+    FlightSummary summary;
+    std::uint64_t trajectory_bytes;
+};
+
+namespace {
+
+constexpr std::uint32_t kIndexMagic = 0x43525342; // "BSRC"
+constexpr std::uint32_t kIndexVersion = 2;
+constexpr std::uint32_t kSlotUsed = 1;
+constexpr std::uint32_t kSlotHasTrajectory = 2;
+constexpr std::uint32_t kProbeWindow = 16; // слотов, просматриваемых от начальной позиции ключа
+constexpr int kLockTimeoutMs = 2000;
+
+std::uint64_t splitmix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Хэш последовательности 64-битных слов с заданным зерном
+struct Hasher {
+    std::uint64_t state;
+    explicit Hasher(std::uint64_t seed) : state(splitmix(seed)) {}
+    void add(std::uint64_t word) { state = splitmix(state ^ splitmix(word)); }
+    void add(double value) {
+        // -0 и 0, а также все NaN дают одинаковый ключ
+        if (value == 0.0) {
+            value = 0.0;
+        }
+        std::uint64_t bits = 0x7ff8000000000000ull;
+        if (!std::isnan(value)) {
+            std::memcpy(&bits, &value, sizeof(bits));
+        }
+        add(bits);
+    }
+    void add(const QString& text) {
+        QByteArray bytes = text.toUtf8();
+        add(static_cast<std::uint64_t>(bytes.size()));
+        for (char c : bytes) {
+            add(static_cast<std::uint64_t>(static_cast<unsigned char>(c)));
+        }
+    }
+};
+
+} // namespace
+
+std::uint64_t result_cache_environment() {
+    // Рельеф и поле ветра входят в ключ по пути, размеру и времени изменения файла
+    Hasher hasher(0x456e7669726f6e6dull);
+    auto add_file = [&hasher](const std::string& path) {
+        QFileInfo info(QString::fromStdString(path));
+        hasher.add(info.absoluteFilePath());
+        hasher.add(static_cast<std::uint64_t>(info.size()));
+        hasher.add(static_cast<std::uint64_t>(info.lastModified().toMSecsSinceEpoch()));
+    };
+    std::shared_ptr<const Heightmap> terrain = active_terrain();
+    hasher.add(static_cast<std::uint64_t>(terrain ? 1 : 0));
+    if (terrain) {
+        add_file(terrain->source());
+    }
+    std::shared_ptr<const WindField> field = active_wind_field();
+    hasher.add(static_cast<std::uint64_t>(field ? 1 : 0));
+    if (field) {
+        add_file(field->source());
+    }
+    return hasher.state;
+}
+
+ResultCacheKey result_cache_key(const Parameters& params, const BatchOptions& options, std::uint64_t environment) {
+    ResultCacheKey key;
+    for (int pass = 0; pass < 2; ++pass) {
+        Hasher hasher(pass == 0 ? 0x5265737543616368ull : 0x436865636b4b6579ull);
+        hasher.add(static_cast<std::uint64_t>(kResultCacheModelVersion));
+        hasher.add(options.dt);
+        hasher.add(static_cast<std::uint64_t>(options.max_points));
+        // float32-итоги отличаются от double, поэтому настройки режима тоже часть ключа
+        hasher.add(static_cast<std::uint64_t>(options.single_precision));
+        if (options.single_precision) {
+            hasher.add(options.tolerance);
+            hasher.add(static_cast<std::uint64_t>(options.verify_every));
+            hasher.add(static_cast<std::uint64_t>(options.auto_escalate));
+        }
+        hasher.add(params.mass);
+        hasher.add(params.Cd);
+        hasher.add(params.air_density);
+        hasher.add(params.radius);
+        hasher.add(params.g);
+        hasher.add(params.wind_x);
+        hasher.add(params.wind_z);
+        hasher.add(params.angle_deg);
+        hasher.add(params.initial_speed);
+        hasher.add(params.azimuth_deg);
+        hasher.add(environment);
+        (pass == 0 ? key.hash : key.check) = hasher.state;
+    }
+    return key;
+}
+
+ResultCache& ResultCache::instance() {
+    // Траектории в кэше пользователя хранятся сжатыми: лимит размера вмещает в 20-30 раз больше полетов
+    static ResultCache& cache = []() -> ResultCache& {
+        static ResultCache instance(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results");
+        TrajectoryCodecOptions options;
+        instance.set_trajectory_compression(&options);
+        return instance;
+    }();
+    return cache;
+}
+
+void ResultCache::set_trajectory_compression(const TrajectoryCodecOptions* options) {
+    compress_trajectories = options != nullptr;
+    if (options) {
+        codec = *options;
+    }
+}
+
+ResultCache::ResultCache(const QString& directory, std::uint32_t capacity, std::uint64_t trajectory_budget)
+    : root(directory), slot_count(1), budget(trajectory_budget) {
+    // Емкость - степень двойки, чтобы позиция ключа бралась маской
+    while (slot_count < capacity && slot_count < (1u << 30)) {
+        slot_count <<= 1;
+    }
+    open_index();
+}
+
+ResultCache::~ResultCache() {
+    if (header) {
+        indexFile.unmap(reinterpret_cast<uchar*>(header));
+    }
+}
+
+bool ResultCache::open_index() {
+    if (root.isEmpty() || !QDir().mkpath(root + "/trajectories")) {
+        return false;
+    }
+    QLockFile lock(root + "/index.lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        return false;
+    }
+
+    indexFile.setFileName(root + "/index.bin");
+    if (!indexFile.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    // Существующий индекс принимается со своей емкостью, иначе создается заново
+    IndexHeader existing{};
+    bool valid = indexFile.size() >= static_cast<qint64>(sizeof(IndexHeader))
+                 && indexFile.read(reinterpret_cast<char*>(&existing), sizeof(existing)) == static_cast<qint64>(sizeof(existing))
+                 && existing.magic == kIndexMagic && existing.version == kIndexVersion
+                 && existing.capacity != 0 && (existing.capacity & (existing.capacity - 1)) == 0
+                 && indexFile.size() == static_cast<qint64>(sizeof(IndexHeader) + existing.capacity * sizeof(IndexSlot));
+    if (valid) {
+        slot_count = existing.capacity;
+    } else {
+        IndexHeader fresh{};
+        fresh.magic = kIndexMagic;
+        fresh.version = kIndexVersion;
+        fresh.capacity = slot_count;
+        if (!indexFile.resize(0) || !indexFile.resize(static_cast<qint64>(sizeof(IndexHeader) + slot_count * sizeof(IndexSlot)))
+            || !indexFile.seek(0) || indexFile.write(reinterpret_cast<const char*>(&fresh), sizeof(fresh)) != static_cast<qint64>(sizeof(fresh))
+            || !indexFile.flush()) {
+            indexFile.close();
+            return false;
+        }
+        QDir(root + "/trajectories").removeRecursively();
+        QDir().mkpath(root + "/trajectories");
+    }
+
+    uchar* mapped = indexFile.map(0, indexFile.size());
+    if (!mapped) {
+        indexFile.close();
+        return false;
+    }
+    header = reinterpret_cast<IndexHeader*>(mapped);
+    slots = reinterpret_cast<IndexSlot*>(mapped + sizeof(IndexHeader));
+    return true;
+}
+
+bool ResultCache::read_slot(IndexSlot& slot, IndexSlot& copy) {
+    // Чтение без блокировки: копия действительна, если счетчик seqlock не изменился
+    std::atomic_ref<std::uint32_t> seq(slot.seq);
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        std::uint32_t before = seq.load(std::memory_order_acquire);
+        if (before & 1u) {
+            continue;
+        }
+        std::memcpy(&copy, &slot, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t ResultCache::tick() {
+    return std::atomic_ref<std::uint64_t>(header->clock).fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+QString ResultCache::trajectory_path(const ResultCacheKey& key) const {
+    return QString("%1/trajectories/%2%3.traj").arg(root)
+        .arg(key.hash, 16, 16, QChar('0')).arg(key.check, 16, 16, QChar('0'));
+}
+
+void ResultCache::write_slot(IndexSlot& slot, const ResultCacheKey& key, const FlightSummary& summary, std::uint32_t flags, std::uint64_t trajectory_bytes) {
+    std::atomic_ref<std::uint32_t> seq(slot.seq);
+    std::uint32_t current = seq.load(std::memory_order_relaxed);
+    seq.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.flags = flags;
+    slot.hash = key.hash;
+    slot.check = key.check;
+    std::atomic_ref<std::uint64_t>(slot.last_used).store(flags ? tick() : 0, std::memory_order_relaxed);
+    slot.summary = summary;
+    slot.trajectory_bytes = trajectory_bytes;
+    seq.store(current + 2, std::memory_order_release);
+}
+
+void ResultCache::drop_trajectory(IndexSlot& slot) {
+    if (!(slot.flags & kSlotHasTrajectory)) {
+        return;
+    }
+    ResultCacheKey key{ slot.hash, slot.check };
+    QFile::remove(trajectory_path(key));
+    header->trajectory_bytes -= std::min(header->trajectory_bytes, slot.trajectory_bytes);
+    FlightSummary summary = slot.summary;
+    write_slot(slot, key, summary, slot.flags & ~kSlotHasTrajectory, 0);
+}
+
+bool ResultCache::find(const ResultCacheKey& key, FlightSummary& summary, std::vector<State>* trajectory) {
+    if (!slots) {
+        miss_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::uint32_t mask = slot_count - 1;
+    for (std::uint32_t probe = 0; probe < kProbeWindow; ++probe) {
+        IndexSlot& slot = slots[(key.hash + probe) & mask];
+        IndexSlot copy;
+        if (!read_slot(slot, copy) || !(copy.flags & kSlotUsed)) {
+            break;
+        }
+        if (copy.hash != key.hash || copy.check != key.check) {
+            continue;
+        }
+        if (trajectory) {
+            QFile file(trajectory_path(key));
+            if (!(copy.flags & kSlotHasTrajectory) || !file.open(QIODevice::ReadOnly)
+                || file.size() != static_cast<qint64>(copy.trajectory_bytes)) {
+                break;
+            }
+            QByteArray data = file.readAll();
+            const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data.constData());
+            std::size_t size = static_cast<std::size_t>(data.size());
+            if (size != copy.trajectory_bytes) {
+                break;
+            }
+            if (is_encoded_trajectory(bytes, size)) {
+                if (!decode_trajectory(bytes, size, *trajectory)) {
+                    break;
+                }
+            } else {
+                if (size % sizeof(State) != 0) {
+                    break;
+                }
+                trajectory->resize(size / sizeof(State));
+                std::memcpy(trajectory->data(), bytes, size);
+            }
+        }
+        std::atomic_ref<std::uint64_t>(slot.last_used).store(tick(), std::memory_order_relaxed);
+        summary = copy.summary;
+        hit_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    miss_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::store(const ResultCacheKey& key, const FlightSummary& summary, const std::vector<State>* trajectory) {
+    if (!slots) {
+        return;
+    }
+
+    // Файл траектории адресуется ключом, поэтому одновременная запись одной траектории безопасна
+    std::uint64_t bytes = 0;
+    if (trajectory) {
+        QSaveFile file(trajectory_path(key));
+        std::vector<std::uint8_t> encoded;
+        if (compress_trajectories) {
+            encoded = encode_trajectory(*trajectory, codec);
+        }
+        const char* data = encoded.empty() ? reinterpret_cast<const char*>(trajectory->data()) : reinterpret_cast<const char*>(encoded.data());
+        bytes = encoded.empty() ? trajectory->size() * sizeof(State) : encoded.size();
+        if (!file.open(QIODevice::WriteOnly)
+            || file.write(data, static_cast<qint64>(bytes)) != static_cast<qint64>(bytes)
+            || !file.commit()) {
+            trajectory = nullptr;
+            bytes = 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(write_mutex);
+    QLockFile lock(root + "/index.lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        return; // кэш занят другим процессом слишком долго - результат просто не сохраняется
+    }
+
+    std::uint32_t mask = slot_count - 1;
+    IndexSlot* target = nullptr;
+    IndexSlot* oldest = nullptr;
+    for (std::uint32_t probe = 0; probe < kProbeWindow; ++probe) {
+        IndexSlot& slot = slots[(key.hash + probe) & mask];
+        if (!(slot.flags & kSlotUsed) || (slot.hash == key.hash && slot.check == key.check)) {
+            target = &slot;
+            break;
+        }
+        if (!oldest || slot.last_used < oldest->last_used) {
+            oldest = &slot;
+        }
+    }
+    if (!target) {
+        target = oldest;
+    }
+
+    bool same_key = (target->flags & kSlotUsed) && target->hash == key.hash && target->check == key.check;
+    if (same_key && !trajectory && (target->flags & kSlotHasTrajectory)) {
+        // Новый итог без траектории не отменяет уже сохраненную траекторию
+        write_slot(*target, key, summary, target->flags, target->trajectory_bytes);
+        return;
+    }
+    if (same_key && trajectory && (target->flags & kSlotHasTrajectory)) {
+        header->trajectory_bytes -= std::min(header->trajectory_bytes, target->trajectory_bytes);
+    } else {
+        drop_trajectory(*target);
+    }
+    write_slot(*target, key, summary, kSlotUsed | (trajectory ? kSlotHasTrajectory : 0), bytes);
+    header->trajectory_bytes += bytes;
+
+    // Вытеснение самых старых траекторий сверх лимита размера
+    while (header->trajectory_bytes > budget) {
+        IndexSlot* victim = nullptr;
+        for (std::uint32_t i = 0; i < slot_count; ++i) {
+            if ((slots[i].flags & kSlotHasTrajectory) && &slots[i] != target
+                && (!victim || slots[i].last_used < victim->last_used)) {
+                victim = &slots[i];
+            }
+        }
+        if (!victim) {
+            break;
+        }
+        drop_trajectory(*victim);
+    }
+}
+
+void ResultCache::clear() {
+    if (!slots) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(write_mutex);
+    QLockFile lock(root + "/index.lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        return;
+    }
+    for (std::uint32_t i = 0; i < slot_count; ++i) {
+        if (slots[i].flags & kSlotUsed) {
+            write_slot(slots[i], ResultCacheKey{}, FlightSummary{}, 0, 0);
+        }
+    }
+    header->trajectory_bytes = 0;
+    QDir(root + "/trajectories").removeRecursively();
+    QDir().mkpath(root + "/trajectories");
+}
+
+std::vector<FlightSummary> evaluate_with_cache(ResultCache& cache, const std::vector<Parameters>& params, const BatchOptions& options,
+                                               const std::function<std::vector<FlightSummary>(const std::vector<Parameters>&)>& evaluate,
+                                               std::size_t* hits) {
+    std::vector<FlightSummary> results(params.size());
+    std::vector<ResultCacheKey> keys(params.size());
+    std::vector<std::size_t> missing;
+    std::vector<Parameters> missingParams;
+    std::uint64_t environment = result_cache_environment();
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        keys[i] = result_cache_key(params[i], options, environment);
+        if (!cache.find(keys[i], results[i])) {
+            missing.push_back(i);
+            missingParams.push_back(params[i]);
+        }
+    }
+    if (hits) {
+        *hits = params.size() - missing.size();
+    }
+    if (missing.empty()) {
+        return results;
+    }
+
+    std::vector<FlightSummary> computed = evaluate(missingParams);
+    for (std::size_t m = 0; m < missing.size() && m < computed.size(); ++m) {
+        results[missing[m]] = computed[m];
+        cache.store(keys[missing[m]], computed[m]);
+    }
+    return results;
+}
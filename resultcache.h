@@ -0,0 +1,93 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "batch.h"
+#include "trajectorycodec.h"
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Версия модели полета: увеличивать при любом изменении физики или интегратора,
+// чтобы старые записи кэша перестали совпадать с новыми ключами
+constexpr std::uint32_t kResultCacheModelVersion = 2;
+
+// Ключ записи: два независимых 64-битных хэша канонизированных параметров,
+// настроек интегрирования, версии модели и загруженных рельефа и поля ветра
+struct ResultCacheKey {
+    std::uint64_t hash = 0;
+    std::uint64_t check = 0;
+};
+
+// Отпечаток загруженных рельефа и поля ветра (считается один раз на пакет)
+std::uint64_t result_cache_environment();
+ResultCacheKey result_cache_key(const Parameters& params, const BatchOptions& options, std::uint64_t environment);
+
+// Кэш итогов полетов (и, по желанию, полных траекторий) на диске.
+// Индекс - хэш-таблица фиксированного размера в отображенном в память файле:
+// поиск - O(1) без блокировок (слоты читаются по seqlock), запись - под файловой
+// блокировкой, поэтому кэш могут одновременно использовать несколько копий программы.
+// При заполнении окна поиска вытесняется давно не использованная запись;
+// траектории лежат отдельными файлами и вытесняются по общему лимиту размера.
+class ResultCache {
+public:
+    static constexpr std::uint32_t kDefaultCapacity = 1u << 16;
+    static constexpr std::uint64_t kDefaultTrajectoryBudget = 256ull << 20;
+
+    // Кэш в каталоге пользователя (QStandardPaths::CacheLocation)
+    static ResultCache& instance();
+
+    explicit ResultCache(const QString& directory, std::uint32_t capacity = kDefaultCapacity,
+                         std::uint64_t trajectory_budget = kDefaultTrajectoryBudget);
+    ~ResultCache();
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    bool is_open() const { return slots != nullptr; }
+
+    // trajectory != nullptr - нужна и траектория; без нее запись считается промахом
+    bool find(const ResultCacheKey& key, FlightSummary& summary, std::vector<State>* trajectory = nullptr);
+    void store(const ResultCacheKey& key, const FlightSummary& summary, const std::vector<State>* trajectory = nullptr);
+    void clear();
+
+    // Траектории записываются сжатыми с ограниченной ошибкой (trajectorycodec.h), nullptr - точные
+    // состояния; читаются файлы в обоих видах. Вызывать до первого обращения к кэшу
+    void set_trajectory_compression(const TrajectoryCodecOptions* options);
+
+    std::uint64_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+
+private:
+    struct IndexHeader;
+    struct IndexSlot;
+
+    bool open_index();
+    static bool read_slot(IndexSlot& slot, IndexSlot& copy);
+    std::uint64_t tick();
+    QString trajectory_path(const ResultCacheKey& key) const;
+    void drop_trajectory(IndexSlot& slot); // под блокировкой записи
+    void write_slot(IndexSlot& slot, const ResultCacheKey& key, const FlightSummary& summary, std::uint32_t flags, std::uint64_t trajectory_bytes);
+
+    QString root;
+    std::uint32_t slot_count;
+    std::uint64_t budget;
+    bool compress_trajectories = false;
+    TrajectoryCodecOptions codec;
+    QFile indexFile;
+    IndexHeader* header = nullptr;
+    IndexSlot* slots = nullptr;
+    std::mutex write_mutex;
+    std::atomic<std::uint64_t> hit_count{ 0 };
+    std::atomic<std::uint64_t> miss_count{ 0 };
+};
+
+// Расчет пакета через кэш: evaluate получает только промахи, их итоги сохраняются
+std::vector<FlightSummary> evaluate_with_cache(ResultCache& cache, const std::vector<Parameters>& params, const BatchOptions& options,
+                                               const std::function<std::vector<FlightSummary>(const std::vector<Parameters>&)>& evaluate,
+                                               std::size_t* hits = nullptr);
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,523 @@
+#include "scenario.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+constexpr std::string_view kHeader = "ballistics-scenarios";
+
+constexpr std::string_view kParameterNames[kScenarioParameterCount] = {
+    "mass", "Cd", "air_density", "radius", "g", "wind_x", "wind_z", "angle_deg", "initial_speed", "azimuth_deg"
+};
+
+constexpr double Parameters::* kParameterFields[kScenarioParameterCount] = {
+    &Parameters::mass, &Parameters::Cd, &Parameters::air_density, &Parameters::radius, &Parameters::g,
+    &Parameters::wind_x, &Parameters::wind_z, &Parameters::angle_deg, &Parameters::initial_speed, &Parameters::azimuth_deg
+};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Следующий токен строки (разделители - пробелы и табуляция)
+std::string_view next_token(std::string_view& rest) {
+    std::size_t begin = 0;
+    while (begin < rest.size() && is_space(rest[begin])) {
+        ++begin;
+    }
+    std::size_t end = begin;
+    while (end < rest.size() && !is_space(rest[end])) {
+        ++end;
+    }
+    std::string_view token = rest.substr(begin, end - begin);
+    rest.remove_prefix(end);
+    return token;
+}
+
+// inf и nan from_chars принимает, но ни одному полю они не годятся
+bool parse_number(std::string_view text, double& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end && std::isfinite(value);
+}
+
+bool parse_number(std::string_view text, std::uint64_t& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+// Разделение key=value; false, если '=' нет
+bool split_assignment(std::string_view token, std::string_view& key, std::string_view& value) {
+    std::size_t eq = token.find('=');
+    if (eq == std::string_view::npos) {
+        return false;
+    }
+    key = token.substr(0, eq);
+    value = token.substr(eq + 1);
+    return true;
+}
+
+class LineReader {
+public:
+    explicit LineReader(const std::vector<char>& text) : pos(text.data()), end(text.data() + text.size()) {}
+
+    // Следующая строка без комментария; false в конце файла
+    bool next(std::string_view& line) {
+        if (pos >= end) {
+            return false;
+        }
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+        const char* stop = newline ? newline : end;
+        line = std::string_view(pos, static_cast<std::size_t>(stop - pos));
+        pos = newline ? newline + 1 : end;
+        ++number;
+        std::size_t comment = line.find('#');
+        if (comment != std::string_view::npos) {
+            line = line.substr(0, comment);
+        }
+        return true;
+    }
+
+    int line_number() const { return number; }
+
+private:
+    const char* pos;
+    const char* end;
+    int number = 0;
+};
+
+std::uint64_t splitmix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Нормальная величина для члена ансамбля и поля: зависит только от (seed, member, field)
+double ensemble_normal(std::uint64_t seed, std::uint64_t member, int field) {
+    std::uint64_t bits = splitmix(seed ^ splitmix(member * kScenarioParameterCount + static_cast<std::uint64_t>(field)));
+    double u1 = (static_cast<double>(bits >> 11) + 0.5) * 0x1.0p-53;
+    double u2 = static_cast<double>(splitmix(bits) >> 11) * 0x1.0p-53;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, ec == std::errc() ? ptr : buffer);
+}
+
+void append_parameters(std::string& out, const Parameters& params, const char* prefix = "") {
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        out += ' ';
+        out += prefix;
+        out += kParameterNames[i];
+        out += '=';
+        append_number(out, scenario_parameter(params, i));
+    }
+}
+
+} // namespace
+
+std::string_view scenario_parameter_name(int index) {
+    return kParameterNames[index];
+}
+
+int scenario_parameter_index(std::string_view name) {
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        if (kParameterNames[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+double& scenario_parameter(Parameters& params, int index) {
+    return params.*kParameterFields[index];
+}
+
+double scenario_parameter(const Parameters& params, int index) {
+    return params.*kParameterFields[index];
+}
+
+double clamp_scenario_parameter(int index, double value) {
+    switch (index) {
+        case 0: case 3: case 4: case 8: return std::max(value, 0.001);
+        case 1: case 2: return std::max(value, 0.0);
+        case 7: return std::clamp(value, 0.0, 90.0);
+        default: return value;
+    }
+}
+
+double scenario_parameter_scale(int index) {
+    switch (index) {
+        case 5: case 6: return 10.0;
+        case 9: return 90.0;
+        default: return 0.0;
+    }
+}
+
+Parameters default_parameters() {
+    return { 10.0, 0.47, 1.225, 0.1, 9.81, 5.0, 0.0, 45.0, 50.0, 30.0 };
+}
+
+const Scenario* ScenarioFile::find_scenario(std::string_view name) const {
+    for (const Scenario& scenario : scenarios) {
+        if (scenario.name == name) {
+            return &scenario;
+        }
+    }
+    return nullptr;
+}
+
+bool parse_scenarios(std::vector<char>&& text, ScenarioFile& file, std::string* error) {
+    file = ScenarioFile();
+    file.text = std::move(text);
+    LineReader reader(file.text);
+    auto fail = [&](const std::string& message) {
+        if (error) {
+            *error = "Строка " + std::to_string(reader.line_number()) + ": " + message;
+        }
+        file = ScenarioFile();
+        return false;
+    };
+
+    // Первая непустая строка определяет формат
+    std::string_view line;
+    std::string_view first;
+    while (reader.next(line)) {
+        std::string_view rest = line;
+        first = next_token(rest);
+        if (!first.empty()) {
+            break;
+        }
+    }
+    if (first.empty()) {
+        return true; // пустой файл
+    }
+
+    Parameters defaults = default_parameters();
+    if (first != kHeader) {
+        LineReader legacy(file.text);
+        if (line.find('=') != std::string_view::npos) {
+            // Старый формат окна: key=value по строкам, неизвестные ключи пропускаются
+            Parameters params = defaults;
+            while (legacy.next(line)) {
+                std::string_view key, value;
+                double number = 0.0;
+                int index = -1;
+                if (split_assignment(line, key, value)) {
+                    std::string_view rest = key;
+                    key = next_token(rest);
+                    rest = value;
+                    value = next_token(rest);
+                    if ((index = scenario_parameter_index(key)) >= 0 && parse_number(value, number)) {
+                        scenario_parameter(params, index) = number;
+                    }
+                }
+            }
+            file.version = 0;
+            file.scenarios.push_back({ "parameters", params });
+            return true;
+        }
+
+        // Parameters.txt: числа без ключей в порядке полей структуры
+        std::vector<double> numbers;
+        while (legacy.next(line)) {
+            std::string_view rest = line;
+            for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+                double number = 0.0;
+                if (!parse_number(token, number)) {
+                    reader = legacy;
+                    return fail("ожидалось число, найдено \"" + std::string(token) + "\"");
+                }
+                numbers.push_back(number);
+            }
+        }
+        if (numbers.empty() || numbers.size() % kScenarioParameterCount != 0) {
+            return fail("число значений должно быть кратно " + std::to_string(kScenarioParameterCount));
+        }
+        file.version = 0;
+        for (std::size_t s = 0; s < numbers.size() / kScenarioParameterCount; ++s) {
+            Parameters params = defaults;
+            for (int i = 0; i < kScenarioParameterCount; ++i) {
+                scenario_parameter(params, i) = numbers[s * kScenarioParameterCount + static_cast<std::size_t>(i)];
+            }
+            file.scenarios.push_back({ "parameters", params });
+        }
+        return true;
+    }
+
+    {
+        std::string_view rest = line;
+        next_token(rest);
+        std::uint64_t version = 0;
+        if (!parse_number(next_token(rest), version) || version != static_cast<std::uint64_t>(kScenarioFormatVersion)) {
+            return fail("поддерживается только версия формата " + std::to_string(kScenarioFormatVersion));
+        }
+        file.version = kScenarioFormatVersion;
+    }
+
+    auto apply = [&](std::string_view token, Parameters& params, std::string_view prefix = {}) -> bool {
+        std::string_view key, value;
+        double number = 0.0;
+        if (!split_assignment(token, key, value) || key.substr(0, prefix.size()) != prefix) {
+            return false;
+        }
+        int index = scenario_parameter_index(key.substr(prefix.size()));
+        if (index < 0 || !parse_number(value, number)) {
+            return false;
+        }
+        scenario_parameter(params, index) = number;
+        return true;
+    };
+    auto resolve_base = [&](std::string_view base, Parameters& params) -> bool {
+        if (base.empty()) {
+            params = defaults;
+            return true;
+        }
+        const Scenario* scenario = file.find_scenario(base);
+        if (!scenario) {
+            return false;
+        }
+        params = scenario->params;
+        return true;
+    };
+
+    while (reader.next(line)) {
+        std::string_view rest = line;
+        std::string_view kind = next_token(rest);
+        if (kind.empty()) {
+            continue;
+        }
+
+        if (kind == "defaults") {
+            for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+                if (!apply(token, defaults)) {
+                    return fail("неверное значение \"" + std::string(token) + "\"");
+                }
+            }
+        } else if (kind == "scenario") {
+            Scenario scenario{ next_token(rest), defaults };
+            if (scenario.name.empty() || scenario.name.find('=') != std::string_view::npos) {
+                return fail("у сценария нет имени");
+            }
+            for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+                if (!apply(token, scenario.params)) {
+                    return fail("неверное значение \"" + std::string(token) + "\"");
+                }
+            }
+            file.scenarios.push_back(scenario);
+        } else if (kind == "sweep") {
+            SweepDefinition sweep;
+            sweep.name = next_token(rest);
+            sweep.parameter = -1;
+            bool has_from = false, has_to = false;
+            for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+                std::string_view key, value;
+                bool ok = split_assignment(token, key, value);
+                if (ok && key == "base") {
+                    sweep.base = value;
+                } else if (ok && key == "param") {
+                    sweep.parameter = scenario_parameter_index(value);
+                    ok = sweep.parameter >= 0;
+                } else if (ok && key == "from") {
+                    ok = has_from = parse_number(value, sweep.from);
+                } else if (ok && key == "to") {
+                    ok = has_to = parse_number(value, sweep.to);
+                } else if (ok && key == "step") {
+                    ok = parse_number(value, sweep.step);
+                } else {
+                    ok = false;
+                }
+                if (!ok) {
+                    return fail("неверное поле развертки \"" + std::string(token) + "\"");
+                }
+            }
+            if (sweep.name.empty() || sweep.parameter < 0 || !has_from || !has_to || !(sweep.step > 0.0) || sweep.from > sweep.to) {
+                return fail("развертке нужны имя, param, from <= to и step > 0");
+            }
+            if (sweep_size(sweep) == 0) {
+                return fail("развертка \"" + std::string(sweep.name) + "\" не дает ни одной точки");
+            }
+            if (!resolve_base(sweep.base, sweep.base_params)) {
+                return fail("неизвестный базовый сценарий \"" + std::string(sweep.base) + "\"");
+            }
+            file.sweeps.push_back(sweep);
+        } else if (kind == "ensemble") {
+            EnsembleDefinition ensemble;
+            ensemble.name = next_token(rest);
+            ensemble.sigma = Parameters{};
+            for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+                std::string_view key, value;
+                std::uint64_t count = 0;
+                bool ok = split_assignment(token, key, value);
+                if (ok && key == "base") {
+                    ensemble.base = value;
+                } else if (ok && key == "count") {
+                    ok = parse_number(value, count);
+                    ensemble.count = static_cast<std::size_t>(count);
+                } else if (ok && key == "seed") {
+                    ok = parse_number(value, ensemble.seed);
+                } else {
+                    ok = apply(token, ensemble.sigma, "sigma.");
+                }
+                if (!ok) {
+                    return fail("неверное поле ансамбля \"" + std::string(token) + "\"");
+                }
+            }
+            if (ensemble.name.empty() || ensemble.count == 0) {
+                return fail("ансамблю нужны имя и count > 0");
+            }
+            if (!resolve_base(ensemble.base, ensemble.base_params)) {
+                return fail("неизвестный базовый сценарий \"" + std::string(ensemble.base) + "\"");
+            }
+            file.ensembles.push_back(ensemble);
+        } else {
+            return fail("неизвестная запись \"" + std::string(kind) + "\"");
+        }
+    }
+    return true;
+}
+
+bool load_scenario_file(const std::string& path, ScenarioFile& file, std::string* error) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        if (error) {
+            *error = "Не удалось открыть файл.";
+        }
+        return false;
+    }
+    std::vector<char> text(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+        if (error) {
+            *error = "Ошибка чтения файла.";
+        }
+        return false;
+    }
+    return parse_scenarios(std::move(text), file, error);
+}
+
+bool save_scenario_file(const std::string& path, const ScenarioFile& file, std::string* error) {
+    // Все поля записываются явно, числа - кратчайшим точным представлением
+    std::string out;
+    out.reserve(64 + file.scenarios.size() * 200);
+    out += kHeader;
+    out += ' ';
+    out += std::to_string(kScenarioFormatVersion);
+    out += '\n';
+    for (const Scenario& scenario : file.scenarios) {
+        out += "scenario ";
+        out += scenario.name;
+        append_parameters(out, scenario.params);
+        out += '\n';
+    }
+    // Базы разверток и ансамблей без имени сохраняются через defaults перед записью
+    for (const SweepDefinition& sweep : file.sweeps) {
+        if (sweep.base.empty()) {
+            out += "defaults";
+            append_parameters(out, sweep.base_params);
+            out += '\n';
+        }
+        out += "sweep ";
+        out += sweep.name;
+        if (!sweep.base.empty()) {
+            out += " base=";
+            out += sweep.base;
+        }
+        out += " param=";
+        out += kParameterNames[sweep.parameter];
+        out += " from=";
+        append_number(out, sweep.from);
+        out += " to=";
+        append_number(out, sweep.to);
+        out += " step=";
+        append_number(out, sweep.step);
+        out += '\n';
+    }
+    for (const EnsembleDefinition& ensemble : file.ensembles) {
+        if (ensemble.base.empty()) {
+            out += "defaults";
+            append_parameters(out, ensemble.base_params);
+            out += '\n';
+        }
+        out += "ensemble ";
+        out += ensemble.name;
+        if (!ensemble.base.empty()) {
+            out += " base=";
+            out += ensemble.base;
+        }
+        out += " count=";
+        out += std::to_string(ensemble.count);
+        out += " seed=";
+        out += std::to_string(ensemble.seed);
+        append_parameters(out, ensemble.sigma, "sigma.");
+        out += '\n';
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream || !stream.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+        if (error) {
+            *error = "Не удалось записать файл.";
+        }
+        return false;
+    }
+    return true;
+}
+
+std::size_t sweep_size(const SweepDefinition& sweep) {
+    if (!(sweep.step > 0.0) || sweep.to < sweep.from) {
+        return 0;
+    }
+    // Число шагов должно помещаться в size_t, иначе развертка считается пустой
+    double steps = std::floor((sweep.to - sweep.from) / sweep.step + 1e-9);
+    if (!(steps < 0x1p52)) {
+        return 0;
+    }
+    return static_cast<std::size_t>(steps) + 1;
+}
+
+Parameters sweep_point(const SweepDefinition& sweep, std::size_t index) {
+    // Значения считаются от начала по номеру шага, без накопления ошибки сложения
+    Parameters params = sweep.base_params;
+    scenario_parameter(params, sweep.parameter) = sweep.from + static_cast<double>(index) * sweep.step;
+    return params;
+}
+
+Parameters ensemble_member(const EnsembleDefinition& ensemble, std::size_t index) {
+    Parameters member = ensemble.base_params;
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        double sigma = scenario_parameter(ensemble.sigma, i);
+        if (sigma > 0.0) {
+            // Возмущенное значение ограничивается как при вводе: масса и радиус не уходят в ноль и ниже
+            double value = scenario_parameter(member, i) + sigma * ensemble_normal(ensemble.seed, index, i);
+            scenario_parameter(member, i) = clamp_scenario_parameter(i, value);
+        }
+    }
+    return member;
+}
+
+std::vector<Parameters> expand_sweep(const SweepDefinition& sweep) {
+    std::size_t count = sweep_size(sweep);
+    std::vector<Parameters> points;
+    points.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        points.push_back(sweep_point(sweep, i));
+    }
+    return points;
+}
+
+std::vector<Parameters> expand_ensemble(const EnsembleDefinition& ensemble) {
+    std::vector<Parameters> members;
+    members.reserve(ensemble.count);
+    for (std::size_t m = 0; m < ensemble.count; ++m) {
+        members.push_back(ensemble_member(ensemble, m));
+    }
+    return members;
+}
@@ -0,0 +1,97 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "parameters.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Файл сценариев (текст, одна запись на строку, # - комментарий):
+//
+//   ballistics-scenarios 1
+//   defaults mass=10 Cd=0.47 air_density=1.225 radius=0.1 g=9.81
+//   scenario mortar initial_speed=120 angle_deg=60
+//   sweep elevation base=mortar param=angle_deg from=10 to=80 step=0.5
+//   ensemble spread base=mortar count=1000 seed=7 sigma.initial_speed=1.5 sigma.angle_deg=0.2
+//
+// Поля сценария, не заданные в строке, берутся из последней строки defaults выше нее.
+// Читаются и старые форматы: строки key=value (сохранение параметров из окна)
+// и список из десяти чисел без ключей (Parameters.txt), по десять на сценарий.
+// Разбор идет по буферу файла без промежуточных строк: числа - std::from_chars,
+// имена - string_view в буфер ScenarioFile.
+
+constexpr int kScenarioFormatVersion = 1;
+constexpr int kScenarioParameterCount = 10;
+
+// Имя поля Parameters по номеру (порядок полей структуры)
+std::string_view scenario_parameter_name(int index);
+// Номер поля по имени, -1 - неизвестное имя
+int scenario_parameter_index(std::string_view name);
+double& scenario_parameter(Parameters& params, int index);
+double scenario_parameter(const Parameters& params, int index);
+// Значение поля в границах полей ввода окна: масса, радиус, g и скорость не меньше 0.001,
+// Cd и плотность неотрицательны, угол в [0, 90]; ветер и азимут не ограничиваются
+double clamp_scenario_parameter(int index, double value);
+// Масштаб относительного сдвига поля: сдвиг на долю r - r * max(|значение|, масштаб).
+// Ненулевой масштаб у полей, которые часто равны нулю: ветер - 10 м/с, азимут - 90°
+double scenario_parameter_scale(int index);
+
+// Значения по умолчанию, как в окне программы
+Parameters default_parameters();
+
+struct Scenario {
+    std::string_view name;
+    Parameters params;
+};
+
+struct SweepDefinition {
+    std::string_view name;
+    std::string_view base; // пусто - значения defaults
+    int parameter = 0;     // номер поля Parameters
+    double from = 0.0, to = 0.0, step = 1.0;
+    Parameters base_params;
+};
+
+struct EnsembleDefinition {
+    std::string_view name;
+    std::string_view base;
+    std::size_t count = 0;
+    std::uint64_t seed = 0;
+    Parameters base_params;
+    Parameters sigma; // среднеквадратичное отклонение каждого поля, 0 - без разброса
+};
+
+struct ScenarioFile {
+    ScenarioFile() = default;
+    ScenarioFile(ScenarioFile&&) = default;
+    ScenarioFile& operator=(ScenarioFile&&) = default;
+    ScenarioFile(const ScenarioFile&) = delete; // имена указывают в собственный буфер
+    ScenarioFile& operator=(const ScenarioFile&) = delete;
+
+    int version = kScenarioFormatVersion;
+    std::vector<Scenario> scenarios;
+    std::vector<SweepDefinition> sweeps;
+    std::vector<EnsembleDefinition> ensembles;
+    std::vector<char> text; // содержимое файла, на которое ссылаются имена
+
+    const Scenario* find_scenario(std::string_view name) const;
+};
+
+// error - сообщение с номером строки
+bool parse_scenarios(std::vector<char>&& text, ScenarioFile& file, std::string* error = nullptr);
+bool load_scenario_file(const std::string& path, ScenarioFile& file, std::string* error = nullptr);
+bool save_scenario_file(const std::string& path, const ScenarioFile& file, std::string* error = nullptr);
+
+// Параметры всех точек развертки и членов ансамбля (разброс нормальный,
+// член i зависит только от seed и i, поэтому часть ансамбля можно пересчитать отдельно)
+std::vector<Parameters> expand_sweep(const SweepDefinition& sweep);
+std::vector<Parameters> expand_ensemble(const EnsembleDefinition& ensemble);
+
+// Отдельная точка развертки или член ансамбля по номеру (без построения всего набора)
+std::size_t sweep_size(const SweepDefinition& sweep);
+Parameters sweep_point(const SweepDefinition& sweep, std::size_t index);
+Parameters ensemble_member(const EnsembleDefinition& ensemble, std::size_t index);
+
+#endif // SCENARIO_H
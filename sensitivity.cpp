@@ -0,0 +1,76 @@
+#include "sensitivity.h"
+#include "analytic.h"
+#include "parallel.h"
+#include "scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+void fill_metrics(double* out, const FlightSummary& summary, const Parameters& params) {
+    for (int m = 0; m < kSweepMetricCount; ++m) {
+        out[m] = sweep_metric(summary, params, static_cast<SweepMetric>(m));
+    }
+}
+
+} // namespace
+
+double SensitivityEntry::swing(SweepMetric metric) const {
+    int m = static_cast<int>(metric);
+    return std::abs(high[m] - low[m]);
+}
+
+SensitivityReport analyze_sensitivity(const Parameters& base, const SensitivityOptions& options) {
+    auto started = std::chrono::steady_clock::now();
+    SensitivityReport report;
+    report.base = base;
+
+    // Пакет: базовая точка и по два сдвига на каждое поле
+    std::vector<Parameters> shots{ base };
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        double value = scenario_parameter(base, i);
+        double delta = options.use_sigma ? std::abs(scenario_parameter(options.sigma, i))
+                                         : options.relative * std::max(std::abs(value), scenario_parameter_scale(i));
+        SensitivityEntry entry;
+        entry.parameter = i;
+        entry.low_value = clamp_scenario_parameter(i, value - delta);
+        entry.high_value = clamp_scenario_parameter(i, value + delta);
+        if (!(entry.high_value > entry.low_value)) {
+            continue;
+        }
+        report.entries.push_back(entry);
+        Parameters low = base, high = base;
+        scenario_parameter(low, i) = entry.low_value;
+        scenario_parameter(high, i) = entry.high_value;
+        shots.push_back(low);
+        shots.push_back(high);
+    }
+
+    // Полеты разной длины, поэтому по одному на кусок
+    std::vector<FlightSummary> results(shots.size());
+    parallel_for(shots.size(), 1, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t i = begin; i < end; ++i) {
+            results[i] = evaluate_flight(shots[i], options.dt, options.max_points);
+        }
+    });
+
+    fill_metrics(report.base_metrics, results[0], base);
+    for (std::size_t e = 0; e < report.entries.size(); ++e) {
+        fill_metrics(report.entries[e].low, results[1 + 2 * e], shots[1 + 2 * e]);
+        fill_metrics(report.entries[e].high, results[2 + 2 * e], shots[2 + 2 * e]);
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+std::vector<std::size_t> tornado_order(const SensitivityReport& report, SweepMetric metric) {
+    std::vector<std::size_t> order(report.entries.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return report.entries[a].swing(metric) > report.entries[b].swing(metric);
+    });
+    return order;
+}
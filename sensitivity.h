@@ -0,0 +1,44 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include "sweepstore.h"
+#include <cstddef>
+#include <vector>
+
+// Чувствительность итогов полета к каждому полю Parameters (диаграмма "торнадо").
+// Каждое поле по очереди сдвигается вниз и вверх от базовой точки, остальные не меняются;
+// все 2 * 10 полетов и базовый считаются одним пакетом параллельно.
+
+struct SensitivityOptions {
+    // Сдвиг поля: relative * max(|значение|, scenario_parameter_scale) либо, при use_sigma, sigma этого поля
+    double relative = 0.1;
+    bool use_sigma = false;
+    Parameters sigma{};
+    double dt = 0.01;
+    std::size_t max_points = 100000;
+    int threads = 0; // 0 - по числу ядер
+};
+
+struct SensitivityEntry {
+    int parameter = 0;                      // номер поля Parameters
+    double low_value = 0.0, high_value = 0.0; // значения поля после сдвига (с учетом допустимых границ)
+    double low[kSweepMetricCount] = {};     // величины sweep_metric при low_value
+    double high[kSweepMetricCount] = {};
+
+    // Размах влияния на величину: |high - low|
+    double swing(SweepMetric metric) const;
+};
+
+struct SensitivityReport {
+    Parameters base{};
+    double base_metrics[kSweepMetricCount] = {};
+    std::vector<SensitivityEntry> entries; // поля с ненулевым сдвигом
+    double seconds = 0.0;                  // время расчета
+};
+
+SensitivityReport analyze_sensitivity(const Parameters& base, const SensitivityOptions& options = {});
+
+// Номера записей по убыванию размаха величины - порядок полос торнадо
+std::vector<std::size_t> tornado_order(const SensitivityReport& report, SweepMetric metric);
+
+#endif // SENSITIVITY_H
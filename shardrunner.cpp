@@ -0,0 +1,347 @@
+#include "shardrunner.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace {
+
+static_assert(std::is_trivially_copyable<Parameters>::value, "Parameters are copied into shared memory");
+static_assert(std::is_trivially_copyable<FlightSummary>::value, "FlightSummary is copied out of shared memory");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Shard counters must be lock-free to be shared between processes");
+
+constexpr std::uint32_t kSegmentMagic = 0x53575050; // "SWPP"
+constexpr std::uint32_t kSegmentVersion = 1;
+constexpr std::size_t kWorkerChunk = 64; // полетов между обновлениями счетчика прогресса
+
+enum ShardState : std::uint32_t { ShardPending = 0, ShardRunning = 1, ShardDone = 2 };
+
+// Сегмент: заголовок, слоты шардов, массив Parameters, массив FlightSummary
+struct SegmentHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t flights;
+    std::uint32_t shards;
+    double dt;
+    std::uint64_t max_points;
+    double tolerance;
+    std::uint32_t verify_every;
+    std::uint32_t single_precision;
+    std::uint32_t auto_escalate;
+    std::uint32_t reserved;
+};
+
+struct ShardSlot {
+    std::atomic<std::uint32_t> state;
+    std::atomic<std::uint32_t> done; // посчитано полетов шарда
+    std::uint32_t begin;
+    std::uint32_t end;
+    // Сводка evaluate_batch по шарду, действительна при state == ShardDone
+    std::uint64_t single_precision_flights;
+    std::uint64_t verified;
+    double max_divergence;
+    std::uint32_t tolerance_exceeded;
+    std::uint32_t escalated;
+};
+
+struct SegmentView {
+    SegmentHeader* header = nullptr;
+    ShardSlot* slots = nullptr;
+    Parameters* params = nullptr;
+    FlightSummary* results = nullptr;
+};
+
+std::size_t segment_size(std::size_t flights, std::size_t shards) {
+    return sizeof(SegmentHeader) + shards * sizeof(ShardSlot) + flights * (sizeof(Parameters) + sizeof(FlightSummary));
+}
+
+SegmentView segment_view(void* data, std::size_t flights, std::size_t shards) {
+    SegmentView view;
+    char* bytes = static_cast<char*>(data);
+    view.header = reinterpret_cast<SegmentHeader*>(bytes);
+    bytes += sizeof(SegmentHeader);
+    view.slots = reinterpret_cast<ShardSlot*>(bytes);
+    bytes += shards * sizeof(ShardSlot);
+    view.params = reinterpret_cast<Parameters*>(bytes);
+    bytes += flights * sizeof(Parameters);
+    view.results = reinterpret_cast<FlightSummary*>(bytes);
+    return view;
+}
+
+BatchOptions batch_options(const SegmentHeader& header) {
+    BatchOptions options;
+    options.dt = header.dt;
+    options.max_points = static_cast<std::size_t>(header.max_points);
+    options.tolerance = header.tolerance;
+    options.verify_every = header.verify_every;
+    options.single_precision = header.single_precision != 0;
+    options.auto_escalate = header.auto_escalate != 0;
+    return options;
+}
+
+// Считает шард порциями, обновляя счетчик прогресса; используется и в рабочем, и в родительском процессе
+void evaluate_shard(const SegmentView& view, ShardSlot& slot) {
+    BatchOptions options = batch_options(*view.header);
+    BatchReport total;
+    std::vector<Parameters> chunk;
+    for (std::uint32_t begin = slot.begin; begin < slot.end; begin += kWorkerChunk) {
+        std::uint32_t end = std::min<std::uint32_t>(slot.end, begin + kWorkerChunk);
+        chunk.assign(view.params + begin, view.params + end);
+        BatchReport part;
+        std::vector<FlightSummary> results = evaluate_batch(chunk, options, &part);
+        std::copy(results.begin(), results.end(), view.results + begin);
+        total.single_precision_flights += part.single_precision_flights;
+        total.verified += part.verified;
+        total.max_divergence = std::max(total.max_divergence, part.max_divergence);
+        total.tolerance_exceeded = total.tolerance_exceeded || part.tolerance_exceeded;
+        total.escalated = total.escalated || part.escalated;
+        slot.done.fetch_add(end - begin, std::memory_order_release);
+    }
+    slot.single_precision_flights = total.single_precision_flights;
+    slot.verified = total.verified;
+    slot.max_divergence = total.max_divergence;
+    slot.tolerance_exceeded = total.tolerance_exceeded;
+    slot.escalated = total.escalated;
+    slot.state.store(ShardDone, std::memory_order_release);
+}
+
+} // namespace
+
+int run_sweep_worker(const QStringList& arguments) {
+    if (arguments.size() < 2) {
+        return 2;
+    }
+    for (int i = 2; i + 1 < arguments.size(); i += 2) {
+        // Рабочий процесс воспроизводит рельеф и поле ветра родителя
+        if (arguments[i] == "--terrain") {
+            std::shared_ptr<Heightmap> terrain = Heightmap::load(arguments[i + 1].toStdString());
+            if (!terrain) {
+                return 3;
+            }
+            terrain->rebase_to_origin();
+            set_active_terrain(terrain);
+        } else if (arguments[i] == "--wind-field") {
+            std::shared_ptr<WindField> field = WindField::load(arguments[i + 1].toStdString());
+            if (!field) {
+                return 3;
+            }
+            set_active_wind_field(field);
+        }
+    }
+
+    QSharedMemory memory;
+    memory.setKey(arguments[0]);
+    if (!memory.attach(QSharedMemory::ReadWrite)) {
+        return 4;
+    }
+    // Сегмент меньше заголовка (чужой или поврежденный ключ) - поля заголовка не читаются
+    if (static_cast<std::size_t>(memory.size()) < sizeof(SegmentHeader)) {
+        return 5;
+    }
+    const SegmentHeader* header = static_cast<const SegmentHeader*>(memory.constData());
+    bool ok = false;
+    std::uint32_t shard = arguments[1].toUInt(&ok);
+    if (!ok || header->magic != kSegmentMagic || header->version != kSegmentVersion || shard >= header->shards
+        || static_cast<std::size_t>(memory.size()) < segment_size(header->flights, header->shards)) {
+        return 5;
+    }
+
+    SegmentView view = segment_view(memory.data(), header->flights, header->shards);
+    ShardSlot& slot = view.slots[shard];
+    slot.state.store(ShardRunning, std::memory_order_release);
+    evaluate_shard(view, slot);
+    return 0;
+}
+
+std::vector<FlightSummary> run_sharded_sweep(const std::vector<Parameters>& params, const ShardOptions& options,
+                                             ShardReport* report, const std::function<void(std::size_t, std::size_t)>& progress) {
+    ShardReport local;
+    std::vector<FlightSummary> results(params.size());
+    local.batch.flights = params.size();
+    if (params.empty()) {
+        if (report) {
+            *report = local;
+        }
+        return results;
+    }
+
+    local.workers = options.workers > 0 ? options.workers : std::max(1, QThread::idealThreadCount());
+    local.shards = static_cast<int>(std::min<std::size_t>(params.size(),
+        static_cast<std::size_t>(local.workers) * std::max(1, options.shards_per_worker)));
+    local.workers = std::min(local.workers, local.shards);
+
+    // Уникальный ключ сегмента: два запуска развертки не должны пересекаться
+    static std::atomic<int> runCounter{ 0 };
+    QSharedMemory memory;
+    memory.setKey(QString("ballistics-sweep-%1-%2").arg(QCoreApplication::applicationPid()).arg(runCounter.fetch_add(1)));
+    std::size_t shard_count = static_cast<std::size_t>(local.shards);
+    bool shared = memory.create(static_cast<qsizetype>(segment_size(params.size(), shard_count)));
+
+    // Без общей памяти все шарды считаются здесь же
+    std::unique_ptr<char[]> fallback;
+    void* data = memory.data();
+    if (!shared) {
+        fallback = std::make_unique<char[]>(segment_size(params.size(), shard_count));
+        data = fallback.get();
+    }
+    SegmentView view = segment_view(data, params.size(), shard_count);
+
+    SegmentHeader& header = *view.header;
+    header.magic = kSegmentMagic;
+    header.version = kSegmentVersion;
+    header.flights = static_cast<std::uint32_t>(params.size());
+    header.shards = static_cast<std::uint32_t>(shard_count);
+    header.dt = options.batch.dt;
+    header.max_points = options.batch.max_points;
+    header.tolerance = options.batch.tolerance;
+    header.verify_every = static_cast<std::uint32_t>(options.batch.verify_every);
+    header.single_precision = options.batch.single_precision;
+    header.auto_escalate = options.batch.auto_escalate;
+    header.reserved = 0;
+    for (std::size_t s = 0; s < shard_count; ++s) {
+        ShardSlot* slot = new (&view.slots[s]) ShardSlot();
+        slot->state.store(ShardPending, std::memory_order_relaxed);
+        slot->done.store(0, std::memory_order_relaxed);
+        slot->begin = static_cast<std::uint32_t>(params.size() * s / shard_count);
+        slot->end = static_cast<std::uint32_t>(params.size() * (s + 1) / shard_count);
+    }
+    std::copy(params.begin(), params.end(), view.params);
+
+    QStringList extraArguments;
+    if (std::shared_ptr<const Heightmap> terrain = active_terrain()) {
+        extraArguments << "--terrain" << QString::fromStdString(terrain->source());
+    }
+    if (std::shared_ptr<const WindField> field = active_wind_field()) {
+        extraArguments << "--wind-field" << QString::fromStdString(field->source());
+    }
+
+    struct RunningShard {
+        std::unique_ptr<QProcess> process;
+        std::size_t shard = 0;
+        std::uint32_t last_done = 0;
+        QElapsedTimer since_progress;
+    };
+    std::deque<std::size_t> pending;
+    std::vector<int> attempts(shard_count, 0);
+    for (std::size_t s = 0; s < shard_count; ++s) {
+        pending.push_back(s);
+    }
+    std::vector<RunningShard> running;
+    std::size_t reported = 0;
+
+    auto run_locally = [&](std::size_t s) {
+        ShardSlot& slot = view.slots[s];
+        slot.done.store(0, std::memory_order_relaxed);
+        evaluate_shard(view, slot);
+        ++local.local_shards;
+    };
+    auto shard_failed = [&](std::size_t s) {
+        ++local.failed_attempts;
+        ShardSlot& slot = view.slots[s];
+        if (attempts[s] <= options.max_retries) {
+            if (attempts[s] == 1) {
+                ++local.retried_shards;
+            }
+            slot.state.store(ShardPending, std::memory_order_relaxed);
+            slot.done.store(0, std::memory_order_relaxed);
+            pending.push_back(s);
+        } else {
+            run_locally(s);
+        }
+    };
+
+    if (!shared) {
+        while (!pending.empty()) {
+            run_locally(pending.front());
+            pending.pop_front();
+        }
+    }
+
+    while (!pending.empty() || !running.empty()) {
+        while (!pending.empty() && static_cast<int>(running.size()) < local.workers) {
+            RunningShard next;
+            next.shard = pending.front();
+            pending.pop_front();
+            ++attempts[next.shard];
+            next.process = std::make_unique<QProcess>();
+            next.process->setStandardOutputFile(QProcess::nullDevice());
+            next.process->setStandardErrorFile(QProcess::nullDevice());
+            next.process->start(QCoreApplication::applicationFilePath(),
+                                QStringList() << "--sweep-worker" << memory.key() << QString::number(next.shard) << extraArguments);
+            if (!next.process->waitForStarted()) {
+                shard_failed(next.shard);
+                continue;
+            }
+            next.since_progress.start();
+            running.push_back(std::move(next));
+        }
+
+        for (std::size_t r = 0; r < running.size();) {
+            RunningShard& current = running[r];
+            ShardSlot& slot = view.slots[current.shard];
+            bool finished = current.process->waitForFinished(running.size() > 1 ? 5 : 20);
+            std::uint32_t done = slot.done.load(std::memory_order_acquire);
+            if (done != current.last_done) {
+                current.last_done = done;
+                current.since_progress.restart();
+            }
+            bool stalled = !finished && current.since_progress.elapsed() > options.stall_timeout_ms;
+            if (!finished && !stalled) {
+                ++r;
+                continue;
+            }
+            if (stalled) {
+                current.process->kill();
+                current.process->waitForFinished();
+            }
+            bool succeeded = !stalled && current.process->exitStatus() == QProcess::NormalExit
+                             && current.process->exitCode() == 0
+                             && slot.state.load(std::memory_order_acquire) == ShardDone;
+            std::size_t shard = current.shard;
+            running.erase(running.begin() + static_cast<std::ptrdiff_t>(r));
+            if (!succeeded) {
+                shard_failed(shard);
+            }
+        }
+
+        if (progress) {
+            std::size_t done = 0;
+            for (std::size_t s = 0; s < shard_count; ++s) {
+                done += view.slots[s].done.load(std::memory_order_relaxed);
+            }
+            if (done != reported) {
+                reported = done;
+                progress(done, params.size());
+            }
+        }
+    }
+
+    // Слияние результатов и сводок шардов
+    std::copy(view.results, view.results + params.size(), results.begin());
+    for (std::size_t s = 0; s < shard_count; ++s) {
+        const ShardSlot& slot = view.slots[s];
+        local.batch.single_precision_flights += static_cast<std::size_t>(slot.single_precision_flights);
+        local.batch.verified += static_cast<std::size_t>(slot.verified);
+        local.batch.max_divergence = std::max(local.batch.max_divergence, slot.max_divergence);
+        local.batch.tolerance_exceeded = local.batch.tolerance_exceeded || slot.tolerance_exceeded;
+        local.batch.escalated = local.batch.escalated || slot.escalated;
+    }
+    if (!shared) {
+        local.workers = 0;
+    }
+
+    if (report) {
+        *report = local;
+    }
+    return results;
+}
@@ -0,0 +1,41 @@
+#ifndef SHARDRUNNER_H
+#define SHARDRUNNER_H
+
+#include "batch.h"
+#include <QStringList>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Запуск развертки в нескольких рабочих процессах на этой машине.
+// Развертка делится на шарды (по несколько на процесс), входные параметры и результаты
+// лежат в одном сегменте общей памяти, у каждого шарда свой счетчик прогресса.
+// Упавший или зависший процесс не роняет развертку: его шард запускается повторно,
+// а после исчерпания попыток считается в родительском процессе.
+struct ShardOptions {
+    int workers = 0;            // число процессов, 0 - по числу ядер
+    int shards_per_worker = 4;  // мелкие шарды - дешевле повтор и ровнее загрузка
+    int max_retries = 2;        // повторные запуски шарда в новом процессе
+    int stall_timeout_ms = 60000; // шард без прогресса дольше этого считается зависшим
+    BatchOptions batch;
+};
+
+struct ShardReport {
+    int workers = 0;
+    int shards = 0;
+    int failed_attempts = 0; // запуски, завершившиеся ошибкой, падением или зависанием
+    int retried_shards = 0;  // шарды, запущенные повторно
+    int local_shards = 0;    // шарды, досчитанные в родительском процессе
+    BatchReport batch;       // сводка float32-проверок по всем шардам
+};
+
+// progress(done, total) вызывается из родительского процесса по мере продвижения шардов
+std::vector<FlightSummary> run_sharded_sweep(const std::vector<Parameters>& params, const ShardOptions& options,
+                                             ShardReport* report = nullptr,
+                                             const std::function<void(std::size_t, std::size_t)>& progress = {});
+
+// Точка входа рабочего процесса: аргументы после --sweep-worker
+// (ключ сегмента, номер шарда, необязательные --terrain <путь> и --wind-field <путь>)
+int run_sweep_worker(const QStringList& arguments);
+
+#endif // SHARDRUNNER_H
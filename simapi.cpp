@@ -0,0 +1,212 @@
+#include "simapi.h"
+#include "analytic.h"
+#include "parallel.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <string>
+
+static_assert(sizeof(Parameters) == PROJECTILE_SIM_PARAMETER_FIELDS * sizeof(double), "Parameters field count");
+static_assert(sizeof(State) == PROJECTILE_SIM_STATE_FIELDS * sizeof(double), "State field count");
+
+namespace {
+
+constexpr std::size_t kSummaryChunk = 256;
+constexpr std::size_t kTrajectoryChunk = 4;
+
+// Шаги в байтах не обязаны быть кратны double: адрес считается от char*, чтение через memcpy
+double load(const double* base, std::ptrdiff_t offset) {
+    double value;
+    std::memcpy(&value, reinterpret_cast<const char*>(base) + offset, sizeof(value));
+    return value;
+}
+
+void store(double* base, std::ptrdiff_t offset, double value) {
+    std::memcpy(reinterpret_cast<char*>(base) + offset, &value, sizeof(value));
+}
+
+Parameters read_parameters(const projectile_sim_input& params, std::size_t i) {
+    double fields[PROJECTILE_SIM_PARAMETER_FIELDS];
+    std::ptrdiff_t row = static_cast<std::ptrdiff_t>(i) * params.row_stride;
+    for (int j = 0; j < PROJECTILE_SIM_PARAMETER_FIELDS; ++j) {
+        fields[j] = load(params.data, row + j * params.column_stride);
+    }
+    Parameters p;
+    std::memcpy(&p, fields, sizeof(p));
+    return p;
+}
+
+bool read_options(const projectile_sim_options* options, projectile_sim_options& out) {
+    projectile_sim_default_options(&out);
+    if (options) {
+        // Более новая версия структуры может быть длиннее: известные поля в начале
+        if (options->struct_size < sizeof(projectile_sim_options)) {
+            return false;
+        }
+        out.threads = options->threads;
+        out.dt = options->dt;
+        out.max_points = options->max_points;
+    }
+    return std::isfinite(out.dt) && out.dt > 0.0 && out.max_points > 0;
+}
+
+void write_error(const std::string& text, char* error, std::size_t error_size) {
+    if (error && error_size > 0) {
+        std::size_t n = std::min(text.size(), error_size - 1);
+        if (n < text.size()) {
+            // Обрезка по границе символа UTF-8: продолжающие байты 10xxxxxx не отрываются от начала символа
+            while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) {
+                --n;
+            }
+        }
+        std::memcpy(error, text.data(), n);
+        error[n] = '\0';
+    }
+}
+
+template <typename Body>
+int guarded(Body body) {
+    try {
+        return body();
+    } catch (const std::exception&) {
+        return PROJECTILE_SIM_INTERNAL_ERROR;
+    } catch (...) {
+        return PROJECTILE_SIM_INTERNAL_ERROR;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t projectile_sim_abi_version(void) {
+    return PROJECTILE_SIM_ABI_VERSION;
+}
+
+void projectile_sim_default_options(projectile_sim_options* options) {
+    if (!options) {
+        return;
+    }
+    options->struct_size = sizeof(projectile_sim_options);
+    options->threads = 0;
+    options->dt = 0.01;
+    options->max_points = 100000;
+}
+
+int projectile_sim_evaluate_summaries(size_t count, projectile_sim_input params, projectile_sim_output summaries,
+                                      const projectile_sim_options* options) {
+    projectile_sim_options opts;
+    if (!read_options(options, opts) || (count > 0 && (!params.data || !summaries.data))) {
+        return PROJECTILE_SIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        parallel_for(count, kSummaryChunk, opts.threads, [&](std::size_t begin, std::size_t end, int) {
+            for (std::size_t i = begin; i < end; ++i) {
+                FlightSummary s = evaluate_flight(read_parameters(params, i), opts.dt, opts.max_points);
+                const double fields[PROJECTILE_SIM_SUMMARY_FIELDS] = { s.max_height, s.total_distance, s.flight_time,
+                                                                       s.impact_x, s.impact_z };
+                std::ptrdiff_t row = static_cast<std::ptrdiff_t>(i) * summaries.row_stride;
+                for (int j = 0; j < PROJECTILE_SIM_SUMMARY_FIELDS; ++j) {
+                    store(summaries.data, row + j * summaries.column_stride, fields[j]);
+                }
+            }
+        });
+        return PROJECTILE_SIM_OK;
+    });
+}
+
+uint64_t projectile_sim_max_trajectory_length(const projectile_sim_options* options) {
+    projectile_sim_options opts;
+    return read_options(options, opts) ? opts.max_points : 0;
+}
+
+int projectile_sim_trajectory_lengths(size_t count, projectile_sim_input params, projectile_sim_lengths lengths,
+                                      const projectile_sim_options* options) {
+    projectile_sim_trajectories none{ nullptr, 0, 0, 0, 0 };
+    if (count > 0 && !lengths.data) {
+        return PROJECTILE_SIM_INVALID_ARGUMENT;
+    }
+    int status = projectile_sim_evaluate_trajectories(count, params, none, lengths, options);
+    return status == PROJECTILE_SIM_BUFFER_TOO_SMALL ? PROJECTILE_SIM_OK : status;
+}
+
+int projectile_sim_evaluate_trajectories(size_t count, projectile_sim_input params,
+                                         projectile_sim_trajectories trajectories, projectile_sim_lengths lengths,
+                                         const projectile_sim_options* options) {
+    projectile_sim_options opts;
+    if (!read_options(options, opts) || (count > 0 && !params.data) || (trajectories.capacity > 0 && !trajectories.data)) {
+        return PROJECTILE_SIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        std::atomic<bool> truncated{ false };
+        std::size_t maxPoints = static_cast<std::size_t>(std::min<std::uint64_t>(opts.max_points, SIZE_MAX));
+        parallel_for(count, kTrajectoryChunk, opts.threads, [&](std::size_t begin, std::size_t end, int) {
+            bool chunkTruncated = false;
+            for (std::size_t i = begin; i < end; ++i) {
+                std::ptrdiff_t base = static_cast<std::ptrdiff_t>(i) * trajectories.trajectory_stride;
+                std::uint64_t k = 0;
+                std::size_t n = integrate_trajectory_points(read_parameters(params, i), opts.dt, maxPoints, [&](const State& s) {
+                    if (k < trajectories.capacity) {
+                        const double fields[PROJECTILE_SIM_STATE_FIELDS] = { s.x, s.y, s.z, s.vx, s.vy, s.vz };
+                        std::ptrdiff_t point = base + static_cast<std::ptrdiff_t>(k) * trajectories.point_stride;
+                        for (int j = 0; j < PROJECTILE_SIM_STATE_FIELDS; ++j) {
+                            store(trajectories.data, point + j * trajectories.component_stride, fields[j]);
+                        }
+                    }
+                    ++k;
+                });
+                if (lengths.data) {
+                    std::uint64_t length = n;
+                    std::memcpy(reinterpret_cast<char*>(lengths.data) + static_cast<std::ptrdiff_t>(i) * lengths.stride,
+                                &length, sizeof(length));
+                }
+                chunkTruncated = chunkTruncated || n > trajectories.capacity;
+            }
+            if (chunkTruncated) {
+                truncated.store(true, std::memory_order_relaxed);
+            }
+        });
+        return truncated.load() ? PROJECTILE_SIM_BUFFER_TOO_SMALL : PROJECTILE_SIM_OK;
+    });
+}
+
+int projectile_sim_load_terrain(const char* path, char* error, size_t error_size) {
+    return guarded([&]() {
+        if (!path) {
+            set_active_terrain(nullptr);
+            return PROJECTILE_SIM_OK;
+        }
+        std::string text;
+        std::shared_ptr<Heightmap> terrain = Heightmap::load(path, &text);
+        if (!terrain) {
+            write_error(text, error, error_size);
+            return PROJECTILE_SIM_IO_ERROR;
+        }
+        terrain->rebase_to_origin();
+        set_active_terrain(terrain);
+        return PROJECTILE_SIM_OK;
+    });
+}
+
+int projectile_sim_load_wind_field(const char* path, char* error, size_t error_size) {
+    return guarded([&]() {
+        if (!path) {
+            set_active_wind_field(nullptr);
+            return PROJECTILE_SIM_OK;
+        }
+        std::string text;
+        std::shared_ptr<WindField> field = WindField::load(path, &text);
+        if (!field) {
+            write_error(text, error, error_size);
+            return PROJECTILE_SIM_IO_ERROR;
+        }
+        set_active_wind_field(field);
+        return PROJECTILE_SIM_OK;
+    });
+}
+
+} // extern "C"
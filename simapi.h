@@ -0,0 +1,118 @@
+#ifndef SIMAPI_H
+#define SIMAPI_H
+
+/* Стабильный C-интерфейс расчета (библиотека ProjectileSim) для других сред: Python/NumPy
+ * (ctypes, cffi), C, Rust и т.п. Все данные - массивы double, которые выделяет вызывающий;
+ * библиотека читает и пишет их на месте по шагам в байтах, как strides в NumPy, поэтому
+ * подходят и строки, и столбцы, и срезы чужих массивов без копирования.
+ * Результаты пишутся прямо в эти массивы, внутри библиотека память под них не выделяет.
+ * Исключения C++ наружу не выходят, ошибки - коды возврата. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(PROJECTILE_SIM_BUILD)
+#define PROJECTILE_SIM_API __declspec(dllexport)
+#else
+#define PROJECTILE_SIM_API __declspec(dllimport)
+#endif
+#else
+#define PROJECTILE_SIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROJECTILE_SIM_ABI_VERSION 1
+
+/* Число столбцов массивов. Параметры выстрела - в порядке Parameters:
+ * mass, Cd, air_density, radius, g, wind_x, wind_z, angle_deg, initial_speed, azimuth_deg.
+ * Итоги полета: max_height, total_distance, flight_time, impact_x, impact_z.
+ * Состояние точки траектории: x, y, z, vx, vy, vz. */
+#define PROJECTILE_SIM_PARAMETER_FIELDS 10
+#define PROJECTILE_SIM_SUMMARY_FIELDS 5
+#define PROJECTILE_SIM_STATE_FIELDS 6
+
+enum {
+    PROJECTILE_SIM_OK = 0,
+    PROJECTILE_SIM_INVALID_ARGUMENT = -1,
+    PROJECTILE_SIM_BUFFER_TOO_SMALL = -2, /* траектория не поместилась, записано начало */
+    PROJECTILE_SIM_IO_ERROR = -3,
+    PROJECTILE_SIM_INTERNAL_ERROR = -4
+};
+
+/* Двумерный массив: элемент (i, j) по адресу (char*)data + i * row_stride + j * column_stride */
+typedef struct projectile_sim_input {
+    const double* data;
+    ptrdiff_t row_stride;
+    ptrdiff_t column_stride;
+} projectile_sim_input;
+
+typedef struct projectile_sim_output {
+    double* data;
+    ptrdiff_t row_stride;
+    ptrdiff_t column_stride;
+} projectile_sim_output;
+
+/* Траектории всех выстрелов в одном трехмерном массиве [выстрел][точка][компонента]:
+ * (char*)data + i * trajectory_stride + k * point_stride + j * component_stride,
+ * capacity - число точек, отведенное на один выстрел */
+typedef struct projectile_sim_trajectories {
+    double* data;
+    ptrdiff_t trajectory_stride;
+    ptrdiff_t point_stride;
+    ptrdiff_t component_stride;
+    uint64_t capacity;
+} projectile_sim_trajectories;
+
+/* Длины траекторий: (char*)data + i * stride */
+typedef struct projectile_sim_lengths {
+    uint64_t* data;
+    ptrdiff_t stride;
+} projectile_sim_lengths;
+
+typedef struct projectile_sim_options {
+    uint32_t struct_size; /* sizeof(projectile_sim_options), заполняет projectile_sim_default_options */
+    int32_t threads;      /* 0 - по числу ядер, 1 - только вызывающий поток */
+    double dt;            /* шаг интегрирования, с */
+    uint64_t max_points;  /* предел точек одного полета */
+} projectile_sim_options;
+
+PROJECTILE_SIM_API uint32_t projectile_sim_abi_version(void);
+PROJECTILE_SIM_API void projectile_sim_default_options(projectile_sim_options* options);
+
+/* Итоги count полетов: params - count x PARAMETER_FIELDS, summaries - count x SUMMARY_FIELDS.
+ * options = NULL - настройки по умолчанию */
+PROJECTILE_SIM_API int projectile_sim_evaluate_summaries(size_t count, projectile_sim_input params,
+                                                         projectile_sim_output summaries,
+                                                         const projectile_sim_options* options);
+
+/* Наибольшая длина траектории при этих настройках - для выделения буфера заранее без расчета */
+PROJECTILE_SIM_API uint64_t projectile_sim_max_trajectory_length(const projectile_sim_options* options);
+
+/* Точные длины траекторий без записи точек (стоимость - как у расчета итогов) */
+PROJECTILE_SIM_API int projectile_sim_trajectory_lengths(size_t count, projectile_sim_input params,
+                                                         projectile_sim_lengths lengths,
+                                                         const projectile_sim_options* options);
+
+/* Траектории count полетов. В lengths (может быть data = NULL) - полная длина каждой траектории.
+ * Если какая-то длиннее capacity, записываются первые capacity точек и возвращается
+ * PROJECTILE_SIM_BUFFER_TOO_SMALL; остальные траектории при этом посчитаны полностью */
+PROJECTILE_SIM_API int projectile_sim_evaluate_trajectories(size_t count, projectile_sim_input params,
+                                                            projectile_sim_trajectories trajectories,
+                                                            projectile_sim_lengths lengths,
+                                                            const projectile_sim_options* options);
+
+/* Рельеф (.asc, .raw/.bin с .hdr) и поле ветра (.wnd) для всех следующих расчетов процесса;
+ * path = NULL снимает их. Текст ошибки - в error (UTF-8, до error_size байт с завершающим нулем,
+ * длинный текст обрезается по границе символа; может быть NULL) */
+PROJECTILE_SIM_API int projectile_sim_load_terrain(const char* path, char* error, size_t error_size);
+PROJECTILE_SIM_API int projectile_sim_load_wind_field(const char* path, char* error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMAPI_H */
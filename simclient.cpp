@@ -0,0 +1,261 @@
+#include "simclient.h"
+#include "scenario.h"
+#include "trajectorycodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <fcntl.h>
+#endif
+#endif
+
+namespace {
+
+#ifndef _WIN32
+// Запись в закрытый демоном сокет не должна убивать клиента сигналом SIGPIPE: в Linux - флаг
+// send, в macOS его нет, там сокет создается с SO_NOSIGPIPE
+#ifdef __APPLE__
+constexpr int kSendFlags = 0;
+#else
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+bool write_all(int fd, const std::uint8_t* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(fd, data, size, kSendFlags);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, std::uint8_t* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t got = ::recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+#endif
+
+template <typename T>
+void append(std::vector<std::uint8_t>& out, const T& value) {
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+} // namespace
+
+SimulationClient::~SimulationClient() {
+    close();
+}
+
+bool SimulationClient::connect(const std::string& path, std::string* error) {
+    close();
+#ifndef _WIN32
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error_text = "bad socket path: " + path;
+    } else {
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+#ifdef __APPLE__
+        // SOCK_CLOEXEC в macOS нет: флаг ставится отдельно, как и SO_NOSIGPIPE
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0) {
+            int one = 1;
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+        }
+#else
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#endif
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            return true;
+        }
+        error_text = path + ": " + std::strerror(errno);
+        close();
+    }
+#else
+    error_text = "local socket client is not supported on this platform";
+#endif
+    if (error) {
+        *error = error_text;
+    }
+    return false;
+}
+
+void SimulationClient::close() {
+#ifndef _WIN32
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+    fd = -1;
+}
+
+bool SimulationClient::exchange(SimRequestType type, const std::vector<std::uint8_t>& payload,
+                                std::vector<std::uint8_t>& response) {
+#ifndef _WIN32
+    if (fd < 0) {
+        error_text = "not connected";
+        return false;
+    }
+    SimFrameHeader header{ kSimProtocolMagic, static_cast<std::uint16_t>(type), 0, next_id++,
+                           static_cast<std::uint32_t>(payload.size()) };
+    std::vector<std::uint8_t> frame;
+    frame.reserve(sizeof(header) + payload.size());
+    append(frame, header);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    if (!write_all(fd, frame.data(), frame.size())) {
+        error_text = std::string("send: ") + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    SimFrameHeader reply;
+    if (!read_all(fd, reinterpret_cast<std::uint8_t*>(&reply), sizeof(reply)) || reply.magic != kSimProtocolMagic
+        || reply.id != header.id || reply.size > kSimMaxFrameSize) {
+        error_text = "connection lost or bad reply";
+        close();
+        return false;
+    }
+    response.resize(reply.size);
+    if (!read_all(fd, response.data(), response.size())) {
+        error_text = "connection lost";
+        close();
+        return false;
+    }
+    if (reply.status != static_cast<std::uint16_t>(SimStatus::Ok)) {
+        error_text.assign(response.begin(), response.end());
+        return false;
+    }
+    return true;
+#else
+    (void)type;
+    (void)payload;
+    (void)response;
+    error_text = "not connected";
+    return false;
+#endif
+}
+
+bool SimulationClient::summaries(const std::vector<Parameters>& shots, std::vector<FlightSummary>& results,
+                                 const SimSummaryOptions& options) {
+    std::vector<std::uint8_t> payload;
+    payload.reserve(sizeof(options) + shots.size() * sizeof(Parameters));
+    append(payload, options);
+    for (const Parameters& shot : shots) {
+        append(payload, shot);
+    }
+    std::vector<std::uint8_t> response;
+    if (!exchange(SimRequestType::Summaries, payload, response)) {
+        return false;
+    }
+    if (response.size() != shots.size() * sizeof(FlightSummary)) {
+        error_text = "bad summaries reply size";
+        return false;
+    }
+    results.resize(shots.size());
+    std::memcpy(results.data(), response.data(), response.size());
+    return true;
+}
+
+bool SimulationClient::trajectory(const Parameters& shot, std::vector<State>& states, const SimTrajectoryOptions& options) {
+    std::vector<std::uint8_t> payload;
+    append(payload, options);
+    append(payload, shot);
+    std::vector<std::uint8_t> response;
+    if (!exchange(SimRequestType::Trajectory, payload, response)) {
+        return false;
+    }
+    if (options.flags & kSimTrajectoryCompressed) {
+        if (!decode_trajectory(response.data(), response.size(), states)) {
+            error_text = "bad compressed trajectory";
+            return false;
+        }
+        return true;
+    }
+    if (response.size() % sizeof(State) != 0) {
+        error_text = "bad trajectory reply size";
+        return false;
+    }
+    states.resize(response.size() / sizeof(State));
+    std::memcpy(states.data(), response.data(), response.size());
+    return true;
+}
+
+bool SimulationClient::health(std::string& text) {
+    std::vector<std::uint8_t> response;
+    if (!exchange(SimRequestType::Health, {}, response)) {
+        return false;
+    }
+    text.assign(response.begin(), response.end());
+    return true;
+}
+
+int run_simulation_client_benchmark(const std::string& path, std::size_t requests) {
+    SimulationClient client;
+    std::string error;
+    if (!client.connect(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 3;
+    }
+    std::vector<Parameters> shot{ default_parameters() };
+    std::vector<FlightSummary> result;
+    auto request = [&]() {
+        auto begin = std::chrono::steady_clock::now();
+        bool ok = client.summaries(shot, result);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+        return ok ? us : -1.0;
+    };
+    double first = request();
+    if (first < 0.0) {
+        std::fprintf(stderr, "%s\n", client.last_error().c_str());
+        return 3;
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+    for (std::size_t i = 0; i < requests; ++i) {
+        double us = request();
+        if (us < 0.0) {
+            std::fprintf(stderr, "%s\n", client.last_error().c_str());
+            return 3;
+        }
+        latencies.push_back(us);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&](double q) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(q * latencies.size()))];
+    };
+    std::printf("Первый запрос (расчет): %.1f мкс\n", first);
+    std::printf("Из кэша, %zu запросов: p50 %.1f мкс, p99 %.1f мкс, максимум %.1f мкс\n", latencies.size(), at(0.50),
+                at(0.99), latencies.empty() ? 0.0 : latencies.back());
+
+    std::string text;
+    if (client.health(text)) {
+        std::printf("%s", text.c_str());
+    }
+    return 0;
+}
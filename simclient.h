@@ -0,0 +1,44 @@
+#ifndef SIMCLIENT_H
+#define SIMCLIENT_H
+
+#include "simprotocol.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Клиент демона расчета (--serve) для внутренних инструментов: без Qt, блокирующие вызовы
+// по одному запросу. Путь сокета печатает демон при запуске (по умолчанию /tmp/projectile-sim).
+// Только для Unix-подобных систем; в остальных connect возвращает false.
+class SimulationClient {
+public:
+    SimulationClient() = default;
+    ~SimulationClient();
+    SimulationClient(const SimulationClient&) = delete;
+    SimulationClient& operator=(const SimulationClient&) = delete;
+
+    bool connect(const std::string& path, std::string* error = nullptr);
+    void close();
+    bool connected() const { return fd >= 0; }
+    const std::string& last_error() const { return error_text; }
+
+    bool summaries(const std::vector<Parameters>& shots, std::vector<FlightSummary>& results,
+                   const SimSummaryOptions& options = {});
+    bool trajectory(const Parameters& shot, std::vector<State>& states, const SimTrajectoryOptions& options = {});
+    bool health(std::string& text);
+
+private:
+    bool exchange(SimRequestType type, const std::vector<std::uint8_t>& payload, std::vector<std::uint8_t>& response);
+
+    int fd = -1;
+    std::uint32_t next_id = 1;
+    std::string error_text;
+};
+
+constexpr const char* kDefaultSimSocket = "/tmp/projectile-sim";
+
+// Замер задержки запросов одного выстрела: первый запрос прогревает кэш, затем requests
+// повторов; печатает p50/p99/максимум и метрики демона. Код возврата для main
+int run_simulation_client_benchmark(const std::string& path, std::size_t requests);
+
+#endif // SIMCLIENT_H
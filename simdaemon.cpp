@@ -0,0 +1,239 @@
+#include "simdaemon.h"
+#include "simservice.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+constexpr const char* kDefaultServerName = "projectile-sim";
+
+std::atomic<bool> g_stopRequested{ false };
+
+void request_stop(int) {
+    g_stopRequested.store(true);
+}
+
+// Сокеты и очередь пакетов живут в потоке событий; расчет пакета идет в отдельном потоке,
+// чтобы ответы из кэша не ждали его. Пока пакет считается, новые промахи копятся для следующего
+class SimulationDaemon : public QObject {
+public:
+    SimulationDaemon(std::size_t cacheCapacity, int threads) : service(cacheCapacity, threads) {
+        server.setSocketOptions(QLocalServer::UserAccessOption);
+        connect(&server, &QLocalServer::newConnection, this, [this]() { acceptConnections(); });
+    }
+
+    ~SimulationDaemon() override {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    bool listen(const QString& name, QString* error) {
+        // Файл сокета от упавшего демона мешает listen; живой демон на нем же - ошибка
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(200)) {
+            *error = QString("Демон уже запущен: %1").arg(probe.fullServerName());
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (!server.listen(name)) {
+            *error = server.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QString socketPath() const { return server.fullServerName(); }
+
+private:
+    struct Connection {
+        QLocalSocket* socket;
+        QByteArray buffer;
+    };
+
+    void acceptConnections() {
+        while (QLocalSocket* socket = server.nextPendingConnection()) {
+            std::uint64_t id = ++lastConnection;
+            connections[id] = Connection{ socket, {} };
+            service.connection_opened();
+            connect(socket, &QLocalSocket::readyRead, this, [this, id]() { readFrames(id); });
+            connect(socket, &QLocalSocket::disconnected, this, [this, id]() {
+                auto it = connections.find(id);
+                if (it != connections.end()) {
+                    it->second.socket->deleteLater();
+                    connections.erase(it);
+                    service.connection_closed();
+                }
+            });
+        }
+    }
+
+    void readFrames(std::uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end()) {
+            return;
+        }
+        Connection& connection = it->second;
+        connection.buffer.append(connection.socket->readAll());
+
+        std::vector<SimulationService::Reply> replies;
+        qsizetype offset = 0;
+        bool broken = false;
+        while (connection.buffer.size() - offset >= static_cast<qsizetype>(sizeof(SimFrameHeader))) {
+            SimFrameHeader header;
+            std::memcpy(&header, connection.buffer.constData() + offset, sizeof(header));
+            if (header.magic != kSimProtocolMagic || header.size > kSimMaxFrameSize) {
+                // Границу следующего кадра уже не найти: ответить ошибкой и закрыть соединение
+                service.submit(id, header, nullptr, replies);
+                broken = true;
+                break;
+            }
+            qsizetype frameSize = static_cast<qsizetype>(sizeof(header) + header.size);
+            if (connection.buffer.size() - offset < frameSize) {
+                break;
+            }
+            const std::uint8_t* payload = reinterpret_cast<const std::uint8_t*>(connection.buffer.constData() + offset + sizeof(header));
+            service.submit(id, header, payload, replies);
+            offset += frameSize;
+        }
+        connection.buffer.remove(0, offset);
+
+        deliver(std::move(replies));
+        if (broken) {
+            connection.socket->disconnectFromServer();
+        }
+        scheduleBatch();
+    }
+
+    void deliver(std::vector<SimulationService::Reply> replies) {
+        QLocalSocket* last = nullptr;
+        for (const SimulationService::Reply& reply : replies) {
+            auto it = connections.find(reply.connection);
+            if (it == connections.end()) {
+                continue; // клиент отключился, не дождавшись ответа
+            }
+            QLocalSocket* socket = it->second.socket;
+            socket->write(reinterpret_cast<const char*>(reply.frame.data()), static_cast<qint64>(reply.frame.size()));
+            if (last && last != socket) {
+                last->flush();
+            }
+            last = socket;
+        }
+        if (last) {
+            last->flush();
+        }
+    }
+
+    // Пакет запускается после уже полученных событий сокетов, чтобы в него попали
+    // запросы всех клиентов, пришедшие одновременно
+    void scheduleBatch() {
+        if (batchRunning || batchScheduled || !service.has_pending()) {
+            return;
+        }
+        batchScheduled = true;
+        QTimer::singleShot(0, this, [this]() {
+            batchScheduled = false;
+            startBatch();
+        });
+    }
+
+    void startBatch() {
+        if (batchRunning || !service.has_pending()) {
+            return;
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        batchRunning = true;
+        worker = std::thread([this]() {
+            std::vector<SimulationService::Reply> replies = service.run_batch();
+            QMetaObject::invokeMethod(this, [this, replies = std::move(replies)]() mutable {
+                batchRunning = false;
+                deliver(std::move(replies));
+                scheduleBatch();
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    SimulationService service;
+    QLocalServer server;
+    std::unordered_map<std::uint64_t, Connection> connections;
+    std::uint64_t lastConnection = 0;
+    std::thread worker;
+    bool batchRunning = false;
+    bool batchScheduled = false;
+};
+
+} // namespace
+
+int run_simulation_daemon(const QStringList& arguments) {
+    QString name = kDefaultServerName;
+    std::size_t cacheCapacity = 1u << 20;
+    int threads = 0;
+    // Рельеф и поле ветра задаются при запуске и не меняются, поэтому в ключ кэша не входят
+    for (int i = 0; i < arguments.size(); ++i) {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+        if (arg == "--threads" && hasValue) {
+            threads = arguments[++i].toInt();
+        } else if (arg == "--cache" && hasValue) {
+            cacheCapacity = static_cast<std::size_t>(std::max(1LL, arguments[++i].toLongLong()));
+        } else if (arg == "--terrain" && hasValue) {
+            std::string terrainError;
+            std::shared_ptr<Heightmap> terrain = Heightmap::load(arguments[++i].toStdString(), &terrainError);
+            if (!terrain) {
+                std::fprintf(stderr, "%s\n", terrainError.c_str());
+                return 3;
+            }
+            terrain->rebase_to_origin();
+            set_active_terrain(terrain);
+        } else if (arg == "--wind-field" && hasValue) {
+            std::string fieldError;
+            std::shared_ptr<WindField> field = WindField::load(arguments[++i].toStdString(), &fieldError);
+            if (!field) {
+                std::fprintf(stderr, "%s\n", fieldError.c_str());
+                return 3;
+            }
+            set_active_wind_field(field);
+        } else if (i == 0 && !arg.startsWith("--")) {
+            name = arg;
+        } else {
+            std::fprintf(stderr, "Использование: --serve [имя или путь сокета] [--threads N] [--cache N] "
+                                 "[--terrain путь] [--wind-field путь]\n");
+            return 2;
+        }
+    }
+
+    SimulationDaemon daemon(cacheCapacity, threads);
+    QString error;
+    if (!daemon.listen(name, &error)) {
+        std::fprintf(stderr, "%s\n", error.toUtf8().constData());
+        return 3;
+    }
+    std::printf("Демон расчета слушает %s\n", daemon.socketPath().toUtf8().constData());
+    std::fflush(stdout);
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    QTimer stopTimer;
+    QObject::connect(&stopTimer, &QTimer::timeout, []() {
+        if (g_stopRequested.load()) {
+            QCoreApplication::quit();
+        }
+    });
+    stopTimer.start(200);
+    return QCoreApplication::exec();
+}
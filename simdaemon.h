@@ -0,0 +1,12 @@
+#ifndef SIMDAEMON_H
+#define SIMDAEMON_H
+
+#include <QStringList>
+
+// Долгоживущий демон расчета (--serve): принимает запросы протокола simprotocol.h
+// через локальный сокет (Unix domain socket), отвечает из теплого кэша сразу,
+// а промахи всех клиентов собирает в общий пакет и считает в рабочем потоке.
+// arguments - аргументы после --serve. Работает до SIGINT/SIGTERM, код возврата для main
+int run_simulation_daemon(const QStringList& arguments);
+
+#endif // SIMDAEMON_H
@@ -0,0 +1,64 @@
+#ifndef SIMPROTOCOL_H
+#define SIMPROTOCOL_H
+
+#include "simulation.h"
+#include <cstdint>
+#include <type_traits>
+
+// Двоичный протокол демона расчета (--serve) поверх локального сокета.
+// Каждый кадр - заголовок SimFrameHeader и size байт данных; порядок байт - родной
+// (клиент и демон на одной машине). Ответ приходит с тем же id и типом, запросы одного
+// соединения можно отправлять подряд, не дожидаясь ответов; ответы из кэша
+// могут обогнать ответы, ждущие расчета.
+//
+//   Summaries:  SimSummaryOptions, n * Parameters   ->  n * FlightSummary
+//   Trajectory: SimTrajectoryOptions, Parameters    ->  состояния подряд (State) или,
+//               при kSimTrajectoryCompressed, траектория в формате trajectorycodec.h
+//   Health:     пусто                               ->  текст "ключ=значение" по строке
+//
+// При ошибке status != Ok, данные ответа - текст причины.
+
+constexpr std::uint32_t kSimProtocolMagic = 0x32534442; // "BDS2"
+constexpr std::uint32_t kSimMaxFrameSize = 64u << 20;
+
+enum class SimRequestType : std::uint16_t {
+    Summaries = 1,
+    Trajectory = 2,
+    Health = 3,
+};
+
+enum class SimStatus : std::uint16_t {
+    Ok = 0,
+    BadRequest = 1,
+    TooLarge = 2,
+};
+
+struct SimFrameHeader {
+    std::uint32_t magic;
+    std::uint16_t type;
+    std::uint16_t status; // в запросе 0
+    std::uint32_t id;     // выбирает клиент, возвращается в ответе
+    std::uint32_t size;   // байт данных после заголовка
+};
+
+constexpr std::uint32_t kSimSinglePrecision = 1;      // SimSummaryOptions::flags: пакет float32 (batch.h)
+constexpr std::uint32_t kSimTrajectoryCompressed = 1; // SimTrajectoryOptions::flags
+
+struct SimSummaryOptions {
+    double dt = 0.01;
+    std::uint32_t max_points = 100000;
+    std::uint32_t flags = 0;
+};
+
+struct SimTrajectoryOptions {
+    double dt = 0.01;
+    std::uint32_t max_points = 100000;
+    std::uint32_t flags = 0;
+    double tolerance = 1e-3; // допуск сжатия, м и м/с
+};
+
+static_assert(sizeof(SimFrameHeader) == 16, "frame header layout");
+static_assert(sizeof(SimSummaryOptions) == 16 && sizeof(SimTrajectoryOptions) == 24, "options layout");
+static_assert(std::is_trivially_copyable<Parameters>::value && sizeof(Parameters) == 10 * sizeof(double), "Parameters layout");
+
+#endif // SIMPROTOCOL_H
@@ -0,0 +1,391 @@
+#include "simservice.h"
+#include "batch.h"
+#include "parallel.h"
+#include "trajectorycodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+constexpr std::size_t kBatchChunk = 64;         // полетов на вызов evaluate_batch в одном потоке
+constexpr std::uint32_t kMaxPointsLimit = 10000000;
+
+std::uint64_t splitmix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+bool valid_step(double dt, std::uint32_t maxPoints) {
+    return std::isfinite(dt) && dt > 0.0 && dt <= 1.0 && maxPoints > 0 && maxPoints <= kMaxPointsLimit;
+}
+
+// -0 и 0 - один и тот же выстрел
+Parameters canonical(Parameters p) {
+    double* values = reinterpret_cast<double*>(&p);
+    for (std::size_t i = 0; i < sizeof(Parameters) / sizeof(double); ++i) {
+        if (values[i] == 0.0) {
+            values[i] = 0.0;
+        }
+    }
+    return p;
+}
+
+BatchOptions batch_options(const SimSummaryOptions& options) {
+    BatchOptions batch;
+    batch.dt = options.dt;
+    batch.max_points = options.max_points;
+    batch.single_precision = (options.flags & kSimSinglePrecision) != 0;
+    return batch;
+}
+
+} // namespace
+
+bool SimulationService::ShotKey::operator==(const ShotKey& other) const {
+    return std::memcmp(&params, &other.params, sizeof(params)) == 0 && options.dt == other.options.dt
+        && options.max_points == other.options.max_points && options.flags == other.options.flags;
+}
+
+std::size_t SimulationService::ShotKeyHash::operator()(const ShotKey& key) const {
+    std::uint64_t words[sizeof(Parameters) / sizeof(double) + 2];
+    std::memcpy(words, &key.params, sizeof(key.params));
+    std::memcpy(&words[10], &key.options.dt, sizeof(double));
+    words[11] = (static_cast<std::uint64_t>(key.options.max_points) << 32) | key.options.flags;
+    std::uint64_t h = 0x42445331;
+    for (std::uint64_t w : words) {
+        h = splitmix(h ^ w);
+    }
+    return static_cast<std::size_t>(h);
+}
+
+SimulationService::SimulationService(std::size_t cache_capacity, int thread_count)
+    : threads(thread_count > 0 ? thread_count : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))),
+      capacity(std::clamp<std::size_t>(cache_capacity, 1, 0xffffffffu)),
+      started(std::chrono::steady_clock::now()),
+      latency_buckets(kLatencyBuckets, 0) {
+    index.reserve(std::min<std::size_t>(capacity, 1u << 16));
+}
+
+bool SimulationService::cache_find(const ShotKey& key, FlightSummary& summary) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return false;
+    }
+    Slot& slot = slots[it->second];
+    slot.referenced = true;
+    summary = slot.summary;
+    return true;
+}
+
+void SimulationService::cache_insert(const ShotKey& key, const FlightSummary& summary) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        slots[it->second].summary = summary;
+        return;
+    }
+    if (slots.size() < capacity) {
+        index.emplace(key, static_cast<std::uint32_t>(slots.size()));
+        slots.push_back(Slot{ key, summary, false });
+        return;
+    }
+    while (slots[hand].referenced) {
+        slots[hand].referenced = false;
+        hand = (hand + 1) % slots.size();
+    }
+    index.erase(slots[hand].key);
+    slots[hand] = Slot{ key, summary, false };
+    index.emplace(key, static_cast<std::uint32_t>(hand));
+    hand = (hand + 1) % slots.size();
+}
+
+void SimulationService::record_latency(std::chrono::steady_clock::duration latency) {
+    std::uint64_t ns = static_cast<std::uint64_t>(std::max<std::int64_t>(
+        0, std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+    int bucket = ns > 1000 ? static_cast<int>(8.0 * std::log2(ns / 1000.0)) : 0;
+    bucket = std::clamp(bucket, 0, kLatencyBuckets - 1);
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    ++latency_buckets[bucket];
+    max_latency_ns = std::max(max_latency_ns, ns);
+}
+
+void SimulationService::finish(std::uint64_t connection, const SimFrameHeader& request, SimStatus status,
+                               const void* data, std::size_t size, std::chrono::steady_clock::time_point received,
+                               std::vector<Reply>& replies) {
+    SimFrameHeader header{ kSimProtocolMagic, request.type, static_cast<std::uint16_t>(status), request.id,
+                           static_cast<std::uint32_t>(size) };
+    Reply reply{ connection, std::vector<std::uint8_t>(sizeof(header) + size) };
+    std::memcpy(reply.frame.data(), &header, sizeof(header));
+    if (size) {
+        std::memcpy(reply.frame.data() + sizeof(header), data, size);
+    }
+    replies.push_back(std::move(reply));
+    if (status != SimStatus::Ok) {
+        ++errors;
+    }
+    record_latency(std::chrono::steady_clock::now() - received);
+}
+
+void SimulationService::submit(std::uint64_t connection, const SimFrameHeader& header, const std::uint8_t* payload,
+                               std::vector<Reply>& replies) {
+    auto received = std::chrono::steady_clock::now();
+    ++requests;
+    auto fail = [&](SimStatus status, const char* message) {
+        finish(connection, header, status, message, std::strlen(message), received, replies);
+    };
+    if (header.magic != kSimProtocolMagic) {
+        fail(SimStatus::BadRequest, "bad magic");
+        return;
+    }
+    if (header.size > kSimMaxFrameSize) {
+        fail(SimStatus::TooLarge, "frame too large");
+        return;
+    }
+
+    switch (static_cast<SimRequestType>(header.type)) {
+        case SimRequestType::Health: {
+            std::string text = health();
+            finish(connection, header, SimStatus::Ok, text.data(), text.size(), received, replies);
+            return;
+        }
+        case SimRequestType::Summaries: {
+            SimSummaryOptions options;
+            if (header.size < sizeof(options) || (header.size - sizeof(options)) % sizeof(Parameters) != 0) {
+                fail(SimStatus::BadRequest, "bad summaries payload size");
+                return;
+            }
+            std::memcpy(&options, payload, sizeof(options));
+            if (!valid_step(options.dt, options.max_points)) {
+                fail(SimStatus::BadRequest, "bad dt or max_points");
+                return;
+            }
+            options.flags &= kSimSinglePrecision;
+            std::size_t n = (header.size - sizeof(options)) / sizeof(Parameters);
+            Pending request{ connection, header, received, {}, std::vector<FlightSummary>(n), {}, {}, {} };
+            request.shots.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                Parameters params;
+                std::memcpy(&params, payload + sizeof(options) + i * sizeof(Parameters), sizeof(params));
+                request.shots[i] = ShotKey{ canonical(params), options };
+            }
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                for (std::size_t i = 0; i < n; ++i) {
+                    if (!cache_find(request.shots[i], request.results[i])) {
+                        request.missing.push_back(i);
+                    }
+                }
+            }
+            flights += n;
+            cache_hits += n - request.missing.size();
+            cache_misses += request.missing.size();
+            if (request.missing.empty()) {
+                finish(connection, header, SimStatus::Ok, request.results.data(), n * sizeof(FlightSummary), received, replies);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            pending.push_back(std::move(request));
+            return;
+        }
+        case SimRequestType::Trajectory: {
+            SimTrajectoryOptions options;
+            if (header.size != sizeof(options) + sizeof(Parameters)) {
+                fail(SimStatus::BadRequest, "bad trajectory payload size");
+                return;
+            }
+            std::memcpy(&options, payload, sizeof(options));
+            if (!valid_step(options.dt, options.max_points)
+                || ((options.flags & kSimTrajectoryCompressed) && !(options.tolerance > 0.0))) {
+                fail(SimStatus::BadRequest, "bad trajectory options");
+                return;
+            }
+            Pending request{ connection, header, received, {}, {}, {}, {}, options };
+            std::memcpy(&request.trajectory_params, payload + sizeof(options), sizeof(Parameters));
+            ++flights;
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            pending.push_back(std::move(request));
+            return;
+        }
+    }
+    fail(SimStatus::BadRequest, "unknown request type");
+}
+
+bool SimulationService::has_pending() const {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    return !pending.empty();
+}
+
+std::vector<SimulationService::Reply> SimulationService::run_batch() {
+    std::vector<Pending> work;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        work.swap(pending);
+    }
+    std::vector<Reply> replies;
+    if (work.empty()) {
+        return replies;
+    }
+    ++batches;
+    batched_requests += work.size();
+
+    // Одинаковые полеты разных запросов считаются один раз; полеты с одинаковыми
+    // настройками идут одним пакетом (float32 - пачками по kFloatLanes снарядов)
+    using OptionsKey = std::tuple<double, std::uint32_t, std::uint32_t>;
+    std::map<OptionsKey, std::vector<ShotKey>> groups;
+    std::unordered_map<ShotKey, std::size_t, ShotKeyHash> unique;
+    std::vector<Pending*> trajectories;
+    for (Pending& request : work) {
+        if (static_cast<SimRequestType>(request.header.type) == SimRequestType::Trajectory) {
+            trajectories.push_back(&request);
+            continue;
+        }
+        for (std::size_t i : request.missing) {
+            const ShotKey& key = request.shots[i];
+            if (unique.emplace(key, 0).second) {
+                groups[OptionsKey(key.options.dt, key.options.max_points, key.options.flags)].push_back(key);
+            }
+        }
+    }
+
+    std::unordered_map<ShotKey, FlightSummary, ShotKeyHash> computed;
+    computed.reserve(unique.size());
+    for (auto& [optionsKey, shots] : groups) {
+        BatchOptions options = batch_options(shots.front().options);
+        std::vector<FlightSummary> results(shots.size());
+        parallel_for(shots.size(), kBatchChunk, threads, [&](std::size_t begin, std::size_t end, int) {
+            std::vector<Parameters> params;
+            params.reserve(end - begin);
+            for (std::size_t i = begin; i < end; ++i) {
+                params.push_back(shots[i].params);
+            }
+            std::vector<FlightSummary> chunk = evaluate_batch(params, options);
+            std::copy(chunk.begin(), chunk.end(), results.begin() + static_cast<std::ptrdiff_t>(begin));
+        });
+        for (std::size_t i = 0; i < shots.size(); ++i) {
+            computed.emplace(shots[i], results[i]);
+        }
+        computed_flights += shots.size();
+    }
+
+    std::vector<std::vector<std::uint8_t>> trajectoryData(trajectories.size());
+    parallel_for(trajectories.size(), 1, threads, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<State> states;
+        for (std::size_t i = begin; i < end; ++i) {
+            const Pending& request = *trajectories[i];
+            const SimTrajectoryOptions& options = request.trajectory_options;
+            integrate_trajectory(request.trajectory_params, options.dt, options.max_points, states);
+            if (options.flags & kSimTrajectoryCompressed) {
+                TrajectoryCodecOptions codec;
+                codec.position_tolerance = codec.velocity_tolerance = options.tolerance;
+                trajectoryData[i] = encode_trajectory(states, codec);
+            } else {
+                const std::uint8_t* raw = reinterpret_cast<const std::uint8_t*>(states.data());
+                trajectoryData[i].assign(raw, raw + states.size() * sizeof(State));
+            }
+        }
+    });
+    computed_flights += trajectories.size();
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        for (const auto& [key, summary] : computed) {
+            cache_insert(key, summary);
+        }
+    }
+
+    std::size_t nextTrajectory = 0;
+    for (Pending& request : work) {
+        if (static_cast<SimRequestType>(request.header.type) == SimRequestType::Trajectory) {
+            const std::vector<std::uint8_t>& data = trajectoryData[nextTrajectory++];
+            if (data.size() > kSimMaxFrameSize) {
+                const char* message = "trajectory too large";
+                finish(request.connection, request.header, SimStatus::TooLarge, message, std::strlen(message),
+                       request.received, replies);
+            } else if (data.empty() && (request.trajectory_options.flags & kSimTrajectoryCompressed)) {
+                const char* message = "trajectory cannot be compressed with this tolerance";
+                finish(request.connection, request.header, SimStatus::BadRequest, message, std::strlen(message),
+                       request.received, replies);
+            } else {
+                finish(request.connection, request.header, SimStatus::Ok, data.data(), data.size(), request.received, replies);
+            }
+            continue;
+        }
+        for (std::size_t i : request.missing) {
+            request.results[i] = computed.at(request.shots[i]);
+        }
+        finish(request.connection, request.header, SimStatus::Ok, request.results.data(),
+               request.results.size() * sizeof(FlightSummary), request.received, replies);
+    }
+    return replies;
+}
+
+void SimulationService::connection_opened() {
+    ++connections;
+}
+
+void SimulationService::connection_closed() {
+    --connections;
+}
+
+std::string SimulationService::health() const {
+    std::vector<std::uint64_t> buckets;
+    std::uint64_t maxNs;
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex);
+        buckets = latency_buckets;
+        maxNs = max_latency_ns;
+    }
+    std::uint64_t total = 0;
+    for (std::uint64_t b : buckets) {
+        total += b;
+    }
+    // Верхняя граница корзины, в которую попадает доля q ответов
+    auto percentile = [&](double q) {
+        if (total == 0) {
+            return 0.0;
+        }
+        std::uint64_t target = static_cast<std::uint64_t>(std::ceil(q * total));
+        std::uint64_t seen = 0;
+        for (int b = 0; b < kLatencyBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= std::max<std::uint64_t>(target, 1)) {
+                return std::min(std::exp2((b + 1) / 8.0), maxNs / 1000.0);
+            }
+        }
+        return maxNs / 1000.0;
+    };
+
+    std::size_t cached, pendingCount;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cached = slots.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pendingCount = pending.size();
+    }
+    std::uint64_t hits = cache_hits, misses = cache_misses, batchCount = batches;
+    double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    char text[1024];
+    std::snprintf(text, sizeof(text),
+                  "status=ok\nuptime_s=%.1f\nthreads=%d\nconnections=%lld\nrequests=%llu\nerrors=%llu\npending=%zu\n"
+                  "flights=%llu\ncomputed_flights=%llu\ncache_entries=%zu\ncache_capacity=%zu\ncache_hits=%llu\n"
+                  "cache_misses=%llu\ncache_hit_ratio=%.4f\nbatches=%llu\nmean_batch_requests=%.2f\n"
+                  "latency_p50_us=%.1f\nlatency_p90_us=%.1f\nlatency_p99_us=%.1f\nlatency_max_us=%.1f\n",
+                  uptime, threads, static_cast<long long>(connections.load()),
+                  static_cast<unsigned long long>(requests.load()), static_cast<unsigned long long>(errors.load()),
+                  pendingCount, static_cast<unsigned long long>(flights.load()),
+                  static_cast<unsigned long long>(computed_flights.load()), cached, capacity,
+                  static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses),
+                  hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0,
+                  static_cast<unsigned long long>(batchCount),
+                  batchCount ? static_cast<double>(batched_requests.load()) / batchCount : 0.0,
+                  percentile(0.50), percentile(0.90), percentile(0.99), maxNs / 1000.0);
+    return text;
+}
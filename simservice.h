@@ -0,0 +1,105 @@
+#ifndef SIMSERVICE_H
+#define SIMSERVICE_H
+
+#include "simprotocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Ядро демона расчета без транспорта: разбор кадров, теплый кэш итогов полета в памяти,
+// сборка запросов разных клиентов в общий пакет и метрики задержек.
+// submit вызывается потоком сокетов, run_batch - рабочим потоком; они могут идти одновременно.
+class SimulationService {
+public:
+    struct Reply {
+        std::uint64_t connection;
+        std::vector<std::uint8_t> frame; // заголовок и данные ответа
+    };
+
+    // cache_capacity - число итогов полета в кэше, thread_count = 0 - по числу ядер
+    explicit SimulationService(std::size_t cache_capacity = 1u << 20, int thread_count = 0);
+
+    // Кадр запроса соединения connection. Ответы из кэша, метрики и ошибки сразу добавляются
+    // в replies, остальное ждет пакета
+    void submit(std::uint64_t connection, const SimFrameHeader& header, const std::uint8_t* payload,
+                std::vector<Reply>& replies);
+
+    bool has_pending() const;
+    // Считает все ожидающие запросы одним пакетом: одинаковые полеты разных клиентов - один раз
+    std::vector<Reply> run_batch();
+
+    void connection_opened();
+    void connection_closed();
+
+    // Состояние и метрики, текст "ключ=значение" по строке (он же ответ на Health)
+    std::string health() const;
+
+private:
+    struct ShotKey {
+        Parameters params;
+        SimSummaryOptions options;
+        bool operator==(const ShotKey& other) const;
+    };
+    struct ShotKeyHash {
+        std::size_t operator()(const ShotKey& key) const;
+    };
+    struct Slot {
+        ShotKey key;
+        FlightSummary summary;
+        bool referenced;
+    };
+
+    struct Pending {
+        std::uint64_t connection;
+        SimFrameHeader header;
+        std::chrono::steady_clock::time_point received;
+        std::vector<ShotKey> shots;       // Summaries
+        std::vector<FlightSummary> results;
+        std::vector<std::size_t> missing; // номера полетов без кэша
+        Parameters trajectory_params{};    // Trajectory
+        SimTrajectoryOptions trajectory_options;
+    };
+
+    bool cache_find(const ShotKey& key, FlightSummary& summary); // под cache_mutex
+    void cache_insert(const ShotKey& key, const FlightSummary& summary);
+    void finish(std::uint64_t connection, const SimFrameHeader& request, SimStatus status, const void* data,
+                std::size_t size, std::chrono::steady_clock::time_point received, std::vector<Reply>& replies);
+    void record_latency(std::chrono::steady_clock::duration latency);
+
+    int threads;
+    std::size_t capacity;
+    std::chrono::steady_clock::time_point started;
+
+    // Кэш с вытеснением "по часам": при нехватке места стрелка идет по слотам, снимая
+    // отметку обращения, и занимает первый слот без нее
+    mutable std::mutex cache_mutex;
+    std::unordered_map<ShotKey, std::uint32_t, ShotKeyHash> index;
+    std::vector<Slot> slots;
+    std::size_t hand = 0;
+
+    mutable std::mutex pending_mutex;
+    std::vector<Pending> pending;
+
+    // Гистограмма задержек от приема кадра до готового ответа: корзины по 1/8 октавы от 1 мкс
+    static constexpr int kLatencyBuckets = 8 * 28;
+    mutable std::mutex metrics_mutex;
+    std::vector<std::uint64_t> latency_buckets;
+    std::uint64_t max_latency_ns = 0;
+
+    std::atomic<std::uint64_t> requests{ 0 };
+    std::atomic<std::uint64_t> errors{ 0 };
+    std::atomic<std::uint64_t> flights{ 0 };
+    std::atomic<std::uint64_t> cache_hits{ 0 };
+    std::atomic<std::uint64_t> cache_misses{ 0 };
+    std::atomic<std::uint64_t> batches{ 0 };
+    std::atomic<std::uint64_t> batched_requests{ 0 };
+    std::atomic<std::uint64_t> computed_flights{ 0 };
+    std::atomic<std::int64_t> connections{ 0 };
+};
+
+#endif // SIMSERVICE_H
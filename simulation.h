@@ -2,24 +2,66 @@
 #define SIMULATION_H
 
 #include "parameters.h"
+#include <cstddef>
+#include <functional>
+#include <string>
 #include <vector>
-#include <vtkSmartPointer.h>
-#include <vtkActor.h>
-#include <vtkRenderWindow.h>
-#include <vtkRenderWindowInteractor.h>
+
+class WindField;
 
 struct State {
     double x, y, z;
     double vx, vy, vz;
 };
 
+// Итоговые характеристики одного полета
+struct FlightSummary {
+    double max_height = 0.0;
+    double total_distance = 0.0;
+    double flight_time = 0.0;
+    double impact_x = 0.0;
+    double impact_z = 0.0;
+    double impact_speed = 0.0; // модуль скорости в точке падения, м/с
+};
+
+// Набор траекторий (развертка, рассеивание), упакованный в плоские массивы
+// для отрисовки одним vtkPolyData
+struct TrajectoryEnsemble {
+    std::vector<double> points;       // x, y, z подряд для всех траекторий
+    std::vector<std::size_t> offsets; // индекс первой точки каждой траектории, offsets.size() == count + 1
+    std::vector<double> metric;       // значение метрики для раскраски, по одному на траекторию
+};
+
 // Объявления функций
-State compute_derivatives(const State& state, const Parameters& params);
-State runge_kutta_step(const State& state, const Parameters& params, double dt);
-void StartSimulation(Parameters params);
+double drag_factor(const Parameters& params); // k = 0.5 * Cd * rho * A / m
+// wind - поле ветра поверх постоянного ветра из параметров, t - время от выстрела
+State compute_derivatives(const State& state, const Parameters& params, const WindField* wind = nullptr, double t = 0.0);
+State runge_kutta_step(const State& state, const Parameters& params, double dt, const WindField* wind = nullptr, double t = 0.0);
+State initial_state(const Parameters& params);
+// Кубическая интерполяция Эрмита внутри шага h по значениям p и производным d на концах, s в [0, 1]
+double hermite(double p0, double p1, double d0, double d1, double h, double s);
+double hermite_slope(double p0, double p1, double d0, double d1, double h, double s); // d/ds
+// Корень f на [0, 1] делением пополам при f(0) >= 0 > f(1) - момент падения или апогея внутри шага
+template <typename F>
+double bisect_unit(F f) {
+    double lo = 0.0, hi = 1.0;
+    for (int i = 0; i < 60; ++i) {
+        double mid = 0.5 * (lo + hi);
+        (f(mid) >= 0.0 ? lo : hi) = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+// Интегрирует траекторию до падения на землю, заполняя states (буфер переиспользуется)
+void integrate_trajectory(const Parameters& params, double dt, std::size_t max_points, std::vector<State>& states);
+// То же без буфера: точки передаются emit по мере расчета, возвращается их число
+std::size_t integrate_trajectory_points(const Parameters& params, double dt, std::size_t max_points,
+                                       const std::function<void(const State&)>& emit);
+// То же интегрирование без хранения траектории, только итоговые характеристики
+FlightSummary integrate_flight_summary(const Parameters& params, double dt, std::size_t max_points);
+
+// Добавляет траекторию в набор, сохраняя каждую stride-ю точку (и последнюю)
+void append_to_ensemble(TrajectoryEnsemble& ensemble, const std::vector<State>& states, double metric, std::size_t stride);
 
-// Новые функции для анимации
-void StartAnimatedSimulation(Parameters params);
-class AnimationCallback;
+// 3D-визуализация (StartSimulation и др.) - в модуле view3d.h, загружаемом по требованию
 
 #endif // SIMULATION_H 
\ No newline at end of file
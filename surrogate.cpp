@@ -0,0 +1,509 @@
+#include "surrogate.h"
+#include "optimalangle.h"
+#include "parallel.h"
+#include "scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+
+namespace {
+
+constexpr int kN = kScenarioParameterCount;
+constexpr int kM = kSweepMetricCount;
+constexpr int kMaxLevel = 255; // предел взвешенной степени
+
+// Заголовок файла суррогата (little-endian). За ним для каждой величины:
+// int32 взвешенная степень, uint32 число коэффициентов, double cv_rms, cv_max, коэффициенты
+struct SurrogateFileHeader {
+    char magic[4];                  // "SURR"
+    std::uint32_t version;          // kSurrogateFormatVersion
+    std::uint32_t samples;
+    std::uint32_t reserved;
+    double dt;
+    double low[kN], high[kN];
+    std::int32_t axis_degree[kN];   // наибольшая степень по полю, 0 - поле фиксировано
+    std::int32_t axis_weight[kN];   // вес поля во взвешенной степени
+};
+
+std::uint64_t splitmix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+double unit(std::uint64_t bits) {
+    return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
+// Решение (A + ridge) x = b для симметричной положительно определенной A размера m
+// (хранится полностью, строками с шагом stride) с rhs правыми частями; false - вырождена
+bool solve_spd(std::vector<double>& a, std::size_t stride, std::size_t m, std::vector<double>& b, int rhs) {
+    double mean_diag = 0.0;
+    for (std::size_t i = 0; i < m; ++i) mean_diag += a[i * stride + i];
+    double ridge = 1e-12 * mean_diag / static_cast<double>(std::max<std::size_t>(m, 1));
+    for (std::size_t j = 0; j < m; ++j) {
+        double d = a[j * stride + j] + ridge;
+        for (std::size_t k = 0; k < j; ++k) d -= a[j * stride + k] * a[j * stride + k];
+        if (!(d > 0.0)) {
+            return false;
+        }
+        d = std::sqrt(d);
+        a[j * stride + j] = d;
+        for (std::size_t i = j + 1; i < m; ++i) {
+            double s = a[i * stride + j];
+            for (std::size_t k = 0; k < j; ++k) s -= a[i * stride + k] * a[j * stride + k];
+            a[i * stride + j] = s / d;
+        }
+    }
+    for (int r = 0; r < rhs; ++r) {
+        for (std::size_t i = 0; i < m; ++i) {
+            double s = b[i * rhs + r];
+            for (std::size_t k = 0; k < i; ++k) s -= a[i * stride + k] * b[k * rhs + r];
+            b[i * rhs + r] = s / a[i * stride + i];
+        }
+        for (std::size_t i = m; i-- > 0;) {
+            double s = b[i * rhs + r];
+            for (std::size_t k = i + 1; k < m; ++k) s -= a[k * stride + i] * b[k * rhs + r];
+            b[i * rhs + r] = s / a[i * stride + i];
+        }
+    }
+    return true;
+}
+
+// Скалярное произведение четырьмя независимыми суммами: цепочка сложений не ждет каждое предыдущее
+double dot(const double* c, const double* v, std::size_t n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    std::size_t t = 0;
+    for (; t + 4 <= n; t += 4) {
+        s0 += c[t] * v[t];
+        s1 += c[t + 1] * v[t + 1];
+        s2 += c[t + 2] * v[t + 2];
+        s3 += c[t + 3] * v[t + 3];
+    }
+    for (; t < n; ++t) s0 += c[t] * v[t];
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace
+
+bool Surrogate::build_terms(int degree, std::size_t max_terms) {
+    max_degree = degree;
+    int d = dimensions();
+    degree_end.assign(degree + 1, 0);
+    term_parent.clear();
+    term_axis.clear();
+    term_power.clear();
+
+    // Перебор показателей со взвешенной суммой level по возрастанию level; индекс члена - по показателям
+    std::map<std::vector<std::uint8_t>, std::uint32_t> index;
+    std::vector<std::uint8_t> e(d, 0);
+    auto add_term = [&]() {
+        int last = d - 1;
+        while (last >= 0 && e[last] == 0) --last;
+        std::uint32_t id = static_cast<std::uint32_t>(term_parent.size());
+        if (last < 0) {
+            term_parent.push_back(0);
+            term_axis.push_back(0);
+            term_power.push_back(0);
+        } else {
+            std::vector<std::uint8_t> parent = e;
+            parent[last] = 0;
+            term_parent.push_back(index.at(parent));
+            term_axis.push_back(static_cast<std::uint8_t>(last));
+            term_power.push_back(e[last]);
+        }
+        index.emplace(e, id);
+    };
+    // Перебор прекращается, как только членов становится больше max_terms: при большой
+    // степени и многих полях их число растет комбинаторно
+    bool over = false;
+    auto visit = [&](auto& self, int axis, int left) -> void {
+        if (axis == d) {
+            if (left == 0) {
+                over = term_parent.size() >= max_terms;
+                if (!over) add_term();
+            }
+            return;
+        }
+        for (int k = std::min(left / axis_weights[axis], axis_caps[axis]); k >= 0 && !over; --k) {
+            e[axis] = static_cast<std::uint8_t>(k);
+            self(self, axis + 1, left - k * axis_weights[axis]);
+        }
+        e[axis] = 0;
+    };
+    for (int level = 0; level <= degree && !over; ++level) {
+        visit(visit, 0, level);
+        degree_end[level] = term_parent.size();
+    }
+    return !over;
+}
+
+void Surrogate::term_values(const Parameters& params, double* values, std::size_t count) const {
+    // T_k(u) по каждому полю, u в [-1, 1] на боксе
+    double table[kN][kSurrogateMaxDegree + 1];
+    for (std::size_t a = 0; a < axes.size(); ++a) {
+        int field = axes[a];
+        double lo = scenario_parameter(bounds.low, field), hi = scenario_parameter(bounds.high, field);
+        double u = 2.0 * (scenario_parameter(params, field) - lo) / (hi - lo) - 1.0;
+        table[a][0] = 1.0;
+        if (axis_caps[a] > 0) table[a][1] = u;
+        for (int k = 2; k <= axis_caps[a]; ++k) {
+            table[a][k] = 2.0 * u * table[a][k - 1] - table[a][k - 2];
+        }
+    }
+    values[0] = 1.0;
+    for (std::size_t t = 1; t < count; ++t) {
+        values[t] = values[term_parent[t]] * table[term_axis[t]][term_power[t]];
+    }
+}
+
+bool Surrogate::contains(const Parameters& params) const {
+    for (int i = 0; i < kN; ++i) {
+        double lo = scenario_parameter(bounds.low, i), hi = scenario_parameter(bounds.high, i);
+        double value = scenario_parameter(params, i);
+        double slack = 1e-9 * std::max({ 1.0, std::abs(lo), std::abs(hi) });
+        if (value < lo - slack || value > std::max(lo, hi) + slack) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double Surrogate::evaluate(const Parameters& params, SweepMetric metric) const {
+    const std::vector<double>& c = fits[static_cast<int>(metric)].coefficients;
+    double values[1024];
+    std::vector<double> heap;
+    double* terms = values;
+    if (c.size() > 1024) {
+        heap.resize(c.size());
+        terms = heap.data();
+    }
+    term_values(params, terms, c.size());
+    return dot(c.data(), terms, c.size());
+}
+
+void Surrogate::evaluate_all(const Parameters& params, double out[kSweepMetricCount]) const {
+    std::size_t count = 0;
+    for (const SurrogateFit& fit : fits) count = std::max(count, fit.coefficients.size());
+    double values[1024];
+    std::vector<double> heap;
+    double* terms = values;
+    if (count > 1024) {
+        heap.resize(count);
+        terms = heap.data();
+    }
+    term_values(params, terms, count);
+    for (int m = 0; m < kM; ++m) {
+        out[m] = dot(fits[m].coefficients.data(), terms, fits[m].coefficients.size());
+    }
+}
+
+Surrogate build_surrogate(const SurrogateBox& box, const SurrogateOptions& options, SurrogateReport* report) {
+    SurrogateReport localReport;
+    SurrogateReport& r = report ? *report : localReport;
+    r = SurrogateReport();
+
+    Surrogate surrogate;
+    surrogate.bounds = box;
+    surrogate.dt = options.dt;
+    for (int i = 0; i < kN; ++i) {
+        if (scenario_parameter(box.high, i) > scenario_parameter(box.low, i)) {
+            surrogate.axes.push_back(i);
+            surrogate.axis_caps.push_back(std::clamp(options.max_axis_degree[i], 0, kSurrogateMaxDegree));
+            surrogate.axis_weights.push_back(std::clamp(options.axis_weight[i], 1, kSurrogateMaxDegree));
+        } else {
+            scenario_parameter(surrogate.bounds.high, i) = scenario_parameter(box.low, i);
+        }
+    }
+    int d = surrogate.dimensions();
+    int folds = std::max(options.folds, 2);
+    std::size_t n = options.samples;
+    if (n < static_cast<std::size_t>(2 * folds)) {
+        return surrogate;
+    }
+
+    // Латинский гиперкуб: по каждому полю n слоев в случайном порядке, точка - случайная внутри слоя
+    auto started = std::chrono::steady_clock::now();
+    std::vector<Parameters> points(n, surrogate.bounds.low);
+    std::vector<std::size_t> order(n);
+    for (int a = 0; a < d; ++a) {
+        int field = surrogate.axes[a];
+        for (std::size_t i = 0; i < n; ++i) order[i] = i;
+        for (std::size_t i = n - 1; i > 0; --i) {
+            std::size_t j = splitmix(options.seed ^ splitmix(static_cast<std::uint64_t>(a) << 40 ^ i)) % (i + 1);
+            std::swap(order[i], order[j]);
+        }
+        double lo = scenario_parameter(box.low, field), hi = scenario_parameter(box.high, field);
+        for (std::size_t i = 0; i < n; ++i) {
+            double jitter = unit(splitmix(~options.seed ^ splitmix(static_cast<std::uint64_t>(a) << 40 ^ i)));
+            scenario_parameter(points[i], field) = lo + (hi - lo) * (static_cast<double>(order[i]) + jitter) / static_cast<double>(n);
+        }
+    }
+
+    std::vector<FlightSummary> flights(n);
+    parallel_for(n, 1, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t i = begin; i < end; ++i) {
+            flights[i] = smooth_flight_summary(points[i], options.dt, options.max_points);
+        }
+    });
+    r.flights = n;
+
+    std::vector<Parameters> used;
+    std::vector<double> y;
+    for (std::size_t i = 0; i < n; ++i) {
+        double metrics[kM];
+        bool finite = true;
+        for (int m = 0; m < kM; ++m) {
+            metrics[m] = sweep_metric(flights[i], points[i], static_cast<SweepMetric>(m));
+            finite = finite && std::isfinite(metrics[m]);
+        }
+        if (finite) {
+            used.push_back(points[i]);
+            y.insert(y.end(), metrics, metrics + kM);
+        }
+    }
+    r.used = used.size();
+    auto sampled = std::chrono::steady_clock::now();
+    r.flight_seconds = std::chrono::duration<double>(sampled - started).count();
+    if (used.size() < static_cast<std::size_t>(2 * folds)) {
+        return surrogate;
+    }
+
+    // Наибольшая степень: членов не больше max_terms и половины обучающей части выборки
+    // (или уже все произведения до степеней полей)
+    std::size_t train = used.size() * (folds - 1) / folds;
+    std::size_t term_limit = std::min(options.max_terms, train / 2);
+    std::size_t tensor = 1;
+    for (int cap : surrogate.axis_caps) tensor *= static_cast<std::size_t>(cap + 1);
+    int top = 0;
+    for (int p = 1; p <= std::min(options.max_degree, kMaxLevel); ++p) {
+        if (!surrogate.build_terms(p, term_limit)) {
+            break;
+        }
+        top = p;
+        if (surrogate.term_parent.size() == tensor) {
+            break;
+        }
+    }
+    surrogate.build_terms(top, term_limit);
+    std::size_t terms = surrogate.term_parent.size();
+
+    // Матрица членов и суммы A^T A, A^T y отдельно по частям перекрестной проверки
+    std::size_t rows = used.size();
+    std::vector<double> basis(rows * terms);
+    parallel_for(rows, 256, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t i = begin; i < end; ++i) {
+            surrogate.term_values(used[i], basis.data() + i * terms, terms);
+        }
+    });
+    std::vector<std::vector<double>> gram(folds, std::vector<double>(terms * terms, 0.0));
+    std::vector<std::vector<double>> moment(folds, std::vector<double>(terms * kM, 0.0));
+    parallel_for(folds, 1, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t f = begin; f < end; ++f) {
+            for (std::size_t i = f; i < rows; i += folds) {
+                const double* row = basis.data() + i * terms;
+                for (std::size_t a = 0; a < terms; ++a) {
+                    double* g = gram[f].data() + a * terms;
+                    for (std::size_t b = 0; b <= a; ++b) g[b] += row[a] * row[b];
+                    for (int m = 0; m < kM; ++m) moment[f][a * kM + m] += row[a] * y[i * kM + m];
+                }
+            }
+        }
+    });
+    std::vector<double> gram_all(terms * terms, 0.0), moment_all(terms * kM, 0.0);
+    for (int f = 0; f < folds; ++f) {
+        for (std::size_t k = 0; k < gram_all.size(); ++k) gram_all[k] += gram[f][k];
+        for (std::size_t k = 0; k < moment_all.size(); ++k) moment_all[k] += moment[f][k];
+    }
+
+    // Ошибка на отложенной части для каждой степени: обучение на остальных частях
+    std::vector<double> sq((top + 1) * folds * kM, 0.0), worst((top + 1) * folds * kM, 0.0);
+    std::vector<char> solved((top + 1) * folds, 0);
+    parallel_for(static_cast<std::size_t>(top + 1) * folds, 1, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<double> a, b;
+        for (std::size_t job = begin; job < end; ++job) {
+            std::size_t p = job / folds, f = job % folds;
+            std::size_t m = surrogate.degree_end[p];
+            a.assign(m * m, 0.0);
+            b.assign(m * kM, 0.0);
+            for (std::size_t i = 0; i < m; ++i) {
+                for (std::size_t j = 0; j <= i; ++j) {
+                    a[i * m + j] = a[j * m + i] = gram_all[i * terms + j] - gram[f][i * terms + j];
+                }
+                for (int c = 0; c < kM; ++c) b[i * kM + c] = moment_all[i * kM + c] - moment[f][i * kM + c];
+            }
+            if (!solve_spd(a, m, m, b, kM)) {
+                continue;
+            }
+            solved[job] = 1;
+            for (std::size_t i = f; i < rows; i += folds) {
+                const double* row = basis.data() + i * terms;
+                for (int c = 0; c < kM; ++c) {
+                    double predicted = 0.0;
+                    for (std::size_t t = 0; t < m; ++t) predicted += b[t * kM + c] * row[t];
+                    double error = std::abs(predicted - y[i * kM + c]);
+                    sq[job * kM + c] += error * error;
+                    worst[job * kM + c] = std::max(worst[job * kM + c], error);
+                }
+            }
+        }
+    });
+
+    // Для каждой величины - степень с наименьшей ошибкой перекрестной проверки
+    for (int c = 0; c < kM; ++c) {
+        double best = std::numeric_limits<double>::max();
+        for (int p = 0; p <= top; ++p) {
+            double total = 0.0, largest = 0.0;
+            bool complete = true;
+            for (int f = 0; f < folds; ++f) {
+                std::size_t job = static_cast<std::size_t>(p) * folds + f;
+                complete = complete && solved[job];
+                total += sq[job * kM + c];
+                largest = std::max(largest, worst[job * kM + c]);
+            }
+            double rms = std::sqrt(total / static_cast<double>(rows));
+            if (complete && rms < best) {
+                best = rms;
+                surrogate.fits[c].degree = p;
+                surrogate.fits[c].cv_rms = rms;
+                surrogate.fits[c].cv_max = largest;
+            }
+        }
+        std::size_t m = surrogate.degree_end[surrogate.fits[c].degree];
+        std::vector<double> a(m * m), b(m);
+        for (std::size_t i = 0; i < m; ++i) {
+            for (std::size_t j = 0; j <= i; ++j) a[i * m + j] = a[j * m + i] = gram_all[i * terms + j];
+            b[i] = moment_all[i * kM + c];
+        }
+        if (!solve_spd(a, m, m, b, 1)) {
+            return surrogate;
+        }
+        surrogate.fits[c].coefficients = std::move(b);
+    }
+    surrogate.samples = rows;
+    surrogate.fitted = true;
+    r.fit_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sampled).count();
+    return surrogate;
+}
+
+bool Surrogate::save(const std::string& path, std::string* error) const {
+    auto fail = [error](const std::string& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    if (!fitted) {
+        return fail("Суррогат не построен.");
+    }
+
+    SurrogateFileHeader header{};
+    std::memcpy(header.magic, "SURR", 4);
+    header.version = kSurrogateFormatVersion;
+    header.samples = static_cast<std::uint32_t>(samples);
+    header.dt = dt;
+    for (int i = 0; i < kN; ++i) {
+        header.low[i] = scenario_parameter(bounds.low, i);
+        header.high[i] = scenario_parameter(bounds.high, i);
+    }
+    for (std::size_t a = 0; a < axes.size(); ++a) {
+        header.axis_degree[axes[a]] = axis_caps[a];
+        header.axis_weight[axes[a]] = axis_weights[a];
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return fail("Не удалось создать файл суррогата.");
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const SurrogateFit& fit : fits) {
+        std::int32_t degree = fit.degree;
+        std::uint32_t count = static_cast<std::uint32_t>(fit.coefficients.size());
+        out.write(reinterpret_cast<const char*>(&degree), sizeof(degree));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(&fit.cv_rms), sizeof(double));
+        out.write(reinterpret_cast<const char*>(&fit.cv_max), sizeof(double));
+        out.write(reinterpret_cast<const char*>(fit.coefficients.data()), std::streamsize(count * sizeof(double)));
+    }
+    if (!out) {
+        return fail("Ошибка записи файла суррогата.");
+    }
+    return true;
+}
+
+bool Surrogate::load(const std::string& path, Surrogate& surrogate, std::string* error) {
+    auto fail = [error](const std::string& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return fail("Не удалось открыть файл суррогата.");
+    }
+    SurrogateFileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "SURR", 4) != 0) {
+        return fail("Файл не является суррогатной моделью.");
+    }
+    if (header.version != kSurrogateFormatVersion) {
+        return fail("Суррогат построен другой версией модели полета; постройте его заново.");
+    }
+
+    Surrogate loaded;
+    loaded.samples = header.samples;
+    loaded.dt = header.dt;
+    for (int i = 0; i < kN; ++i) {
+        scenario_parameter(loaded.bounds.low, i) = header.low[i];
+        scenario_parameter(loaded.bounds.high, i) = std::max(header.low[i], header.high[i]);
+        if (header.high[i] > header.low[i]) {
+            if (header.axis_degree[i] < 0 || header.axis_degree[i] > kSurrogateMaxDegree
+                || header.axis_weight[i] < 1 || header.axis_weight[i] > kSurrogateMaxDegree) {
+                return fail("Поврежден заголовок файла суррогата.");
+            }
+            loaded.axes.push_back(i);
+            loaded.axis_caps.push_back(header.axis_degree[i]);
+            loaded.axis_weights.push_back(header.axis_weight[i]);
+        }
+    }
+
+    int top = 0;
+    std::size_t most = 0;
+    for (SurrogateFit& fit : loaded.fits) {
+        std::int32_t degree = 0;
+        std::uint32_t count = 0;
+        in.read(reinterpret_cast<char*>(&degree), sizeof(degree));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        in.read(reinterpret_cast<char*>(&fit.cv_rms), sizeof(double));
+        in.read(reinterpret_cast<char*>(&fit.cv_max), sizeof(double));
+        if (!in || degree < 0 || degree > kMaxLevel || count > (1u << 20)) {
+            return fail("Файл суррогата обрезан или поврежден.");
+        }
+        fit.degree = degree;
+        fit.coefficients.resize(count);
+        if (!in.read(reinterpret_cast<char*>(fit.coefficients.data()), std::streamsize(count * sizeof(double)))) {
+            return fail("Файл суррогата обрезан или поврежден.");
+        }
+        top = std::max(top, degree);
+        most = std::max<std::size_t>(most, count);
+    }
+    // Члены восстанавливаются по степеням; число коэффициентов должно с ними совпасть.
+    // Членов не может быть больше коэффициентов, поэтому перебор ограничен их числом
+    if (!loaded.build_terms(top, most)) {
+        return fail("Число коэффициентов суррогата не совпадает со степенью.");
+    }
+    for (const SurrogateFit& fit : loaded.fits) {
+        if (fit.coefficients.size() != loaded.degree_end[fit.degree]) {
+            return fail("Число коэффициентов суррогата не совпадает со степенью.");
+        }
+    }
+    loaded.fitted = true;
+    surrogate = std::move(loaded);
+    return true;
+}
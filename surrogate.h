@@ -0,0 +1,104 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include "sweepstore.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Суррогатная модель итогов полета: многочлены Чебышева от полей Parameters внутри
+// заданного бокса, по одному на каждую величину sweep_metric. Выборка - латинский
+// гиперкуб по боксу, полеты считаются параллельно (smooth_flight_summary: гладкие
+// итоги нужны для аппроксимации), степень каждой величины выбирается k-кратной
+// перекрестной проверкой, она же дает оценку ошибки. Вычисление - микросекунды вместо
+// интегрирования (495 членов в 9 полях: около 4 мкс на все пять величин, 2.5 мкс на одну).
+// Модель строится для плоской земли без поля ветра.
+
+// Увеличивать вместе с kResultCacheModelVersion: файл хранит коэффициенты, а не полеты
+constexpr int kSurrogateFormatVersion = 1;
+constexpr int kSurrogateMaxDegree = 16;
+
+// Бокс: поле варьируется, если high > low, иначе фиксировано значением low
+struct SurrogateBox {
+    Parameters low{};
+    Parameters high{};
+};
+
+struct SurrogateOptions {
+    std::size_t samples = 1500;
+    // Члены с взвешенной степенью sum(weight * e) не больше max_degree. Вес 2 у поля с узким
+    // диапазоном оставляет степени для широкого поля с весом 1 при том же числе членов
+    int max_degree = 10;
+    int max_axis_degree[10] = { 10, 10, 10, 10, 10, 10, 10, 10, 10, 10 }; // степень по каждому полю
+    int axis_weight[10] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    std::size_t max_terms = 500;   // ограничение числа членов (и размера системы)
+    int folds = 5;                 // k перекрестной проверки
+    std::uint64_t seed = 1;
+    double dt = 0.01;
+    std::size_t max_points = 100000;
+    int threads = 0;               // 0 - по числу ядер
+};
+
+// Многочлен одной величины и ошибка на отложенных при перекрестной проверке точках
+struct SurrogateFit {
+    int degree = 0;                   // взвешенная степень
+    std::vector<double> coefficients; // по членам в порядке возрастания взвешенной степени
+    double cv_rms = 0.0;              // среднеквадратичная ошибка, в единицах величины
+    double cv_max = 0.0;              // наибольшая ошибка
+};
+
+struct SurrogateReport {
+    std::size_t flights = 0;     // посчитано полетов
+    std::size_t used = 0;        // из них с конечными итогами
+    double flight_seconds = 0.0; // выборка
+    double fit_seconds = 0.0;    // подбор степени и коэффициентов
+};
+
+class Surrogate {
+public:
+    bool valid() const { return fitted; }
+    const SurrogateBox& box() const { return bounds; }
+    const SurrogateFit& fit(SweepMetric metric) const { return fits[static_cast<int>(metric)]; }
+    std::size_t sample_count() const { return samples; }
+    int dimensions() const { return static_cast<int>(axes.size()); }
+
+    // Точка внутри бокса; фиксированные поля должны совпадать с точностью 1e-9 от значения
+    bool contains(const Parameters& params) const;
+    // Значение величины; вне бокса - экстраполяция без гарантий ошибки
+    double evaluate(const Parameters& params, SweepMetric metric) const;
+    void evaluate_all(const Parameters& params, double out[kSweepMetricCount]) const;
+
+    // Бинарный файл: заголовок, затем степени, ошибки и коэффициенты по величинам
+    bool save(const std::string& path, std::string* error = nullptr) const;
+    static bool load(const std::string& path, Surrogate& surrogate, std::string* error = nullptr);
+
+private:
+    friend Surrogate build_surrogate(const SurrogateBox& box, const SurrogateOptions& options, SurrogateReport* report);
+
+    // Члены взвешенной степени не выше degree с ограничениями по полям, по возрастанию степени.
+    // Член - произведение T_e(u) по полям; он же - член-родитель, умноженный на один множитель.
+    // false - членов больше max_terms (перебор прерван, таблица неполная)
+    bool build_terms(int degree, std::size_t max_terms);
+    // Значения первых count членов в точке: одно умножение на член
+    void term_values(const Parameters& params, double* values, std::size_t count) const;
+
+    SurrogateBox bounds;
+    std::vector<int> axes;       // номера варьируемых полей
+    std::vector<int> axis_caps;  // наибольшая степень по каждому из них
+    std::vector<int> axis_weights;
+    int max_degree = 0;
+    std::vector<std::size_t> degree_end; // число членов взвешенной степени не выше p
+    std::vector<std::uint32_t> term_parent; // член без последнего ненулевого множителя
+    std::vector<std::uint8_t> term_axis;    // номер в axes этого множителя
+    std::vector<std::uint8_t> term_power;   // и его степень (0 - свободный член)
+    std::array<SurrogateFit, kSweepMetricCount> fits{};
+    std::size_t samples = 0;
+    double dt = 0.01;
+    bool fitted = false;
+};
+
+Surrogate build_surrogate(const SurrogateBox& box, const SurrogateOptions& options = {}, SurrogateReport* report = nullptr);
+
+#endif // SURROGATE_H
@@ -0,0 +1,154 @@
+#include "sweepplanner.h"
+#include "terrain.h"
+#include "windfield.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr double kDegToModelRad = 3.14 / 180.0; // как в initial_state
+constexpr int kKeyBits = 40;
+constexpr double kWindFloor = 1e-12; // остаток поворота нулевой составляющей ветра, м/с
+
+double quantize(double value) {
+    if (value == 0.0 || !std::isfinite(value)) {
+        return value == 0.0 ? 0.0 : value; // -0 и +0 - один ключ
+    }
+    int exponent = 0;
+    double mantissa = std::frexp(value, &exponent);
+    return std::ldexp(std::round(std::ldexp(mantissa, kKeyBits)), exponent - kKeyBits);
+}
+
+double quantize_wind(double value) {
+    return std::abs(value) < kWindFloor ? 0.0 : quantize(value);
+}
+
+} // namespace
+
+bool CanonicalFlight::operator==(const CanonicalFlight& other) const {
+    return k == other.k && g == other.g && speed == other.speed && angle == other.angle
+           && wind_along == other.wind_along && wind_across == other.wind_across && azimuth == other.azimuth;
+}
+
+CanonicalFlight canonical_flight(const Parameters& params, bool rotational) {
+    CanonicalFlight flight;
+    flight.k = quantize(drag_factor(params));
+    flight.g = quantize(params.g);
+    flight.speed = quantize(params.initial_speed);
+    flight.angle = quantize(params.angle_deg);
+    if (rotational) {
+        // Ветер в системе выстрела: поворот на -азимут
+        double azimuth = params.azimuth_deg * kDegToModelRad;
+        double c = std::cos(azimuth), s = std::sin(azimuth);
+        flight.wind_along = quantize_wind(params.wind_x * c + params.wind_z * s);
+        flight.wind_across = quantize_wind(params.wind_z * c - params.wind_x * s);
+    } else {
+        flight.wind_along = quantize(params.wind_x);
+        flight.wind_across = quantize(params.wind_z);
+        flight.azimuth = quantize(params.azimuth_deg);
+    }
+    return flight;
+}
+
+FlightSummary rotate_summary(const FlightSummary& summary, double rotation) {
+    FlightSummary rotated = summary;
+    double c = std::cos(rotation), s = std::sin(rotation);
+    rotated.impact_x = summary.impact_x * c - summary.impact_z * s;
+    rotated.impact_z = summary.impact_x * s + summary.impact_z * c;
+    return rotated;
+}
+
+std::size_t SweepPlanner::FlightHash::operator()(const CanonicalFlight& flight) const {
+    const double fields[] = { flight.k, flight.g, flight.speed, flight.angle,
+                              flight.wind_along, flight.wind_across, flight.azimuth };
+    std::uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (double field : fields) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &field, sizeof(bits));
+        h = (h ^ bits) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    }
+    return static_cast<std::size_t>(h);
+}
+
+SweepPlanner::SweepPlanner(std::size_t max_flights) : capacity(max_flights) {
+}
+
+void SweepPlanner::clear() {
+    known.clear();
+}
+
+bool SweepPlanner::same_context(const BatchOptions& options, std::uint64_t environment) const {
+    return environment == context_environment && options.dt == context_options.dt
+           && options.max_points == context_options.max_points
+           && options.single_precision == context_options.single_precision
+           && (!options.single_precision
+               || (options.tolerance == context_options.tolerance && options.verify_every == context_options.verify_every
+                   && options.auto_escalate == context_options.auto_escalate));
+}
+
+std::vector<FlightSummary> SweepPlanner::evaluate(const std::vector<Parameters>& params, const BatchOptions& options,
+                                                  std::uint64_t environment, const Evaluator& evaluate,
+                                                  SweepPlanReport* report) {
+    if (!same_context(options, environment)) {
+        known.clear();
+        context_options = options;
+        context_environment = environment;
+    }
+    bool rotational = !active_terrain() && !active_wind_field();
+
+    // Первая точка каждого нового вида идет на расчет, остальные ссылаются на нее
+    std::vector<FlightSummary> results(params.size());
+    std::vector<Parameters> fresh;
+    std::unordered_map<CanonicalFlight, std::size_t, FlightHash> pending;
+    std::vector<std::size_t> source(params.size(), params.size());
+    SweepPlanReport local;
+    local.requested = params.size();
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        CanonicalFlight key = canonical_flight(params[i], rotational);
+        auto stored = known.find(key);
+        if (stored != known.end()) {
+            double rotation = rotational ? (params[i].azimuth_deg - stored->second.azimuth_deg) * kDegToModelRad : 0.0;
+            results[i] = rotation != 0.0 ? rotate_summary(stored->second.summary, rotation) : stored->second.summary;
+            ++local.reused;
+            continue;
+        }
+        auto [slot, added] = pending.emplace(key, fresh.size());
+        if (added) {
+            fresh.push_back(params[i]);
+        } else {
+            ++local.merged;
+        }
+        source[i] = slot->second;
+    }
+    local.flights = fresh.size();
+
+    std::vector<FlightSummary> computed;
+    if (!fresh.empty()) {
+        computed = evaluate(fresh);
+        if (known.size() + fresh.size() > capacity) {
+            known.clear();
+        }
+        if (fresh.size() <= capacity) {
+            for (const auto& [key, j] : pending) {
+                known[key] = KnownFlight{ computed[j], fresh[j].azimuth_deg };
+            }
+        }
+    }
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (source[i] == params.size()) {
+            continue;
+        }
+        const Parameters& first = fresh[source[i]];
+        double rotation = rotational ? (params[i].azimuth_deg - first.azimuth_deg) * kDegToModelRad : 0.0;
+        results[i] = rotation != 0.0 ? rotate_summary(computed[source[i]], rotation) : computed[source[i]];
+    }
+
+    if (report) {
+        report->requested += local.requested;
+        report->reused += local.reused;
+        report->merged += local.merged;
+        report->flights += local.flights;
+    }
+    return results;
+}
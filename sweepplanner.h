@@ -0,0 +1,81 @@
+#ifndef SWEEPPLANNER_H
+#define SWEEPPLANNER_H
+
+#include "batch.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Планировщик развертки по инвариантам модели. Масса, Cd, плотность воздуха и радиус
+// входят в уравнения только через k = drag_factor, поэтому полеты с равными k, g,
+// скоростью и углом совпадают. На плоской земле без поля ветра поворот выстрела по
+// азимуту вместе с ветром поворачивает всю траекторию, и полет сводится к азимуту 0
+// с ветром в системе выстрела. Точки пакета приводятся к такому каноническому виду,
+// считается по одному полету на вид, остальные получают его итог с поворотом точки
+// падения. Виды запоминаются между пакетами: развертки по массе, Cd и азимуту при
+// нулевом ветре попадают в одни и те же полеты.
+
+// Канонический вид полета; значения округлены до 40 бит мантиссы (~1e-12 от величины),
+// чтобы k из разных сочетаний массы и Cd совпадали несмотря на ошибки округления
+struct CanonicalFlight {
+    double k = 0.0;
+    double g = 0.0;
+    double speed = 0.0;
+    double angle = 0.0;
+    double wind_along = 0.0;  // ветер вдоль направления выстрела (при повороте) или wind_x
+    double wind_across = 0.0; // поперек направления или wind_z
+    double azimuth = 0.0;     // 0 при повороте, иначе азимут точки
+
+    bool operator==(const CanonicalFlight& other) const;
+};
+
+// rotational - поворот по азимуту допустим (плоская земля без поля ветра)
+CanonicalFlight canonical_flight(const Parameters& params, bool rotational);
+
+// Итог полета с азимутом, повернутым на rotation (рад модели, как в initial_state)
+FlightSummary rotate_summary(const FlightSummary& summary, double rotation);
+
+struct SweepPlanReport {
+    std::size_t requested = 0; // точек в пакетах
+    std::size_t reused = 0;    // итог взят из полетов прошлых пакетов
+    std::size_t merged = 0;    // совпали с другой точкой того же пакета
+    std::size_t flights = 0;   // отдано на расчет
+};
+
+class SweepPlanner {
+public:
+    using Evaluator = std::function<std::vector<FlightSummary>(const std::vector<Parameters>&)>;
+
+    // max_flights - наибольшее число запомненных видов, при переполнении память сбрасывается
+    explicit SweepPlanner(std::size_t max_flights = std::size_t(1) << 16);
+
+    // Итоги точек пакета; evaluate получает только новые виды (по первой точке каждого).
+    // Память действительна для одних настроек расчета и окружения (result_cache_environment),
+    // при их смене сбрасывается. Отчет накапливается
+    std::vector<FlightSummary> evaluate(const std::vector<Parameters>& params, const BatchOptions& options,
+                                        std::uint64_t environment, const Evaluator& evaluate,
+                                        SweepPlanReport* report = nullptr);
+    void clear();
+    std::size_t size() const { return known.size(); }
+
+private:
+    struct FlightHash {
+        std::size_t operator()(const CanonicalFlight& flight) const;
+    };
+    // Итог посчитанной точки и ее азимут: для точек с тем же азимутом итог копируется без поворота
+    struct KnownFlight {
+        FlightSummary summary;
+        double azimuth_deg = 0.0;
+    };
+
+    bool same_context(const BatchOptions& options, std::uint64_t environment) const;
+
+    std::size_t capacity;
+    std::unordered_map<CanonicalFlight, KnownFlight, FlightHash> known;
+    BatchOptions context_options;
+    std::uint64_t context_environment = 0;
+};
+
+#endif // SWEEPPLANNER_H
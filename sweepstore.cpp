@@ -0,0 +1,75 @@
+#include "sweepstore.h"
+#include "scenario.h"
+#include <algorithm>
+
+double sweep_metric(const FlightSummary& summary, const Parameters& params, SweepMetric metric) {
+    switch (metric) {
+        case SweepMetric::Range: return summary.total_distance;
+        case SweepMetric::Apex: return summary.max_height;
+        case SweepMetric::FlightTime: return summary.flight_time;
+        case SweepMetric::ImpactSpeed: return summary.impact_speed;
+        case SweepMetric::LateralDrift: {
+            // Направление выстрела на земле - как у initial_state, и для отвесного выстрела
+            Parameters level = params;
+            level.angle_deg = 0.0;
+            level.initial_speed = 1.0;
+            State direction = initial_state(level);
+            return direction.vx * summary.impact_z - direction.vz * summary.impact_x;
+        }
+    }
+    return 0.0;
+}
+
+bool SweepKey::operator==(const SweepKey& other) const {
+    for (int i = 0; i < kScenarioParameterCount; ++i) {
+        if (scenario_parameter(base, i) != scenario_parameter(other.base, i)) {
+            return false;
+        }
+    }
+    return parameter == other.parameter && from == other.from && to == other.to
+           && adaptive == other.adaptive && single_precision == other.single_precision
+           && (adaptive ? adaptive_tolerance == other.adaptive_tolerance && adaptive_budget == other.adaptive_budget
+                        : step == other.step)
+           && (!single_precision || precision_tolerance == other.precision_tolerance)
+           && terrain == other.terrain && wind_field == other.wind_field && surrogate == other.surrogate;
+}
+
+void SweepRecord::add(double value, const Parameters& params, const FlightSummary& summary) {
+    values.push_back(value);
+    for (int m = 0; m < kSweepMetricCount; ++m) {
+        metrics.push_back(sweep_metric(summary, params, static_cast<SweepMetric>(m)));
+    }
+}
+
+void SweepRecord::add(double value, const double m[kSweepMetricCount]) {
+    values.push_back(value);
+    metrics.insert(metrics.end(), m, m + kSweepMetricCount);
+}
+
+const SweepRecord* SweepStore::find(const SweepKey& key) const {
+    for (const SweepRecord& record : records) {
+        if (record.key == key) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+const SweepRecord* SweepStore::find_parameter(int parameter) const {
+    for (const SweepRecord& record : records) {
+        if (record.key.parameter == parameter) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+void SweepStore::store(SweepRecord&& record) {
+    auto same = std::find_if(records.begin(), records.end(),
+                             [&](const SweepRecord& r) { return r.key.parameter == record.key.parameter; });
+    if (same != records.end()) {
+        *same = std::move(record);
+    } else {
+        records.push_back(std::move(record));
+    }
+}
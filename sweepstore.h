@@ -0,0 +1,66 @@
+#ifndef SWEEPSTORE_H
+#define SWEEPSTORE_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class Heightmap;
+class WindField;
+
+// Величины графика зависимости. Развертка записывает в каждой точке сразу все,
+// поэтому смена величины перерисовывает график из сохраненных данных без расчета
+enum class SweepMetric {
+    Range = 0,    // дальность, м
+    Apex,         // наибольшая высота, м
+    FlightTime,   // время полета, с
+    ImpactSpeed,  // скорость в точке падения, м/с
+    LateralDrift, // смещение точки падения поперек направления выстрела, м (+ - в сторону оси z при азимуте 0)
+};
+constexpr int kSweepMetricCount = 5;
+
+double sweep_metric(const FlightSummary& summary, const Parameters& params, SweepMetric metric);
+
+// Все, от чего зависят точки развертки (величина графика сюда не входит)
+struct SweepKey {
+    Parameters base{};
+    int parameter = 0; // группа графика: скорость, угол, масса, Cd, плотность, радиус, ветер X, ветер Z, азимут
+    double from = 0.0, to = 0.0, step = 0.0;
+    bool adaptive = false;
+    double adaptive_tolerance = 0.0;
+    std::size_t adaptive_budget = 0;
+    bool single_precision = false;
+    double precision_tolerance = 0.0;
+    std::shared_ptr<const Heightmap> terrain;
+    std::shared_ptr<const WindField> wind_field;
+    bool surrogate = false; // точки - значения суррогатной модели, а не полеты
+
+    bool operator==(const SweepKey& other) const;
+};
+
+// Точки одной развертки: значение параметра и все величины в нем
+struct SweepRecord {
+    SweepKey key;
+    std::vector<double> values;
+    std::vector<double> metrics; // kSweepMetricCount величин на точку подряд
+
+    std::size_t size() const { return values.size(); }
+    void add(double value, const Parameters& params, const FlightSummary& summary);
+    void add(double value, const double metrics[kSweepMetricCount]);
+    double metric(std::size_t i, SweepMetric m) const { return metrics[i * kSweepMetricCount + static_cast<int>(m)]; }
+};
+
+// Последняя развертка по каждому параметру
+class SweepStore {
+public:
+    const SweepRecord* find(const SweepKey& key) const;
+    const SweepRecord* find_parameter(int parameter) const;
+    void store(SweepRecord&& record); // заменяет развертку того же параметра
+    void clear() { records.clear(); }
+
+private:
+    std::vector<SweepRecord> records;
+};
+
+#endif // SWEEPSTORE_H
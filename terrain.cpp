@@ -0,0 +1,394 @@
+#include "terrain.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+
+namespace {
+
+// Допуск касания поверхности: точка выстрела лежит на рельефе с точностью округления float
+constexpr double kSurfaceTolerance = 1e-3;
+// Наибольшее число узлов сетки: с пирамидой min/max около 2.5 ГБ
+constexpr std::size_t kMaxNodes = std::size_t(1) << 27;
+
+std::mutex g_terrainMutex;
+std::shared_ptr<const Heightmap> g_activeTerrain;
+
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+// Ключи заголовка ESRI grid; возвращает первый токен после заголовка (начало данных)
+bool read_grid_header(std::istream& in, std::map<std::string, double>& header, std::string& first_value) {
+    std::string token;
+    while (in >> token) {
+        if (std::isalpha(static_cast<unsigned char>(token[0]))) {
+            double value = 0.0;
+            if (!(in >> value)) {
+                return false;
+            }
+            header[lower(token)] = value;
+        } else {
+            first_value = token;
+            return true;
+        }
+    }
+    return true; // Заголовок без данных (файл .hdr)
+}
+
+} // namespace
+
+std::shared_ptr<Heightmap> Heightmap::load(const std::string& path, std::string* error) {
+    auto fail = [error](const std::string& message) -> std::shared_ptr<Heightmap> {
+        if (error) {
+            *error = message;
+        }
+        return nullptr;
+    };
+
+    std::string extension = lower(path.substr(path.find_last_of('.') == std::string::npos ? path.size() : path.find_last_of('.')));
+    bool raw = extension == ".raw" || extension == ".bin";
+
+    std::map<std::string, double> header;
+    std::string first_value;
+    std::ifstream text(raw ? path.substr(0, path.size() - extension.size()) + ".hdr" : path);
+    if (!text || !read_grid_header(text, header, first_value)) {
+        return fail("Не удалось прочитать заголовок сетки высот.");
+    }
+    if (!header.count("ncols") || !header.count("nrows") || !header.count("cellsize")) {
+        return fail("В заголовке нет ncols, nrows или cellsize.");
+    }
+
+    // Размеры проверяются до выделения памяти: заголовок может обещать сколько угодно узлов
+    double ncols = header["ncols"], nrows = header["nrows"], cellsize = header["cellsize"];
+    if (!(ncols >= 2.0) || !(nrows >= 2.0) || !std::isfinite(cellsize) || !(cellsize > 0.0)) {
+        return fail("Сетка высот должна быть не меньше 2x2 с положительным шагом.");
+    }
+    if (ncols > std::numeric_limits<int>::max() || nrows > std::numeric_limits<int>::max()
+        || std::floor(ncols) * std::floor(nrows) > static_cast<double>(kMaxNodes)) {
+        return fail("Сетка высот больше " + std::to_string(kMaxNodes) + " узлов.");
+    }
+
+    auto map = std::make_shared<Heightmap>();
+    map->source_path = path;
+    map->columns = static_cast<int>(ncols);
+    map->row_count = static_cast<int>(nrows);
+    map->cell = cellsize;
+    // Угол сетки задает край ячейки, центр - сам узел
+    map->origin_x = header.count("xllcenter") ? header["xllcenter"] : header["xllcorner"] + 0.5 * map->cell;
+    map->origin_z = header.count("yllcenter") ? header["yllcenter"] : header["yllcorner"] + 0.5 * map->cell;
+    double nodata = header.count("nodata_value") ? header["nodata_value"] : -9999.0;
+
+    std::size_t count = static_cast<std::size_t>(map->columns) * map->row_count;
+    std::ifstream data;
+    if (raw) {
+        data.open(path, std::ios::binary | std::ios::ate);
+        if (!data || static_cast<std::uint64_t>(std::max<std::streamoff>(data.tellg(), 0)) < count * sizeof(float)) {
+            return fail("Размер файла меньше ncols * nrows значений float32.");
+        }
+        data.seekg(0);
+    } else {
+        // На каждое значение после первого нужны хотя бы цифра и разделитель
+        std::streamoff position = first_value.empty() ? -1 : static_cast<std::streamoff>(text.tellg());
+        std::streamoff remaining = 0;
+        if (position >= 0 && text.seekg(0, std::ios::end)) {
+            remaining = static_cast<std::streamoff>(text.tellg()) - position;
+            text.seekg(position);
+        }
+        if (first_value.empty() || static_cast<std::uint64_t>(remaining) < 2 * (static_cast<std::uint64_t>(count) - 1)) {
+            return fail("В файле меньше ncols * nrows значений высоты.");
+        }
+    }
+
+    auto out_of_memory = [&]() {
+        return fail("Недостаточно памяти для сетки высот " + std::to_string(map->columns) + "x" + std::to_string(map->row_count) + ".");
+    };
+    std::vector<float> file_rows;
+    try {
+        file_rows.resize(count);
+        map->heights.resize(count);
+    } catch (const std::bad_alloc&) {
+        return out_of_memory();
+    }
+    if (raw) {
+        if (!data.read(reinterpret_cast<char*>(file_rows.data()), static_cast<std::streamsize>(count * sizeof(float)))) {
+            return fail("Размер файла меньше ncols * nrows значений float32.");
+        }
+    } else {
+        // Токен целиком должен быть числом; from_chars не бросает исключений и не принимает '+'
+        const char* begin = first_value.data() + (first_value[0] == '+' ? 1 : 0);
+        const char* end = first_value.data() + first_value.size();
+        auto [stop, code] = std::from_chars(begin, end, file_rows[0]);
+        if (code != std::errc() || stop != end) {
+            return fail("Первое значение высоты после заголовка не является числом.");
+        }
+        std::size_t index = 1;
+        while (index < count && text >> file_rows[index]) {
+            ++index;
+        }
+        if (index < count) {
+            return fail("В файле меньше ncols * nrows значений высоты.");
+        }
+    }
+
+    // В файле первая строка - северный край; в памяти строка j растет вместе с Z
+    for (int r = 0; r < map->row_count; ++r) {
+        int j = map->row_count - 1 - r;
+        for (int i = 0; i < map->columns; ++i) {
+            float h = file_rows[static_cast<std::size_t>(r) * map->columns + i];
+            map->heights[static_cast<std::size_t>(j) * map->columns + i] = (h == nodata || !std::isfinite(h)) ? 0.0f : h;
+        }
+    }
+
+    try {
+        map->build_pyramid();
+    } catch (const std::bad_alloc&) {
+        return out_of_memory();
+    }
+    return map;
+}
+
+void Heightmap::rebase_to_origin() {
+    float base = static_cast<float>(height_at(0.0, 0.0));
+    for (float& h : heights) {
+        h -= base;
+    }
+    // Сдвиг на константу сохраняет порядок высот: пирамида сдвигается на месте, без новых выделений
+    for (std::size_t level = 0; level < min_levels.size(); ++level) {
+        for (float& h : min_levels[level]) {
+            h -= base;
+        }
+        for (float& h : max_levels[level]) {
+            h -= base;
+        }
+    }
+}
+
+void Heightmap::build_pyramid() {
+    level_cols.assign(1, columns - 1);
+    level_rows.assign(1, row_count - 1);
+    min_levels.assign(1, std::vector<float>(static_cast<std::size_t>(columns - 1) * (row_count - 1)));
+    max_levels.assign(1, std::vector<float>(min_levels[0].size()));
+
+    for (int j = 0; j < row_count - 1; ++j) {
+        for (int i = 0; i < columns - 1; ++i) {
+            float h00 = heights[static_cast<std::size_t>(j) * columns + i];
+            float h10 = heights[static_cast<std::size_t>(j) * columns + i + 1];
+            float h01 = heights[static_cast<std::size_t>(j + 1) * columns + i];
+            float h11 = heights[static_cast<std::size_t>(j + 1) * columns + i + 1];
+            // Билинейная ячейка лежит между минимумом и максимумом своих углов
+            min_levels[0][static_cast<std::size_t>(j) * (columns - 1) + i] = std::min({ h00, h10, h01, h11 });
+            max_levels[0][static_cast<std::size_t>(j) * (columns - 1) + i] = std::max({ h00, h10, h01, h11 });
+        }
+    }
+
+    while (level_cols.back() > 1 || level_rows.back() > 1) {
+        int pc = level_cols.back(), pr = level_rows.back();
+        int nc = (pc + 1) / 2, nr = (pr + 1) / 2;
+        const std::vector<float>& pmin = min_levels.back();
+        const std::vector<float>& pmax = max_levels.back();
+        std::vector<float> nmin(static_cast<std::size_t>(nc) * nr, std::numeric_limits<float>::max());
+        std::vector<float> nmax(nmin.size(), std::numeric_limits<float>::lowest());
+        for (int j = 0; j < pr; ++j) {
+            for (int i = 0; i < pc; ++i) {
+                std::size_t parent = static_cast<std::size_t>(j / 2) * nc + i / 2;
+                nmin[parent] = std::min(nmin[parent], pmin[static_cast<std::size_t>(j) * pc + i]);
+                nmax[parent] = std::max(nmax[parent], pmax[static_cast<std::size_t>(j) * pc + i]);
+            }
+        }
+        level_cols.push_back(nc);
+        level_rows.push_back(nr);
+        min_levels.push_back(std::move(nmin));
+        max_levels.push_back(std::move(nmax));
+    }
+}
+
+bool Heightmap::contains(double x, double z) const {
+    return x >= node_x(0) && x <= node_x(columns - 1) && z >= node_z(0) && z <= node_z(row_count - 1);
+}
+
+double Heightmap::height_at(double x, double z) const {
+    if (!contains(x, z)) {
+        return 0.0;
+    }
+    double u = (x - origin_x) / cell;
+    double v = (z - origin_z) / cell;
+    int i = std::min(static_cast<int>(u), columns - 2);
+    int j = std::min(static_cast<int>(v), row_count - 2);
+    u -= i;
+    v -= j;
+    return node_height(i, j) * (1 - u) * (1 - v) + node_height(i + 1, j) * u * (1 - v)
+         + node_height(i, j + 1) * (1 - u) * v + node_height(i + 1, j + 1) * u * v;
+}
+
+bool Heightmap::clip(double x0, double z0, double x1, double z1, const double a[3], const double d[3], double& t0, double& t1) const {
+    // Отсечение отрезка a + t * d прямоугольником [x0, x1] x [z0, z1] в плоскости X-Z
+    const double lo[2] = { x0, z0 }, hi[2] = { x1, z1 };
+    const int axis[2] = { 0, 2 };
+    for (int k = 0; k < 2; ++k) {
+        double p = a[axis[k]], dp = d[axis[k]];
+        if (dp == 0.0) {
+            if (p < lo[k] || p > hi[k]) {
+                return false;
+            }
+            continue;
+        }
+        double ta = (lo[k] - p) / dp, tb = (hi[k] - p) / dp;
+        if (ta > tb) {
+            std::swap(ta, tb);
+        }
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Heightmap::intersect_cell(int ci, int cj, const double a[3], const double d[3], double t0, double t1, double& hit) const {
+    // Вдоль отрезка билинейная высота - квадратичная функция t, f(t) = y(t) - h(t)
+    double h00 = node_height(ci, cj), h10 = node_height(ci + 1, cj);
+    double h01 = node_height(ci, cj + 1), h11 = node_height(ci + 1, cj + 1);
+    double e1 = h10 - h00, e2 = h01 - h00, e3 = h00 - h10 - h01 + h11;
+    double u0 = (a[0] - node_x(ci)) / cell, du = d[0] / cell;
+    double v0 = (a[2] - node_z(cj)) / cell, dv = d[2] / cell;
+
+    double p0 = a[1] - (h00 + e1 * u0 + e2 * v0 + e3 * u0 * v0);
+    double p1 = d[1] - (e1 * du + e2 * dv + e3 * (u0 * dv + v0 * du));
+    double p2 = -e3 * du * dv;
+    auto f = [&](double t) { return p0 + (p1 + p2 * t) * t; };
+
+    if (f(t0) < -kSurfaceTolerance) {
+        hit = t0;
+        return true;
+    }
+
+    double roots[2];
+    int count = 0;
+    if (std::abs(p2) < 1e-12 * (std::abs(p1) + std::abs(p0) + 1.0)) {
+        if (p1 != 0.0) {
+            roots[count++] = -p0 / p1;
+        }
+    } else {
+        double disc = p1 * p1 - 4.0 * p2 * p0;
+        if (disc >= 0.0) {
+            double q = -0.5 * (p1 + std::copysign(std::sqrt(disc), p1));
+            roots[count++] = q / p2;
+            if (q != 0.0) {
+                roots[count++] = p0 / q;
+            }
+            if (count == 2 && roots[1] < roots[0]) {
+                std::swap(roots[0], roots[1]);
+            }
+        }
+    }
+    for (int r = 0; r < count; ++r) {
+        // Засчитывается только уход под поверхность, а не выход из нее (старт с земли)
+        if (roots[r] >= t0 && roots[r] <= t1 && p1 + 2.0 * p2 * roots[r] < 0.0) {
+            hit = roots[r];
+            return true;
+        }
+    }
+    if (f(t1) < -kSurfaceTolerance) {
+        hit = t1;
+        return true;
+    }
+    return false;
+}
+
+bool Heightmap::intersect_block(int level, int bi, int bj, const double a[3], const double d[3], double t0, double t1, double& hit) const {
+    // Отрезок целиком выше максимума блока - ячейки внутри не проверяются
+    double y_min = std::min(a[1] + d[1] * t0, a[1] + d[1] * t1);
+    if (y_min > max_levels[level][static_cast<std::size_t>(bj) * level_cols[level] + bi]) {
+        return false;
+    }
+    if (level == 0) {
+        return intersect_cell(bi, bj, a, d, t0, t1, hit);
+    }
+
+    struct Child { int i, j; double t0, t1; };
+    Child children[4];
+    int count = 0;
+    int child_level = level - 1;
+    for (int dj = 0; dj < 2; ++dj) {
+        for (int di = 0; di < 2; ++di) {
+            int ci = bi * 2 + di, cj = bj * 2 + dj;
+            if (ci >= level_cols[child_level] || cj >= level_rows[child_level]) {
+                continue;
+            }
+            int first_i = ci << child_level, first_j = cj << child_level;
+            int last_i = std::min((ci + 1) << child_level, level_cols[0]);
+            int last_j = std::min((cj + 1) << child_level, level_rows[0]);
+            double c0 = t0, c1 = t1;
+            if (clip(node_x(first_i), node_z(first_j), node_x(last_i), node_z(last_j), a, d, c0, c1)) {
+                children[count++] = { ci, cj, c0, c1 };
+            }
+        }
+    }
+    // Дочерние блоки обходятся в порядке входа в них отрезка: первое найденное пересечение - самое раннее
+    for (int c = 1; c < count; ++c) {
+        for (int k = c; k > 0 && children[k].t0 < children[k - 1].t0; --k) {
+            std::swap(children[k], children[k - 1]);
+        }
+    }
+    for (int c = 0; c < count; ++c) {
+        if (intersect_block(child_level, children[c].i, children[c].j, a, d, children[c].t0, children[c].t1, hit)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Heightmap::intersect(const State& from, const State& to, double& fraction) const {
+    const double a[3] = { from.x, from.y, from.z };
+    const double d[3] = { to.x - from.x, to.y - from.y, to.z - from.z };
+
+    // Быстрый отказ: отрезок выше всего рельефа и плоскости вокруг него
+    if (std::min(from.y, to.y) > std::max(max_height(), 0.0)) {
+        return false;
+    }
+
+    auto plane_hit = [&](double t0, double t1, double& hit) {
+        double y0 = a[1] + d[1] * t0, y1 = a[1] + d[1] * t1;
+        if (y0 < 0.0) {
+            hit = t0;
+            return true;
+        }
+        if (y1 < 0.0) {
+            hit = t0 + (t1 - t0) * y0 / (y0 - y1);
+            return true;
+        }
+        return false;
+    };
+
+    double t_in = 0.0, t_out = 1.0;
+    int top = static_cast<int>(max_levels.size()) - 1;
+    if (!clip(node_x(0), node_z(0), node_x(columns - 1), node_z(row_count - 1), a, d, t_in, t_out)) {
+        return plane_hit(0.0, 1.0, fraction);
+    }
+    if (t_in > 0.0 && plane_hit(0.0, t_in, fraction)) {
+        return true;
+    }
+    if (intersect_block(top, 0, 0, a, d, t_in, t_out, fraction)) {
+        return true;
+    }
+    return t_out < 1.0 && plane_hit(t_out, 1.0, fraction);
+}
+
+std::shared_ptr<const Heightmap> active_terrain() {
+    std::lock_guard<std::mutex> lock(g_terrainMutex);
+    return g_activeTerrain;
+}
+
+void set_active_terrain(std::shared_ptr<const Heightmap> terrain) {
+    std::lock_guard<std::mutex> lock(g_terrainMutex);
+    g_activeTerrain = std::move(terrain);
+}
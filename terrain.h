@@ -0,0 +1,66 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "simulation.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Карта высот рельефа на плоскости X-Z (высота по Y).
+// Узлы сетки лежат с шагом cellsize, между узлами высота интерполируется билинейно.
+// Для поиска точки падения строится пирамида min/max высот: блок уровня L покрывает
+// 2^L x 2^L ячеек, поэтому на каждом шаге интегрирования проверяется лишь несколько ячеек.
+class Heightmap {
+public:
+    // ESRI ASCII grid (.asc) или сырой float32 (.raw/.bin) с заголовком .hdr в том же формате
+    // (ncols, nrows, xllcorner/xllcenter, yllcorner/yllcenter, cellsize, nodata_value).
+    // Ось Y файла соответствует оси Z симуляции.
+    static std::shared_ptr<Heightmap> load(const std::string& path, std::string* error = nullptr);
+
+    // Сдвигает высоты так, чтобы точка выстрела (0, 0) лежала на уровне y = 0
+    void rebase_to_origin();
+
+    // Путь к файлу, из которого загружена карта
+    const std::string& source() const { return source_path; }
+    int cols() const { return columns; }
+    int rows() const { return row_count; }
+    double node_x(int i) const { return origin_x + i * cell; }
+    double node_z(int j) const { return origin_z + j * cell; }
+    double node_height(int i, int j) const { return heights[static_cast<std::size_t>(j) * columns + i]; }
+    double min_height() const { return min_levels.back()[0]; }
+    double max_height() const { return max_levels.back()[0]; }
+
+    bool contains(double x, double z) const;
+    // Высота поверхности в точке (вне сетки - плоскость y = 0)
+    double height_at(double x, double z) const;
+
+    // Пересекает ли отрезок from -> to поверхность (рельеф внутри сетки, y = 0 снаружи).
+    // fraction - доля отрезка до точки пересечения.
+    bool intersect(const State& from, const State& to, double& fraction) const;
+
+private:
+    void build_pyramid();
+    bool intersect_block(int level, int bi, int bj, const double a[3], const double d[3], double t0, double t1, double& hit) const;
+    bool intersect_cell(int ci, int cj, const double a[3], const double d[3], double t0, double t1, double& hit) const;
+    bool clip(double x0, double z0, double x1, double z1, const double a[3], const double d[3], double& t0, double& t1) const;
+
+    std::string source_path;
+    int columns = 0;
+    int row_count = 0;
+    double origin_x = 0.0;
+    double origin_z = 0.0;
+    double cell = 1.0;
+    std::vector<float> heights; // узел (i, j) -> heights[j * columns + i]
+
+    // Уровень 0 - ячейки (columns - 1) x (row_count - 1), далее блоки 2x2 предыдущего уровня
+    std::vector<int> level_cols;
+    std::vector<int> level_rows;
+    std::vector<std::vector<float>> min_levels;
+    std::vector<std::vector<float>> max_levels;
+};
+
+// Текущий рельеф для расчета траекторий и 3D-сцены (nullptr - плоская земля y = 0)
+std::shared_ptr<const Heightmap> active_terrain();
+void set_active_terrain(std::shared_ptr<const Heightmap> terrain);
+
+#endif // TERRAIN_H
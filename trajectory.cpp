@@ -0,0 +1,248 @@
+#include "trajectory.h"
+#include "windfield.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+double position(const State& s, Axis axis) {
+    return axis == Axis::X ? s.x : axis == Axis::Y ? s.y : s.z;
+}
+
+double velocity(const State& s, Axis axis) {
+    return axis == Axis::X ? s.vx : axis == Axis::Y ? s.vy : s.vz;
+}
+
+// Корень f на [a, b] при f(a) и f(b) разных знаков
+template <typename F>
+double bisect(F f, double a, double b) {
+    double fa = f(a);
+    for (int i = 0; i < 60 && b - a > 1e-15; ++i) {
+        double m = 0.5 * (a + b);
+        double fm = f(m);
+        if ((fm <= 0.0) == (fa <= 0.0)) {
+            a = m;
+            fa = fm;
+        } else {
+            b = m;
+        }
+    }
+    return 0.5 * (a + b);
+}
+
+int direction(double from, double to) {
+    return to > from ? 1 : (to < from ? -1 : 0);
+}
+
+// Корень монотонной на [a, b] функции f с производной df: шаги Ньютона, а при выходе
+// из текущей скобки - деление пополам
+template <typename F, typename D>
+double solve_monotone(F f, D df, double a, double b) {
+    double fa = f(a);
+    double x = 0.5 * (a + b);
+    for (int i = 0; i < 60; ++i) {
+        double fx = f(x);
+        if (fx == 0.0) {
+            return x;
+        }
+        if ((fx < 0.0) == (fa < 0.0)) {
+            a = x;
+            fa = fx;
+        } else {
+            b = x;
+        }
+        double d = df(x);
+        double next = d != 0.0 ? x - fx / d : a - 1.0;
+        if (!(next > a && next < b)) {
+            next = 0.5 * (a + b);
+        }
+        if (std::abs(next - x) <= 1e-14 || b - a <= 1e-15) {
+            return next;
+        }
+        x = next;
+    }
+    return x;
+}
+
+} // namespace
+
+Trajectory::Trajectory(std::shared_ptr<const std::vector<State>> samples, const Parameters& params, double dt)
+    : states(std::move(samples)) {
+    if (empty()) {
+        states.reset();
+        return;
+    }
+    const std::vector<State>& s = *states;
+    std::size_t n = s.size();
+    times.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        times[i] = i * dt;
+    }
+    if (n >= 2) {
+        // Точка падения на рельеф - интерполяция внутри шага: время по проекции перемещения
+        // на среднюю скорость. Для обычного отсчета оценка совпадает с dt с точностью O(dt^3)
+        const State& a = s[n - 2];
+        const State& b = s[n - 1];
+        double vx = 0.5 * (a.vx + b.vx), vy = 0.5 * (a.vy + b.vy), vz = 0.5 * (a.vz + b.vz);
+        double v2 = vx * vx + vy * vy + vz * vz;
+        if (v2 > 0.0) {
+            double h = ((b.x - a.x) * vx + (b.y - a.y) * vy + (b.z - a.z) * vz) / v2;
+            if (h > 0.0 && h < dt * (1.0 - 1e-6)) {
+                times[n - 1] = times[n - 2] + h;
+            }
+        }
+    }
+
+    std::shared_ptr<const WindField> wind = active_wind_field();
+    accelerations.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        State d = compute_derivatives(s[i], params, wind.get(), times[i]);
+        accelerations[i] = { d.vx, d.vy, d.vz };
+    }
+
+    for (int a = 0; a < 3; ++a) {
+        Axis axis = static_cast<Axis>(a);
+        runs[a].push_back(0);
+        int dir = 0;
+        for (std::size_t k = 1; k < n; ++k) {
+            int d = direction(position(s[k - 1], axis), position(s[k], axis));
+            if (d == 0) {
+                continue;
+            }
+            if (dir != 0 && d != dir) {
+                runs[a].push_back(k - 1);
+            }
+            dir = d;
+        }
+    }
+}
+
+Trajectory Trajectory::integrate(const Parameters& params, double dt, std::size_t max_points) {
+    auto states = std::make_shared<std::vector<State>>();
+    integrate_trajectory(params, dt, max_points, *states);
+    return Trajectory(std::move(states), params, dt);
+}
+
+State Trajectory::at(double t) const {
+    if (empty()) {
+        return State{};
+    }
+    const std::vector<State>& s = *states;
+    if (s.size() == 1 || t <= times.front()) {
+        return s.front();
+    }
+    if (t >= times.back()) {
+        return s.back();
+    }
+    std::size_t i = static_cast<std::size_t>(std::upper_bound(times.begin(), times.end(), t) - times.begin()) - 1;
+    const State& a = s[i];
+    const State& b = s[i + 1];
+    const Acceleration& da = accelerations[i];
+    const Acceleration& db = accelerations[i + 1];
+    double h = times[i + 1] - times[i];
+    double u = (t - times[i]) / h;
+    return {
+        hermite(a.x, b.x, a.vx, b.vx, h, u), hermite(a.y, b.y, a.vy, b.vy, h, u), hermite(a.z, b.z, a.vz, b.vz, h, u),
+        hermite(a.vx, b.vx, da.ax, db.ax, h, u), hermite(a.vy, b.vy, da.ay, db.ay, h, u), hermite(a.vz, b.vz, da.az, db.az, h, u)
+    };
+}
+
+void Trajectory::solve_interval(std::size_t i, Axis axis, double value, std::vector<double>& out) const {
+    const State& a = (*states)[i];
+    const State& b = (*states)[i + 1];
+    double p0 = position(a, axis), p1 = position(b, axis);
+    double d0 = velocity(a, axis), d1 = velocity(b, axis);
+    double h = times[i + 1] - times[i];
+    auto f = [&](double u) { return hermite(p0, p1, d0, d1, h, u) - value; };
+    auto slope = [&](double u) { return hermite_slope(p0, p1, d0, d1, h, u); };
+
+    // Экстремум внутри шага (вершина) делит его на два монотонных куска
+    double pieces[3] = { 0.0, 1.0, 1.0 };
+    int count = 1;
+    if ((d0 > 0.0 && d1 < 0.0) || (d0 < 0.0 && d1 > 0.0)) {
+        // Значение по другую сторону от концов, чем вершина, не достигается
+        if (d0 > 0.0 ? value < std::min(p0, p1) : value > std::max(p0, p1)) {
+            return;
+        }
+        pieces[1] = bisect(slope, 0.0, 1.0);
+        count = 2;
+    } else if (value < std::min(p0, p1) || value > std::max(p0, p1)) {
+        return;
+    }
+    for (int k = 0; k < count; ++k) {
+        double lo = pieces[k], hi = pieces[k + 1];
+        double flo = f(lo), fhi = f(hi);
+        if (flo == 0.0) {
+            out.push_back(times[i] + lo * h);
+        } else if (fhi == 0.0) {
+            out.push_back(times[i] + hi * h);
+        } else if ((flo < 0.0) != (fhi < 0.0)) {
+            out.push_back(times[i] + solve_monotone(f, slope, lo, hi) * h);
+        }
+    }
+}
+
+std::vector<double> Trajectory::times_at(Axis axis, double value) const {
+    std::vector<double> result;
+    if (size() < 2) {
+        if (!empty() && position(states->front(), axis) == value) {
+            result.push_back(0.0);
+        }
+        return result;
+    }
+    const std::vector<State>& s = *states;
+    const std::vector<std::size_t>& starts = runs[static_cast<int>(axis)];
+    std::size_t last = s.size() - 1;
+
+    // Шаги-кандидаты: на каждом монотонном участке, где лежит value, - двоичным поиском,
+    // плюс шаги у границ участков (вершина между отсчетами может быть выше соседних отсчетов)
+    std::vector<std::size_t> intervals;
+    for (std::size_t r = 0; r < starts.size(); ++r) {
+        std::size_t begin = starts[r];
+        std::size_t end = r + 1 < starts.size() ? starts[r + 1] : last;
+        double vb = position(s[begin], axis), ve = position(s[end], axis);
+        if (r > 0) {
+            intervals.push_back(begin - 1);
+        }
+        if (begin < last) {
+            intervals.push_back(begin);
+        }
+        if (value < std::min(vb, ve) || value > std::max(vb, ve) || begin == end) {
+            continue;
+        }
+        bool increasing = ve >= vb;
+        std::size_t lo = begin, hi = end; // инвариант: value между отсчетами lo и hi
+        while (hi - lo > 1) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            double vm = position(s[mid], axis);
+            if (increasing ? vm < value : vm > value) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        intervals.push_back(lo);
+    }
+    std::sort(intervals.begin(), intervals.end());
+    intervals.erase(std::unique(intervals.begin(), intervals.end()), intervals.end());
+
+    for (std::size_t i : intervals) {
+        solve_interval(i, axis, value, result);
+    }
+    std::sort(result.begin(), result.end());
+    // Корень в общем отсчете соседних шагов найден дважды
+    double tolerance = 1e-9 * std::max(duration(), 1.0);
+    result.erase(std::unique(result.begin(), result.end(), [&](double x, double y) { return y - x <= tolerance; }),
+                 result.end());
+    return result;
+}
+
+bool Trajectory::first_time_at(Axis axis, double value, double& t, double after) const {
+    for (double candidate : times_at(axis, value)) {
+        if (candidate >= after) {
+            t = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+enum class Axis { X = 0, Y = 1, Z = 2 };
+
+// Траектория с запросами по времени и по координатам за O(log n) без прохода по отсчетам.
+// Индекс времени - моменты отсчетов, индекс координат - для каждой оси границы участков,
+// на которых координата монотонна (у высоты обычно два: подъем и спуск). Внутри шага
+// положение интерполируется кубическим сплайном Эрмита по положениям и скоростям,
+// скорость - по скоростям и ускорениям из уравнений движения.
+class Trajectory {
+public:
+    Trajectory() = default;
+    // states - отсчеты integrate_trajectory с шагом dt. Последний отсчет при падении на рельеф
+    // лежит внутри шага, его время оценивается по перемещению и скорости
+    Trajectory(std::shared_ptr<const std::vector<State>> states, const Parameters& params, double dt);
+    static Trajectory integrate(const Parameters& params, double dt, std::size_t max_points);
+
+    bool empty() const { return !states || states->empty(); }
+    std::size_t size() const { return states ? states->size() : 0; }
+    const std::vector<State>& samples() const { return *states; }
+    std::shared_ptr<const std::vector<State>> shared_samples() const { return states; }
+    double sample_time(std::size_t i) const { return times[i]; }
+    double duration() const { return times.empty() ? 0.0 : times.back(); }
+
+    // Состояние в момент t; вне [0, duration()] - крайний отсчет
+    State at(double t) const;
+
+    // Все моменты, когда координата равна value, по возрастанию
+    std::vector<double> times_at(Axis axis, double value) const;
+    // Первый такой момент не раньше after; false - координата не принимает значение
+    bool first_time_at(Axis axis, double value, double& t, double after = 0.0) const;
+    std::vector<double> times_at_altitude(double height) const { return times_at(Axis::Y, height); }
+
+private:
+    struct Acceleration {
+        double ax, ay, az;
+    };
+
+    void solve_interval(std::size_t i, Axis axis, double value, std::vector<double>& out) const;
+
+    std::shared_ptr<const std::vector<State>> states;
+    std::vector<double> times;
+    std::vector<Acceleration> accelerations;
+    std::vector<std::size_t> runs[3]; // первые отсчеты монотонных участков по каждой оси
+};
+
+#endif // TRAJECTORY_H
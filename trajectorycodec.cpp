@@ -0,0 +1,304 @@
+#include "trajectorycodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr char kCodecMagic[4] = { 'B', 'T', 'R', 'C' };
+constexpr std::uint32_t kCodecVersion = 1;
+constexpr int kComponents = 6;
+constexpr double kMaxQuantum = 1e15; // квантованные значения и остатки заведомо помещаются в 53 бита
+
+struct CodecHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint32_t block_size;
+    std::uint32_t block_count;
+    double position_step;
+    double velocity_step;
+};
+
+double component(const State& s, int c) {
+    switch (c) {
+        case 0: return s.x;
+        case 1: return s.y;
+        case 2: return s.z;
+        case 3: return s.vx;
+        case 4: return s.vy;
+        default: return s.vz;
+    }
+}
+
+double& component(State& s, int c) {
+    switch (c) {
+        case 0: return s.x;
+        case 1: return s.y;
+        case 2: return s.z;
+        case 3: return s.vx;
+        case 4: return s.vy;
+        default: return s.vz;
+    }
+}
+
+std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool get_varint(const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        std::uint8_t byte = *p++;
+        v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int bit_width(std::uint64_t v) {
+    int width = 0;
+    while (v) {
+        ++width;
+        v >>= 1;
+    }
+    return width;
+}
+
+void encode_block(const State* states, std::size_t n, const double* steps, std::vector<std::uint8_t>& out) {
+    std::vector<std::uint64_t> residuals;
+    for (int c = 0; c < kComponents; ++c) {
+        double step = steps[c];
+        auto quantum = [&](std::size_t i) { return static_cast<std::int64_t>(std::llround(component(states[i], c) / step)); };
+        std::int64_t q0 = quantum(0);
+        put_varint(out, zigzag(q0));
+        if (n < 2) {
+            continue;
+        }
+        std::int64_t q1 = quantum(1);
+        put_varint(out, zigzag(q1 - q0));
+
+        residuals.clear();
+        std::uint64_t widest = 0;
+        for (std::size_t i = 2; i < n; ++i) {
+            std::int64_t q2 = quantum(i);
+            std::uint64_t r = zigzag(q2 - (2 * q1 - q0));
+            residuals.push_back(r);
+            widest |= r;
+            q0 = q1;
+            q1 = q2;
+        }
+        int width = bit_width(widest);
+        out.push_back(static_cast<std::uint8_t>(width));
+        std::uint64_t acc = 0;
+        int bits = 0;
+        for (std::uint64_t r : residuals) {
+            acc |= r << bits;
+            bits += width;
+            while (bits >= 8) {
+                out.push_back(static_cast<std::uint8_t>(acc));
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0) {
+            out.push_back(static_cast<std::uint8_t>(acc));
+        }
+    }
+}
+
+bool decode_block(const std::uint8_t* p, const std::uint8_t* end, std::size_t n, const double* steps, State* states) {
+    for (int c = 0; c < kComponents; ++c) {
+        std::uint64_t v;
+        if (!get_varint(p, end, v)) {
+            return false;
+        }
+        std::int64_t q0 = unzigzag(v);
+        component(states[0], c) = q0 * steps[c];
+        if (n < 2) {
+            continue;
+        }
+        if (!get_varint(p, end, v)) {
+            return false;
+        }
+        std::int64_t q1 = q0 + unzigzag(v);
+        component(states[1], c) = q1 * steps[c];
+        if (p >= end) {
+            return false;
+        }
+        int width = *p++;
+        if (width > 56 || static_cast<std::size_t>(end - p) < ((n - 2) * width + 7) / 8) {
+            return false;
+        }
+        std::uint64_t mask = width ? (~0ull >> (64 - width)) : 0;
+        std::uint64_t acc = 0;
+        int bits = 0;
+        for (std::size_t i = 2; i < n; ++i) {
+            while (bits < width) {
+                acc |= static_cast<std::uint64_t>(*p++) << bits;
+                bits += 8;
+            }
+            std::int64_t q2 = 2 * q1 - q0 + unzigzag(acc & mask);
+            acc = width < 64 ? acc >> width : 0;
+            bits -= width;
+            component(states[i], c) = q2 * steps[c];
+            q0 = q1;
+            q1 = q2;
+        }
+    }
+    return true;
+}
+
+std::uint64_t load_u64(const std::uint8_t* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+} // namespace
+
+std::vector<std::uint8_t> encode_trajectory(const std::vector<State>& states, const TrajectoryCodecOptions& options) {
+    std::vector<std::uint8_t> out;
+    if (!(options.position_tolerance > 0.0) || !(options.velocity_tolerance > 0.0) || options.block_size < 2
+        || options.block_size > 0xffffffffu) {
+        return out;
+    }
+    double positionStep = 2.0 * options.position_tolerance;
+    double velocityStep = 2.0 * options.velocity_tolerance;
+    const double steps[kComponents] = { positionStep, positionStep, positionStep, velocityStep, velocityStep, velocityStep };
+    for (const State& s : states) {
+        for (int c = 0; c < kComponents; ++c) {
+            if (!(std::abs(component(s, c) / steps[c]) < kMaxQuantum)) {
+                return out;
+            }
+        }
+    }
+
+    std::size_t blockCount = (states.size() + options.block_size - 1) / options.block_size;
+    CodecHeader header;
+    std::memcpy(header.magic, kCodecMagic, sizeof(kCodecMagic));
+    header.version = kCodecVersion;
+    header.count = states.size();
+    header.block_size = static_cast<std::uint32_t>(options.block_size);
+    header.block_count = static_cast<std::uint32_t>(blockCount);
+    header.position_step = positionStep;
+    header.velocity_step = velocityStep;
+
+    std::vector<std::uint8_t> payload;
+    payload.reserve(states.size() * 3);
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(blockCount + 1);
+    for (std::size_t first = 0; first < states.size(); first += options.block_size) {
+        offsets.push_back(payload.size());
+        encode_block(states.data() + first, std::min(options.block_size, states.size() - first), steps, payload);
+    }
+    offsets.push_back(payload.size());
+
+    out.resize(sizeof(header) + offsets.size() * sizeof(std::uint64_t));
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+bool is_encoded_trajectory(const std::uint8_t* data, std::size_t size) {
+    return size >= sizeof(CodecHeader) && std::memcmp(data, kCodecMagic, sizeof(kCodecMagic)) == 0;
+}
+
+bool TrajectoryReader::open(const std::uint8_t* data, std::size_t size) {
+    *this = TrajectoryReader();
+    if (!is_encoded_trajectory(data, size)) {
+        return false;
+    }
+    CodecHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t indexBytes = (static_cast<std::size_t>(header.block_count) + 1) * sizeof(std::uint64_t);
+    if (header.version != kCodecVersion || header.block_size < 2 || size - sizeof(header) < indexBytes
+        || header.block_count != (header.count + header.block_size - 1) / header.block_size
+        || !(header.position_step > 0.0) || !(header.velocity_step > 0.0)) {
+        return false;
+    }
+    offsets = data + sizeof(header);
+    payload = offsets + indexBytes;
+    payload_size = size - sizeof(header) - indexBytes;
+    if (load_u64(offsets + header.block_count * sizeof(std::uint64_t)) != payload_size) {
+        offsets = nullptr;
+        return false;
+    }
+    count = static_cast<std::size_t>(header.count);
+    block = header.block_size;
+    blocks = header.block_count;
+    position_step = header.position_step;
+    velocity_step = header.velocity_step;
+    return true;
+}
+
+bool TrajectoryReader::read_block(std::size_t index, std::vector<State>& out) const {
+    if (!offsets || index >= blocks) {
+        return false;
+    }
+    std::uint64_t begin = load_u64(offsets + index * sizeof(std::uint64_t));
+    std::uint64_t end = load_u64(offsets + (index + 1) * sizeof(std::uint64_t));
+    if (begin > end || end > payload_size) {
+        return false;
+    }
+    std::size_t n = std::min(block, count - index * block);
+    const double steps[kComponents] = { position_step, position_step, position_step, velocity_step, velocity_step, velocity_step };
+    std::size_t base = out.size();
+    out.resize(base + n);
+    if (!decode_block(payload + begin, payload + end, n, steps, out.data() + base)) {
+        out.resize(base);
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryReader::read(std::size_t first, std::size_t length, std::vector<State>& out) const {
+    if (!offsets || first > count || length > count - first) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    std::vector<State> buffer;
+    for (std::size_t b = first / block; b <= (first + length - 1) / block; ++b) {
+        buffer.clear();
+        if (!read_block(b, buffer)) {
+            return false;
+        }
+        std::size_t from = b * block;
+        std::size_t lo = std::max(first, from) - from;
+        std::size_t hi = std::min(first + length, from + buffer.size()) - from;
+        out.insert(out.end(), buffer.begin() + lo, buffer.begin() + hi);
+    }
+    return true;
+}
+
+bool decode_trajectory(const std::uint8_t* data, std::size_t size, std::vector<State>& states) {
+    TrajectoryReader reader;
+    states.clear();
+    if (!reader.open(data, size)) {
+        return false;
+    }
+    states.reserve(reader.size());
+    for (std::size_t b = 0; b < reader.block_count(); ++b) {
+        if (!reader.read_block(b, states)) {
+            return false;
+        }
+    }
+    return true;
+}
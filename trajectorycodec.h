@@ -0,0 +1,59 @@
+#ifndef TRAJECTORYCODEC_H
+#define TRAJECTORYCODEC_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатое хранение траекторий с ограниченной ошибкой. Каждая координата и скорость
+// квантуется с шагом 2 * допуск (ошибка восстановления не больше допуска, без накопления),
+// квантованное значение предсказывается линейной экстраполяцией по двум предыдущим,
+// остатки (для гладкой траектории - единицы квантов) упаковываются битами минимальной
+// ширины. Траектория делится на блоки по времени с таблицей смещений, поэтому любой
+// участок распаковывается без чтения остальных. При допуске 1 мм и 1 мм/с и шаге 0.01 с
+// состояние занимает около 1.5-3 байт вместо 48.
+//
+// Формат: заголовок, смещения начала блоков (block_count + 1 значений от начала данных),
+// данные блоков. В блоке для каждой из шести величин: первое значение и первая разность
+// (zigzag varint), ширина остатков в битах (1 байт), остатки.
+
+struct TrajectoryCodecOptions {
+    double position_tolerance = 1e-3; // м
+    double velocity_tolerance = 1e-3; // м/с
+    std::size_t block_size = 256;     // состояний в блоке
+};
+
+// Пустой результат - траекторию нельзя закодировать (нечисловые или слишком большие значения)
+std::vector<std::uint8_t> encode_trajectory(const std::vector<State>& states, const TrajectoryCodecOptions& options = {});
+
+bool is_encoded_trajectory(const std::uint8_t* data, std::size_t size);
+
+// Чтение закодированной траектории без распаковки целиком; данные должны жить дольше читателя
+class TrajectoryReader {
+public:
+    bool open(const std::uint8_t* data, std::size_t size);
+
+    std::size_t size() const { return count; }
+    std::size_t block_size() const { return block; }
+    std::size_t block_count() const { return blocks; }
+
+    // Состояния блока дописываются в конец out
+    bool read_block(std::size_t index, std::vector<State>& out) const;
+    // Состояния [first, first + length) - распаковываются только затронутые блоки
+    bool read(std::size_t first, std::size_t length, std::vector<State>& out) const;
+
+private:
+    const std::uint8_t* offsets = nullptr;
+    const std::uint8_t* payload = nullptr;
+    std::size_t payload_size = 0;
+    std::size_t count = 0;
+    std::size_t block = 0;
+    std::size_t blocks = 0;
+    double position_step = 0.0;
+    double velocity_step = 0.0;
+};
+
+bool decode_trajectory(const std::uint8_t* data, std::size_t size, std::vector<State>& states);
+
+#endif // TRAJECTORYCODEC_H
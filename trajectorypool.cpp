@@ -0,0 +1,117 @@
+#include "trajectorypool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Предел заранее выделяемой емкости: оценка не учитывает сопротивление и при больших скоростях
+// или малом g завышена на порядки, а длинная траектория дорастит буфер сама
+constexpr std::size_t kMaxReservedPoints = std::size_t(1) << 16;
+
+} // namespace
+
+std::size_t estimate_trajectory_points(const Parameters& params, double dt, std::size_t max_points) {
+    // Сопротивление воздуха почти всегда укорачивает полет, поэтому время полета в вакууме
+    // дает верхнюю оценку; запас 10% покрывает сильный встречный ветер
+    State start = initial_state(params);
+    double vacuum_time = start.vy > 0.0 ? 2.0 * start.vy / params.g : 0.0;
+    double estimate = vacuum_time / dt * 1.1 + 16.0;
+    std::size_t limit = std::min(max_points, kMaxReservedPoints);
+    if (!(estimate < static_cast<double>(limit))) {
+        return limit;
+    }
+    return static_cast<std::size_t>(estimate);
+}
+
+TrajectoryPool::Buffer::Buffer(TrajectoryPool* owner, std::vector<State>&& buffer)
+    : pool(owner), storage(std::move(buffer)) {
+}
+
+TrajectoryPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool(other.pool), storage(std::move(other.storage)) {
+    other.pool = nullptr;
+}
+
+TrajectoryPool::Buffer& TrajectoryPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        if (pool) {
+            pool->release(std::move(storage));
+        }
+        pool = other.pool;
+        storage = std::move(other.storage);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+TrajectoryPool::Buffer::~Buffer() {
+    if (pool) {
+        pool->release(std::move(storage));
+    }
+}
+
+std::shared_ptr<const std::vector<State>> TrajectoryPool::Buffer::share() && {
+    TrajectoryPool* owner = pool;
+    pool = nullptr;
+    auto* shared = new std::vector<State>(std::move(storage));
+    return std::shared_ptr<const std::vector<State>>(shared, [owner](const std::vector<State>* states) {
+        auto* buffer = const_cast<std::vector<State>*>(states);
+        if (owner) {
+            owner->release(std::move(*buffer));
+        }
+        delete buffer;
+    });
+}
+
+TrajectoryPool& TrajectoryPool::instance() {
+    static TrajectoryPool pool;
+    return pool;
+}
+
+TrajectoryPool::Buffer TrajectoryPool::acquire(std::size_t capacity) {
+    std::vector<State> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Наименьший подходящий буфер, иначе самый большой (его придется дорастить)
+        auto fitting = free_buffers.end();
+        auto largest = free_buffers.end();
+        for (auto it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+            if (it->capacity() >= capacity && (fitting == free_buffers.end() || it->capacity() < fitting->capacity())) {
+                fitting = it;
+            }
+            if (largest == free_buffers.end() || it->capacity() > largest->capacity()) {
+                largest = it;
+            }
+        }
+        auto best = fitting != free_buffers.end() ? fitting : largest;
+        if (best != free_buffers.end()) {
+            buffer = std::move(*best);
+            *best = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+    buffer.clear();
+    buffer.reserve(capacity);
+    return Buffer(this, std::move(buffer));
+}
+
+std::size_t TrajectoryPool::cached_buffers() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return free_buffers.size();
+}
+
+void TrajectoryPool::release(std::vector<State>&& buffer) {
+    if (buffer.capacity() == 0 || buffer.capacity() > kMaxCachedPoints) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_buffers.size() < kMaxCachedBuffers) {
+        free_buffers.push_back(std::move(buffer));
+    }
+}
+
+TrajectoryPool::Buffer simulate_trajectory(const Parameters& params, double dt, std::size_t max_points) {
+    TrajectoryPool::Buffer buffer = TrajectoryPool::instance().acquire(estimate_trajectory_points(params, dt, max_points));
+    integrate_trajectory(params, dt, max_points, buffer.states());
+    return buffer;
+}
@@ -0,0 +1,64 @@
+#ifndef TRAJECTORYPOOL_H
+#define TRAJECTORYPOOL_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Оценка числа точек траектории по времени полета в вакууме (с запасом),
+// чтобы буфер обычно выделялся один раз, без перевыделений при push_back.
+// Не больше 65536 точек: дальше буфер растет как обычный вектор
+std::size_t estimate_trajectory_points(const Parameters& params, double dt, std::size_t max_points);
+
+// Пул буферов траекторий, общий для всех полетов и потоков.
+// Память освобожденных траекторий не возвращается системе, а выдается следующим полетам.
+class TrajectoryPool {
+public:
+    // Буфер траектории: только перемещение, при уничтожении память возвращается в пул
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer();
+
+        std::vector<State>& states() { return storage; }
+        const std::vector<State>& states() const { return storage; }
+
+        // Совместное владение без копирования: память вернется в пул вместе с последней ссылкой
+        std::shared_ptr<const std::vector<State>> share() &&;
+
+    private:
+        friend class TrajectoryPool;
+        Buffer(TrajectoryPool* owner, std::vector<State>&& buffer);
+
+        TrajectoryPool* pool = nullptr;
+        std::vector<State> storage;
+    };
+
+    static TrajectoryPool& instance();
+
+    // Пустой буфер с емкостью не меньше capacity
+    Buffer acquire(std::size_t capacity);
+
+    std::size_t cached_buffers() const;
+
+private:
+    void release(std::vector<State>&& buffer);
+
+    static constexpr std::size_t kMaxCachedBuffers = 64;
+    // Буферы, доросшие больше этого, освобождаются, а не копятся в пуле
+    static constexpr std::size_t kMaxCachedPoints = std::size_t(1) << 20;
+
+    mutable std::mutex mutex;
+    std::vector<std::vector<State>> free_buffers;
+};
+
+// Траектория полета в буфере из пула, размер которого оценен заранее
+TrajectoryPool::Buffer simulate_trajectory(const Parameters& params, double dt, std::size_t max_points);
+
+#endif // TRAJECTORYPOOL_H
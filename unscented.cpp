@@ -0,0 +1,152 @@
+#include "unscented.h"
+#include "optimalangle.h"
+#include "parallel.h"
+#include "scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+constexpr int kN = kScenarioParameterCount;
+
+// Разложение Холецкого P = L L^T. Направления без разброса (поле с нулевой дисперсией
+// или линейно зависимое от предыдущих) дают нулевой столбец, остальные - номера в columns
+void cholesky(const ParameterCovariance& p, ParameterCovariance& l, std::vector<int>& columns) {
+    l.fill(0.0);
+    columns.clear();
+    for (int j = 0; j < kN; ++j) {
+        double d = p[j * kN + j];
+        for (int k = 0; k < j; ++k) d -= l[j * kN + k] * l[j * kN + k];
+        if (!(p[j * kN + j] > 0.0) || !(d > 1e-12 * p[j * kN + j])) {
+            continue;
+        }
+        double pivot = std::sqrt(d);
+        l[j * kN + j] = pivot;
+        for (int i = j + 1; i < kN; ++i) {
+            double s = p[i * kN + j];
+            for (int k = 0; k < j; ++k) s -= l[i * kN + k] * l[j * kN + k];
+            l[i * kN + j] = s / pivot;
+        }
+        columns.push_back(j);
+    }
+}
+
+} // namespace
+
+ParameterCovariance diagonal_covariance(const Parameters& sigma) {
+    ParameterCovariance covariance{};
+    for (int i = 0; i < kN; ++i) {
+        double s = scenario_parameter(sigma, i);
+        covariance[i * kN + i] = s * s;
+    }
+    return covariance;
+}
+
+void ImpactEllipse::point(double phase, double& x, double& z) const {
+    double a = semi_major * std::cos(phase), b = semi_minor * std::sin(phase);
+    x = center_x + a * std::cos(angle) - b * std::sin(angle);
+    z = center_z + a * std::sin(angle) + b * std::cos(angle);
+}
+
+double ellipse_scale(double probability) {
+    return std::sqrt(-2.0 * std::log(1.0 - std::clamp(probability, 0.0, 1.0 - 1e-12)));
+}
+
+ImpactEllipse UnscentedReport::ellipse(double scale) const {
+    // Собственные числа и направление большой оси ковариации 2 x 2
+    double half_trace = 0.5 * (cov_xx + cov_zz);
+    double radius = std::hypot(0.5 * (cov_xx - cov_zz), cov_xz);
+    ImpactEllipse e;
+    e.center_x = impact_x;
+    e.center_z = impact_z;
+    e.semi_major = scale * std::sqrt(std::max(half_trace + radius, 0.0));
+    e.semi_minor = scale * std::sqrt(std::max(half_trace - radius, 0.0));
+    e.angle = 0.5 * std::atan2(2.0 * cov_xz, cov_xx - cov_zz);
+    return e;
+}
+
+UnscentedReport unscented_transform(const Parameters& mean, const ParameterCovariance& covariance,
+                                    const UnscentedOptions& options) {
+    auto started = std::chrono::steady_clock::now();
+    UnscentedReport report;
+    report.mean = mean;
+
+    ParameterCovariance l;
+    std::vector<int> columns;
+    cholesky(covariance, l, columns);
+    int r = static_cast<int>(columns.size());
+    report.rank = r;
+
+    double lambda = options.alpha * options.alpha * (r + options.kappa) - r;
+    double c = r + lambda;
+    double spread = r > 0 ? std::sqrt(c) : 0.0;
+
+    // Точки: среднее и по паре на каждый ненулевой столбец L
+    auto add_point = [&](Parameters point) {
+        bool moved = false;
+        for (int i = 0; i < kN; ++i) {
+            double value = scenario_parameter(point, i);
+            double inside = clamp_scenario_parameter(i, value);
+            moved = moved || inside != value;
+            scenario_parameter(point, i) = inside;
+        }
+        report.clamped += moved ? 1 : 0;
+        report.sigma_points.push_back(point);
+    };
+    add_point(mean);
+    for (int j : columns) {
+        for (double sign : { 1.0, -1.0 }) {
+            Parameters point = mean;
+            for (int i = j; i < kN; ++i) {
+                scenario_parameter(point, i) += sign * spread * l[i * kN + j];
+            }
+            add_point(point);
+        }
+    }
+    if (r > 0) {
+        report.mean_weights.assign(report.sigma_points.size(), 0.5 / c);
+        report.covariance_weights.assign(report.sigma_points.size(), 0.5 / c);
+        report.mean_weights[0] = lambda / c;
+        report.covariance_weights[0] = lambda / c + 1.0 - options.alpha * options.alpha + options.beta;
+    } else {
+        report.mean_weights = { 1.0 };
+        report.covariance_weights = { 0.0 };
+    }
+
+    // Полеты разной длины, поэтому по одному на кусок
+    report.flights.resize(report.sigma_points.size());
+    parallel_for(report.sigma_points.size(), 1, options.threads, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t i = begin; i < end; ++i) {
+            report.flights[i] = smooth_flight_summary(report.sigma_points[i], options.dt, options.max_points);
+        }
+    });
+
+    // Взвешенные моменты точки падения и величин
+    for (std::size_t i = 0; i < report.flights.size(); ++i) {
+        double w = report.mean_weights[i];
+        report.impact_x += w * report.flights[i].impact_x;
+        report.impact_z += w * report.flights[i].impact_z;
+        for (int m = 0; m < kSweepMetricCount; ++m) {
+            report.metric_mean[m] += w * sweep_metric(report.flights[i], report.sigma_points[i], static_cast<SweepMetric>(m));
+        }
+    }
+    double variance[kSweepMetricCount] = {};
+    for (std::size_t i = 0; i < report.flights.size(); ++i) {
+        double w = report.covariance_weights[i];
+        double dx = report.flights[i].impact_x - report.impact_x;
+        double dz = report.flights[i].impact_z - report.impact_z;
+        report.cov_xx += w * dx * dx;
+        report.cov_xz += w * dx * dz;
+        report.cov_zz += w * dz * dz;
+        for (int m = 0; m < kSweepMetricCount; ++m) {
+            double d = sweep_metric(report.flights[i], report.sigma_points[i], static_cast<SweepMetric>(m)) - report.metric_mean[m];
+            variance[m] += w * d * d;
+        }
+    }
+    for (int m = 0; m < kSweepMetricCount; ++m) {
+        report.metric_sigma[m] = std::sqrt(std::max(variance[m], 0.0));
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
@@ -0,0 +1,68 @@
+#ifndef UNSCENTED_H
+#define UNSCENTED_H
+
+#include "sweepstore.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Распространение неопределенности параметров через модель полета сигма-точками
+// (unscented transform). По среднему и ковариации Parameters строится 2r + 1 точка,
+// r - число независимых направлений разброса (не больше 10, т.е. не больше 21 полета),
+// и по их точкам падения - среднее, ковариация и эллипс рассеивания. Моменты второго
+// порядка точны для квадратичной модели, Монте-Карло для той же точности нужны тысячи полетов.
+
+// Ковариация полей Parameters построчно, 10 x 10 в порядке полей структуры
+using ParameterCovariance = std::array<double, 100>;
+
+// Независимые поля с заданными среднеквадратичными отклонениями (как у ансамбля сценария)
+ParameterCovariance diagonal_covariance(const Parameters& sigma);
+
+struct UnscentedOptions {
+    // Разброс точек sqrt(r + lambda) * sigma, lambda = alpha^2 * (r + kappa) - r;
+    // beta = 2 - поправка веса центральной точки для нормального распределения
+    double alpha = 1.0;
+    double beta = 2.0;
+    double kappa = 0.0;
+    double dt = 0.01;
+    std::size_t max_points = 100000;
+    int threads = 0; // 0 - по числу ядер
+};
+
+// Эллипс на земле: центр, полуоси и угол большой полуоси от оси X к оси Z
+struct ImpactEllipse {
+    double center_x = 0.0, center_z = 0.0;
+    double semi_major = 0.0, semi_minor = 0.0;
+    double angle = 0.0; // рад
+
+    // Точка контура, phase в [0, 2 pi)
+    void point(double phase, double& x, double& z) const;
+};
+
+// Радиус эллипса в сигмах, внутри которого лежит доля probability точек
+// двумерного нормального распределения: sqrt(-2 ln(1 - p)); для 95% - 2.45
+double ellipse_scale(double probability);
+
+struct UnscentedReport {
+    Parameters mean{};
+    std::vector<Parameters> sigma_points;   // первая - среднее, затем пары +/- по направлениям
+    std::vector<FlightSummary> flights;     // итоги полетов сигма-точек
+    std::vector<double> mean_weights;       // веса точек для среднего и для ковариации
+    std::vector<double> covariance_weights;
+    int rank = 0;                           // число направлений разброса r
+    int clamped = 0;                        // точки, приведенные к границам полей
+
+    double impact_x = 0.0, impact_z = 0.0;  // среднее точки падения
+    double cov_xx = 0.0, cov_xz = 0.0, cov_zz = 0.0;
+    double metric_mean[kSweepMetricCount] = {};  // среднее и СКО величин sweep_metric
+    double metric_sigma[kSweepMetricCount] = {};
+    double seconds = 0.0;
+
+    // Эллипс рассеивания точки падения радиусом scale сигм (1 - эллипс одной сигмы)
+    ImpactEllipse ellipse(double scale) const;
+};
+
+UnscentedReport unscented_transform(const Parameters& mean, const ParameterCovariance& covariance,
+                                    const UnscentedOptions& options = {});
+
+#endif // UNSCENTED_H
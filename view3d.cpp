@@ -0,0 +1,1071 @@
+#include "view3d.h"
+#include "trajectory.h"
+#include "trajectorypool.h"
+#include "terrain.h"
+#include "impactmap.h"
+#include "unscented.h"
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkPolyLine.h>
+#include <vtkCellArray.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkActor.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkAxesActor.h>
+#include <vtkNamedColors.h>
+#include <vtkCubeSource.h>
+#include <vtkSphereSource.h>
+#include <vtkArrowSource.h>
+#include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkTextActor.h>
+#include <vtkTextProperty.h>
+#include <vtkCommand.h>
+#include <vtkCallbackCommand.h>
+#include <vtkAnimationCue.h>
+#include <vtkAnimationScene.h>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <vtkButtonWidget.h>
+#include <vtkTexturedButtonRepresentation2D.h>
+#include <vtkTextWidget.h>
+#include <vtkTextRepresentation.h>
+#include <vtkCoordinate.h>
+#include <vtkProperty2D.h>
+#include <vtkCubeAxesActor.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkLookupTable.h>
+#include <vtkScalarBarActor.h>
+#include <vtkImageData.h>
+#include <vtkPlaneSource.h>
+#include <vtkTexture.h>
+#include <algorithm>
+#include <limits>
+
+// Declare a global or class member vtkTextActor for coordinates
+// To be accessed by AnimationCallback
+// Better approach: Pass it via a setter to AnimationCallback instance
+vtkSmartPointer<vtkTextActor> g_coordinatesActor = nullptr;
+
+// Глобальная переменная для хранения максимальных координат, чтобы vtkCubeAxesActor мог их использовать
+double max_coord_x = 10.0, max_coord_y = 10.0, max_coord_z = 10.0;
+
+// Наибольшее число точек траектории в 3D-сцене: 1000 с полета при dt = 0.01
+static constexpr std::size_t kMaxScenePoints = 100000;
+
+// Земля сцены: поверхность загруженного рельефа или плоская плита
+static vtkSmartPointer<vtkActor> CreateGroundActor() {
+    auto groundActor = vtkSmartPointer<vtkActor>::New();
+    std::shared_ptr<const Heightmap> terrain = active_terrain();
+    if (!terrain) {
+        auto ground = vtkSmartPointer<vtkCubeSource>::New();
+        ground->SetXLength(100);
+        ground->SetYLength(0.1);
+        ground->SetZLength(100);
+
+        auto groundMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        groundMapper->SetInputConnection(ground->GetOutputPort());
+        groundActor->SetMapper(groundMapper);
+        groundActor->GetProperty()->SetColor(0.5, 0.5, 0.5);
+        return groundActor;
+    }
+
+    // Большие карты прореживаются до 512 узлов по стороне
+    const int kMaxSide = 512;
+    int stride = std::max(1, (std::max(terrain->cols(), terrain->rows()) + kMaxSide - 2) / (kMaxSide - 1));
+    std::vector<int> columns, rows;
+    for (int i = 0; i < terrain->cols(); i += stride) columns.push_back(i);
+    if (columns.back() != terrain->cols() - 1) columns.push_back(terrain->cols() - 1);
+    for (int j = 0; j < terrain->rows(); j += stride) rows.push_back(j);
+    if (rows.back() != terrain->rows() - 1) rows.push_back(terrain->rows() - 1);
+
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    auto elevation = vtkSmartPointer<vtkDoubleArray>::New();
+    elevation->SetName("Elevation");
+    points->SetNumberOfPoints(static_cast<vtkIdType>(columns.size() * rows.size()));
+    elevation->SetNumberOfValues(points->GetNumberOfPoints());
+    vtkIdType id = 0;
+    for (int j : rows) {
+        for (int i : columns) {
+            double h = terrain->node_height(i, j);
+            points->SetPoint(id, terrain->node_x(i), h, terrain->node_z(j));
+            elevation->SetValue(id, h);
+            ++id;
+        }
+    }
+
+    auto quads = vtkSmartPointer<vtkCellArray>::New();
+    vtkIdType width = static_cast<vtkIdType>(columns.size());
+    for (vtkIdType j = 0; j + 1 < static_cast<vtkIdType>(rows.size()); ++j) {
+        for (vtkIdType i = 0; i + 1 < width; ++i) {
+            vtkIdType quad[4] = { j * width + i, j * width + i + 1, (j + 1) * width + i + 1, (j + 1) * width + i };
+            quads->InsertNextCell(4, quad);
+        }
+    }
+
+    auto surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->SetPoints(points);
+    surface->SetPolys(quads);
+    surface->GetPointData()->SetScalars(elevation);
+
+    // Цвет по высоте: от зеленого в низинах к коричневому на вершинах
+    auto lookupTable = vtkSmartPointer<vtkLookupTable>::New();
+    lookupTable->SetHueRange(0.33, 0.08);
+    lookupTable->SetSaturationRange(0.6, 0.5);
+    lookupTable->SetValueRange(0.55, 0.75);
+    lookupTable->Build();
+
+    auto groundMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    groundMapper->SetInputData(surface);
+    groundMapper->SetLookupTable(lookupTable);
+    groundMapper->SetScalarRange(terrain->min_height(), std::max(terrain->max_height(), terrain->min_height() + 1e-6));
+    groundActor->SetMapper(groundMapper);
+    return groundActor;
+}
+
+// Карта плотности падений: полупрозрачная текстура на плоскости над сеткой карты,
+// на рельефе узлы плоскости поднимаются на его поверхность
+static vtkSmartPointer<vtkActor> CreateImpactMapActor(const ImpactHistogram& histogram) {
+    const ImpactGrid& grid = histogram.grid();
+    std::vector<std::uint32_t> colors = impact_map_colors(histogram);
+
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(grid.nx, grid.nz, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        pixels[4 * i + 0] = static_cast<unsigned char>(colors[i] >> 16);
+        pixels[4 * i + 1] = static_cast<unsigned char>(colors[i] >> 8);
+        pixels[4 * i + 2] = static_cast<unsigned char>(colors[i]);
+        pixels[4 * i + 3] = static_cast<unsigned char>(colors[i] >> 24);
+    }
+    auto texture = vtkSmartPointer<vtkTexture>::New();
+    texture->SetInputData(image);
+    texture->InterpolateOff(); // ячейки гистограммы без размытия
+
+    // Координаты текстуры плоскости: s вдоль X (столбцы), t вдоль Z (строки от z_min)
+    std::shared_ptr<const Heightmap> terrain = active_terrain();
+    auto plane = vtkSmartPointer<vtkPlaneSource>::New();
+    plane->SetOrigin(grid.x_min, 0.0, grid.z_min);
+    plane->SetPoint1(grid.x_max, 0.0, grid.z_min);
+    plane->SetPoint2(grid.x_min, 0.0, grid.z_max);
+    plane->SetResolution(terrain ? 128 : 1, terrain ? 128 : 1);
+    plane->Update();
+
+    auto surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->DeepCopy(plane->GetOutput());
+    vtkPoints* points = surface->GetPoints();
+    const double lift = 0.1; // над плитой земли (ее верх на y = 0.05)
+    for (vtkIdType id = 0; id < points->GetNumberOfPoints(); ++id) {
+        double p[3];
+        points->GetPoint(id, p);
+        p[1] = (terrain ? terrain->height_at(p[0], p[2]) : 0.0) + lift;
+        points->SetPoint(id, p);
+    }
+
+    auto mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData(surface);
+    auto actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper(mapper);
+    actor->SetTexture(texture);
+    actor->GetProperty()->SetLighting(false);
+    return actor;
+}
+
+// Контур эллипса рассеивания замкнутой линией на земле (на рельефе - по его поверхности)
+static vtkSmartPointer<vtkActor> CreateEllipseActor(const ImpactEllipse& ellipse, const double color[3]) {
+    const int kSegments = 128;
+    std::shared_ptr<const Heightmap> terrain = active_terrain();
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    auto outline = vtkSmartPointer<vtkPolyLine>::New();
+    outline->GetPointIds()->SetNumberOfIds(kSegments + 1);
+    const double lift = 0.1; // над плитой земли, как у карты падений
+    for (int k = 0; k < kSegments; ++k) {
+        double x, z;
+        ellipse.point(2.0 * 3.14159265358979 * k / kSegments, x, z);
+        points->InsertNextPoint(x, (terrain ? terrain->height_at(x, z) : 0.0) + lift, z);
+        outline->GetPointIds()->SetId(k, k);
+    }
+    outline->GetPointIds()->SetId(kSegments, 0);
+
+    auto cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->InsertNextCell(outline);
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(points);
+    polyData->SetLines(cells);
+
+    auto mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData(polyData);
+    auto actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper(mapper);
+    actor->GetProperty()->SetColor(color[0], color[1], color[2]);
+    actor->GetProperty()->SetLineWidth(3.0);
+    actor->GetProperty()->SetLighting(false);
+    return actor;
+}
+
+// Класс для обработки анимации
+class AnimationCallback : public vtkCommand {
+public:
+    static AnimationCallback* New() {
+        return new AnimationCallback;
+    }
+
+    void SetSphereActor(vtkActor* actor) {
+        sphereActor = actor;
+    }
+
+    void SetTrajectory(std::shared_ptr<const Trajectory> flight) {
+        trajectory = std::move(flight); // Траектория не копируется, владение совместное
+        currentTime = 0.0;
+        finished = false;
+    }
+
+    void SetRenderWindow(vtkRenderWindow* window) {
+        renderWindow = window;
+    }
+
+    // Секунд полета на кадр; положение между отсчетами интерполируется
+    void SetTimePerFrame(double seconds) {
+        timePerFrame = seconds;
+    }
+
+    void SetRenderer(vtkRenderer* renderer) {
+        this->renderer = renderer;
+    }
+
+    void SetCoordinatesActor(vtkTextActor* actor) {
+        coordinatesActor = actor;
+    }
+
+    void InitializeTrajectoryActors() {
+        // Создаем вектор для хранения акторов отрезков траектории
+        trajectoryActors.clear();
+        points = vtkSmartPointer<vtkPoints>::New();
+        
+        // Добавляем начальную точку
+        const State& start = trajectory->samples().front();
+        points->InsertNextPoint(start.x, start.y, start.z);
+    }
+
+    void Execute(vtkObject* caller, unsigned long eventId, void* callData) override {
+        if (!finished) {
+            State state = trajectory->at(currentTime);
+            
+            // Обновляем положение снаряда
+            sphereActor->SetPosition(state.x, state.y, state.z);
+            
+            // Обновляем текст с координатами снаряда
+            if (coordinatesActor) {
+                std::stringstream ss;
+                ss << std::fixed << std::setprecision(2) 
+                   << "X: " << state.x 
+                   << " Y: " << state.y 
+                   << " Z: " << state.z;
+                coordinatesActor->SetInput(ss.str().c_str());
+            }
+            
+            // Добавляем новую точку в траекторию
+            points->InsertNextPoint(state.x, state.y, state.z);
+            
+            // Создаем полигональные данные для всей траектории до текущей точки
+            auto polyData = vtkSmartPointer<vtkPolyData>::New();
+            polyData->SetPoints(points);
+            
+            // Создаем линию для всей траектории
+            auto line = vtkSmartPointer<vtkPolyLine>::New();
+            line->GetPointIds()->SetNumberOfIds(points->GetNumberOfPoints());
+            for (unsigned int i = 0; i < points->GetNumberOfPoints(); i++) {
+                line->GetPointIds()->SetId(i, i);
+            }
+            
+            auto cells = vtkSmartPointer<vtkCellArray>::New();
+            cells->InsertNextCell(line);
+            polyData->SetLines(cells);
+            
+            // Удаляем предыдущие акторы траектории, если они есть
+            for (auto actor : trajectoryActors) {
+                renderer->RemoveActor(actor);
+            }
+            trajectoryActors.clear();
+            
+            // Создаем новый актор для траектории
+            auto lineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+            lineMapper->SetInputData(polyData);
+            
+            auto lineActor = vtkSmartPointer<vtkActor>::New();
+            lineActor->SetMapper(lineMapper);
+            lineActor->GetProperty()->SetColor(1.0, 0.0, 0.0);
+            lineActor->GetProperty()->SetLineWidth(3.0);
+            
+            renderer->AddActor(lineActor);
+            trajectoryActors.push_back(lineActor);
+            
+            renderWindow->Render();
+            
+            // Последний кадр - точно в момент падения
+            finished = currentTime >= trajectory->duration();
+            currentTime = std::min(currentTime + timePerFrame, trajectory->duration());
+        }
+    }
+
+private:
+    vtkActor* sphereActor = nullptr;
+    vtkRenderWindow* renderWindow = nullptr;
+    vtkRenderer* renderer = nullptr;
+    std::shared_ptr<const Trajectory> trajectory;
+    std::vector<vtkSmartPointer<vtkActor>> trajectoryActors;
+    vtkSmartPointer<vtkPoints> points;
+    double currentTime = 0.0;
+    double timePerFrame = 0.01;
+    bool finished = false;
+    vtkTextActor* coordinatesActor = nullptr; // Член класса для хранения указателя на текстовый актор координат
+};
+
+// Function to close the render window
+class CloseWindowCallback : public vtkCommand {
+public:
+    static CloseWindowCallback* New() {
+        return new CloseWindowCallback;
+    }
+    void Execute(vtkObject* caller, unsigned long eventId, void* callData) override {
+        if (renderWindow) {
+            renderWindow->Finalize(); 
+            if (interactor) {
+                interactor->TerminateApp(); 
+            }
+        }
+    }
+    void SetRenderWindow(vtkRenderWindow* win) {
+        renderWindow = win;
+    }
+    void SetInteractor(vtkRenderWindowInteractor* inter) {
+		interactor = inter;
+	}
+private:
+    vtkRenderWindow* renderWindow = nullptr;
+    vtkRenderWindowInteractor* interactor = nullptr;
+};
+
+static void StartSimulation(Parameters params) {
+    //Parameters params = {
+    //    10.0,    // mass
+    //    0.47,    // Cd
+    //    1.225,   // air_density
+    //    0.1,     // radius
+    //    9.81,    // g
+    //    5.0,     // wind_x
+    //    0.0,     // wind_z
+    //    45.0,    // angle_deg
+    //    50.0,    // initial_speed
+    //    30.0     // azimuth_deg
+    //};
+
+    // Буфер траектории из пула, размер оценен заранее
+    double dt = 0.01;
+    TrajectoryPool::Buffer trajectoryBuffer = simulate_trajectory(params, dt, kMaxScenePoints);
+    const std::vector<State>& states = trajectoryBuffer.states();
+
+    // Находим максимальные и минимальные значения координат для настройки vtkCubeAxesActor (Шаг 1.3)
+    double actual_min_x = 0.0, actual_max_x = 0.0;
+    double actual_min_y = 0.0, actual_max_y = 0.0; // Y всегда от 0, но найдем макс
+    double actual_min_z = 0.0, actual_max_z = 0.0;
+
+    if (!states.empty()) {
+        actual_min_x = states[0].x; actual_max_x = states[0].x;
+        actual_min_y = states[0].y; actual_max_y = states[0].y; // y начинается с 0 или params.initial_height
+        actual_min_z = states[0].z; actual_max_z = states[0].z;
+
+        for (const auto& s_coord : states) {
+            actual_min_x = std::min(actual_min_x, s_coord.x);
+            actual_max_x = std::max(actual_max_x, s_coord.x);
+            actual_min_y = std::min(actual_min_y, s_coord.y); // Хотя обычно y >= 0
+            actual_max_y = std::max(actual_max_y, s_coord.y);
+            actual_min_z = std::min(actual_min_z, s_coord.z);
+            actual_max_z = std::max(actual_max_z, s_coord.z);
+        }
+    }
+    // Добавляем небольшой отступ (padding), чтобы траектория не прилипала к границам
+    double x_range = actual_max_x - actual_min_x;
+    double y_range = actual_max_y - 0; // Y ось обычно от 0
+    double z_range = actual_max_z - actual_min_z;
+    double padding = std::max({x_range, y_range, z_range}) * 0.1 + 1.0; // 10% от макс. диапазона + немного
+
+    actual_min_x -= padding;
+    actual_max_x += padding;
+    actual_max_y += padding; // Нижняя граница Y остается 0 (или params.initial_height если > 0)
+    actual_min_z -= padding;
+    actual_max_z += padding;
+    
+    // Убедимся, что нижняя граница Y не ниже 0
+    actual_min_y = std::min(0.0, actual_min_y); 
+
+    // Создание точек траектории
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    for (const auto& s : states) {
+        points->InsertNextPoint(s.x, s.y, s.z);
+    }
+
+    // Создание линии траектории
+    auto trajectory = vtkSmartPointer<vtkPolyLine>::New();
+    trajectory->GetPointIds()->SetNumberOfIds(points->GetNumberOfPoints());
+    for (unsigned int i = 0; i < points->GetNumberOfPoints(); i++) {
+        trajectory->GetPointIds()->SetId(i, i);
+    }
+
+    // Создание полигональных данных
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(points);
+    auto cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->InsertNextCell(trajectory);
+    polyData->SetLines(cells);
+
+    // Визуализация траектории
+    auto trajectoryMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    trajectoryMapper->SetInputData(polyData);
+
+    auto trajectoryActor = vtkSmartPointer<vtkActor>::New();
+    trajectoryActor->SetMapper(trajectoryMapper);
+    trajectoryActor->GetProperty()->SetColor(1.0, 0.0, 0.0);
+    trajectoryActor->GetProperty()->SetLineWidth(3.0);
+
+    // Создание снаряда
+    auto sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(0.2);
+    sphere->SetCenter(states.back().x, states.back().y, states.back().z);
+
+    auto sphereMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    sphereMapper->SetInputConnection(sphere->GetOutputPort());
+
+    auto sphereActor = vtkSmartPointer<vtkActor>::New();
+    sphereActor->SetMapper(sphereMapper);
+    sphereActor->GetProperty()->SetColor(0.0, 0.0, 1.0);
+
+    // Создание земли
+    auto groundActor = CreateGroundActor();
+
+    // Визуализация ветра
+    auto windArrow = vtkSmartPointer<vtkArrowSource>::New();
+    windArrow->SetTipLength(0.5);
+    windArrow->SetTipRadius(0.1);
+    windArrow->SetShaftRadius(0.05);
+
+    auto windMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    windMapper->SetInputConnection(windArrow->GetOutputPort());
+
+    auto windActor = vtkSmartPointer<vtkActor>::New();
+    windActor->SetMapper(windMapper);
+    windActor->SetPosition(5, 0, 0); // Смещение для видимости
+    windActor->SetScale(params.wind_x, 1, params.wind_z);
+    windActor->SetOrientation(0, 0, 45); // Пример поворота
+    windActor->GetProperty()->SetColor(0.0, 1.0, 0.0);
+    windActor->GetProperty()->SetOpacity(0.5);
+
+    // Добавление осей координат
+    // auto axes = vtkSmartPointer<vtkAxesActor>::New();
+    // axes->SetTotalLength(15, 15, 15);  // Увеличиваем длину осей
+    // axes->AxisLabelsOff(); // Убираем отключение меток, чтобы они отображались
+    // Настройка меток осей (можно настроить цвет, шрифт и т.д. при необходимости)
+    // axes->SetXAxisLabelText("X");
+    // axes->SetYAxisLabelText("Y");
+    // axes->SetZAxisLabelText("Z");
+
+    // Создание текстовых меток
+    auto CreateTextActor = [](const std::string& text, int y_pos) {
+        auto actor = vtkSmartPointer<vtkTextActor>::New();
+        actor->SetInput(text.c_str());
+        actor->SetPosition(10, y_pos);
+        actor->GetTextProperty()->SetFontSize(20);
+        actor->GetTextProperty()->SetColor(0.0, 0.0, 0.0);
+        return actor;
+    };
+
+    double max_height = 0.0;
+    for (const auto& s : states) {
+        if (s.y > max_height) max_height = s.y;
+    }
+    double flight_time = (states.size() - 1) * dt;
+    
+    // Вычисляем дальность полета
+    double distance_x = std::abs(states.back().x - states.front().x);
+    double distance_z = std::abs(states.back().z - states.front().z);
+    double total_distance = std::sqrt(distance_x * distance_x + distance_z * distance_z);
+
+    // Поднимаем все тексты выше, чтобы они были видны
+
+
+    // Настройка рендерера
+    auto colors = vtkSmartPointer<vtkNamedColors>::New();
+    auto renderer = vtkSmartPointer<vtkRenderer>::New();
+    renderer->AddActor(trajectoryActor);
+    renderer->AddActor(sphereActor);
+    renderer->AddActor(groundActor);
+    renderer->AddActor(windActor);
+    // renderer->AddActor(axes); // Закомментировано
+    renderer->SetBackground(1.0, 1.0, 1.0); // Белый фон
+
+    // Создание и настройка vtkCubeAxesActor (Шаг 1.2)
+    auto cubeAxesActor = vtkSmartPointer<vtkCubeAxesActor>::New();
+    cubeAxesActor->SetCamera(renderer->GetActiveCamera()); // Используем камеру рендерера
+    
+    // Настройка внешнего вида (цвета можно взять из colors, если vtkNamedColors используется)
+    // Для примера, пока зададим черным цветом
+    cubeAxesActor->GetTitleTextProperty(0)->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetLabelTextProperty(0)->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetTitleTextProperty(1)->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetLabelTextProperty(1)->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetTitleTextProperty(2)->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetLabelTextProperty(2)->SetColor(0.0, 0.0, 0.0);
+
+    cubeAxesActor->SetXTitle("X (m)");
+    cubeAxesActor->SetYTitle("Y (m)");
+    cubeAxesActor->SetZTitle("Z (m)");
+
+    // Обновляем границы vtkCubeAxesActor (Шаг 1.3)
+    cubeAxesActor->SetBounds(actual_min_x, actual_max_x, actual_min_y, actual_max_y, actual_min_z, actual_max_z); 
+
+    // Настройка отображения сетки (Шаг 1.4)
+    cubeAxesActor->SetFlyModeToOuterEdges(); // Режим отображения осей
+    cubeAxesActor->DrawXGridlinesOn();
+    cubeAxesActor->DrawYGridlinesOn();
+    cubeAxesActor->DrawZGridlinesOn();
+    // Установка цвета сетки (альтернативный способ)
+    cubeAxesActor->GetXAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+    cubeAxesActor->GetYAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+    cubeAxesActor->GetZAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+    // cubeAxesActor->XAxisMinorTickVisibilityOff(); // Опционально: убрать мелкие деления
+    // cubeAxesActor->YAxisMinorTickVisibilityOff();
+    // cubeAxesActor->ZAxisMinorTickVisibilityOff();
+
+    renderer->AddActor(cubeAxesActor); // Добавляем cubeAxesActor к рендереру
+
+    // Add "3D Simulation" label
+    auto simulationLabel = vtkSmartPointer<vtkTextActor>::New();
+    simulationLabel->SetInput("3D Simulation");
+    simulationLabel->GetTextProperty()->SetFontSize(24);
+    simulationLabel->GetTextProperty()->SetColor(0.0, 0.0, 0.0); // Black color
+    simulationLabel->GetTextProperty()->SetJustificationToCentered();
+    // Position label at the top-center of the window. Adjust X as needed.
+    // Assuming window width is 1200, Y position 750 is near the top.
+    simulationLabel->SetPosition(600, 750); 
+    renderer->AddActor2D(simulationLabel);
+    
+    // Настройка окна
+    auto renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+    renderWindow->AddRenderer(renderer);
+    renderWindow->SetSize(1200, 800);
+    renderWindow->SetWindowName("3D Projectile Trajectory");
+    renderWindow->Render();
+
+    // Сброс камеры для охвата всей сцены (Шаг 2)
+    renderer->ResetCamera();
+    renderer->ResetCameraClippingRange();
+
+    // Интерактивный режим
+    auto interactor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
+    interactor->SetRenderWindow(renderWindow);
+
+    auto style = vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
+    interactor->SetInteractorStyle(style);
+
+    // Create "Back to Menu" button
+    auto textRepresentation = vtkSmartPointer<vtkTextRepresentation>::New();
+    textRepresentation->SetText("Back to Menu");
+    // Position and size the button in display coordinates
+    textRepresentation->GetPositionCoordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPositionCoordinate()->SetValue(20, 20); // Bottom-left corner of the button
+    textRepresentation->GetPosition2Coordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPosition2Coordinate()->SetValue(170, 60); // Top-right corner of the button
+
+    textRepresentation->GetTextActor()->GetTextProperty()->SetFontSize(18);
+    textRepresentation->GetTextActor()->GetTextProperty()->SetColor(0.1, 0.1, 0.1); // Dark grey text
+    textRepresentation->GetTextActor()->GetTextProperty()->SetJustificationToCentered();
+    textRepresentation->GetTextActor()->GetTextProperty()->SetVerticalJustificationToCentered();
+    textRepresentation->GetBorderProperty()->SetColor(0.2, 0.2, 0.2); // Darker grey border
+    textRepresentation->SetShowBorder(true);
+
+    auto buttonWidget = vtkSmartPointer<vtkTextWidget>::New();
+    buttonWidget->SetRepresentation(textRepresentation);
+    buttonWidget->SetInteractor(interactor);
+    buttonWidget->SetSelectable(true); 
+    
+    auto closeCallback = vtkSmartPointer<CloseWindowCallback>::New();
+    closeCallback->SetRenderWindow(renderWindow);
+    closeCallback->SetInteractor(interactor);
+    buttonWidget->AddObserver(vtkCommand::EndInteractionEvent, closeCallback); // Use EndInteractionEvent
+
+    buttonWidget->On();
+
+    // // Создаем и настраиваем обработчик анимации
+    // auto animationCallback = vtkSmartPointer<AnimationCallback>::New();
+    // animationCallback->SetSphereActor(sphereActor);
+    // animationCallback->SetTrajectory(std::make_shared<const Trajectory>(trajectory, params, dt));
+    // animationCallback->SetRenderWindow(renderWindow);
+    // animationCallback->SetRenderer(renderer);
+    // animationCallback->SetTimePerFrame(0.02); // Скорость анимации
+    // animationCallback->InitializeTrajectoryActors(); // Инициализируем акторы траектории
+
+    // // Добавляем обработчик таймера
+    // interactor->Initialize(); // This might be needed for the button, let's test. If button fails, uncomment this and comment out the next two.
+    // interactor->AddObserver(vtkCommand::TimerEvent, animationCallback);
+    // int timerId = interactor->CreateRepeatingTimer(30); // 30 мс между кадрами (примерно 33 кадра в секунду)
+
+    // Запускаем интерактор (должен быть после инициализации, если она нужна)
+    interactor->Initialize(); // Ensure interactor is initialized for the button to work.
+    interactor->Start();
+}
+ 
+static void StartAnimatedSimulation(Parameters params) {
+    // Траектория передается в AnimationCallback по общей ссылке, без копирования
+    double dt = 0.01;
+    std::shared_ptr<const std::vector<State>> trajectory = simulate_trajectory(params, dt, kMaxScenePoints).share();
+    const std::vector<State>& states = *trajectory;
+
+    // Находим максимальные и минимальные значения координат для настройки vtkCubeAxesActor (Шаг 2.2)
+    double anim_min_x = 0.0, anim_max_x = 0.0;
+    double anim_min_y = 0.0, anim_max_y = 0.0; 
+    double anim_min_z = 0.0, anim_max_z = 0.0;
+
+    if (!states.empty()) {
+        anim_min_x = states[0].x; anim_max_x = states[0].x;
+        anim_min_y = states[0].y; anim_max_y = states[0].y;
+        anim_min_z = states[0].z; anim_max_z = states[0].z;
+
+        for (const auto& s_coord : states) {
+            anim_min_x = std::min(anim_min_x, s_coord.x);
+            anim_max_x = std::max(anim_max_x, s_coord.x);
+            anim_min_y = std::min(anim_min_y, s_coord.y);
+            anim_max_y = std::max(anim_max_y, s_coord.y);
+            anim_min_z = std::min(anim_min_z, s_coord.z);
+            anim_max_z = std::max(anim_max_z, s_coord.z);
+        }
+    }
+    double x_range_anim = anim_max_x - anim_min_x;
+    double y_range_anim = anim_max_y - 0; 
+    double z_range_anim = anim_max_z - anim_min_z;
+    double padding_anim = std::max({x_range_anim, y_range_anim, z_range_anim}) * 0.1 + 1.0; 
+
+    anim_min_x -= padding_anim;
+    anim_max_x += padding_anim;
+    anim_max_y += padding_anim; 
+    anim_min_z -= padding_anim;
+    anim_max_z += padding_anim;
+    anim_min_y = std::min(0.0, anim_min_y);
+
+    // Создание снаряда
+    auto sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(0.2);
+    sphere->SetCenter(states[0].x, states[0].y, states[0].z); // Начальная позиция
+
+    auto sphereMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    sphereMapper->SetInputConnection(sphere->GetOutputPort());
+
+    auto sphereActor = vtkSmartPointer<vtkActor>::New();
+    sphereActor->SetMapper(sphereMapper);
+    sphereActor->GetProperty()->SetColor(0.0, 0.0, 1.0);
+
+    // Создание земли
+    auto groundActor = CreateGroundActor();
+
+    // Визуализация ветра
+    auto windArrow = vtkSmartPointer<vtkArrowSource>::New();
+    windArrow->SetTipLength(0.5);
+    windArrow->SetTipRadius(0.1);
+    windArrow->SetShaftRadius(0.05);
+
+    auto windMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    windMapper->SetInputConnection(windArrow->GetOutputPort());
+
+    auto windActor = vtkSmartPointer<vtkActor>::New();
+    windActor->SetMapper(windMapper);
+    windActor->SetPosition(5, 0, 0); // Смещение для видимости
+    windActor->SetScale(params.wind_x, 1, params.wind_z);
+    windActor->SetOrientation(0, 0, 45); // Пример поворота
+    windActor->GetProperty()->SetColor(0.0, 1.0, 0.0);
+    windActor->GetProperty()->SetOpacity(0.5);
+
+    // Добавление осей координат
+    // auto axes = vtkSmartPointer<vtkAxesActor>::New();
+    // axes->SetTotalLength(15, 15, 15);  // Увеличиваем длину осей
+    
+    // Настройка меток осей
+    // axes->AxisLabelsOn(); 
+    // axes->SetXAxisLabelText("X");
+    // axes->SetYAxisLabelText("Y");
+    // axes->SetZAxisLabelText("Z");
+
+    // Создание текстовых меток
+    auto CreateTextActor = [](const std::string& text, int y_pos) {
+        auto actor = vtkSmartPointer<vtkTextActor>::New();
+        actor->SetInput(text.c_str());
+        actor->SetPosition(10, y_pos);
+        actor->GetTextProperty()->SetFontSize(20);
+        actor->GetTextProperty()->SetColor(0.0, 0.0, 0.0);
+        return actor;
+    };
+
+    double max_height = 0.0;
+    for (const auto& s : states) {
+        if (s.y > max_height) max_height = s.y;
+    }
+    double flight_time = (states.size() - 1) * dt;
+    
+    // Вычисляем дальность полета
+    double distance_x = std::abs(states.back().x - states.front().x);
+    double distance_z = std::abs(states.back().z - states.front().z);
+    double total_distance = std::sqrt(distance_x * distance_x + distance_z * distance_z);
+
+    // Поднимаем все тексты выше, чтобы они были видны
+
+
+    // Создание текстового актора для координат снаряда (для анимации)
+    g_coordinatesActor = vtkSmartPointer<vtkTextActor>::New();
+    g_coordinatesActor->GetTextProperty()->SetFontSize(18);
+    g_coordinatesActor->GetTextProperty()->SetColor(0.0, 0.0, 0.0); // Черный цвет
+    g_coordinatesActor->SetPosition(20, 80); // Позиция в левом нижнем углу, выше кнопки "Back to menu" и ниже других текстов
+    g_coordinatesActor->SetInput("X: 0.00 Y: 0.00 Z: 0.00"); // Начальный текст
+
+    // Настройка рендерера
+    auto colors = vtkSmartPointer<vtkNamedColors>::New();
+    auto renderer = vtkSmartPointer<vtkRenderer>::New();
+    renderer->AddActor(sphereActor);
+    renderer->AddActor(groundActor);
+    renderer->AddActor(windActor);
+    // renderer->AddActor(axes); // Закомментировано (или удалить, если точно не нужен)
+    renderer->SetBackground(1.0, 1.0, 1.0); // Белый фон
+
+    // Удаляем некорректно добавленный ранее cubeAxesActor, чтобы избежать дублирования
+    // Этот блок нужно будет найти и удалить или изменить, если он был создан ранее в этой функции
+    // ОБРАТИТЕ ВНИМАНИЕ: если предыдущий шаг добавил cubeAxesActor в StartAnimatedSimulation,
+    // этот код нужно адаптировать, чтобы не создавать его дважды, а обновить существующий.
+    // На данном этапе предполагается, что мы его создаем заново здесь корректно.
+
+    // Создание и настройка vtkCubeAxesActor для анимированной симуляции (Шаг 2.2)
+    auto animCubeAxesActor = vtkSmartPointer<vtkCubeAxesActor>::New();
+    animCubeAxesActor->SetCamera(renderer->GetActiveCamera());
+    
+    animCubeAxesActor->GetTitleTextProperty(0)->SetColor(0.0, 0.0, 0.0);
+    animCubeAxesActor->GetLabelTextProperty(0)->SetColor(0.0, 0.0, 0.0);
+    animCubeAxesActor->GetTitleTextProperty(1)->SetColor(0.0, 0.0, 0.0);
+    animCubeAxesActor->GetLabelTextProperty(1)->SetColor(0.0, 0.0, 0.0);
+    animCubeAxesActor->GetTitleTextProperty(2)->SetColor(0.0, 0.0, 0.0);
+    animCubeAxesActor->GetLabelTextProperty(2)->SetColor(0.0, 0.0, 0.0);
+
+    animCubeAxesActor->SetXTitle("X (m)");
+    animCubeAxesActor->SetYTitle("Y (m)");
+    animCubeAxesActor->SetZTitle("Z (m)");
+
+    animCubeAxesActor->SetBounds(anim_min_x, anim_max_x, anim_min_y, anim_max_y, anim_min_z, anim_max_z);
+    
+    animCubeAxesActor->SetFlyModeToOuterEdges();
+    animCubeAxesActor->DrawXGridlinesOn();
+    animCubeAxesActor->DrawYGridlinesOn();
+    animCubeAxesActor->DrawZGridlinesOn();
+    // Установка цвета сетки (альтернативный способ)
+    animCubeAxesActor->GetXAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+    animCubeAxesActor->GetYAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+    animCubeAxesActor->GetZAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0); // Черный
+
+    renderer->AddActor(animCubeAxesActor); // Добавляем настроенный cubeAxesActor
+    renderer->AddActor2D(g_coordinatesActor); // Убедимся, что это добавлено ПОСЛЕ настройки renderer
+
+    // Add "3D Simulation" label
+    auto simulationLabel = vtkSmartPointer<vtkTextActor>::New();
+    simulationLabel->SetInput("3D Simulation");
+    simulationLabel->GetTextProperty()->SetFontSize(24);
+    simulationLabel->GetTextProperty()->SetColor(0.0, 0.0, 0.0); // Black color
+    simulationLabel->GetTextProperty()->SetJustificationToCentered();
+    // Position label at the top-center of the window. Adjust X as needed.
+    simulationLabel->SetPosition(600, 750);
+    renderer->AddActor2D(simulationLabel);
+    
+    // Настройка окна
+    auto renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+    renderWindow->AddRenderer(renderer);
+    renderWindow->SetSize(1200, 800);
+    renderWindow->SetWindowName("3D Projectile Trajectory Animation");
+    renderWindow->Render();
+
+    // Сброс камеры для охвата всей сцены (Шаг 2)
+    renderer->ResetCamera();
+    renderer->ResetCameraClippingRange();
+
+    // Интерактивный режим
+    auto interactor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
+    interactor->SetRenderWindow(renderWindow);
+
+    auto style = vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
+    interactor->SetInteractorStyle(style);
+
+    // Create "Back to Menu" button
+    auto textRepresentation = vtkSmartPointer<vtkTextRepresentation>::New();
+    textRepresentation->SetText("Back to Menu");
+    // Position and size the button in display coordinates
+    textRepresentation->GetPositionCoordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPositionCoordinate()->SetValue(20, 20); // Bottom-left corner of the button
+    textRepresentation->GetPosition2Coordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPosition2Coordinate()->SetValue(170, 60); // Top-right corner of the button
+
+    textRepresentation->GetTextActor()->GetTextProperty()->SetFontSize(18);
+    textRepresentation->GetTextActor()->GetTextProperty()->SetColor(0.1, 0.1, 0.1); // Dark grey text
+    textRepresentation->GetTextActor()->GetTextProperty()->SetJustificationToCentered();
+    textRepresentation->GetTextActor()->GetTextProperty()->SetVerticalJustificationToCentered();
+    textRepresentation->GetBorderProperty()->SetColor(0.2, 0.2, 0.2); // Darker grey border
+    textRepresentation->SetShowBorder(true);
+
+    auto buttonWidget = vtkSmartPointer<vtkTextWidget>::New();
+    buttonWidget->SetRepresentation(textRepresentation);
+    buttonWidget->SetInteractor(interactor);
+    buttonWidget->SetSelectable(true); 
+
+    auto closeCallback = vtkSmartPointer<CloseWindowCallback>::New();
+    closeCallback->SetRenderWindow(renderWindow);
+    closeCallback->SetInteractor(interactor);
+    buttonWidget->AddObserver(vtkCommand::EndInteractionEvent, closeCallback); // Use EndInteractionEvent
+
+    buttonWidget->On();
+
+    // Создаем и настраиваем обработчик анимации
+    auto animationCallback = vtkSmartPointer<AnimationCallback>::New();
+    animationCallback->SetSphereActor(sphereActor);
+    animationCallback->SetTrajectory(std::make_shared<const Trajectory>(trajectory, params, dt));
+    animationCallback->SetRenderWindow(renderWindow);
+    animationCallback->SetRenderer(renderer);
+    animationCallback->SetTimePerFrame(0.02); // Скорость анимации: 0.02 с полета за кадр
+    animationCallback->InitializeTrajectoryActors(); // Инициализируем акторы траектории
+    animationCallback->SetCoordinatesActor(g_coordinatesActor); // Передаем актор координат в callback
+
+    // Добавляем обработчик таймера
+    interactor->Initialize();
+    interactor->AddObserver(vtkCommand::TimerEvent, animationCallback);
+    int timerId = interactor->CreateRepeatingTimer(30); // 30 мс между кадрами (примерно 33 кадра в секунду)
+
+    // Запускаем интерактор
+    interactor->Start();
+}
+
+// Общая сцена наложения траекторий: карта падений и эллипсы рассеивания необязательны
+static void ShowEnsemble(const TrajectoryEnsemble& ensemble, const std::string& metric_name, const ImpactHistogram* impact_map,
+                         const ImpactEllipse* ellipses, int ellipse_count) {
+    if (ensemble.metric.empty()) {
+        return;
+    }
+    vtkIdType numTrajectories = static_cast<vtkIdType>(ensemble.metric.size());
+    vtkIdType numPoints = static_cast<vtkIdType>(ensemble.points.size() / 3);
+
+    // Координаты передаются в VTK без копирования: ensemble живет до закрытия окна
+    auto coords = vtkSmartPointer<vtkDoubleArray>::New();
+    coords->SetNumberOfComponents(3);
+    coords->SetArray(const_cast<double*>(ensemble.points.data()), numPoints * 3, 1);
+
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coords);
+
+    // Все траектории - ячейки одного массива: offsets + connectivity
+    auto offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(numTrajectories + 1);
+    for (vtkIdType i = 0; i <= numTrajectories; i++) {
+        offsets->SetValue(i, static_cast<vtkIdType>(ensemble.offsets[i]));
+    }
+    auto connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(numPoints);
+    for (vtkIdType i = 0; i < numPoints; i++) {
+        connectivity->SetValue(i, i);
+    }
+    auto cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->SetData(offsets, connectivity);
+
+    // Значение метрики на каждую траекторию (данные ячеек)
+    auto scalars = vtkSmartPointer<vtkDoubleArray>::New();
+    scalars->SetName(metric_name.c_str());
+    scalars->SetNumberOfValues(numTrajectories);
+    double metric_min = std::numeric_limits<double>::max();
+    double metric_max = std::numeric_limits<double>::lowest();
+    for (vtkIdType i = 0; i < numTrajectories; i++) {
+        scalars->SetValue(i, ensemble.metric[i]);
+        metric_min = std::min(metric_min, ensemble.metric[i]);
+        metric_max = std::max(metric_max, ensemble.metric[i]);
+    }
+    if (metric_max <= metric_min) {
+        metric_max = metric_min + 1.0;
+    }
+
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(points);
+    polyData->SetLines(cells);
+    polyData->GetCellData()->SetScalars(scalars);
+
+    auto lookupTable = vtkSmartPointer<vtkLookupTable>::New();
+    lookupTable->SetHueRange(0.667, 0.0); // От синего к красному
+    lookupTable->SetTableRange(metric_min, metric_max);
+    lookupTable->Build();
+
+    auto ensembleMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    ensembleMapper->SetInputData(polyData);
+    ensembleMapper->SetScalarModeToUseCellData();
+    ensembleMapper->SetLookupTable(lookupTable);
+    ensembleMapper->SetScalarRange(metric_min, metric_max);
+
+    auto ensembleActor = vtkSmartPointer<vtkActor>::New();
+    ensembleActor->SetMapper(ensembleMapper);
+    ensembleActor->GetProperty()->SetLineWidth(1.5);
+
+    // Шкала значений метрики
+    auto scalarBar = vtkSmartPointer<vtkScalarBarActor>::New();
+    scalarBar->SetLookupTable(lookupTable);
+    scalarBar->SetTitle(metric_name.c_str());
+    scalarBar->SetNumberOfLabels(5);
+    scalarBar->GetTitleTextProperty()->SetColor(0.0, 0.0, 0.0);
+    scalarBar->GetLabelTextProperty()->SetColor(0.0, 0.0, 0.0);
+
+    // Границы для vtkCubeAxesActor с отступом, как в StartSimulation
+    double bounds[6];
+    polyData->GetBounds(bounds);
+    bool showImpactMap = impact_map && impact_map->grid().valid();
+    if (showImpactMap) {
+        bounds[0] = std::min(bounds[0], impact_map->grid().x_min);
+        bounds[1] = std::max(bounds[1], impact_map->grid().x_max);
+        bounds[4] = std::min(bounds[4], impact_map->grid().z_min);
+        bounds[5] = std::max(bounds[5], impact_map->grid().z_max);
+    }
+    for (int e = 0; e < ellipse_count; ++e) {
+        double reach = ellipses[e].semi_major;
+        bounds[0] = std::min(bounds[0], ellipses[e].center_x - reach);
+        bounds[1] = std::max(bounds[1], ellipses[e].center_x + reach);
+        bounds[4] = std::min(bounds[4], ellipses[e].center_z - reach);
+        bounds[5] = std::max(bounds[5], ellipses[e].center_z + reach);
+    }
+    double padding = std::max({bounds[1] - bounds[0], bounds[3], bounds[5] - bounds[4]}) * 0.1 + 1.0;
+    bounds[0] -= padding;
+    bounds[1] += padding;
+    bounds[2] = std::min(0.0, bounds[2]);
+    bounds[3] += padding;
+    bounds[4] -= padding;
+    bounds[5] += padding;
+
+    // Создание земли
+    auto groundActor = CreateGroundActor();
+
+    auto renderer = vtkSmartPointer<vtkRenderer>::New();
+    renderer->AddActor(ensembleActor);
+    renderer->AddActor(groundActor);
+    if (showImpactMap) {
+        renderer->AddActor(CreateImpactMapActor(*impact_map));
+    }
+    // Первый эллипс - синий, следующие - красные
+    const double innerColor[3] = { 0.1, 0.3, 0.9 }, outerColor[3] = { 0.9, 0.15, 0.1 };
+    for (int e = 0; e < ellipse_count; ++e) {
+        renderer->AddActor(CreateEllipseActor(ellipses[e], e == 0 ? innerColor : outerColor));
+    }
+    renderer->AddActor2D(scalarBar);
+    renderer->SetBackground(1.0, 1.0, 1.0); // Белый фон
+
+    auto cubeAxesActor = vtkSmartPointer<vtkCubeAxesActor>::New();
+    cubeAxesActor->SetCamera(renderer->GetActiveCamera());
+    for (int axis = 0; axis < 3; axis++) {
+        cubeAxesActor->GetTitleTextProperty(axis)->SetColor(0.0, 0.0, 0.0);
+        cubeAxesActor->GetLabelTextProperty(axis)->SetColor(0.0, 0.0, 0.0);
+    }
+    cubeAxesActor->SetXTitle("X (m)");
+    cubeAxesActor->SetYTitle("Y (m)");
+    cubeAxesActor->SetZTitle("Z (m)");
+    cubeAxesActor->SetBounds(bounds);
+    cubeAxesActor->SetFlyModeToOuterEdges();
+    cubeAxesActor->DrawXGridlinesOn();
+    cubeAxesActor->DrawYGridlinesOn();
+    cubeAxesActor->DrawZGridlinesOn();
+    cubeAxesActor->GetXAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetYAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0);
+    cubeAxesActor->GetZAxesGridlinesProperty()->SetColor(0.0, 0.0, 0.0);
+    renderer->AddActor(cubeAxesActor);
+
+    std::stringstream label;
+    label << "3D Overlay: " << numTrajectories << " trajectories";
+    if (showImpactMap) {
+        label << ", impact density of " << impact_map->inside() + impact_map->outside() << " flights";
+    }
+    if (ellipse_count > 0) {
+        label << ", " << ellipse_count << " dispersion ellipses";
+    }
+    auto simulationLabel = vtkSmartPointer<vtkTextActor>::New();
+    simulationLabel->SetInput(label.str().c_str());
+    simulationLabel->GetTextProperty()->SetFontSize(24);
+    simulationLabel->GetTextProperty()->SetColor(0.0, 0.0, 0.0);
+    simulationLabel->GetTextProperty()->SetJustificationToCentered();
+    simulationLabel->SetPosition(600, 750);
+    renderer->AddActor2D(simulationLabel);
+
+    // Настройка окна
+    auto renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+    renderWindow->AddRenderer(renderer);
+    renderWindow->SetSize(1200, 800);
+    renderWindow->SetWindowName("3D Trajectory Overlay");
+    renderWindow->Render();
+
+    renderer->ResetCamera();
+    renderer->ResetCameraClippingRange();
+
+    auto interactor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
+    interactor->SetRenderWindow(renderWindow);
+
+    auto style = vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
+    interactor->SetInteractorStyle(style);
+
+    // Create "Back to Menu" button
+    auto textRepresentation = vtkSmartPointer<vtkTextRepresentation>::New();
+    textRepresentation->SetText("Back to Menu");
+    textRepresentation->GetPositionCoordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPositionCoordinate()->SetValue(20, 20);
+    textRepresentation->GetPosition2Coordinate()->SetCoordinateSystemToDisplay();
+    textRepresentation->GetPosition2Coordinate()->SetValue(170, 60);
+    textRepresentation->GetTextActor()->GetTextProperty()->SetFontSize(18);
+    textRepresentation->GetTextActor()->GetTextProperty()->SetColor(0.1, 0.1, 0.1);
+    textRepresentation->GetTextActor()->GetTextProperty()->SetJustificationToCentered();
+    textRepresentation->GetTextActor()->GetTextProperty()->SetVerticalJustificationToCentered();
+    textRepresentation->GetBorderProperty()->SetColor(0.2, 0.2, 0.2);
+    textRepresentation->SetShowBorder(true);
+
+    auto buttonWidget = vtkSmartPointer<vtkTextWidget>::New();
+    buttonWidget->SetRepresentation(textRepresentation);
+    buttonWidget->SetInteractor(interactor);
+    buttonWidget->SetSelectable(true);
+
+    auto closeCallback = vtkSmartPointer<CloseWindowCallback>::New();
+    closeCallback->SetRenderWindow(renderWindow);
+    closeCallback->SetInteractor(interactor);
+    buttonWidget->AddObserver(vtkCommand::EndInteractionEvent, closeCallback);
+
+    buttonWidget->On();
+
+    interactor->Initialize();
+    interactor->Start();
+}
+
+static void StartEnsembleSimulation(const TrajectoryEnsemble& ensemble, const std::string& metric_name, const ImpactHistogram* impact_map) {
+    ShowEnsemble(ensemble, metric_name, impact_map, nullptr, 0);
+}
+
+static void StartUncertaintySimulation(const TrajectoryEnsemble& ensemble, const ImpactEllipse* ellipses, int ellipse_count) {
+    ShowEnsemble(ensemble, "Range (m)", nullptr, ellipses, ellipse_count);
+}
+
+#ifdef _WIN32
+#define VIEW3D_EXPORT __declspec(dllexport)
+#else
+#define VIEW3D_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" VIEW3D_EXPORT const View3DModule* projectile_view3d_module() {
+    static const View3DModule module = { kView3DModuleVersion, StartSimulation, StartAnimatedSimulation, StartEnsembleSimulation,
+                                         StartUncertaintySimulation };
+    return &module;
+}
@@ -0,0 +1,35 @@
+#ifndef VIEW3D_H
+#define VIEW3D_H
+
+#include "simulation.h"
+#include <string>
+
+class ImpactHistogram;
+struct ImpactEllipse;
+
+// 3D-визуализация на VTK собрана отдельным модулем ProjectileTrajectory3D (view3d.cpp),
+// который программа загружает при первом нажатии 3D-кнопок. Без него запуск не загружает
+// библиотеки VTK и не выполняет их автоинициализацию, а 2D-предпросмотр появляется раньше.
+// Физику, рельеф и пул траекторий модуль берет из исполняемого файла (ENABLE_EXPORTS).
+
+constexpr int kView3DModuleVersion = 2;
+
+struct View3DModule {
+    int version;
+    void (*start_simulation)(Parameters params);
+    void (*start_animated_simulation)(Parameters params);
+    // Один актор на все траектории с раскраской по метрике; impact_map - плотность падений текстурой на земле
+    void (*start_ensemble_simulation)(const TrajectoryEnsemble& ensemble, const std::string& metric_name, const ImpactHistogram* impact_map);
+    // Траектории сигма-точек и эллипсы рассеивания точки падения контурами на земле
+    void (*start_uncertainty_simulation)(const TrajectoryEnsemble& ensemble, const ImpactEllipse* ellipses, int ellipse_count);
+};
+
+// Функция модуля extern "C", возвращающая таблицу точек входа
+#define VIEW3D_ENTRY_POINT "projectile_view3d_module"
+using View3DEntryPoint = const View3DModule* (*)();
+
+// Модуль рядом с исполняемым файлом, загружается при первом вызове; nullptr - не удалось (error - причина).
+// load_ms заполняется только вызовом, который загрузил модуль, иначе остается 0
+const View3DModule* view3d_module(std::string* error = nullptr, double* load_ms = nullptr);
+
+#endif // VIEW3D_H
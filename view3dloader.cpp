@@ -0,0 +1,35 @@
+#include "view3d.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLibrary>
+#include <mutex>
+
+const View3DModule* view3d_module(std::string* error, double* load_ms) {
+    static const View3DModule* module = nullptr;
+    static std::string loadError;
+    static std::once_flag once;
+    if (load_ms) {
+        *load_ms = 0.0;
+    }
+    std::call_once(once, [load_ms]() {
+        QElapsedTimer timer;
+        timer.start();
+        // Префикс и расширение библиотеки QLibrary подставляет сам; модуль не выгружается до выхода
+        static QLibrary library(QCoreApplication::applicationDirPath() + "/ProjectileTrajectory3D");
+        auto entry = reinterpret_cast<View3DEntryPoint>(library.resolve(VIEW3D_ENTRY_POINT));
+        if (!entry) {
+            loadError = library.errorString().toStdString();
+        } else if (const View3DModule* candidate = entry(); !candidate || candidate->version != kView3DModuleVersion) {
+            loadError = "модуль 3D-визуализации другой версии";
+        } else {
+            module = candidate;
+        }
+        if (load_ms) {
+            *load_ms = timer.nsecsElapsed() / 1e6;
+        }
+    });
+    if (!module && error) {
+        *error = loadError;
+    }
+    return module;
+}
@@ -0,0 +1,217 @@
+#include "windfield.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(WindFieldHeader) == 96, "WindFieldHeader must match the file layout");
+
+namespace {
+
+constexpr std::uint32_t kBlock = 4;
+constexpr std::size_t kBlockNodes = kBlock * kBlock * kBlock;
+
+std::mutex g_windMutex;
+std::shared_ptr<const WindField> g_activeWindField;
+
+std::uint64_t block_count(std::uint32_t nodes) {
+    return (static_cast<std::uint64_t>(nodes) + kBlock - 1) / kBlock;
+}
+
+// a * b в 64 битах; false при переполнении
+bool checked_multiply(std::uint64_t a, std::uint64_t b, std::uint64_t& product) {
+    if (a != 0 && b > std::numeric_limits<std::uint64_t>::max() / a) {
+        return false;
+    }
+    product = a * b;
+    return true;
+}
+
+// Доля интервала и номер ячейки по одной оси; за пределами сетки - крайний узел
+inline double cell_coordinate(double position, double origin, double inv_step, std::uint32_t last_cell, std::uint32_t& index) {
+    double u = std::clamp((position - origin) * inv_step, 0.0, static_cast<double>(last_cell) + 1.0);
+    index = std::min(static_cast<std::uint32_t>(u), last_cell);
+    return std::min(u - index, 1.0);
+}
+
+} // namespace
+
+std::shared_ptr<WindField> WindField::load(const std::string& path, std::string* error) {
+    auto fail = [error](const std::string& message) -> std::shared_ptr<WindField> {
+        if (error) {
+            *error = message;
+        }
+        return nullptr;
+    };
+
+    std::shared_ptr<WindField> field(new WindField());
+    field->source_path = path;
+
+#ifdef _WIN32
+    int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring wide(length > 0 ? length - 1 : 0, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide.data(), length);
+    HANDLE file = CreateFileW(wide.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return fail("Не удалось открыть файл поля ветра.");
+    }
+    field->file_handle = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(WindFieldHeader))) {
+        return fail("Файл поля ветра короче заголовка.");
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        return fail("Не удалось отобразить файл поля ветра в память.");
+    }
+    field->mapping_handle = mapping;
+    field->mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    field->mapped_size = static_cast<std::size_t>(size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return fail("Не удалось открыть файл поля ветра.");
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(WindFieldHeader))) {
+        close(fd);
+        return fail("Файл поля ветра короче заголовка.");
+    }
+    void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // отображение остается действительным и после закрытия дескриптора
+    if (view != MAP_FAILED) {
+        field->mapping = view;
+        field->mapped_size = static_cast<std::size_t>(status.st_size);
+    }
+#endif
+    if (!field->mapping) {
+        return fail("Не удалось отобразить файл поля ветра в память.");
+    }
+
+    WindFieldHeader& info = field->info;
+    std::memcpy(&info, field->mapping, sizeof(WindFieldHeader));
+    if (std::memcmp(info.magic, "WNDF", 4) != 0 || info.version != 1 || info.block != kBlock) {
+        return fail("Неизвестный формат поля ветра (ожидается WNDF версии 1 с блоками 4x4x4).");
+    }
+    if (info.nx == 0 || info.ny == 0 || info.nz == 0 || info.nt == 0) {
+        return fail("Размеры сетки поля ветра должны быть положительными.");
+    }
+
+    const std::uint32_t nodes[3] = { info.nx, info.ny, info.nz };
+    for (int a = 0; a < 3; ++a) {
+        if (nodes[a] > 1 && !(info.spacing[a] > 0.0)) {
+            return fail("Шаг сетки поля ветра должен быть положительным.");
+        }
+        field->inv_spacing[a] = nodes[a] > 1 ? 1.0 / info.spacing[a] : 0.0;
+        field->last_cell[a] = nodes[a] > 1 ? nodes[a] - 2 : 0;
+    }
+    if (info.nt > 1 && !(info.time_step > 0.0)) {
+        return fail("Интервал между срезами поля ветра должен быть положительным.");
+    }
+    field->inv_time_step = info.nt > 1 ? 1.0 / info.time_step : 0.0;
+    field->last_cell[3] = info.nt > 1 ? info.nt - 2 : 0;
+
+    // Размеры считаются в 64 битах с проверкой переполнения: файл должен содержать ровно
+    // nt срезов из дополненных до 4x4x4 блоков, иначе sample прочитал бы за отображением
+    std::uint64_t blocks = 0, slice_floats = 0, data_floats = 0, data_bytes = 0;
+    if (!checked_multiply(block_count(info.nx), block_count(info.ny), blocks)
+        || !checked_multiply(blocks, block_count(info.nz), blocks)
+        || !checked_multiply(blocks, kBlockNodes * 3, slice_floats)
+        || !checked_multiply(slice_floats, info.nt, data_floats)
+        || !checked_multiply(data_floats, sizeof(float), data_bytes)
+        || data_bytes > std::numeric_limits<std::uint64_t>::max() - sizeof(WindFieldHeader)
+        || data_bytes + sizeof(WindFieldHeader) != static_cast<std::uint64_t>(field->mapped_size)) {
+        return fail("Размер файла поля ветра не совпадает с размерами сетки из заголовка.");
+    }
+    field->blocks_x = static_cast<std::size_t>(block_count(info.nx));
+    field->blocks_y = static_cast<std::size_t>(block_count(info.ny));
+    field->slice_floats = static_cast<std::size_t>(slice_floats);
+    field->samples = reinterpret_cast<const float*>(static_cast<const char*>(field->mapping) + sizeof(WindFieldHeader));
+    return field;
+}
+
+WindField::~WindField() {
+#ifdef _WIN32
+    if (mapping) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle) {
+        CloseHandle(file_handle);
+    }
+#else
+    if (mapping) {
+        munmap(mapping, mapped_size);
+    }
+#endif
+}
+
+std::size_t WindField::node_offset(std::uint32_t i, std::uint32_t j, std::uint32_t k) const {
+    std::size_t block = ((static_cast<std::size_t>(k / kBlock) * blocks_y + j / kBlock) * blocks_x + i / kBlock);
+    std::size_t inner = ((k % kBlock) * kBlock + (j % kBlock)) * kBlock + (i % kBlock);
+    return (block * kBlockNodes + inner) * 3;
+}
+
+void WindField::sample(double x, double y, double z, double t, double wind[3]) const {
+    // Восемь углов ячейки в двух срезах по времени; веса вместо ветвлений на краях сетки:
+    // на последнем узле оси вес соседа равен 0, а его индекс не выходит за сетку
+    std::uint32_t i0, j0, k0, s0;
+    double fx = cell_coordinate(x, info.origin[0], inv_spacing[0], last_cell[0], i0);
+    double fy = cell_coordinate(y, info.origin[1], inv_spacing[1], last_cell[1], j0);
+    double fz = cell_coordinate(z, info.origin[2], inv_spacing[2], last_cell[2], k0);
+    double ft = cell_coordinate(t, info.t0, inv_time_step, last_cell[3], s0);
+    std::uint32_t i1 = std::min(i0 + 1, info.nx - 1);
+    std::uint32_t j1 = std::min(j0 + 1, info.ny - 1);
+    std::uint32_t k1 = std::min(k0 + 1, info.nz - 1);
+    std::uint32_t s1 = std::min(s0 + 1, info.nt - 1);
+
+    const std::size_t corners[8] = {
+        node_offset(i0, j0, k0), node_offset(i1, j0, k0), node_offset(i0, j1, k0), node_offset(i1, j1, k0),
+        node_offset(i0, j0, k1), node_offset(i1, j0, k1), node_offset(i0, j1, k1), node_offset(i1, j1, k1)
+    };
+    const double weights[8] = {
+        (1 - fx) * (1 - fy) * (1 - fz), fx * (1 - fy) * (1 - fz), (1 - fx) * fy * (1 - fz), fx * fy * (1 - fz),
+        (1 - fx) * (1 - fy) * fz, fx * (1 - fy) * fz, (1 - fx) * fy * fz, fx * fy * fz
+    };
+    const float* slice0 = samples + s0 * slice_floats;
+    const float* slice1 = samples + s1 * slice_floats;
+
+    double w0[3] = { 0.0, 0.0, 0.0 }, w1[3] = { 0.0, 0.0, 0.0 };
+    for (int c = 0; c < 8; ++c) {
+        for (int a = 0; a < 3; ++a) {
+            w0[a] += weights[c] * slice0[corners[c] + a];
+            w1[a] += weights[c] * slice1[corners[c] + a];
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        wind[a] = w0[a] + ft * (w1[a] - w0[a]);
+    }
+}
+
+std::shared_ptr<const WindField> active_wind_field() {
+    std::lock_guard<std::mutex> lock(g_windMutex);
+    return g_activeWindField;
+}
+
+void set_active_wind_field(std::shared_ptr<const WindField> field) {
+    std::lock_guard<std::mutex> lock(g_windMutex);
+    g_activeWindField = std::move(field);
+}
@@ -0,0 +1,72 @@
+#ifndef WINDFIELD_H
+#define WINDFIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Заголовок бинарного файла поля ветра (little-endian, 96 байт).
+// За заголовком идут nt срезов по времени. Срез разбит на блоки 4x4x4 узла
+// (порядок блоков: z, y, x, x быстрее всего), внутри блока узлы в порядке k, j, i.
+// Узел - три float: скорость ветра вдоль X, Y, Z (м/с). Неполные блоки на краях
+// дополняются до 4x4x4. Профиль ветра по высоте - частный случай nx = nz = 1.
+struct WindFieldHeader {
+    char magic[4];            // "WNDF"
+    std::uint32_t version;    // 1
+    std::uint32_t nx, ny, nz; // число узлов по осям
+    std::uint32_t nt;         // число срезов по времени (1 - стационарное поле)
+    std::uint32_t block;      // сторона блока, всегда 4
+    std::uint32_t reserved;
+    double origin[3];         // координаты узла (0, 0, 0), м
+    double spacing[3];        // шаг сетки по осям, м
+    double t0;                // время первого среза, с
+    double time_step;         // интервал между срезами, с
+};
+
+// Поле ветра на регулярной сетке, отображенное в память без чтения и копирования.
+// Между узлами скорость интерполируется трилинейно (и линейно по времени),
+// за пределами сетки берется значение на ее границе.
+class WindField {
+public:
+    static std::shared_ptr<WindField> load(const std::string& path, std::string* error = nullptr);
+
+    ~WindField();
+    WindField(const WindField&) = delete;
+    WindField& operator=(const WindField&) = delete;
+
+    const WindFieldHeader& header() const { return info; }
+    // Путь к отображенному файлу
+    const std::string& source() const { return source_path; }
+
+    // Скорость ветра в точке (x, y, z) в момент t
+    void sample(double x, double y, double z, double t, double wind[3]) const;
+
+private:
+    WindField() = default;
+
+    std::size_t node_offset(std::uint32_t i, std::uint32_t j, std::uint32_t k) const;
+
+    WindFieldHeader info{};
+    std::string source_path;
+    double inv_spacing[3] = { 0.0, 0.0, 0.0 }; // 0 для осей из одного узла
+    double inv_time_step = 0.0;
+    std::uint32_t last_cell[4] = { 0, 0, 0, 0 }; // последняя ячейка по x, y, z, t
+    std::size_t blocks_x = 0, blocks_y = 0;
+    std::size_t slice_floats = 0;
+    const float* samples = nullptr;
+
+    // Отображение файла в память
+    void* mapping = nullptr;
+    std::size_t mapped_size = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+// Текущее поле ветра (nullptr - постоянный ветер из параметров)
+std::shared_ptr<const WindField> active_wind_field();
+void set_active_wind_field(std::shared_ptr<const WindField> field);
+
+#endif // WINDFIELD_H
@@ -0,0 +1,262 @@
+#include "workprecision.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr double kReferenceStep = 1e-4;
+constexpr std::size_t kMaxSteps = 20000000;
+// Минимальное время замера одной конфигурации на сценарий, чтобы короткие расчеты
+// не упирались в разрешение часов
+constexpr double kMinTimingSeconds = 2e-3;
+
+State add_scaled(const State& s, double h, const State& d) {
+    return { s.x + h * d.x, s.y + h * d.y, s.z + h * d.z,
+             s.vx + h * d.vx, s.vy + h * d.vy, s.vz + h * d.vz };
+}
+
+// Таблица Бутчера явного метода: a[i][j] - коэффициенты стадий, b - веса решения
+struct Tableau {
+    int stages;
+    double a[7][7];
+    double b[7];
+};
+
+const Tableau& tableau(Integrator integrator) {
+    static const Tableau euler = { 1, {}, { 1.0 } };
+    static const Tableau heun = { 2, { {}, { 1.0 } }, { 0.5, 0.5 } };
+    static const Tableau kutta3 = { 3, { {}, { 0.5 }, { -1.0, 2.0 } }, { 1.0 / 6.0, 2.0 / 3.0, 1.0 / 6.0 } };
+    static const Tableau rk4 = { 4, { {}, { 0.5 }, { 0.0, 0.5 }, { 0.0, 0.0, 1.0 } },
+                                 { 1.0 / 6.0, 1.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0 } };
+    static const Tableau dopri5 = { 7,
+        { {},
+          { 1.0 / 5.0 },
+          { 3.0 / 40.0, 9.0 / 40.0 },
+          { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0 },
+          { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0 },
+          { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0 },
+          { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 } },
+        { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0, 0.0 } };
+    switch (integrator) {
+        case Integrator::Euler: return euler;
+        case Integrator::Heun: return heun;
+        case Integrator::Kutta3: return kutta3;
+        case Integrator::RK4: return rk4;
+        case Integrator::DormandPrince5: return dopri5;
+    }
+    return rk4;
+}
+
+// Один шаг явного метода. Седьмая стадия Дорманда - Принса нужна только для оценки
+// ошибки (b[6] == 0) и при постоянном шаге не считается - 6 вычислений правой части на шаг
+struct Stepper {
+    const Tableau& t;
+    const Parameters& params;
+    std::size_t evaluations = 0;
+
+    State step(const State& s, double h) {
+        State k[7];
+        int used = t.stages;
+        while (used > 1 && t.b[used - 1] == 0.0) {
+            --used;
+        }
+        for (int i = 0; i < used; ++i) {
+            State stage = s;
+            for (int j = 0; j < i; ++j) {
+                if (t.a[i][j] != 0.0) {
+                    stage = add_scaled(stage, h * t.a[i][j], k[j]);
+                }
+            }
+            k[i] = compute_derivatives(stage, params);
+        }
+        evaluations += used;
+        State next = s;
+        for (int i = 0; i < used; ++i) {
+            if (t.b[i] != 0.0) {
+                next = add_scaled(next, h * t.b[i], k[i]);
+            }
+        }
+        return next;
+    }
+};
+
+FlightMetrics production_metrics(const Parameters& params, Stepper& stepper, double dt) {
+    // Тот же критерий, что в integrate_flight_summary над плоской землей
+    State state = initial_state(params);
+    State last = state;
+    FlightMetrics metrics;
+    std::size_t count = 0;
+    do {
+        last = state;
+        metrics.apex = std::max(metrics.apex, state.y);
+        state = stepper.step(state, dt);
+        ++count;
+    } while (state.y + dt * state.vy >= 0.0 && count < kMaxSteps);
+    metrics.range = std::sqrt(last.x * last.x + last.z * last.z);
+    metrics.time = (count - 1) * dt;
+    metrics.evaluations = stepper.evaluations;
+    return metrics;
+}
+
+double relative_error(double value, double reference) {
+    return std::abs(value - reference) / std::max(std::abs(reference), 1e-12);
+}
+
+} // namespace
+
+const char* integrator_name(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::Euler: return "Euler";
+        case Integrator::Heun: return "Heun (RK2)";
+        case Integrator::Kutta3: return "Kutta (RK3)";
+        case Integrator::RK4: return "RK4";
+        case Integrator::DormandPrince5: return "Dormand-Prince (RK5)";
+    }
+    return "?";
+}
+
+std::vector<NamedScenario> reference_scenarios() {
+    //        mass   Cd    rho    r      g     wx  wz  angle speed azimuth
+    return {
+        { "Навесной",       { 10.0, 0.47, 1.225, 0.1,  9.81, 5.0, 0.0, 60.0, 120.0, 30.0 } },
+        { "Настильный",     { 20.0, 0.30, 1.225, 0.08, 9.81, 0.0, 0.0, 10.0, 400.0, 0.0 } },
+        { "Легкий снаряд",  { 0.45, 0.47, 1.225, 0.11, 9.81, 3.0, 2.0, 35.0, 30.0, 0.0 } },
+        { "Почти вакуум",   { 10.0, 0.47, 0.01,  0.1,  9.81, 0.0, 0.0, 45.0, 50.0, 0.0 } },
+        { "Боковой ветер",  { 5.0,  0.47, 1.225, 0.1,  9.81, 0.0, 15.0, 45.0, 80.0, 0.0 } },
+    };
+}
+
+FlightMetrics integrate_metrics(const Parameters& params, Integrator integrator, double dt, bool production_stop) {
+    Stepper stepper{ tableau(integrator), params };
+    if (production_stop) {
+        return production_metrics(params, stepper, dt);
+    }
+
+    FlightMetrics metrics;
+    State state = initial_state(params);
+    for (std::size_t count = 0; count < kMaxSteps; ++count) {
+        // Наклон координат на концах шага - скорости, дополнительных вычислений не нужно
+        State next = stepper.step(state, dt);
+
+        metrics.apex = std::max(metrics.apex, state.y);
+        if (state.vy > 0.0 && next.vy <= 0.0) {
+            double s = bisect_unit([&](double u) { return hermite_slope(state.y, next.y, state.vy, next.vy, dt, u); });
+            metrics.apex = std::max(metrics.apex, hermite(state.y, next.y, state.vy, next.vy, dt, s));
+        }
+
+        if (next.y < 0.0) {
+            double s = bisect_unit([&](double u) { return hermite(state.y, next.y, state.vy, next.vy, dt, u); });
+            double x = hermite(state.x, next.x, state.vx, next.vx, dt, s);
+            double z = hermite(state.z, next.z, state.vz, next.vz, dt, s);
+            metrics.range = std::sqrt(x * x + z * z);
+            metrics.time = (count + s) * dt;
+            break;
+        }
+        state = next;
+        metrics.time = (count + 1) * dt;
+    }
+    metrics.evaluations = stepper.evaluations;
+    return metrics;
+}
+
+double WorkPrecisionPoint::max_error() const {
+    return std::max({ range_error, apex_error, time_error });
+}
+
+std::vector<double> default_step_sizes() {
+    return { 0.2, 0.1, 0.05, 0.02, 0.01, 0.005, 0.002, 0.001 };
+}
+
+WorkPrecisionReport run_work_precision(const std::vector<NamedScenario>& scenarios, const std::vector<double>& steps,
+                                       const std::vector<double>& targets) {
+    using Clock = std::chrono::steady_clock;
+    WorkPrecisionReport report;
+    if (scenarios.empty()) {
+        return report;
+    }
+
+    std::vector<FlightMetrics> reference;
+    reference.reserve(scenarios.size());
+    for (const NamedScenario& scenario : scenarios) {
+        reference.push_back(integrate_metrics(scenario.params, Integrator::DormandPrince5, kReferenceStep, false));
+    }
+
+    auto measure = [&](Integrator integrator, double dt, bool production_stop) {
+        WorkPrecisionPoint point;
+        point.integrator = integrator;
+        point.production_stop = production_stop;
+        point.dt = dt;
+        for (std::size_t i = 0; i < scenarios.size(); ++i) {
+            FlightMetrics metrics;
+            std::size_t runs = 0;
+            Clock::time_point start = Clock::now();
+            double elapsed = 0.0;
+            do {
+                metrics = integrate_metrics(scenarios[i].params, integrator, dt, production_stop);
+                ++runs;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < kMinTimingSeconds);
+
+            point.range_error = std::max(point.range_error, relative_error(metrics.range, reference[i].range));
+            point.apex_error = std::max(point.apex_error, relative_error(metrics.apex, reference[i].apex));
+            point.time_error = std::max(point.time_error, relative_error(metrics.time, reference[i].time));
+            point.evaluations += static_cast<double>(metrics.evaluations);
+            point.seconds += elapsed / runs;
+        }
+        point.evaluations /= scenarios.size();
+        point.seconds /= scenarios.size();
+        report.points.push_back(point);
+    };
+
+    for (int i = 0; i < kIntegratorCount; ++i) {
+        for (double dt : steps) {
+            measure(static_cast<Integrator>(i), dt, false);
+        }
+    }
+    // Текущий расчет: RK4 с остановкой в последней точке над землей
+    for (double dt : steps) {
+        measure(Integrator::RK4, dt, true);
+    }
+
+    for (double target : targets) {
+        WorkPrecisionRecommendation recommendation;
+        recommendation.target = target;
+        for (const WorkPrecisionPoint& point : report.points) {
+            if (point.max_error() > target) {
+                continue;
+            }
+            if (!recommendation.found || point.seconds < recommendation.point.seconds) {
+                recommendation.point = point;
+                recommendation.found = true;
+            }
+        }
+        report.recommendations.push_back(recommendation);
+    }
+    return report;
+}
+
+std::string work_precision_csv(const WorkPrecisionReport& report) {
+    std::string csv = "integrator,stop,dt,range_error,apex_error,time_error,evaluations,seconds\n";
+    char line[256];
+    for (const WorkPrecisionPoint& p : report.points) {
+        std::snprintf(line, sizeof(line), "%s,%s,%g,%.6e,%.6e,%.6e,%.1f,%.6e\n",
+                      integrator_name(p.integrator), p.production_stop ? "last-above-ground" : "interpolated",
+                      p.dt, p.range_error, p.apex_error, p.time_error, p.evaluations, p.seconds);
+        csv += line;
+    }
+    // Рекомендации - комментариями, чтобы таблица оставалась читаемой как CSV
+    for (const WorkPrecisionRecommendation& r : report.recommendations) {
+        if (!r.found) {
+            std::snprintf(line, sizeof(line), "# target %.0e: no configuration within tolerance\n", r.target);
+        } else {
+            const WorkPrecisionPoint& p = r.point;
+            std::snprintf(line, sizeof(line), "# target %.0e: %s,%s,dt=%g,max_error=%.2e,evaluations=%.0f,seconds=%.3e\n",
+                          r.target, integrator_name(p.integrator), p.production_stop ? "last-above-ground" : "interpolated",
+                          p.dt, p.max_error(), p.evaluations, p.seconds);
+        }
+        csv += line;
+    }
+    return csv;
+}
@@ -0,0 +1,79 @@
+#ifndef WORKPRECISION_H
+#define WORKPRECISION_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Сравнение интеграторов и шагов по точности и стоимости (диаграмма "работа - точность").
+// Каждая конфигурация считает набор эталонных сценариев; ошибки дальности, высоты апогея
+// и времени полета берутся относительно решения Дорманда - Принса с шагом 1e-4. Расчет идет над плоской
+// землей с постоянным ветром из параметров, загруженные рельеф и поле ветра не учитываются.
+
+enum class Integrator {
+    Euler,          // явный Эйлер, 1-й порядок
+    Heun,           // Хойна (RK2), 2-й порядок
+    Kutta3,         // RK3 Кутты, 3-й порядок
+    RK4,            // классический RK4, 4-й порядок (как в расчете траектории)
+    DormandPrince5  // Дорманда - Принса с фиксированным шагом, 5-й порядок
+};
+
+constexpr int kIntegratorCount = 5;
+const char* integrator_name(Integrator integrator);
+
+struct NamedScenario {
+    std::string name;
+    Parameters params;
+};
+
+// Каталог эталонных выстрелов (навесной, настильный, легкий снаряд, почти вакуум, боковой ветер)
+std::vector<NamedScenario> reference_scenarios();
+
+struct FlightMetrics {
+    double range = 0.0;
+    double apex = 0.0;
+    double time = 0.0;
+    std::size_t evaluations = 0; // вычислений правой части
+};
+
+// production_stop: остановка как в integrate_flight_summary (последняя точка над землей);
+// иначе момент падения и апогей уточняются кубической интерполяцией Эрмита внутри шага
+FlightMetrics integrate_metrics(const Parameters& params, Integrator integrator, double dt, bool production_stop);
+
+struct WorkPrecisionPoint {
+    Integrator integrator = Integrator::RK4;
+    bool production_stop = false;
+    double dt = 0.0;
+    // Наибольшие по сценариям относительные ошибки
+    double range_error = 0.0;
+    double apex_error = 0.0;
+    double time_error = 0.0;
+    double evaluations = 0.0; // в среднем на полет
+    double seconds = 0.0;     // время счета в среднем на полет
+
+    double max_error() const;
+};
+
+struct WorkPrecisionRecommendation {
+    double target = 0.0; // допустимая относительная ошибка
+    bool found = false;
+    WorkPrecisionPoint point; // самая быстрая конфигурация, укладывающаяся в допуск
+};
+
+struct WorkPrecisionReport {
+    std::vector<WorkPrecisionPoint> points;
+    std::vector<WorkPrecisionRecommendation> recommendations;
+};
+
+std::vector<double> default_step_sizes();
+
+WorkPrecisionReport run_work_precision(const std::vector<NamedScenario>& scenarios,
+                                       const std::vector<double>& steps = default_step_sizes(),
+                                       const std::vector<double>& targets = { 1e-2, 1e-3, 1e-4, 1e-6 });
+
+// Таблица CSV: integrator,stop,dt,range_error,apex_error,time_error,evaluations,seconds;
+// за ней строки комментариев "# target ..." с самой быстрой конфигурацией для каждого допуска
+std::string work_precision_csv(const WorkPrecisionReport& report);
+
+#endif // WORKPRECISION_H